@@ -1,12 +1,18 @@
 #include "PixelPaintView.hpp"
+#include "core/ImageImport.hpp"
+#include "core/ProjectFile.hpp"
 #include "export/ImageExporter.hpp"
 #include "export/MeshExporter.hpp"
+#include "export/SvgPathExport.hpp"
 #include "ui/Widgets.hpp"
 #include "tools/DrawingAlgorithms.hpp"
+#include "tools/Filters.hpp"
 #include <iostream>
 #include <fstream>
+#include <cctype>
 #include <cmath>
 #include <algorithm>
+#include <bit>
 #include <cstdlib>
 #include <cstring>
 #include <queue>
@@ -16,9 +22,6 @@
 #include <iomanip>
 #include <filesystem>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
-
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
@@ -47,17 +50,32 @@ namespace pelpaint {
 using pelpaint::exporter::ImageExporter;
 using pelpaint::exporter::MeshExporter;
 using pelpaint::exporter::MeshExportOptions;
+using pelpaint::exporter::MeshFileFormat;
 using pelpaint::exporter::MeshMode;
 
 
 
 namespace fs = std::filesystem;
 
+namespace {
+
+[[nodiscard]] constexpr ColorMatchMode MatchMode(bool perceptual) noexcept
+{
+    return perceptual ? ColorMatchMode::Oklab : ColorMatchMode::Rgb;
+}
+
+[[nodiscard]] constexpr exporter::RectMergeMode MergeMode(bool nearMinimal) noexcept
+{
+    return nearMinimal ? exporter::RectMergeMode::NearMinimal : exporter::RectMergeMode::Rows;
+}
+
+} // namespace
+
 void PixelPaintView::IOSOpenFileCallback(void* context, const char* filepath)
 {
     if (!context || !filepath) return;
     auto* view = static_cast<PixelPaintView*>(context);
-    view->LoadFromImage(filepath);
+    view->OpenFile(filepath);
 }
 
 // Constructor
@@ -94,6 +112,8 @@ PixelPaintView::PixelPaintView()
     // canvas_ already initialised its default layers in Canvas::Canvas().
     LoadLastDirectory();
 
+    autosaveLeftovers_ = core::LeftoverAutosaves(AutosaveDirectory());
+
     // Initial snapshot
     undo_.Push(canvas_.MakeSnapshot("Initial state"));
 }
@@ -104,6 +124,15 @@ PixelPaintView::PixelPaintView()
 // Destructor
 PixelPaintView::~PixelPaintView()
 {
+    // A clean exit leaves nothing to recover.
+    if (autosave_) autosave_->Discard();
+    for (const std::string& journal : autosaveRecovered_) {
+        std::error_code ec;
+        fs::remove(journal, ec);
+        fs::remove(journal + ".part", ec);
+    }
+    filterPreview_.Cancel();
+    DestroyPreviewTexture();
     DestroyTexture();
 }
 
@@ -134,45 +163,27 @@ void PixelPaintView::ReorderLayers(int fromIndex, int toIndex)
 
 // ---------------------------------------------------------------------------
 // CompositeLayers — kept for export functions that need a flat RGBA buffer.
-// Reads from canvas_.Layers() (no canvasData involved).
+// Copies the full canvas composite, so adjustment layers are included.
 // ---------------------------------------------------------------------------
 
-void PixelPaintView::CompositeLayers(std::vector<pelpaint::Pixel>& output) const
+void PixelPaintView::CompositeLayers(std::vector<pelpaint::Pixel>& output)
 {
-    // Start with opaque canvas background.
-    output.assign(static_cast<std::size_t>(canvasWidth) * canvasHeight,
-                  pelpaint::Pixel{30, 30, 30, 255});
-
-    // Sort layers by z-index, composite bottom to top.
-    std::vector<const Layer*> sortedLayers;
-    for (const auto& layer : canvas_.Layers()) sortedLayers.push_back(&layer);
-    std::sort(sortedLayers.begin(), sortedLayers.end(),
-              [](const Layer* a, const Layer* b) { return a->zIndex < b->zIndex; });
+    canvas_.Composite();
+    const core::ImageView view = canvas_.CompositeSurface().Flatten();
 
-    for (const auto* layer : sortedLayers) {
-        if (!layer->visible) continue;
-        for (std::size_t i = 0; i < output.size(); ++i) {
-            const pelpaint::Pixel& src = layer->pixelData[i];
-            if (src.a == 0) continue;
-            float alpha = (src.a / 255.0f) * layer->opacity;
-            float inv   = 1.0f - alpha;
-            output[i].r = static_cast<uint8_t>(output[i].r * inv + src.r * alpha);
-            output[i].g = static_cast<uint8_t>(output[i].g * inv + src.g * alpha);
-            output[i].b = static_cast<uint8_t>(output[i].b * inv + src.b * alpha);
-            output[i].a = std::max(output[i].a,
-                                    static_cast<uint8_t>(src.a * layer->opacity));
-        }
-    }
+    output.resize(static_cast<std::size_t>(canvasWidth) * canvasHeight);
+    if (!view.valid() || output.empty()) return;
+    std::memcpy(output.data(), view.data, output.size() * sizeof(pelpaint::Pixel));
 }
 
 // ---------------------------------------------------------------------------
-// RenderLayerToCanvas — force an immediate composite + texture refresh.
-// Normal drawing path uses the per-frame IsDirty check in Draw() instead.
+// RenderLayerToCanvas — invalidate every composite tile and refresh the
+// texture.  Normal drawing path marks only the touched tiles instead.
 // ---------------------------------------------------------------------------
 
 void PixelPaintView::RenderLayerToCanvas()
 {
-    canvas_.Composite();
+    canvas_.SetDirty();
     textureNeedsUpdate = true;
 }
 
@@ -328,7 +339,7 @@ void PixelPaintView::PutPixel(int x, int y, const pelpaint::Pixel& color)
 }
 
 // Get pixel from active layer
-pelpaint::Pixel PixelPaintView::GetPixel(int x, int y) const
+pelpaint::Pixel PixelPaintView::GetPixel(int x, int y)
 {
     return canvas_.GetPixel(x, y);
 }
@@ -452,115 +463,55 @@ float PixelPaintView::ColorDistance(const pelpaint::Pixel& c1,
 // Find nearest palette color
 pelpaint::Pixel PixelPaintView::FindNearestPaletteColor(const pelpaint::Pixel& color, const std::vector<pelpaint::Pixel>& palette) const
 {
-    if (palette.empty()) return color;
-
-    pelpaint::Pixel nearest = palette[0];
-    float minDistance = ColorDistance(color, palette[0]);
-
-    for (const auto& paletteColor : palette) {
-        float distance = ColorDistance(color, paletteColor);
-        if (distance < minDistance) {
-            minDistance = distance;
-            nearest = paletteColor;
-        }
-    }
-
-    return nearest;
+    return tools::FindNearestColor(color, palette);
 }
 
-void PixelPaintView::DiffuseError(int x, int y, int errorR, int errorG, int errorB, int spreadX, int spreadY, int divisor, int totalWeight)
+std::span<const pelpaint::Pixel> PixelPaintView::CurrentFilterPalette() const noexcept
 {
-    Layer* activeLayer = GetActiveLayer();
-    if (!activeLayer) return;
-
-    // Spread the error to neighboring pixels in the active layer
-    for (int dy = -spreadY; dy <= spreadY; ++dy) {
-        for (int dx = -spreadX; dx <= spreadX; ++dx) {
-            if (dx == 0 && dy == 0) continue; // Skip the current pixel
-
-            int nx = x + dx;
-            int ny = y + dy;
-
-            if (IsValidCoord(nx, ny)) {
-                pelpaint::Pixel& neighbor = activeLayer->pixelData[GetPixelIndex(nx, ny)];
-                // Apply clamped error diffusion to avoid overflow/underflow
-                neighbor.r = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.r) + (errorR * divisor) / totalWeight, 0, 255));
-                neighbor.g = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.g) + (errorG * divisor) / totalWeight, 0, 255));
-                neighbor.b = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.b) + (errorB * divisor) / totalWeight, 0, 255));
-            }
-        }
-    }
+    if (!customPalette.empty()) return customPalette;
+    if (selectedPaletteIndex >= 0 && selectedPaletteIndex < static_cast<int>(availablePalettes.size()))
+        return availablePalettes[selectedPaletteIndex].colors;
+    return {};
 }
 
-
 // Apply palette
 void PixelPaintView::ApplyPalette(const std::vector<pelpaint::Pixel>& palette)
 {
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    for (auto& pixel : activeLayer->pixelData) {
-        pixel = FindNearestPaletteColor(pixel, palette);
-    }
+    tools::ApplyPalette(activeLayer->pixelData, palette, MatchMode(paletteMatchPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Apply palette");
 }
 
-// Floyd-Steinberg dithering
-void PixelPaintView::ApplyFloydSteinbergDithering(const std::vector<pelpaint::Pixel>& palette)
+void PixelPaintView::ExtractPaletteFromLayer()
 {
-    Layer* activeLayer = GetActiveLayer();
+    const Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    std::vector<pelpaint::Pixel> tempData = activeLayer->pixelData;
-
-    for (int y = 0; y < canvasHeight; ++y) {
-        for (int x = 0; x < canvasWidth; ++x) {
-            pelpaint::Pixel oldPixel = tempData[GetPixelIndex(x, y)];
-            pelpaint::Pixel newPixel = FindNearestPaletteColor(oldPixel, palette);
+    tools::PaletteExtractOptions options;
+    options.method           = static_cast<tools::PaletteExtractMethod>(paletteExtractMethod);
+    options.colors           = paletteExtractColors;
+    options.refineIterations = paletteExtractRefine ? 4 : 0;
 
-            if (ditheringPreserveAlpha) {
-                newPixel.a = oldPixel.a;
-            }
-
-            tempData[GetPixelIndex(x, y)] = newPixel;
-
-            int errorR = static_cast<int>(oldPixel.r) - static_cast<int>(newPixel.r);
-            int errorG = static_cast<int>(oldPixel.g) - static_cast<int>(newPixel.g);
-            int errorB = static_cast<int>(oldPixel.b) - static_cast<int>(newPixel.b);
-
-            if (x + 1 < canvasWidth) {
-                pelpaint::Pixel& neighbor = tempData[GetPixelIndex(x + 1, y)];
-                neighbor.r = std::clamp(static_cast<int>(neighbor.r) + errorR * 7 / 16, 0, 255);
-                neighbor.g = std::clamp(static_cast<int>(neighbor.g) + errorG * 7 / 16, 0, 255);
-                neighbor.b = std::clamp(static_cast<int>(neighbor.b) + errorB * 7 / 16, 0, 255);
-            }
-
-            if (y + 1 < canvasHeight) {
-                if (x - 1 >= 0) {
-                    pelpaint::Pixel& neighbor = tempData[GetPixelIndex(x - 1, y + 1)];
-                    neighbor.r = std::clamp(static_cast<int>(neighbor.r) + errorR * 3 / 16, 0, 255);
-                    neighbor.g = std::clamp(static_cast<int>(neighbor.g) + errorG * 3 / 16, 0, 255);
-                    neighbor.b = std::clamp(static_cast<int>(neighbor.b) + errorB * 3 / 16, 0, 255);
-                }
+    std::vector<Pixel> palette = tools::ExtractPalette(activeLayer->pixelData, options);
+    if (palette.empty()) return;   // fully transparent layer
 
-                pelpaint::Pixel& neighbor = tempData[GetPixelIndex(x, y + 1)];
-                neighbor.r = std::clamp(static_cast<int>(neighbor.r) + errorR * 5 / 16, 0, 255);
-                neighbor.g = std::clamp(static_cast<int>(neighbor.g) + errorG * 5 / 16, 0, 255);
-                neighbor.b = std::clamp(static_cast<int>(neighbor.b) + errorB * 5 / 16, 0, 255);
+    customPalette  = std::move(palette);
+    paletteEnabled = true;
+}
 
-                if (x + 1 < canvasWidth) {
-                    pelpaint::Pixel& neighbor = tempData[GetPixelIndex(x + 1, y + 1)];
-                    neighbor.r = std::clamp(static_cast<int>(neighbor.r) + errorR * 1 / 16, 0, 255);
-                    neighbor.g = std::clamp(static_cast<int>(neighbor.g) + errorG * 1 / 16, 0, 255);
-                    neighbor.b = std::clamp(static_cast<int>(neighbor.b) + errorB * 1 / 16, 0, 255);
-                }
-            }
-        }
-    }
+// Floyd-Steinberg dithering
+void PixelPaintView::ApplyFloydSteinbergDithering(const std::vector<pelpaint::Pixel>& palette)
+{
+    Layer* activeLayer = GetActiveLayer();
+    if (!activeLayer) return;
 
-    activeLayer->pixelData = tempData;
+    tools::ApplyFloydSteinbergDithering(activeLayer->pixelData, canvasWidth, canvasHeight,
+                                        palette, ditheringPreserveAlpha,
+                                        MatchMode(ditheringPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Apply dithering");
@@ -600,11 +551,7 @@ void PixelPaintView::ConvertToGrayscale()
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    // Convert active layer to grayscale
-    for (auto& pixel : activeLayer->pixelData) {
-        int gray = static_cast<int>(0.299 * pixel.r + 0.587 * pixel.g + 0.114 * pixel.b);
-        pixel.r = pixel.g = pixel.b = gray;
-    }
+    tools::ConvertToGrayscale(activeLayer->pixelData);
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Convert to grayscale");
@@ -616,94 +563,33 @@ void PixelPaintView::ApplyAtkinsonDithering(const std::vector<pelpaint::Pixel>&
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    // Iterate over each pixel in the canvas
-    for (int y = 0; y < canvasHeight; ++y) {
-        for (int x = 0; x < canvasWidth; ++x) {
-            pelpaint::Pixel& currentPixel = activeLayer->pixelData[GetPixelIndex(x, y)];
-            pelpaint::Pixel closestColor = FindNearestPaletteColor(currentPixel, palette);
-
-            // Calculate the error
-            int errorR = currentPixel.r - closestColor.r;
-            int errorG = currentPixel.g - closestColor.g;
-            int errorB = currentPixel.b - closestColor.b;
-
-            // Apply the closest color
-            currentPixel = closestColor;
-
-            // Diffuse the error to neighboring pixels
-            DiffuseError(x, y, errorR, errorG, errorB, 1, 1, 1, 8); // Atkinson pattern
-        }
-    }
+    tools::ApplyAtkinsonDithering(activeLayer->pixelData, canvasWidth, canvasHeight, palette,
+                                  MatchMode(ditheringPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
 }
 
 
-
 void PixelPaintView::ApplyStuckiDithering(const std::vector<pelpaint::Pixel>& palette)
 {
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    // Iterate over each pixel in the canvas
-    for (int y = 0; y < canvasHeight; ++y) {
-        for (int x = 0; x < canvasWidth; ++x) {
-            pelpaint::Pixel& currentPixel = activeLayer->pixelData[GetPixelIndex(x, y)];
-            pelpaint::Pixel closestColor = FindNearestPaletteColor(currentPixel, palette);
-
-            // Calculate the error
-            int errorR = currentPixel.r - closestColor.r;
-            int errorG = currentPixel.g - closestColor.g;
-            int errorB = currentPixel.b - closestColor.b;
-
-            // Apply the closest color
-            currentPixel = closestColor;
-
-            // Diffuse the error to neighboring pixels
-            DiffuseError(x, y, errorR, errorG, errorB, 2, 2, 2, 42); // Stucki pattern
-        }
-    }
+    tools::ApplyStuckiDithering(activeLayer->pixelData, canvasWidth, canvasHeight, palette,
+                                MatchMode(ditheringPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
 }
 
 
-
 // Ordered dithering
 void PixelPaintView::ApplyOrderedDithering(const std::vector<pelpaint::Pixel>& palette)
 {
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    const int ditherPatternSize = 4;
-    const int ditherPattern[4][4] = {
-        {0, 8, 2, 10},
-        {12, 4, 14, 6},
-        {3, 11, 1, 9},
-        {15, 7, 13, 5}
-    };
-
-    for (int y = 0; y < canvasHeight; ++y) {
-        for (int x = 0; x < canvasWidth; ++x) {
-            pelpaint::Pixel pixel = activeLayer->pixelData[GetPixelIndex(x, y)];
-            int ditherValue = ditherPattern[y % ditherPatternSize][x % ditherPatternSize];
-
-            pelpaint::Pixel ditheredPixel;
-            ditheredPixel.r = std::clamp(static_cast<int>(pixel.r) + ditherValue - 8, 0, 255);
-            ditheredPixel.g = std::clamp(static_cast<int>(pixel.g) + ditherValue - 8, 0, 255);
-            ditheredPixel.b = std::clamp(static_cast<int>(pixel.b) + ditherValue - 8, 0, 255);
-            ditheredPixel.a = pixel.a;
-
-            pelpaint::Pixel quantized = FindNearestPaletteColor(ditheredPixel, palette);
-
-            if (ditheringPreserveAlpha) {
-                quantized.a = pixel.a;
-            }
-
-            activeLayer->pixelData[GetPixelIndex(x, y)] = quantized;
-        }
-    }
-
+    tools::ApplyOrderedDithering(activeLayer->pixelData, canvasWidth, canvasHeight,
+                                 palette, ditheringPreserveAlpha, MatchMode(ditheringPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Apply ordered dithering");
@@ -715,57 +601,13 @@ void PixelPaintView::ApplyPixelify(int pixelSize, bool usePalette)
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer || pixelSize < 1) return;
 
-    // Create output buffer
-    std::vector<pelpaint::Pixel> result = activeLayer->pixelData;
-
     // Get the palette to use for quantization
     const std::vector<pelpaint::Pixel>& palette = customPalette.empty() ? availablePalettes[selectedPaletteIndex].colors : customPalette;
 
-    // Process the image in blocks
-    for (int blockY = 0; blockY < canvasHeight; blockY += pixelSize) {
-        for (int blockX = 0; blockX < canvasWidth; blockX += pixelSize) {
-            // Calculate block bounds
-            int maxX = std::min(blockX + pixelSize, canvasWidth);
-            int maxY = std::min(blockY + pixelSize, canvasHeight);
-
-            // Average the colors in this block
-            int sumR = 0, sumG = 0, sumB = 0, sumA = 0;
-            int pixelCount = 0;
-
-            for (int y = blockY; y < maxY; ++y) {
-                for (int x = blockX; x < maxX; ++x) {
-                    pelpaint::Pixel p = activeLayer->pixelData[GetPixelIndex(x, y)];
-                    sumR += p.r;
-                    sumG += p.g;
-                    sumB += p.b;
-                    sumA += p.a;
-                    pixelCount++;
-                }
-            }
-
-            // Calculate average color
-            pelpaint::Pixel averageColor;
-            averageColor.r = static_cast<uint8_t>(sumR / pixelCount);
-            averageColor.g = static_cast<uint8_t>(sumG / pixelCount);
-            averageColor.b = static_cast<uint8_t>(sumB / pixelCount);
-            averageColor.a = static_cast<uint8_t>(sumA / pixelCount);
-
-            // Apply palette quantization if enabled
-            if (usePalette && !palette.empty()) {
-                averageColor = FindNearestPaletteColor(averageColor, palette);
-            }
-
-            // Fill the block with the averaged (and possibly quantized) color
-            for (int y = blockY; y < maxY; ++y) {
-                for (int x = blockX; x < maxX; ++x) {
-                    result[GetPixelIndex(x, y)] = averageColor;
-                }
-            }
-        }
-    }
-
-    // Apply the result to the active layer
-    activeLayer->pixelData = result;
+    tools::ApplyPixelify(activeLayer->pixelData, canvasWidth, canvasHeight, pixelSize,
+                         usePalette ? std::span<const pelpaint::Pixel>(palette)
+                                    : std::span<const pelpaint::Pixel>(),
+                         MatchMode(pixelifyPerceptual));
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Pixelify");
@@ -909,119 +751,398 @@ void PixelPaintView::ApplyShapeRedrawFilter()
     Layer* activeLayer = GetActiveLayer();
     if (!activeLayer) return;
 
-    const int blockSize = std::max(1, shapeRedrawFilterBlockSize);
-    const int padding   = std::max(0, shapeRedrawFilterPadding);
     const std::vector<pelpaint::Pixel>& palette =
         customPalette.empty() ? availablePalettes[selectedPaletteIndex].colors : customPalette;
 
+    tools::ShapeRedrawParams params;
+    params.mode      = shapeRedrawFilterMode;
+    params.blockSize = std::max(1, shapeRedrawFilterBlockSize);
+    params.padding   = std::max(0, shapeRedrawFilterPadding);
+    params.customMap = shapeRedrawCustomMap;
+    params.match     = MatchMode(shapeRedrawFilterPerceptual);
+    if (shapeRedrawFilterUsePalette) params.palette = palette;
+
     // Determine background pixel
-    pelpaint::Pixel bgPixel;
     switch (shapeRedrawBgMode) {
-        case ShapeRedrawBgMode::Black: bgPixel = pelpaint::Pixel(0,   0,   0,   255); break;
-        case ShapeRedrawBgMode::White: bgPixel = pelpaint::Pixel(255, 255, 255, 255); break;
-        case ShapeRedrawBgMode::Alpha: bgPixel = pelpaint::Pixel(0,   0,   0,   0);   break;
-    }
-
-    // Work on a fresh output buffer, initialized to the background color
-    std::vector<pelpaint::Pixel> result(canvasWidth * canvasHeight, bgPixel);
-
-    for (int blockY = 0; blockY < canvasHeight; blockY += blockSize) {
-        for (int blockX = 0; blockX < canvasWidth; blockX += blockSize) {
-            int maxX = std::min(blockX + blockSize, canvasWidth);
-            int maxY = std::min(blockY + blockSize, canvasHeight);
-
-            // Average color of this block
-            int sumR = 0, sumG = 0, sumB = 0, sumA = 0, count = 0;
-            for (int y = blockY; y < maxY; ++y) {
-                for (int x = blockX; x < maxX; ++x) {
-                    pelpaint::Pixel p = activeLayer->pixelData[GetPixelIndex(x, y)];
-                    sumR += p.r; sumG += p.g; sumB += p.b; sumA += p.a;
-                    ++count;
-                }
-            }
-            if (count == 0) continue;
-
-            pelpaint::Pixel avgColor;
-            avgColor.r = static_cast<uint8_t>(sumR / count);
-            avgColor.g = static_cast<uint8_t>(sumG / count);
-            avgColor.b = static_cast<uint8_t>(sumB / count);
-            avgColor.a = static_cast<uint8_t>(sumA / count);
-
-            if (shapeRedrawFilterUsePalette && !palette.empty()) {
-                avgColor = FindNearestPaletteColor(avgColor, palette);
-            }
-
-            // Inner drawable area: block minus padding on all sides
-            int innerX0 = blockX + padding;
-            int innerY0 = blockY + padding;
-            int innerX1 = maxX  - padding;
-            int innerY1 = maxY  - padding;
-            if (innerX1 <= innerX0 || innerY1 <= innerY0) continue;
-
-            int innerW = innerX1 - innerX0;
-            int innerH = innerY1 - innerY0;
-            int cx = innerX0 + innerW / 2;
-            int cy = innerY0 + innerH / 2;
-            int radius = std::min(innerW, innerH) / 2;
-
-            switch (shapeRedrawFilterMode) {
-                case ShapeRedrawFilterMode::Square: {
-                    for (int y = innerY0; y < innerY1; ++y) {
-                        for (int x = innerX0; x < innerX1; ++x) {
-                            if (x >= 0 && x < canvasWidth && y >= 0 && y < canvasHeight)
-                                result[GetPixelIndex(x, y)] = avgColor;
-                        }
-                    }
-                    break;
-                }
-                case ShapeRedrawFilterMode::Dot: {
-                    for (int dy = -radius; dy <= radius; ++dy) {
-                        for (int dx = -radius; dx <= radius; ++dx) {
-                            if (dx * dx + dy * dy <= radius * radius) {
-                                int px = cx + dx, py = cy + dy;
-                                if (px >= 0 && px < canvasWidth && py >= 0 && py < canvasHeight)
-                                    result[GetPixelIndex(px, py)] = avgColor;
-                            }
-                        }
-                    }
-                    break;
-                }
-                case ShapeRedrawFilterMode::Custom: {
-                    // Stamp the 8x8 custom map, scaled to fit innerW x innerH
-                    for (int row = 0; row < 8; ++row) {
-                        for (int col = 0; col < 8; ++col) {
-                            if (!shapeRedrawCustomMap[row * 8 + col]) continue;
-                            int px = innerX0 + (col * innerW) / 8;
-                            int py = innerY0 + (row * innerH) / 8;
-                            int pw = std::max(1, innerW / 8);
-                            int ph = std::max(1, innerH / 8);
-                            for (int oy = 0; oy < ph; ++oy) {
-                                for (int ox = 0; ox < pw; ++ox) {
-                                    int fx = px + ox, fy = py + oy;
-                                    if (fx >= 0 && fx < canvasWidth && fy >= 0 && fy < canvasHeight)
-                                        result[GetPixelIndex(fx, fy)] = avgColor;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                }
-            }
-        }
+        case ShapeRedrawBgMode::Black: params.bgColor = pelpaint::Pixel(0,   0,   0,   255); break;
+        case ShapeRedrawBgMode::White: params.bgColor = pelpaint::Pixel(255, 255, 255, 255); break;
+        case ShapeRedrawBgMode::Alpha: params.bgColor = pelpaint::Pixel(0,   0,   0,   0);   break;
     }
 
-    activeLayer->pixelData = result;
+    tools::ApplyShapeRedraw(activeLayer->pixelData, canvasWidth, canvasHeight, params);
     canvas_.SetDirty();
     textureNeedsUpdate = true;
     PushUndo("Shape Redraw Filter");
 }
 
+// -----------------------------------------------------------------------
+// Color adjust — levels / grayscale / posterize / palette / alpha cutoff
+// composed into one ColorPipeline, so the layer is read and written once
+// however many operations are enabled.
+// -----------------------------------------------------------------------
+tools::ColorPipeline PixelPaintView::BuildColorPipeline() const
+{
+    tools::ColorPipeline pipeline;
+    if (colorOpLevels)         pipeline.Levels(colorOpInBlack, colorOpInWhite, colorOpGamma);
+    if (colorOpGrayscale)      pipeline.Grayscale();
+    if (colorOpPosterize)      pipeline.Posterize(colorOpPosterizeLevels);
+    if (colorOpPaletteMap)     pipeline.PaletteMap(CurrentFilterPalette(), MatchMode(paletteMatchPerceptual));
+    if (colorOpAlphaThreshold) pipeline.AlphaThreshold(colorOpAlphaCutoff);
+    return pipeline;
+}
+
+void PixelPaintView::ApplyColorPipeline()
+{
+    Layer* activeLayer = GetActiveLayer();
+    if (!activeLayer) return;
+
+    const tools::ColorPipeline pipeline = BuildColorPipeline();
+    if (pipeline.Empty()) return;
+
+    pipeline.Apply(activeLayer->pixelData);
+    canvas_.SetDirty();
+    textureNeedsUpdate = true;
+    PushUndo("Color adjust");
+}
+
+// -----------------------------------------------------------------------
+// Adjustment layers
+//
+// Parameters live in the layer stack; Canvas evaluates them per composite
+// tile, so edits only recompute the tiles on screen and an undo step
+// restores parameters rather than rewritten pixels.
+// -----------------------------------------------------------------------
+void PixelPaintView::AddAdjustmentLayer(AdjustmentType type)
+{
+    Adjustment adjustment;
+    adjustment.type          = type;
+    adjustment.blockSize     = pixelifySize;
+    adjustment.preserveAlpha = ditheringPreserveAlpha;
+    adjustment.match         = MatchMode(type == AdjustmentType::OrderedDither ? ditheringPerceptual
+                                       : type == AdjustmentType::Pixelify      ? pixelifyPerceptual
+                                                                               : paletteMatchPerceptual);
+
+    const auto palette = CurrentFilterPalette();
+    if (type != AdjustmentType::Grayscale && (type != AdjustmentType::Pixelify || pixelifyUsePalette))
+        adjustment.palette.assign(palette.begin(), palette.end());
+
+    const char* name = "Adjustment";
+    switch (type) {
+        case AdjustmentType::Grayscale:     name = "Grayscale";      break;
+        case AdjustmentType::PaletteMap:    name = "Palette Map";    break;
+        case AdjustmentType::OrderedDither: name = "Ordered Dither"; break;
+        case AdjustmentType::Pixelify:      name = "Pixelify";       break;
+        case AdjustmentType::None:          return;
+    }
+
+    canvas_.AddAdjustmentLayer(adjustment, name);
+    textureNeedsUpdate = true;
+    PushAdjustmentUndo("Add adjustment layer");
+}
+
+void PixelPaintView::DrawAdjustmentLayerEditor()
+{
+    const Adjustment* current = canvas_.ActiveAdjustment();
+    if (!current) {
+        ImGui::TextDisabled("Select an adjustment layer to edit it.");
+        return;
+    }
+
+    Adjustment edited = *current;
+    const int  index  = canvas_.ActiveLayerIndex();
+
+    ImGui::Text("Editing: %s", canvas_.Layers()[index].name.c_str());
+
+    if (edited.type != AdjustmentType::Grayscale) {
+        ImGui::Text("Palette: %zu colors", edited.palette.size());
+        if (ImGui::Button("Use Current Palette##adj", ImVec2(-1, 0))) {
+            const auto palette = CurrentFilterPalette();
+            edited.palette.assign(palette.begin(), palette.end());
+        }
+        if (edited.type == AdjustmentType::Pixelify && !edited.palette.empty() &&
+            ImGui::Button("Clear Palette##adj", ImVec2(-1, 0))) {
+            edited.palette.clear();
+        }
+    }
+
+    if (edited.type != AdjustmentType::Grayscale) {
+        bool perceptual = edited.match == ColorMatchMode::Oklab;
+        if (ImGui::Checkbox("Perceptual Match##adj", &perceptual)) edited.match = MatchMode(perceptual);
+    }
+
+    if (edited.type == AdjustmentType::OrderedDither) {
+        ImGui::Checkbox("Preserve Alpha##adj", &edited.preserveAlpha);
+    }
+
+    if (edited.type == AdjustmentType::Pixelify) {
+        // Power-of-two sizes keep every block inside one 64×64 composite tile.
+        const char* blockNames[] = { "1", "2", "4", "8", "16", "32", "64" };
+        int blockIndex = std::countr_zero(static_cast<unsigned>(std::max(1, edited.blockSize)));
+        if (ImGui::Combo("Block Size##adj", &blockIndex, blockNames, IM_ARRAYSIZE(blockNames))) {
+            edited.blockSize = 1 << blockIndex;
+        }
+    }
+
+    if (!(edited == *current)) {
+        canvas_.SetAdjustment(index, edited);
+        textureNeedsUpdate = true;
+        PushAdjustmentUndo("Edit adjustment layer");
+    }
+}
+
+// -----------------------------------------------------------------------
+// Live filter preview
+//
+// The proxy is a nearest-neighbour downsample of the active layer sized to
+// the on-screen canvas, so the worker never touches more pixels than are
+// visible.  Block-based filters scale their block size / padding by the
+// proxy ratio so the preview matches the full-resolution Apply result.
+// -----------------------------------------------------------------------
+
+PixelPaintView::FilterPreviewKey PixelPaintView::MakeFilterPreviewKey(int proxyW, int proxyH) const
+{
+    FilterPreviewKey key;
+    key.filter       = previewFilterIndex;
+    key.proxyW       = proxyW;
+    key.proxyH       = proxyH;
+    key.paletteIndex = selectedPaletteIndex;
+    key.paletteSize  = CurrentFilterPalette().size();
+
+    switch (previewFilterIndex) {
+        case 0:
+            key.perceptual = paletteMatchPerceptual;
+            break;
+        case 1:
+            key.perceptual          = ditheringPerceptual;
+            key.ditherMethod        = selectedDitheringMethod;
+            key.ditherPreserveAlpha = ditheringPreserveAlpha;
+            key.ditherGrayscale     = selectedDitheringMethod == 1 ? atkinsonGrayscaleToMono
+                                    : selectedDitheringMethod == 2 ? stuckiGrayscaleToMono
+                                                                   : grayscaleToMono;
+            break;
+        case 2:
+            key.pixelifySize       = pixelifySize;
+            key.pixelifyUsePalette = pixelifyUsePalette;
+            key.perceptual         = pixelifyPerceptual;
+            break;
+        case 3:
+            key.shapeMode       = static_cast<int>(shapeRedrawFilterMode);
+            key.shapeBgMode     = static_cast<int>(shapeRedrawBgMode);
+            key.shapeBlock      = shapeRedrawFilterBlockSize;
+            key.shapePadding    = shapeRedrawFilterPadding;
+            key.shapeUsePalette = shapeRedrawFilterUsePalette;
+            key.shapeCustomMap  = shapeRedrawCustomMap;
+            key.perceptual      = shapeRedrawFilterPerceptual;
+            break;
+        default:
+            break;
+    }
+    return key;
+}
+
+tools::FilterPreviewWorker::FilterFn
+PixelPaintView::MakePreviewFilter(const FilterPreviewKey& key, float proxyScale) const
+{
+    // The worker outlives this frame — capture everything by value.
+    const auto palSpan = CurrentFilterPalette();
+    std::vector<pelpaint::Pixel> palette(palSpan.begin(), palSpan.end());
+
+    auto scaled = [proxyScale](int v, int minValue) {
+        return std::max(minValue, static_cast<int>(std::lround(static_cast<float>(v) * proxyScale)));
+    };
+
+    const ColorMatchMode match = MatchMode(key.perceptual);
+
+    switch (key.filter) {
+        case 0:
+            return [palette = std::move(palette), match](std::span<pelpaint::Pixel> px, int, int,
+                                                         const std::atomic<bool>* cancel) {
+                tools::ApplyPalette(px, palette, match, cancel);
+            };
+
+        case 1:
+            return [palette = std::move(palette), key, match](std::span<pelpaint::Pixel> px, int w, int h,
+                                                              const std::atomic<bool>* cancel) {
+                if (palette.empty()) return;
+                if (key.ditherGrayscale) tools::ConvertToGrayscale(px, cancel);
+                switch (key.ditherMethod) {
+                    case 1:  tools::ApplyAtkinsonDithering(px, w, h, palette, match, cancel); break;
+                    case 2:  tools::ApplyStuckiDithering(px, w, h, palette, match, cancel);   break;
+                    case 3:  tools::ApplyOrderedDithering(px, w, h, palette, key.ditherPreserveAlpha, match, cancel); break;
+                    default: tools::ApplyFloydSteinbergDithering(px, w, h, palette, key.ditherPreserveAlpha, match, cancel); break;
+                }
+            };
+
+        case 2: {
+            const int blockSize = scaled(key.pixelifySize, 1);
+            if (!key.pixelifyUsePalette) palette.clear();
+            return [palette = std::move(palette), blockSize, match](std::span<pelpaint::Pixel> px, int w, int h,
+                                                                    const std::atomic<bool>* cancel) {
+                tools::ApplyPixelify(px, w, h, blockSize, palette, match, cancel);
+            };
+        }
+
+        case 3: {
+            tools::ShapeRedrawParams params;
+            params.mode      = static_cast<ShapeRedrawFilterMode>(key.shapeMode);
+            params.blockSize = scaled(key.shapeBlock, 1);
+            params.padding   = key.shapePadding > 0 ? scaled(key.shapePadding, 1) : 0;
+            params.customMap = key.shapeCustomMap;
+            params.match     = match;
+            switch (static_cast<ShapeRedrawBgMode>(key.shapeBgMode)) {
+                case ShapeRedrawBgMode::Black: params.bgColor = pelpaint::Pixel(0,   0,   0,   255); break;
+                case ShapeRedrawBgMode::White: params.bgColor = pelpaint::Pixel(255, 255, 255, 255); break;
+                case ShapeRedrawBgMode::Alpha: params.bgColor = pelpaint::Pixel(0,   0,   0,   0);   break;
+            }
+            if (!key.shapeUsePalette) palette.clear();
+            return [palette = std::move(palette), params](std::span<pelpaint::Pixel> px, int w, int h,
+                                                          const std::atomic<bool>* cancel) mutable {
+                params.palette = palette;   // re-point at the captured copy
+                tools::ApplyShapeRedraw(px, w, h, params, cancel);
+            };
+        }
+
+        default:
+            return {};
+    }
+}
+
+void PixelPaintView::UpdateFilterPreview()
+{
+    if (!showFilterPreview) return;
+
+    const Layer* activeLayer = GetActiveLayer();
+    if (!activeLayer || canvasWidth <= 0 || canvasHeight <= 0) return;
+
+    // The proxy covers the visible part of the canvas, padded by a filter
+    // block (at least a tile) so neighbourhood filters have context at the
+    // edges, and snapped to that block so block filters keep the grid they
+    // have on the full layer.  It matches the on-screen size, capped at 1:1.
+    const int block = std::max({ 64,
+                                 previewFilterIndex == 2 ? pixelifySize : 0,
+                                 previewFilterIndex == 3 ? shapeRedrawFilterBlockSize : 0 });
+    const CanvasRect& visible = visibleCanvasRect_;
+    if (visible.x0 >= visible.x1 || visible.y0 >= visible.y1) return;
+    CanvasRect region;
+    region.x0 = std::max(0, (visible.x0 / block - 1) * block);
+    region.y0 = std::max(0, (visible.y0 / block - 1) * block);
+    region.x1 = std::min(canvasWidth,  ((visible.x1 + block - 1) / block + 1) * block);
+    region.y1 = std::min(canvasHeight, ((visible.y1 + block - 1) / block + 1) * block);
+    const int regionW = region.x1 - region.x0;
+    const int regionH = region.y1 - region.y0;
+
+    const int proxyMaxW = std::clamp(static_cast<int>(std::ceil(regionW * canvasScale)), 1, regionW);
+    const int proxyMaxH = std::clamp(static_cast<int>(std::ceil(regionH * canvasScale)), 1, regionH);
+
+    FilterPreviewKey key = MakeFilterPreviewKey(proxyMaxW, proxyMaxH);
+    key.region = region;
+    if (!previewStale_ && key == lastPreviewKey_) return;
+
+    tools::PreviewImage proxy;
+    tools::BuildPreviewProxy(activeLayer->pixelData, canvasWidth, canvasHeight,
+                             region.x0, region.y0, regionW, regionH,
+                             proxyMaxW, proxyMaxH, proxy);
+    if (!proxy.valid()) return;
+
+    const float proxyScale = static_cast<float>(proxy.width) / static_cast<float>(regionW);
+    filterPreview_.Submit(std::move(proxy), MakePreviewFilter(key, proxyScale));
+
+    lastPreviewKey_ = key;
+    previewStale_   = false;
+}
+
+void PixelPaintView::UpdatePreviewTexture()
+{
+    tools::PreviewImage result;
+    if (!filterPreview_.TakeResult(result) || !result.valid()) return;
+
+#if defined(USE_METAL_BACKEND)
+    @autoreleasepool {
+        id<MTLDevice> device = (__bridge id<MTLDevice>)metalDevice;
+        if (!device) return;
+
+        const bool needsAlloc = (previewMetalTexture == nullptr)
+                             || (previewTextureWidth  != result.width)
+                             || (previewTextureHeight != result.height);
+        if (needsAlloc) {
+            DestroyPreviewTexture();
+            MTLTextureDescriptor* desc =
+                [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA8Unorm
+                                                                   width:result.width
+                                                                  height:result.height
+                                                               mipmapped:NO];
+            desc.usage = MTLTextureUsageShaderRead;
+            id<MTLTexture> tex = [device newTextureWithDescriptor:desc];
+            previewMetalTexture  = (void*)tex;
+            previewTextureWidth  = result.width;
+            previewTextureHeight = result.height;
+        }
+
+        id<MTLTexture> tex = (id<MTLTexture>)previewMetalTexture;
+        [tex replaceRegion:MTLRegionMake2D(0, 0, result.width, result.height)
+               mipmapLevel:0
+                 withBytes:result.pixels.data()
+               bytesPerRow:static_cast<NSUInteger>(result.width) * 4];
+    }
+#else
+    if (previewTextureID == 0) {
+        glGenTextures(1, &previewTextureID);
+        glBindTexture(GL_TEXTURE_2D, previewTextureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, previewTextureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                 result.width, result.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+    previewTextureWidth  = result.width;
+    previewTextureHeight = result.height;
+#endif
+    previewRect_        = CanvasRect{ result.sourceX, result.sourceY,
+                                      result.sourceX + result.sourceW, result.sourceY + result.sourceH };
+    previewTextureValid = true;
+}
+
+void PixelPaintView::CancelFilterPreview()
+{
+    filterPreview_.Cancel();
+    previewTextureValid = false;
+    previewStale_       = true;
+    lastPreviewKey_     = FilterPreviewKey{};
+}
+
+void PixelPaintView::DestroyPreviewTexture()
+{
+#if defined(USE_METAL_BACKEND)
+    if (previewMetalTexture != nullptr) {
+        id<MTLTexture> texture = (__bridge_transfer id<MTLTexture>)previewMetalTexture;
+        previewMetalTexture = nullptr;
+    }
+#else
+    if (previewTextureID != 0) {
+        glDeleteTextures(1, &previewTextureID);
+        previewTextureID = 0;
+    }
+#endif
+    previewTextureValid = false;
+}
+
 // Undo/Redo
 void PixelPaintView::PushUndo(std::string_view description)
 {
     undo_.Push(canvas_.MakeSnapshot(description));
 }
 
+void PixelPaintView::PushAdjustmentUndo(std::string_view description)
+{
+    if (const auto* previous = undo_.Current())
+        undo_.Push(canvas_.MakeAdjustmentSnapshot(*previous, description));
+    else
+        PushUndo(description);
+}
+
 void PixelPaintView::Undo()
 {
     if (const auto* snap = undo_.Undo()) {
@@ -1046,229 +1167,185 @@ void PixelPaintView::ClearUndoStack()
 }
 
 // File I/O
-bool PixelPaintView::SaveToTGA(const std::string& filename)
+//
+// Exports run as background jobs (export/ExportJob): the composite is
+// snapshotted here on the UI thread and everything the encoder needs is
+// captured by value, so painting can continue while the file is written.
+// PollExportJobs() picks up the results once per frame.
+void PixelPaintView::StartExport(const std::string& filename, exporter::ExportJob::Task task)
 {
     canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
-
-    FILE* file = fopen(filename.c_str(), "wb");
-    if (!file) return false;
-
-    uint8_t header[18] = {0};
-    header[2] = 2;
-    header[12] = canvasWidth & 0xFF;
-    header[13] = (canvasWidth >> 8) & 0xFF;
-    header[14] = canvasHeight & 0xFF;
-    header[15] = (canvasHeight >> 8) & 0xFF;
-    header[16] = 32;
-    header[17] = 0x20;
-
-    fwrite(header, 1, 18, file);
-
-    const pelpaint::Pixel* pixels = reinterpret_cast<const pelpaint::Pixel*>(view.data);
-    for (std::uint32_t i = 0; i < canvasWidth * canvasHeight; ++i) {
-        fputc(pixels[i].b, file);
-        fputc(pixels[i].g, file);
-        fputc(pixels[i].r, file);
-        fputc(pixels[i].a, file);
-    }
-
-    fclose(file);
-
-    // Save directory for next file dialog
-    fs::path p(filename);
-    SaveLastDirectory(p.parent_path().string());
-
-    return true;
+    exportJobs_.push_back(std::make_unique<exporter::ExportJob>(
+        filename, canvas_.CompositeSurface().Snapshot(), std::move(task)));
 }
 
-bool PixelPaintView::SaveToPNG(const std::string& filename)
+void PixelPaintView::PollExportJobs()
 {
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
-
-    bool success = stbi_write_png(filename.c_str(), canvasWidth, canvasHeight, 4, view.data, canvasWidth * 4);
+    std::erase_if(exportJobs_, [this](const std::unique_ptr<exporter::ExportJob>& job) {
+        const fs::path p(job->Filename());
+        switch (job->State()) {
+            case exporter::ExportState::Running:
+                return false;
+            case exporter::ExportState::Succeeded:
+                // Save directory for next file dialog
+                SaveLastDirectory(p.parent_path().string());
+                exportStatus = "Saved " + p.filename().string();
+                break;
+            case exporter::ExportState::Failed:
+                exportStatus = "Export failed: " + p.filename().string();
+                break;
+            case exporter::ExportState::Cancelled:
+                exportStatus = "Export cancelled: " + p.filename().string();
+                break;
+        }
+        return true;
+    });
+}
 
-    // Save directory for next file dialog
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
+void PixelPaintView::SaveToTGA(const std::string& filename)
+{
+    exporter::TgaOptions options;
+    options.rle = tgaUseRle;
+    StartExport(filename, [options](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        return ImageExporter::SaveToTGA(path, bands, options);
+    });
+}
 
-    return success;
+void PixelPaintView::SaveToPNG(const std::string& filename)
+{
+    // Indexed (PLTE) automatically when the image has at most 256 colours
+    exporter::PngOptions options;
+    options.level = pngFastCompression ? exporter::PngLevel::Fast : exporter::PngLevel::Small;
+    StartExport(filename, [options](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        return ImageExporter::SaveToPNG(path, bands, options);
+    });
 }
 
-bool PixelPaintView::SaveToSVGPixel(const std::string& filename)
+void PixelPaintView::SaveToSVGPixel(const std::string& filename)
 {
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
+    // One <rect> per merged rectangle (export/RectDecomposition)
+    const exporter::RectMergeMode merge = MergeMode(svgNearMinimal);
+    StartExport(filename, [merge](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        bands.SetProgressRange(0.0f, 0.5f);
+        return ImageExporter::SaveToSVGOptimized(path, bands, merge);
+    });
+}
 
-    // Implementation uses optimized greedy rectangle merging
-    bool success = ImageExporter::SaveToSVGOptimized(filename, view);
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
-    return success;
+void PixelPaintView::SaveToSVGVector(const std::string& filename)
+{
+    // Merged rectangles with vector styling
+    const exporter::RectMergeMode merge = MergeMode(svgNearMinimal);
+    StartExport(filename, [merge](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        bands.SetProgressRange(0.0f, 0.5f);
+        return ImageExporter::SaveToSVGVector(path, bands, merge);
+    });
 }
 
-bool PixelPaintView::SaveToSVGVector(const std::string& filename)
+void PixelPaintView::SaveToSVGPaths(const std::string& filename)
 {
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
+    // One <path> per colour; planes merged in parallel.  The palette is
+    // copied: the job must not see later palette edits.
+    const auto paletteSpan = CurrentFilterPalette();
+    std::vector<pelpaint::Pixel> palette(paletteSpan.begin(), paletteSpan.end());
+    const exporter::RectMergeMode merge = MergeMode(svgNearMinimal);
+    const bool useClasses = svgPathUseClasses;
 
-    // Implementation uses optimized greedy rectangle merging with vector styling
-    bool success = ImageExporter::SaveToSVGVector(filename, view);
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
-    return success;
+    StartExport(filename, [palette = std::move(palette), merge, useClasses](
+                              const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::SvgPathOptions options;
+        options.merge      = merge;
+        options.useClasses = useClasses;
+        options.palette    = palette;
+
+        exporter::RowBands bands(image, &progress);
+        bands.SetProgressRange(0.0f, 0.5f);
+        return exporter::SaveToSVGPaths(path, bands, options);
+    });
 }
 
-bool PixelPaintView::SaveDepthMap(const std::string& filename)
+void PixelPaintView::SaveDepthMap(const std::string& filename)
 {
     if (depthMapGridSize < 1) depthMapGridSize = 1;
 
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
-
-    bool success = ImageExporter::SaveDepthMap(
-        view,
-        static_cast<std::uint32_t>(depthMapGridSize),
-        filename
-    );
-
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
-
-    return success;
+    const auto cell = static_cast<std::uint32_t>(depthMapGridSize);
+    StartExport(filename, [cell](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        return ImageExporter::SaveDepthMap(bands, cell, path);
+    });
 }
 
-bool PixelPaintView::SaveMesh(const std::string& filename)
+void PixelPaintView::SaveMesh(const std::string& filename)
 {
     if (meshExportGridSize < 1) meshExportGridSize = 1;
 
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
-
     MeshExportOptions options;
     options.mode = static_cast<MeshMode>(meshExportMode);
+    options.format = static_cast<MeshFileFormat>(meshExportFormat);
     options.gridSize = static_cast<std::uint32_t>(meshExportGridSize);
     options.depthScale = 1.0f;
     options.useVertexColors = true;
     options.optimizeMesh = true;
+    options.quantize = meshExportQuantize;
+    options.targetTriangles = static_cast<std::uint32_t>(std::max(1, meshLoPolyTriangles));
 
-    pelpaint::ColorPalette fallback("Default", {});
     const bool paletteOk = selectedPaletteIndex >= 0 &&
                            selectedPaletteIndex < static_cast<int>(availablePalettes.size());
-    const pelpaint::ColorPalette& palette = paletteOk ? availablePalettes[selectedPaletteIndex] : fallback;
-
-    bool success = MeshExporter::SaveAsMesh(filename, view, palette, options);
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
+    pelpaint::ColorPalette palette = paletteOk ? availablePalettes[selectedPaletteIndex]
+                                               : pelpaint::ColorPalette("Default", {});
+
+    StartExport(filename, [options, palette = std::move(palette)](
+                              const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        // Mesh builders index the whole image (depth SAT, cell colours), so
+        // this is the one export that flattens its snapshot.
+        const core::ImageView flat = image.Flatten();
+        ImageView view;
+        view.data     = flat.data;
+        view.width    = flat.width;
+        view.height   = flat.height;
+        view.stride   = flat.stride;
+        view.channels = 4;
 
-    return success;
+        MeshExportOptions jobOptions = options;
+        jobOptions.progress = &progress;
+        return MeshExporter::SaveAsMesh(path, view, palette, jobOptions);
+    });
 }
 
-bool PixelPaintView::SaveToJPEG(const std::string& filename, int quality)  // NOLINT: quality matches .hpp default
+void PixelPaintView::SaveToJPEG(const std::string& filename)
 {
-    canvas_.Composite();
-    const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-    ImageView view;
-    view.data     = coreView.data;
-    view.width    = static_cast<std::uint32_t>(canvasWidth);
-    view.height   = static_cast<std::uint32_t>(canvasHeight);
-    view.stride   = view.width * 4;
-    view.channels = 4;
-
-    // JPEG has no alpha — extract RGB bytes into intermediate buffer
-    std::vector<uint8_t> jpegData;
-    jpegData.reserve(canvasWidth * canvasHeight * 3);
-    for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(canvasWidth * canvasHeight); ++i) {
-        jpegData.push_back(view.data[i * 4 + 0]); // R
-        jpegData.push_back(view.data[i * 4 + 1]); // G
-        jpegData.push_back(view.data[i * 4 + 2]); // B
+    // JPEG has no alpha: translucent pixels are composited over the matte
+    exporter::JpegOptions options;
+    options.quality = std::clamp(jpegQuality, 1, 100);
+    for (int c = 0; c < 3; ++c) {
+        options.matte[c] = static_cast<std::uint8_t>(std::clamp(jpegMatte[c], 0.0f, 1.0f) * 255.0f + 0.5f);
     }
-
-    bool success = stbi_write_jpg(filename.c_str(), canvasWidth, canvasHeight, 3, jpegData.data(), quality);
-
-    // Save directory for next file dialog
-    if (success) {
-        fs::path p(filename);
-        SaveLastDirectory(p.parent_path().string());
-    }
-
-    return success;
+    StartExport(filename, [options](const std::string& path, const core::ImageSurface& image, exporter::ExportProgress& progress) {
+        exporter::RowBands bands(image, &progress);
+        return ImageExporter::SaveToJPEG(path, bands, options);
+    });
 }
 
 bool PixelPaintView::LoadFromImage(const std::string& filename)
 {
-    int width, height, channels;
-    unsigned char* imageData = stbi_load(filename.c_str(), &width, &height, &channels, 4);
-
-    if (!imageData) return false;
-
-    ResizeCanvas(width, height);
+    // The image replaces the active layer's pixels; an adjustment layer has none.
+    if (canvas_.ActiveAdjustment()) return false;
 
-    Layer* activeLayer = GetActiveLayer();
-    if (!activeLayer) {
-        stbi_image_free(imageData);
-        return false;
-    }
+    auto image = core::ImportImage(filename);
+    if (!image) return false;
 
-    for (int i = 0; i < width * height; ++i) {
-        activeLayer->pixelData[i].r = imageData[i * 4];
-        activeLayer->pixelData[i].g = imageData[i * 4 + 1];
-        activeLayer->pixelData[i].b = imageData[i * 4 + 2];
-        activeLayer->pixelData[i].a = imageData[i * 4 + 3];
-    }
+    const int width  = static_cast<int>(image->Width());
+    const int height = static_cast<int>(image->Height());
+    if (!canvas_.ReplaceActiveLayer(std::move(image))) return false;
 
-    stbi_image_free(imageData);
-    RenderLayerToCanvas();
+    SyncDimsFromCanvas();
+    canvasSize = ImVec2(static_cast<float>(canvasWidth), static_cast<float>(canvasHeight));
     textureNeedsUpdate = true;
     SetFilenameFromLoadedImage(filename);
-    PushUndo("Load image");
+    PushUndo("Load image");   // shares the imported tiles until the layer is edited
 
     // Auto-pixelify large images to prevent memory/performance issues
     if (autoPixelifyOnLoad && width > autoPixelifyThreshold) {
@@ -1350,7 +1427,9 @@ void PixelPaintView::CropToSelection()
     PushUndo("Crop to Selection");
 
     // Extract cropped data for each layer
+    canvas_.MaterializeLayers();
     for (auto& layer : canvas_.Layers()) {
+        if (layer.IsAdjustment()) continue;
         std::vector<pelpaint::Pixel> croppedData(newWidth * newHeight);
         for (int y = 0; y < newHeight; ++y) {
             for (int x = 0; x < newWidth; ++x) {
@@ -1494,57 +1573,94 @@ void PixelPaintView::SaveLastDirectory(const std::string& directory)
     }
 }
 
-bool PixelPaintView::SaveBinary(const std::string& filename)
+bool PixelPaintView::SaveProject(const std::string& filename)
 {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file) return false;
-
-    uint32_t width = canvasWidth;
-    uint32_t height = canvasHeight;
-    file.write(reinterpret_cast<char*>(&width), sizeof(width));
-    file.write(reinterpret_cast<char*>(&height), sizeof(height));
+    const fs::path p(filename);
+    const bool confirmed = damagedSaveConfirmed_ == filename;
+    const auto askFirst = [&] {
+        damagedSaveConfirmed_ = filename;
+        exportStatus = "Some layers have damaged tiles; save again to write "
+                     + p.filename().string() + " with them transparent";
+        return false;
+    };
+    if (canvas_.HasDamagedLayers() && !confirmed) return askFirst();
 
-    const Layer* saveLayer = GetActiveLayer();
-    if (!saveLayer) return false;
-    for (const auto& pixel : saveLayer->pixelData) {
-        file.write(reinterpret_cast<const char*>(&pixel), sizeof(pixel));
+    // Layers not decoded yet only find out while they are written.
+    bool damaged = false;
+    if (!core::SaveProject(filename, canvas_, confirmed, &damaged)) {
+        if (damaged) return askFirst();
+        exportStatus = "Save failed: " + p.filename().string();
+        return false;
     }
 
-    file.close();
-
     // Save directory for next file dialog
-    fs::path p(filename);
     SaveLastDirectory(p.parent_path().string());
-
+    exportStatus = "Saved " + p.filename().string();
     return true;
 }
 
-bool PixelPaintView::LoadBinary(const std::string& filename)
+bool PixelPaintView::LoadProject(const std::string& filename)
 {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) return false;
+    CanvasSnapshot project;
+    int nextLayerId = 0;
+    if (!core::OpenProject(filename, project, nextLayerId)) return false;
 
-    uint32_t width, height;
-    file.read(reinterpret_cast<char*>(&width), sizeof(width));
-    file.read(reinterpret_cast<char*>(&height), sizeof(height));
+    canvas_.RestoreFromSnapshot(std::move(project));
+    canvas_.NextLayerIdRef() = nextLayerId;
+    SyncDimsFromCanvas();
+    canvasSize = ImVec2(static_cast<float>(canvasWidth), static_cast<float>(canvasHeight));
+    textureNeedsUpdate = true;
 
-    ResizeCanvas(width, height);
+    SetFilenameFromLoadedImage(filename);
+    PushUndo("Open project");
+    return true;
+}
 
-    Layer* loadLayer = GetActiveLayer();
-    if (!loadLayer) return false;
-    for (auto& pixel : loadLayer->pixelData) {
-        file.read(reinterpret_cast<char*>(&pixel), sizeof(pixel));
-    }
-    RenderLayerToCanvas();
+bool PixelPaintView::OpenFile(const std::string& filename)
+{
+    std::string extension = fs::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".pelp" ? LoadProject(filename) : LoadFromImage(filename);
+}
 
-    file.close();
+// Autosave journals, beside the last-directory file.
+std::string PixelPaintView::AutosaveDirectory() const
+{
+    return (fs::path(GetHomeDirectory()) / ".pelpaint").string();
+}
 
-    // Save directory for next file dialog
-    fs::path p(filename);
-    SaveLastDirectory(p.parent_path().string());
+void PixelPaintView::UpdateAutosave()
+{
+    if (autoBackup && !autosave_) {
+        const std::string directory = AutosaveDirectory();
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        autosave_ = std::make_unique<core::Autosave>(core::AutosaveFilename(directory));
+    } else if (!autoBackup && autosave_) {
+        autosave_->Discard();
+        autosave_.reset();
+    }
+    if (autosave_) autosave_->Pump(canvas_);
+}
 
+bool PixelPaintView::RecoverAutosave(const std::string& journal)
+{
+    CanvasSnapshot project;
+    int nextLayerId = 0;
+    if (!core::RecoverAutosave(journal, project, nextLayerId)) {
+        exportStatus = "Nothing to recover from the autosave";
+        return false;
+    }
+
+    canvas_.RestoreFromSnapshot(std::move(project));
+    canvas_.NextLayerIdRef() = nextLayerId;
+    SyncDimsFromCanvas();
+    canvasSize = ImVec2(static_cast<float>(canvasWidth), static_cast<float>(canvasHeight));
     textureNeedsUpdate = true;
-    PushUndo("Load binary");
+
+    PushUndo("Recover autosave");
+    exportStatus = "Recovered the autosave";
     return true;
 }
 
@@ -1571,29 +1687,10 @@ ImVec2 PixelPaintView::CanvasToScreen(const ImVec2& canvasCoord) const
 // Update frequent colors
 void PixelPaintView::UpdateFrequentColors()
 {
-    std::map<uint32_t, int> colorFrequency;
-
-    const Layer* freqLayer = GetActiveLayer();
-    if (!freqLayer) return;
-    for (const auto& pixel : freqLayer->pixelData) {
-        uint32_t colorKey = (pixel.r << 24) | (pixel.g << 16) | (pixel.b << 8) | pixel.a;
-        colorFrequency[colorKey]++;
-    }
-
-    std::vector<std::pair<uint32_t, int>> sortedColors(colorFrequency.begin(), colorFrequency.end());
-    std::sort(sortedColors.begin(), sortedColors.end(),
-        [](const auto& a, const auto& b) { return a.second > b.second; });
-
-    frequentColors.clear();
-    for (size_t i = 0; i < sortedColors.size() && i < maxMostUsedColors; ++i) {
-        uint32_t key = sortedColors[i].first;
-        frequentColors.push_back(pelpaint::Pixel(
-            (key >> 24) & 0xFF,
-            (key >> 16) & 0xFF,
-            (key >> 8) & 0xFF,
-            key & 0xFF
-        ));
-    }
+    // Incremental: only tiles changed since the last frame are rescanned,
+    // and the top-N list is rebuilt only when a count actually moved.
+    if (!colorHistogram_.Sync(canvas_)) return;
+    colorHistogram_.TopN(static_cast<std::size_t>(maxMostUsedColors), frequentColors);
 }
 
 // Copy selection
@@ -2273,6 +2370,19 @@ void PixelPaintView::DrawPaletteSelector()
         ImGui::EndCombo();
     }
 
+    if (ImGui::CollapsingHeader("Extract from Image")) {
+        const char* methodNames[] = { "Median Cut", "Octree", "K-Means" };
+        ImGui::Combo("Method##extract", &paletteExtractMethod, methodNames, IM_ARRAYSIZE(methodNames));
+        pelpaint::ui::SliderIntStepStateful(
+            "Colors##extract", 2, 256, 1, "palette_extract_colors", paletteExtractColors,
+            [&](int v){ paletteExtractColors = v; }
+        );
+        ImGui::Checkbox("Refine (k-means passes)", &paletteExtractRefine);
+        if (ImGui::Button("Extract from Active Layer", ImVec2(-1, 0))) {
+            ExtractPaletteFromLayer();
+        }
+    }
+
     // Display palette colors for direct picking
     if (!customPalette.empty()) {
         ImGui::Separator();
@@ -2306,8 +2416,12 @@ void PixelPaintView::DrawPaletteSelector()
     }
 
     ImGui::Separator();
+    ImGui::Checkbox("Perceptual Match##palette", &paletteMatchPerceptual);
+    ImGui::SetItemTooltip("Match in OKLab instead of RGB (slower, closer to what the eye picks)");
     if (ImGui::Button("Apply Palette Direct", ImVec2(-1, 0))) {
         if (!customPalette.empty()) {
+            CancelFilterPreview();
+            showFilterPreview = false;
             ApplyPalette(customPalette);
         }
     }
@@ -2436,7 +2550,6 @@ void PixelPaintView::DrawBrushSettings()
 // Draw canvas view
 void PixelPaintView::DrawCanvasView()
 {
-    UpdateTexture();
 
     const ImVec2 avail      = ImGui::GetContentRegionAvail();
     const ImVec2 regionMin  = ImGui::GetCursorScreenPos();
@@ -2465,6 +2578,28 @@ void PixelPaintView::DrawCanvasView()
     canvasPos = ImVec2(centerX + panOffset.x,
                        centerY + panOffset.y);
 
+    // ---------------------------------------------------------------
+    // Recomposite stale tiles inside the visible part of the canvas
+    // only; off-screen tiles catch up when panned into view or when an
+    // exporter requests the full composite.
+    // ---------------------------------------------------------------
+    {
+        const float invScale = 1.0f / effectiveScale;
+        const int   visX0 = static_cast<int>(std::floor((regionMin.x           - canvasPos.x) * invScale));
+        const int   visY0 = static_cast<int>(std::floor((regionMin.y           - canvasPos.y) * invScale));
+        const int   visX1 = static_cast<int>(std::ceil ((regionMin.x + avail.x - canvasPos.x) * invScale));
+        const int   visY1 = static_cast<int>(std::ceil ((regionMin.y + avail.y - canvasPos.y) * invScale));
+
+        visibleCanvasRect_ = CanvasRect{ std::max(visX0, 0), std::max(visY0, 0),
+                                         std::min(visX1, canvasWidth), std::min(visY1, canvasHeight) };
+
+        if (canvas_.IsDirty()) previewStale_ = true;
+        if (canvas_.Composite(visX0, visY0, visX1, visY1) > 0) textureNeedsUpdate = true;
+    }
+
+    UpdateTexture();
+    UpdatePreviewTexture();
+
     // ---------------------------------------------------------------
     // Invisible full-area button captures mouse events for the whole
     // canvas region (pan, zoom, draw) without ImGui scrolling it.
@@ -2516,6 +2651,24 @@ void PixelPaintView::DrawCanvasView()
         ImVec2(0, 1), ImVec2(1, 0));
 #endif
 
+    // Live filter preview overlay — over the part of the canvas it was
+    // built from, GPU-upscaled.
+    if (showFilterPreview && previewTextureValid) {
+        const ImVec2 p0(canvasPos.x + previewRect_.x0 * effectiveScale,
+                        canvasPos.y + previewRect_.y0 * effectiveScale);
+        const ImVec2 p1(canvasPos.x + previewRect_.x1 * effectiveScale,
+                        canvasPos.y + previewRect_.y1 * effectiveScale);
+#if defined(USE_METAL_BACKEND)
+        if (previewMetalTexture != nullptr)
+            bgList->AddImage(previewMetalTexture, p0, p1);
+#else
+        bgList->AddImage(
+            reinterpret_cast<void*>(static_cast<intptr_t>(previewTextureID)),
+            p0, p1,
+            ImVec2(0, 1), ImVec2(1, 0));
+#endif
+    }
+
     // HandleCanvasInput uses canvasHitHovered / canvasHitActive set above.
     HandleCanvasInput();
     DrawSelectionOverlay();
@@ -2961,21 +3114,108 @@ void PixelPaintView::DrawColorTab()
 // FILTER TAB - Convert, Dithering, Pixelify, Shape Redraw filter
 void PixelPaintView::DrawFilterTab()
 {
+    // ----------------------------------------------------------------
+    // Live Preview
+    // ----------------------------------------------------------------
+    if (ImGui::CollapsingHeader("Preview", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::Checkbox("Live Preview##filter", &showFilterPreview) && !showFilterPreview) {
+            CancelFilterPreview();
+        }
+        ImGui::SetItemTooltip("Show the selected filter over the canvas without applying it");
+
+        const char* previewFilterNames[] = { "Palette", "Dithering", "Pixelify", "Shape Redraw" };
+        ImGui::Combo("Filter##preview", &previewFilterIndex, previewFilterNames, 4);
+
+        if (showFilterPreview && filterPreview_.Busy()) {
+            ImGui::TextDisabled("Rendering preview...");
+        } else {
+            ImGui::TextDisabled("Preview of the active layer at screen resolution.");
+        }
+    }
+    ImGui::Spacing();
+
+    // ----------------------------------------------------------------
+    // Adjustment Layers
+    // ----------------------------------------------------------------
+    if (ImGui::CollapsingHeader("Adjustment Layers")) {
+        ImGui::TextDisabled("Non-destructive: adds a layer that filters everything below it.");
+        if (ImGui::Button("Grayscale##adjadd",      ImVec2(-1, 0))) AddAdjustmentLayer(AdjustmentType::Grayscale);
+        if (ImGui::Button("Palette Map##adjadd",    ImVec2(-1, 0))) AddAdjustmentLayer(AdjustmentType::PaletteMap);
+        if (ImGui::Button("Ordered Dither##adjadd", ImVec2(-1, 0))) AddAdjustmentLayer(AdjustmentType::OrderedDither);
+        if (ImGui::Button("Pixelify##adjadd",       ImVec2(-1, 0))) AddAdjustmentLayer(AdjustmentType::Pixelify);
+        ImGui::Spacing();
+        DrawAdjustmentLayerEditor();
+    }
+    ImGui::Spacing();
+
     // ----------------------------------------------------------------
     // Convert
     // ----------------------------------------------------------------
     if (ImGui::CollapsingHeader("Convert", ImGuiTreeNodeFlags_DefaultOpen)) {
         if (ImGui::Button("To Grayscale", ImVec2(-1, 0))) {
+            CancelFilterPreview();
             ConvertToGrayscale();
         }
     }
     ImGui::Spacing();
 
+    // ----------------------------------------------------------------
+    // Color Adjust
+    // ----------------------------------------------------------------
+    if (ImGui::CollapsingHeader("Color Adjust")) {
+        ImGui::Checkbox("Levels##cop", &colorOpLevels);
+        if (colorOpLevels) {
+            pelpaint::ui::SliderIntStepStateful(
+                "Input Black", 0, 254, 1, "color_op_in_black", colorOpInBlack,
+                [&](int v){ colorOpInBlack = v; }
+            );
+            pelpaint::ui::SliderIntStepStateful(
+                "Input White", 1, 255, 1, "color_op_in_white", colorOpInWhite,
+                [&](int v){ colorOpInWhite = v; }
+            );
+            pelpaint::ui::SliderFloatStepStateful(
+                "Gamma", 0.1f, 4.0f, 0.05f, "color_op_gamma", colorOpGamma,
+                [&](float v){ colorOpGamma = v; }
+            );
+        }
+        ImGui::Checkbox("Grayscale##cop", &colorOpGrayscale);
+        ImGui::Checkbox("Posterize##cop", &colorOpPosterize);
+        if (colorOpPosterize) {
+            pelpaint::ui::SliderIntStepStateful(
+                "Levels##posterize", 2, 32, 1, "color_op_posterize", colorOpPosterizeLevels,
+                [&](int v){ colorOpPosterizeLevels = v; }
+            );
+        }
+        ImGui::Checkbox("Palette Map##cop", &colorOpPaletteMap);
+        ImGui::SetItemTooltip("Snap to the current palette after the steps above");
+        if (colorOpPaletteMap) {
+            ImGui::Checkbox("Perceptual Match##cop", &paletteMatchPerceptual);
+            ImGui::SetItemTooltip("Match in OKLab instead of RGB (slower, closer to what the eye picks)");
+        }
+        ImGui::Checkbox("Alpha Threshold##cop", &colorOpAlphaThreshold);
+        if (colorOpAlphaThreshold) {
+            pelpaint::ui::SliderIntStepStateful(
+                "Cutoff", 1, 255, 1, "color_op_alpha_cutoff", colorOpAlphaCutoff,
+                [&](int v){ colorOpAlphaCutoff = v; }
+            );
+        }
+
+        ImGui::Spacing();
+        if (ImGui::Button("Apply Color Adjust##cop", ImVec2(-1, 0))) {
+            CancelFilterPreview();
+            ApplyColorPipeline();
+        }
+        ImGui::TextDisabled("Enabled steps run top to bottom in a single pass.");
+    }
+    ImGui::Spacing();
+
     // ----------------------------------------------------------------
     // Dithering
     // ----------------------------------------------------------------
     if (ImGui::CollapsingHeader("Dithering", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Checkbox("Preserve Alpha##dither", &ditheringPreserveAlpha);
+        ImGui::Checkbox("Perceptual Match##dither", &ditheringPerceptual);
+        ImGui::SetItemTooltip("Match in OKLab instead of RGB (slower, closer to what the eye picks)");
         ImGui::Spacing();
 
         ImGui::Text("Method:");
@@ -3026,6 +3266,8 @@ void PixelPaintView::DrawFilterTab()
                     case 3:  method = DitheringType::Ordered;        break;
                     default: method = DitheringType::FloydSteinberg; break;
                 }
+                CancelFilterPreview();
+                showFilterPreview = false;
                 ApplyDithering(method, pal);
             }
         }
@@ -3048,8 +3290,14 @@ void PixelPaintView::DrawFilterTab()
         );
         ImGui::Checkbox("Apply Palette##pixelify", &pixelifyUsePalette);
         ImGui::SetItemTooltip("Quantize averaged block color to the current palette");
+        if (pixelifyUsePalette) {
+            ImGui::Checkbox("Perceptual Match##pixelify", &pixelifyPerceptual);
+            ImGui::SetItemTooltip("Match in OKLab instead of RGB");
+        }
         ImGui::Spacing();
         if (ImGui::Button("Apply Pixelify##button", ImVec2(-1, 0))) {
+            CancelFilterPreview();
+            showFilterPreview = false;
             ApplyPixelify(pixelifySize, pixelifyUsePalette);
         }
         ImGui::TextDisabled("Averages color blocks; optionally snaps to palette.");
@@ -3092,6 +3340,10 @@ void PixelPaintView::DrawFilterTab()
 
         ImGui::Checkbox("Use Palette##srf", &shapeRedrawFilterUsePalette);
         ImGui::SetItemTooltip("Snap block color to the current palette");
+        if (shapeRedrawFilterUsePalette) {
+            ImGui::Checkbox("Perceptual Match##srf", &shapeRedrawFilterPerceptual);
+            ImGui::SetItemTooltip("Match in OKLab instead of RGB");
+        }
 
         // Custom 8x8 shape editor – shown only when Custom is selected
         if (shapeRedrawFilterMode == ShapeRedrawFilterMode::Custom) {
@@ -3149,6 +3401,8 @@ void PixelPaintView::DrawFilterTab()
 
         ImGui::Spacing();
         if (ImGui::Button("Apply Shape Redraw##srfapply", ImVec2(-1, 0))) {
+            CancelFilterPreview();
+            showFilterPreview = false;
             ApplyShapeRedrawFilter();
         }
         ImGui::TextDisabled("Redraws the image using block-sampled shapes.");
@@ -3224,7 +3478,9 @@ void PixelPaintView::DrawFilesTab()
         if (!buildCompositeView(view, composite)) return false;
 
         const std::string path = docs + "/" + filename;
-        return ImageExporter::SaveToTGA(path, view);
+        exporter::TgaOptions options;
+        options.rle = tgaUseRle;
+        return ImageExporter::SaveToTGA(path, view, options);
     };
 
     if (ImGui::Button("Share PNG", ImVec2(-1, 0))) {
@@ -3233,6 +3489,7 @@ void PixelPaintView::DrawFilesTab()
             iOS_SaveFile((currentFilename + ".png").c_str(), bytes.data(), bytes.size());
         }
     }
+    ImGui::Checkbox("RLE Compression##tga", &tgaUseRle);
     if (ImGui::Button("Share TGA", ImVec2(-1, 0))) {
         std::string docs = getDocumentsPath();
         if (!docs.empty()) {
@@ -3246,8 +3503,16 @@ void PixelPaintView::DrawFilesTab()
             }
         }
     }
-    if (ImGui::Button("Share Binary", ImVec2(-1, 0))) {
-        SaveBinary(currentFilename + ".pxl");
+    if (ImGui::Button("Share Project", ImVec2(-1, 0))) {
+        std::string docs = getDocumentsPath();
+        if (!docs.empty()) {
+            const std::string filename = currentFilename + ".pelp";
+            const std::string path = docs + "/" + filename;
+            std::vector<std::uint8_t> bytes;
+            if (SaveProject(path) && readFileBytes(path, bytes)) {
+                iOS_SaveFile(filename.c_str(), bytes.data(), bytes.size());
+            }
+        }
     }
     if (ImGui::Button("Save to Files", ImVec2(-1, 0))) {
         std::vector<std::uint8_t> bytes;
@@ -3265,9 +3530,20 @@ void PixelPaintView::DrawFilesTab()
     ImGui::Combo("Export Type", &exportTypeIndex, exportTypes, static_cast<int>(sizeof(exportTypes) / sizeof(exportTypes[0])));
 
     if (exportTypeIndex == 0) {
-        const char* imageFormats[] = { "PNG", "TGA" };
-        if (imageExportFormat < 0 || imageExportFormat >= 2) imageExportFormat = 0;
-        ImGui::Combo("Image Format", &imageExportFormat, imageFormats, 2);
+        const char* imageFormats[] = { "PNG", "TGA", "JPEG" };
+        if (imageExportFormat < 0 || imageExportFormat >= 3) imageExportFormat = 0;
+        ImGui::Combo("Image Format", &imageExportFormat, imageFormats, 3);
+        if (imageExportFormat == 0) {
+            ImGui::Checkbox("Fast Compression##png", &pngFastCompression);
+            ImGui::SetItemTooltip("Quicker save, somewhat larger file");
+        } else if (imageExportFormat == 1) {
+            ImGui::Checkbox("RLE Compression##tga", &tgaUseRle);
+            ImGui::SetItemTooltip("Run-length encode rows; much smaller for flat-colour pixel art");
+        } else {
+            ImGui::SliderInt("Quality##jpeg", &jpegQuality, 1, 100);
+            ImGui::ColorEdit3("Matte##jpeg", jpegMatte, ImGuiColorEditFlags_NoInputs);
+            ImGui::SetItemTooltip("Background for transparent pixels (JPEG has no alpha)");
+        }
 
         if (ImGui::Button("Save As", ImVec2(-1, 0))) {
             if (imageExportFormat == 0) {
@@ -3277,16 +3553,27 @@ void PixelPaintView::DrawFilesTab()
                         if (!filepath.empty()) SaveToPNG(filepath);
                     }
                 );
-            } else {
+            } else if (imageExportFormat == 1) {
                 FileChooser::Instance().SaveFileDialog(
                     "Save TGA", ".tga", currentFilename + ".tga", "",
                     [this](const std::string& filepath) {
                         if (!filepath.empty()) SaveToTGA(filepath);
                     }
                 );
+            } else {
+                FileChooser::Instance().SaveFileDialog(
+                    "Save JPEG", ".jpg", currentFilename + ".jpg", "",
+                    [this](const std::string& filepath) {
+                        if (!filepath.empty()) SaveToJPEG(filepath);
+                    }
+                );
             }
         }
     } else if (exportTypeIndex == 1) {
+        ImGui::Checkbox("Near-Minimal Rects##svg", &svgNearMinimal);
+        ImGui::SetItemTooltip("Merge by rows and by columns per color and keep the smaller (fewer shapes).\n"
+                              "Labels the whole canvas at once plus a transposed copy: about 8 bytes\n"
+                              "per pixel (8 GB at 32768x32768). Off: rows only, one band at a time.");
         if (ImGui::Button("Save SVG Pixel", ImVec2(-1, 0))) {
             FileChooser::Instance().SaveFileDialog(
                 "Save SVG Pixel", ".svg", currentFilename + ".svg", "",
@@ -3303,6 +3590,18 @@ void PixelPaintView::DrawFilesTab()
                 }
             );
         }
+        ImGui::Separator();
+        ImGui::Checkbox("CSS Classes##svgpaths", &svgPathUseClasses);
+        ImGui::SetItemTooltip("Put fills in a <style> block; palette colors get class p<index>");
+        if (ImGui::Button("Save SVG Paths", ImVec2(-1, 0))) {
+            FileChooser::Instance().SaveFileDialog(
+                "Save SVG Paths", ".svg", currentFilename + ".svg", "",
+                [this](const std::string& filepath) {
+                    if (!filepath.empty()) SaveToSVGPaths(filepath);
+                }
+            );
+        }
+        ImGui::TextDisabled("One path per color: much smaller files.");
     } else if (exportTypeIndex == 2) {
         ImGui::Text("Depth Map");
         pelpaint::ui::SliderIntStepStateful(
@@ -3323,17 +3622,28 @@ void PixelPaintView::DrawFilesTab()
         const char* meshModes[] = { "Solid", "Wireframe", "LoPoly", "PixelPerfect" };
         ImGui::Combo("Mesh Type", &meshExportMode, meshModes, static_cast<int>(sizeof(meshModes) / sizeof(meshModes[0])));
 
-        const char* meshFormats[] = { "PLY" };
-        ImGui::Combo("Mesh Format", &meshExportFormat, meshFormats, 1);
+        const char* meshFormats[] = { "PLY (Binary)", "PLY (ASCII)", "GLB" };
+        ImGui::Combo("Mesh Format", &meshExportFormat, meshFormats, static_cast<int>(sizeof(meshFormats) / sizeof(meshFormats[0])));
+        const bool meshGlb = static_cast<MeshFileFormat>(meshExportFormat) == MeshFileFormat::Glb;
+        if (meshGlb) {
+            ImGui::Checkbox("Quantize##glb", &meshExportQuantize);
+            ImGui::SetItemTooltip("16-bit positions and 8-bit normals (KHR_mesh_quantization)");
+        }
 
         pelpaint::ui::SliderIntStepStateful(
             "Mesh Grid Size", 1, 128, 1, "mesh_export_grid_size", meshExportGridSize,
             [&](int v){ meshExportGridSize = v; }
         );
         meshExportGridSize = std::max(1, meshExportGridSize);
+        if (static_cast<MeshMode>(meshExportMode) == MeshMode::LoPoly) {
+            pelpaint::ui::SliderIntStepStateful(
+                "LoPoly Triangles", 100, 50000, 100, "mesh_lopoly_triangles", meshLoPolyTriangles,
+                [&](int v){ meshLoPolyTriangles = v; }
+            );
+        }
         if (ImGui::Button("Export Mesh", ImVec2(-1, 0))) {
             FileChooser::Instance().SaveFileDialog(
-                "Save Mesh", ".ply", currentFilename + ".ply", "",
+                "Save Mesh", meshGlb ? ".glb" : ".ply", currentFilename + (meshGlb ? ".glb" : ".ply"), "",
                 [this](const std::string& filepath) {
                     if (!filepath.empty()) SaveMesh(filepath);
                 }
@@ -3341,11 +3651,20 @@ void PixelPaintView::DrawFilesTab()
         }
     }
 
-    if (ImGui::Button("Load Image", ImVec2(-1, 0))) {
+    if (ImGui::Button("Save Project", ImVec2(-1, 0))) {
+        FileChooser::Instance().SaveFileDialog(
+            "Save Project", ".pelp", currentFilename + ".pelp", "",
+            [this](const std::string& filepath) {
+                if (!filepath.empty()) SaveProject(filepath);
+            }
+        );
+    }
+
+    if (ImGui::Button("Open", ImVec2(-1, 0))) {
         FileChooser::Instance().OpenFileDialog(
-            "Load Image", ".tga,.png,.jpg,.jpeg", "",
+            "Open", ".pelp,.tga,.png,.jpg,.jpeg", "",
             [this](const std::string& filepath) {
-                if (!filepath.empty()) LoadFromImage(filepath);
+                if (!filepath.empty()) OpenFile(filepath);
             }
         );
     }
@@ -3362,18 +3681,35 @@ void PixelPaintView::DrawFilesTab()
     ImGui::Combo("Export Type", &exportTypeIndex, exportTypes, static_cast<int>(sizeof(exportTypes) / sizeof(exportTypes[0])));
 
     if (exportTypeIndex == 0) {
-        const char* imageFormats[] = { "PNG", "TGA" };
-        if (imageExportFormat < 0 || imageExportFormat >= 2) imageExportFormat = 0;
-        ImGui::Combo("Image Format", &imageExportFormat, imageFormats, 2);
+        const char* imageFormats[] = { "PNG", "TGA", "JPEG" };
+        if (imageExportFormat < 0 || imageExportFormat >= 3) imageExportFormat = 0;
+        ImGui::Combo("Image Format", &imageExportFormat, imageFormats, 3);
+        if (imageExportFormat == 0) {
+            ImGui::Checkbox("Fast Compression##png", &pngFastCompression);
+            ImGui::SetItemTooltip("Quicker save, somewhat larger file");
+        } else if (imageExportFormat == 1) {
+            ImGui::Checkbox("RLE Compression##tga", &tgaUseRle);
+            ImGui::SetItemTooltip("Run-length encode rows; much smaller for flat-colour pixel art");
+        } else {
+            ImGui::SliderInt("Quality##jpeg", &jpegQuality, 1, 100);
+            ImGui::ColorEdit3("Matte##jpeg", jpegMatte, ImGuiColorEditFlags_NoInputs);
+            ImGui::SetItemTooltip("Background for transparent pixels (JPEG has no alpha)");
+        }
 
         if (ImGui::Button("Save As", ImVec2(-1, 0))) {
             if (imageExportFormat == 0) {
                 ImGuiFileDialog::Instance()->OpenDialog("SavePNGDialog", "Save PNG", ".png", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
-            } else {
+            } else if (imageExportFormat == 1) {
                 ImGuiFileDialog::Instance()->OpenDialog("SaveTGADialog", "Save TGA", ".tga", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
+            } else {
+                ImGuiFileDialog::Instance()->OpenDialog("SaveJPEGDialog", "Save JPEG", ".jpg,.jpeg", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
             }
         }
     } else if (exportTypeIndex == 1) {
+        ImGui::Checkbox("Near-Minimal Rects##svg", &svgNearMinimal);
+        ImGui::SetItemTooltip("Merge by rows and by columns per color and keep the smaller (fewer shapes).\n"
+                              "Labels the whole canvas at once plus a transposed copy: about 8 bytes\n"
+                              "per pixel (8 GB at 32768x32768). Off: rows only, one band at a time.");
         if (ImGui::Button("Save SVG Pixel", ImVec2(-1, 0))) {
             ImGuiFileDialog::Instance()->OpenDialog("SaveSVGPixelDialog", "Save SVG Pixel", ".svg", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
         }
@@ -3395,21 +3731,36 @@ void PixelPaintView::DrawFilesTab()
         const char* meshModes[] = { "Solid", "Wireframe", "LoPoly", "PixelPerfect" };
         ImGui::Combo("Mesh Type", &meshExportMode, meshModes, static_cast<int>(sizeof(meshModes) / sizeof(meshModes[0])));
 
-        const char* meshFormats[] = { "PLY" };
-        ImGui::Combo("Mesh Format", &meshExportFormat, meshFormats, 1);
+        const char* meshFormats[] = { "PLY (Binary)", "PLY (ASCII)", "GLB" };
+        ImGui::Combo("Mesh Format", &meshExportFormat, meshFormats, static_cast<int>(sizeof(meshFormats) / sizeof(meshFormats[0])));
+        const bool meshGlb = static_cast<MeshFileFormat>(meshExportFormat) == MeshFileFormat::Glb;
+        if (meshGlb) {
+            ImGui::Checkbox("Quantize##glb", &meshExportQuantize);
+            ImGui::SetItemTooltip("16-bit positions and 8-bit normals (KHR_mesh_quantization)");
+        }
 
         pelpaint::ui::SliderIntStepStateful(
             "Mesh Grid Size", 1, 128, 1, "mesh_export_grid_size", meshExportGridSize,
             [&](int v){ meshExportGridSize = v; }
         );
         meshExportGridSize = std::max(1, meshExportGridSize);
+        if (static_cast<MeshMode>(meshExportMode) == MeshMode::LoPoly) {
+            pelpaint::ui::SliderIntStepStateful(
+                "LoPoly Triangles", 100, 50000, 100, "mesh_lopoly_triangles", meshLoPolyTriangles,
+                [&](int v){ meshLoPolyTriangles = v; }
+            );
+        }
         if (ImGui::Button("Export Mesh", ImVec2(-1, 0))) {
-            ImGuiFileDialog::Instance()->OpenDialog("SaveMeshDialog", "Save Mesh", ".ply", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
+            ImGuiFileDialog::Instance()->OpenDialog("SaveMeshDialog", "Save Mesh", meshGlb ? ".glb" : ".ply", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
         }
     }
 
-    if (ImGui::Button("Load Image", ImVec2(-1, 0))) {
-        ImGuiFileDialog::Instance()->OpenDialog("LoadImageDialog", "Load Image", ".tga,.png,.jpg,.jpeg", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal);
+    if (ImGui::Button("Save Project", ImVec2(-1, 0))) {
+        ImGuiFileDialog::Instance()->OpenDialog("SaveProjectDialog", "Save Project", ".pelp", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite);
+    }
+
+    if (ImGui::Button("Open", ImVec2(-1, 0))) {
+        ImGuiFileDialog::Instance()->OpenDialog("LoadImageDialog", "Open", ".pelp,.tga,.png,.jpg,.jpeg", startDir, 1, nullptr, ImGuiFileDialogFlags_Modal);
     }
 
     ImGui::Spacing();
@@ -3417,6 +3768,9 @@ void PixelPaintView::DrawFilesTab()
     ImGui::Spacing();
 #endif
 
+    DrawExportJobs();
+    DrawAutosaveSettings();
+
     // Auto-Pixelify on Load settings
     if (ImGui::CollapsingHeader("Auto-Pixelify on Load", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Checkbox("Enable Auto-Pixelify##onload", &autoPixelifyOnLoad);
@@ -3438,6 +3792,69 @@ void PixelPaintView::DrawFilesTab()
 
 
 
+void PixelPaintView::DrawAutosaveSettings()
+{
+    if (!ImGui::CollapsingHeader("Autosave", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+    // Journals of sessions that did not exit cleanly, newest first.  This
+    // instance journals to a file of its own, so they can wait.
+    for (std::size_t i = 0; i < autosaveLeftovers_.size();) {
+        const std::string journal = autosaveLeftovers_[i];
+        ImGui::PushID(journal.c_str());
+        ImGui::TextWrapped("Autosave %s from a session that did not exit cleanly",
+                           fs::path(journal).filename().string().c_str());
+        bool done = false;
+        if (ImGui::Button("Recover##autosave") && RecoverAutosave(journal)) {
+            autosaveRecovered_.push_back(journal);
+            done = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Discard##autosave")) {
+            std::error_code ec;
+            fs::remove(journal, ec);
+            fs::remove(journal + ".part", ec);
+            done = true;
+        }
+        ImGui::PopID();
+        if (done) autosaveLeftovers_.erase(autosaveLeftovers_.begin() + static_cast<std::ptrdiff_t>(i));
+        else      ++i;
+    }
+
+    ImGui::Checkbox("Enable Autosave##backup", &autoBackup);
+    ImGui::SetItemTooltip("Every 30 seconds, journal the tiles changed since the last autosave\n"
+                          "so the canvas can be recovered after a crash");
+    if (autosave_ && !autosave_->Ok()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Autosave could not write %s",
+                           fs::path(autosave_->Filename()).filename().string().c_str());
+    }
+}
+
+void PixelPaintView::DrawExportJobs()
+{
+    if (exportJobs_.empty() && exportStatus.empty()) return;
+
+    ImGui::Text("Exports");
+    for (const auto& job : exportJobs_) {
+        ImGui::PushID(job.get());
+        const std::string name = fs::path(job->Filename()).filename().string();
+        ImGui::ProgressBar(job->Progress(), ImVec2(-70.0f, 0.0f), name.c_str());
+        ImGui::SameLine();
+        if (job->CancelRequested()) {
+            ImGui::TextDisabled("Stopping");
+        } else if (ImGui::Button("Cancel", ImVec2(-1, 0))) {
+            job->Cancel();
+        }
+        ImGui::PopID();
+    }
+    if (!exportStatus.empty()) {
+        ImGui::TextDisabled("%s", exportStatus.c_str());
+    }
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+}
+
 void PixelPaintView::DrawLayersTab()
 {
     pelpaint::ui::LayerPanel(
@@ -3465,14 +3882,13 @@ void PixelPaintView::Draw(std::string_view label)
 
     ImGui::Begin(label.data(), nullptr, windowFlags);
 
+    PollExportJobs();
+    UpdateAutosave();
     HandleKeyboardShortcuts();
     UpdateFrequentColors();
 
-    // Composite once per frame if any drawing tool wrote pixels since last frame.
-    if (canvas_.IsDirty()) {
-        canvas_.Composite();
-        textureNeedsUpdate = true;
-    }
+    // Compositing happens in DrawCanvasView(), limited to visible tiles.
+    UpdateFilterPreview();
 
     const float statusBarHeight = 30.0f;
     const bool isLandscape = screenSize.x > screenSize.y;
@@ -3584,39 +4000,23 @@ void PixelPaintView::Draw(std::string_view label)
     // File dialogs
     ImVec2 dialogSize = ImVec2(800, 600);
 
-    auto saveCompositeImage = [&](const std::string& filename, bool asPng) -> bool {
-        canvas_.Composite();
-        const core::ImageView coreView = canvas_.CompositeSurface().Flatten();
-        ImageView view;
-        view.data     = coreView.data;
-        view.width    = static_cast<std::uint32_t>(canvasWidth);
-        view.height   = static_cast<std::uint32_t>(canvasHeight);
-        view.stride   = view.width * 4;
-        view.channels = 4;
-
-        return asPng
-            ? ImageExporter::SaveToPNG(filename, view)
-            : ImageExporter::SaveToTGA(filename, view);
-    };
-
     if (ImGuiFileDialog::Instance()->Display("SaveTGADialog", ImGuiWindowFlags_NoCollapse, dialogSize, dialogSize)) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
-            const std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-            if (saveCompositeImage(path, false)) {
-                fs::path p(path);
-                SaveLastDirectory(p.parent_path().string());
-            }
+            SaveToTGA(ImGuiFileDialog::Instance()->GetFilePathName());
         }
         ImGuiFileDialog::Instance()->Close();
     }
 
     if (ImGuiFileDialog::Instance()->Display("SavePNGDialog", ImGuiWindowFlags_NoCollapse, dialogSize, dialogSize)) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
-            const std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-            if (saveCompositeImage(path, true)) {
-                fs::path p(path);
-                SaveLastDirectory(p.parent_path().string());
-            }
+            SaveToPNG(ImGuiFileDialog::Instance()->GetFilePathName());
+        }
+        ImGuiFileDialog::Instance()->Close();
+    }
+
+    if (ImGuiFileDialog::Instance()->Display("SaveJPEGDialog", ImGuiWindowFlags_NoCollapse, dialogSize, dialogSize)) {
+        if (ImGuiFileDialog::Instance()->IsOk()) {
+            SaveToJPEG(ImGuiFileDialog::Instance()->GetFilePathName());
         }
         ImGuiFileDialog::Instance()->Close();
     }
@@ -3649,9 +4049,16 @@ void PixelPaintView::Draw(std::string_view label)
         ImGuiFileDialog::Instance()->Close();
     }
 
+    if (ImGuiFileDialog::Instance()->Display("SaveProjectDialog", ImGuiWindowFlags_NoCollapse, dialogSize, dialogSize)) {
+        if (ImGuiFileDialog::Instance()->IsOk()) {
+            SaveProject(ImGuiFileDialog::Instance()->GetFilePathName());
+        }
+        ImGuiFileDialog::Instance()->Close();
+    }
+
     if (ImGuiFileDialog::Instance()->Display("LoadImageDialog", ImGuiWindowFlags_NoCollapse, dialogSize, dialogSize)) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
-            LoadFromImage(ImGuiFileDialog::Instance()->GetFilePathName());
+            OpenFile(ImGuiFileDialog::Instance()->GetFilePathName());
         }
         ImGuiFileDialog::Instance()->Close();
     }
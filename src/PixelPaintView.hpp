@@ -9,15 +9,22 @@
 #include <functional>
 #include <unordered_map>
 #include <array>
+#include <span>
 
 #include <imgui.h>
 #include <implot.h>
 
 #include "core/Types.hpp"
+#include "core/Autosave.hpp"
 #include "core/Canvas.hpp"
 #include "core/UndoHistory.hpp"
 #include "ColorPalettes.hpp"
+#include "export/ExportJob.hpp"
 #include "export/ImageExporter.hpp"
+#include "tools/FilterPreview.hpp"
+#include "tools/ColorPipeline.hpp"
+#include "tools/ColorHistogram.hpp"
+#include "tools/PaletteExtract.hpp"
 
 #if defined(USE_METAL_BACKEND)
     #ifdef __OBJC__
@@ -121,18 +128,22 @@ private:
     Layer*       GetActiveLayer()       { return canvas_.ActiveLayer(); }
     const Layer* GetActiveLayer() const { return canvas_.ActiveLayer(); }
 
-    // Force a composite + texture refresh (use sparingly — prefer IsDirty flow)
+    // Invalidate the whole composite after a layer-stack edit; the canvas
+    // view recomposites the visible tiles on the next draw.
     void RenderLayerToCanvas();
 
     // CompositeLayers: kept for filter methods that build a temporary flat buffer
     // for export.  Writes into the caller-supplied output vector.
-    void CompositeLayers(std::vector<Pixel>& output) const;
+    void CompositeLayers(std::vector<Pixel>& output);
 
     // ====================================================================
     // Undo helpers
     // ====================================================================
 
     void PushUndo(std::string_view description);
+    // After an edit to adjustment layers only: pixel layers are shared
+    // with the previous snapshot while no pixel has been written since.
+    void PushAdjustmentUndo(std::string_view description);
     void Undo();
     void Redo();
     void ClearUndoStack();
@@ -147,7 +158,7 @@ private:
     // Per-pixel access — canvas_.PutPixel() never composites.
     // Composite happens once per frame via the IsDirty check in Draw().
     void   PutPixel(int x, int y, const Pixel& color);
-    Pixel  GetPixel(int x, int y) const;
+    Pixel  GetPixel(int x, int y);
     bool   IsValidCoord(int x, int y) const noexcept;
     int    GetPixelIndex(int x, int y) const noexcept;
 
@@ -211,6 +222,15 @@ private:
     bool                      paletteEnabled        = true;
     bool                      ditheringPreserveAlpha = false;
 
+    // Perceptual (OKLab) palette matching, chosen per operation
+    bool                      paletteMatchPerceptual = false;   // Apply Palette / Palette Map
+    bool                      ditheringPerceptual    = false;
+
+    // Extract-from-image settings (see tools::ExtractPalette)
+    int                       paletteExtractMethod  = 0;     // PaletteExtractMethod
+    int                       paletteExtractColors  = 16;
+    bool                      paletteExtractRefine  = true;
+
     // ====================================================================
     // Bucket fill
     // ====================================================================
@@ -224,9 +244,101 @@ private:
 
     int  pixelifySize           = 4;
     bool pixelifyUsePalette      = false;
+    bool pixelifyPerceptual      = false;
     bool autoPixelifyOnLoad      = false;
     int  autoPixelifyThreshold   = 8;
-    bool showPixelifyPreview     = false;
+
+    // ====================================================================
+    // Color adjust — chained point operations run as one fused pass
+    // (tools/ColorPipeline.hpp)
+    // ====================================================================
+
+    bool  colorOpLevels          = false;
+    int   colorOpInBlack         = 0;
+    int   colorOpInWhite         = 255;
+    float colorOpGamma           = 1.0f;
+    bool  colorOpGrayscale       = false;
+    bool  colorOpPosterize       = false;
+    int   colorOpPosterizeLevels = 4;
+    bool  colorOpPaletteMap      = false;
+    bool  colorOpAlphaThreshold  = false;
+    int   colorOpAlphaCutoff     = 128;
+
+    [[nodiscard]] tools::ColorPipeline BuildColorPipeline() const;
+    void ApplyColorPipeline();
+
+    // ====================================================================
+    // Live filter preview
+    //
+    // The selected filter runs on a viewport-sized proxy of the visible
+    // part of the active layer on a worker thread and is drawn as an
+    // overlay texture over that part of the canvas.  Parameter changes and
+    // panning cancel and restart the job; only the Apply buttons run the
+    // full-resolution pass.
+    // ====================================================================
+
+    bool showFilterPreview  = false;
+    int  previewFilterIndex = 0;      // 0=Palette 1=Dithering 2=Pixelify 3=Shape Redraw
+    bool previewStale_      = true;   // layer changed since the last submit
+
+    // Canvas pixels [x0, x1) × [y0, y1).
+    struct CanvasRect {
+        int x0 = 0;
+        int y0 = 0;
+        int x1 = 0;
+        int y1 = 0;
+
+        [[nodiscard]] bool operator==(const CanvasRect&) const noexcept = default;
+    };
+    CanvasRect visibleCanvasRect_;   // set by DrawCanvasView, clipped to the canvas
+    CanvasRect previewRect_;         // part of the canvas the preview texture covers
+
+    struct FilterPreviewKey {
+        int  filter        = -1;
+        CanvasRect region;
+        int  proxyW        = 0;
+        int  proxyH        = 0;
+        int  paletteIndex  = 0;
+        std::size_t paletteSize = 0;
+        int  ditherMethod  = 0;
+        bool ditherPreserveAlpha = false;
+        bool ditherGrayscale     = false;
+        int  pixelifySize        = 0;
+        bool pixelifyUsePalette  = false;
+        bool perceptual          = false;   // palette match metric of the active filter
+        int  shapeMode     = 0;
+        int  shapeBgMode   = 0;
+        int  shapeBlock    = 0;
+        int  shapePadding  = 0;
+        bool shapeUsePalette = false;
+        std::array<bool, 64> shapeCustomMap = {};
+
+        [[nodiscard]] bool operator==(const FilterPreviewKey&) const noexcept = default;
+    };
+
+    tools::FilterPreviewWorker filterPreview_;
+    FilterPreviewKey           lastPreviewKey_;
+
+#if defined(USE_METAL_BACKEND)
+    void* previewMetalTexture = nullptr;
+#else
+    unsigned int previewTextureID = 0;
+#endif
+    int  previewTextureWidth  = 0;
+    int  previewTextureHeight = 0;
+    bool previewTextureValid  = false;
+
+    void UpdateFilterPreview();        // per frame: resubmit when params/layer changed
+    void UpdatePreviewTexture();       // per frame: upload a finished preview result
+    void CancelFilterPreview();        // stop the worker and hide the overlay
+    void DestroyPreviewTexture();
+    [[nodiscard]] FilterPreviewKey MakeFilterPreviewKey(int proxyW, int proxyH) const;
+    [[nodiscard]] tools::FilterPreviewWorker::FilterFn
+        MakePreviewFilter(const FilterPreviewKey& key, float proxyScale) const;
+
+    // Palette used by the Filter tab (customPalette, else the selected preset).
+    // Empty when no palette is selected.
+    [[nodiscard]] std::span<const Pixel> CurrentFilterPalette() const noexcept;
 
     // ====================================================================
     // Export settings
@@ -238,6 +350,14 @@ private:
     int depthMapGridSize   = 8;
     int meshExportGridSize = 8;
     int meshExportMode     = 0;
+    bool meshExportQuantize = false;  // GLB: KHR_mesh_quantization
+    int meshLoPolyTriangles = 4000;   // LoPoly simplification target
+    bool svgPathUseClasses = false;   // SVG Paths: CSS classes, palette-indexed
+    bool svgNearMinimal    = false;   // SVG: RectMergeMode::NearMinimal (full-plane labels)
+    bool tgaUseRle         = true;    // TGA: run-length encoded (type 10)
+    bool pngFastCompression = false;  // PNG: PngLevel::Fast instead of Small
+    int jpegQuality = 90;
+    float jpegMatte[3] = { 1.0f, 1.0f, 1.0f };  // JPEG: background behind alpha
 
     // ====================================================================
     // ShapeRedraw brush
@@ -253,6 +373,7 @@ private:
     int                   shapeRedrawFilterBlockSize  = 8;
     int                   shapeRedrawFilterPadding    = 1;
     bool                  shapeRedrawFilterUsePalette = false;
+    bool                  shapeRedrawFilterPerceptual = false;
 
     std::array<bool, 64>  shapeRedrawCustomMap = {};
 
@@ -292,9 +413,10 @@ private:
     // Frequent / recent colours
     // ====================================================================
 
-    std::vector<Pixel> frequentColors;
-    int                maxMostUsedColors = 16;
-    void               UpdateFrequentColors();
+    std::vector<Pixel>    frequentColors;
+    int                   maxMostUsedColors = 16;
+    tools::LayerHistogram colorHistogram_;   // active layer, updated from dirty tiles
+    void                  UpdateFrequentColors();
 
     // ====================================================================
     // Pressure sensitivity
@@ -321,7 +443,6 @@ private:
     int      gridSize       = 8;
     bool     snapToGrid     = false;
     bool     showPixelCoords = false;
-    bool     autoBackup     = false;
     bool     showGridCenter     = false;
     bool     showGridGoldenRatio = false;
 
@@ -347,16 +468,52 @@ private:
     void        LoadLastDirectory();
     void        SaveLastDirectory(const std::string& dir);
 
-    bool SaveToTGA(const std::string& filename);
-    bool SaveToPNG(const std::string& filename);
-    bool SaveToJPEG(const std::string& filename, int quality = 90);
-    bool SaveToSVGPixel(const std::string& filename);
-    bool SaveToSVGVector(const std::string& filename);
-    bool SaveDepthMap(const std::string& filename);
-    bool SaveMesh(const std::string& filename);
+    // Exports snapshot the composite and encode on a background job.
+    std::vector<std::unique_ptr<exporter::ExportJob>> exportJobs_;
+    std::string exportStatus;   // result of the last finished job
+
+    void StartExport(const std::string& filename, exporter::ExportJob::Task task);
+    void PollExportJobs();
+
+    void SaveToTGA(const std::string& filename);
+    void SaveToPNG(const std::string& filename);
+    void SaveToJPEG(const std::string& filename);
+    void SaveToSVGPixel(const std::string& filename);
+    void SaveToSVGVector(const std::string& filename);
+    void SaveToSVGPaths(const std::string& filename);
+    void SaveDepthMap(const std::string& filename);
+    void SaveMesh(const std::string& filename);
+
+    // Import an image into the active layer (core::ImportImage).  The layer
+    // and its undo step share the decoded tiles until the first edit.
     bool LoadFromImage(const std::string& filename);
-    bool SaveBinary(const std::string& filename);
-    bool LoadBinary(const std::string& filename);
+
+    // Native project (.pelp, core/ProjectFile): every layer and its
+    // properties.  Saving is synchronous; the encode runs on all cores.
+    // Opening is lazy: layers are decoded from the mapped file as they are
+    // drawn or edited, and the "Open project" undo step shares the file.
+    // While a layer is damaged (tiles that failed to decode), a save only
+    // goes ahead when repeated for the same file.
+    bool SaveProject(const std::string& filename);
+    std::string damagedSaveConfirmed_;
+    bool LoadProject(const std::string& filename);
+
+    // Open a project or an image, by extension.
+    bool OpenFile(const std::string& filename);
+
+    // Crash-recovery journal (core/Autosave), kept while autoBackup is on
+    // and deleted on a clean exit.  Each instance has its own; journals
+    // left behind by sessions that did not exit cleanly are offered for
+    // recovery in the Files tab, and a recovered one goes on a clean exit.
+    bool autoBackup = false;
+    std::unique_ptr<core::Autosave> autosave_;
+    std::vector<std::string> autosaveLeftovers_;
+    std::vector<std::string> autosaveRecovered_;
+
+    std::string AutosaveDirectory() const;
+    void        UpdateAutosave();   // once per frame
+    bool        RecoverAutosave(const std::string& journal);
+    void        DrawAutosaveSettings();
 
     // ====================================================================
     // Filters / effects
@@ -369,14 +526,17 @@ private:
     void ApplyOrderedDithering(const std::vector<Pixel>& palette);
     void ApplyDithering(DitheringType type, const std::vector<Pixel>& palette);
     void ApplyPalette(const std::vector<Pixel>& palette);
+    void ExtractPaletteFromLayer();   // replaces customPalette
     void ApplyPixelify(int pixelSize, bool usePalette = true);
     void ApplyShapeRedrawFilter();
 
+    // Adjustment layers (non-destructive; evaluated per tile by Canvas)
+    void AddAdjustmentLayer(AdjustmentType type);
+    void DrawAdjustmentLayerEditor();
+
     void SetupDitheringUI();
 
-    // Helpers used by dithering algorithms
-    void   DiffuseError(int x, int y, int errR, int errG, int errB,
-                        int spreadX, int spreadY, int divisor, int totalWeight);
+    // Helpers used by dithering algorithms (kernels live in tools/Filters.hpp)
     Pixel  FindNearestPaletteColor(const Pixel& color, const std::vector<Pixel>& palette) const;
     float  ColorDistance(const Pixel& a, const Pixel& b) const noexcept;
 
@@ -406,6 +566,7 @@ private:
     void DrawColorTab();
     void DrawFilterTab();
     void DrawFilesTab();
+    void DrawExportJobs();
     void DrawLayersTab();
 
     // ====================================================================
@@ -0,0 +1,773 @@
+#include "Autosave.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include "ImageSurface.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+#include "ProjectFile.hpp"
+#include "../export/BufferedWriter.hpp"
+#include "../export/Deflate.hpp"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+    #include <cerrno>
+    #include <csignal>
+    #include <unistd.h>
+#endif
+
+namespace pelpaint::core {
+
+namespace {
+
+using exporter::Crc32;
+using exporter::PutLittleEndian;
+
+constexpr char          kMagic[4]        = {'P', 'J', 'N', 'L'};
+constexpr std::uint16_t kJournalVersion  = 1;
+constexpr std::size_t   kHeaderSize      = 16;   // magic, version, reserved, tile size, CRC
+constexpr std::uint32_t kCommitChunk     = 0xFFFFFFFEu;
+constexpr std::uint32_t kResetChunk      = 0xFFFFFFFDu;
+constexpr std::size_t   kCommitFixed     = 20;   // size, active, next id, layer count
+constexpr std::uint32_t kTile            = ImageSurface::TileSize;
+constexpr std::uint32_t kMaxDimension    = kMaxCanvasDimension;
+
+constexpr auto          kFrameBudget     = std::chrono::microseconds(1500);
+constexpr std::size_t   kMaxQueuedBytes  = std::size_t{64} << 20;
+constexpr std::size_t   kWriteBlock      = std::size_t{4} << 20;
+constexpr std::uint64_t kCompactMinBytes = std::uint64_t{16} << 20;
+constexpr std::uint64_t kCompactRatio    = 3;    // file size over live data
+
+// Tile hashes.  Content hashes never take the two reserved values.
+constexpr std::uint64_t kEmptyTile  = 0;   // fully transparent
+constexpr std::uint64_t kSourceTile = 1;   // journaled from a pending layer's source
+
+template <typename T>
+void Append(std::vector<std::uint8_t>& out, T value)
+{
+    const std::size_t at = out.size();
+    out.resize(at + sizeof(T));
+    PutLittleEndian(out.data() + at, value);
+}
+
+template <typename T>
+T Read(std::span<const std::uint8_t> bytes, std::size_t at) noexcept
+{
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, bytes.data() + at, 4);
+    if constexpr (std::endian::native == std::endian::big) bits = std::byteswap(bits);
+    return std::bit_cast<T>(bits);
+}
+
+std::vector<std::uint8_t> JournalHeader()
+{
+    std::vector<std::uint8_t> header(std::begin(kMagic), std::end(kMagic));
+    Append(header, kJournalVersion);
+    Append<std::uint16_t>(header, 0);
+    Append(header, kTile);
+    Append(header, Crc32(0, header));
+    return header;
+}
+
+// 64-bit hash of the tw × th pixels at `origin` (rows `stride` apart);
+// kEmptyTile exactly when every pixel is zero.  Four independent lanes
+// keep it close to memory speed.
+std::uint64_t HashTile(const Pixel* origin, std::size_t stride, std::uint32_t tw, std::uint32_t th) noexcept
+{
+    constexpr std::uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    std::uint64_t lane[4] = {1, 2, 3, 4};
+    std::uint64_t any     = 0;
+
+    const std::size_t rowBytes = std::size_t{tw} * sizeof(Pixel);
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        const auto* row = reinterpret_cast<const std::uint8_t*>(origin + ly * stride);
+        std::size_t i = 0;
+        for (; i + 32 <= rowBytes; i += 32) {
+            for (int k = 0; k < 4; ++k) {
+                std::uint64_t word;
+                std::memcpy(&word, row + i + k * 8, 8);
+                any |= word;
+                lane[k] = std::rotl((lane[k] ^ word) * kMul, 31);
+            }
+        }
+        for (; i < rowBytes; i += 4) {
+            std::uint32_t word;
+            std::memcpy(&word, row + i, 4);
+            any |= word;
+            lane[0] = std::rotl((lane[0] ^ word) * kMul, 31);
+        }
+    }
+    if (any == 0) return kEmptyTile;
+
+    std::uint64_t hash = lane[0];
+    for (int k = 1; k < 4; ++k) hash = std::rotl((hash ^ lane[k]) * kMul, 27);
+    hash ^= hash >> 29;
+    return hash <= kSourceTile ? hash + 2 : hash;
+}
+
+struct CommitRecord {
+    std::uint32_t      width  = 0;
+    std::uint32_t      height = 0;
+    std::int32_t       active = 0;
+    std::int32_t       nextId = 0;
+    std::vector<Layer> layers;
+};
+
+bool ReadCommit(std::span<const std::uint8_t> payload, CommitRecord& commit)
+{
+    if (payload.size() < kCommitFixed) return false;
+    commit.width  = Read<std::uint32_t>(payload, 0);
+    commit.height = Read<std::uint32_t>(payload, 4);
+    commit.active = Read<std::int32_t>(payload, 8);
+    commit.nextId = Read<std::int32_t>(payload, 12);
+    const auto count = Read<std::uint32_t>(payload, 16);
+    return commit.width != 0 && commit.height != 0 &&
+           commit.width <= kMaxDimension && commit.height <= kMaxDimension && count != 0 &&
+           ReadLayerRecords(payload.subspan(kCommitFixed), count, commit.layers);
+}
+
+std::uint64_t ProcessId() noexcept
+{
+#if defined(_WIN32)
+    return GetCurrentProcessId();
+#elif defined(__EMSCRIPTEN__)
+    return 0;
+#else
+    return static_cast<std::uint64_t>(::getpid());
+#endif
+}
+
+// Whether process `id` still runs.  A browser page is the only instance
+// there is, so under Emscripten every other journal is left over.
+bool ProcessRunning(std::uint64_t id) noexcept
+{
+#if defined(_WIN32)
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(id));
+    if (process == nullptr) return GetLastError() == ERROR_ACCESS_DENIED;
+    DWORD code = 0;
+    const bool running = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+    CloseHandle(process);
+    return running;
+#elif defined(__EMSCRIPTEN__)
+    (void)id;
+    return false;
+#else
+    if (id == 0 || id > static_cast<std::uint64_t>(std::numeric_limits<pid_t>::max())) return false;
+    return ::kill(static_cast<pid_t>(id), 0) == 0 || errno == EPERM;
+#endif
+}
+
+constexpr std::string_view kJournalPrefix    = "autosave-";
+constexpr std::string_view kJournalExtension = ".pjnl";
+
+} // namespace
+
+// ============================================================
+// Batch
+// ============================================================
+
+std::size_t Autosave::Batch::Bytes() const noexcept
+{
+    return pixels.size() * sizeof(Pixel) + tiles.size() * sizeof(CapturedTile) + commit.size();
+}
+
+// ============================================================
+// Lifetime
+// ============================================================
+
+Autosave::Autosave(std::string filename, std::chrono::milliseconds interval)
+    : filename_(std::move(filename))
+    , interval_(interval)
+{
+    const auto header = JournalHeader();
+    file_ = std::fopen(filename_.c_str(), "wb");
+    if (file_ == nullptr || std::fwrite(header.data(), 1, header.size(), file_) != header.size() ||
+        std::fflush(file_) != 0) {
+        failed_.store(true, std::memory_order_relaxed);
+        return;
+    }
+    fileSize_ = header.size();
+
+    if constexpr (ThreadsAvailable) {
+        try {
+            threaded_ = true;
+            writer_   = std::thread([this] { Run(); });
+        } catch (const std::system_error&) {
+            threaded_ = false;   // Pump writes
+        }
+    }
+}
+
+Autosave::~Autosave()
+{
+    Stop();
+}
+
+void Autosave::Stop()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) writer_.join();
+    if (!threaded_) WriteQueued(Clock::time_point::max());
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+void Autosave::Discard()
+{
+    // Nothing queued is worth writing to a file about to be deleted, and
+    // the batch (or compaction) in progress stops at its next tile.
+    {
+        std::lock_guard lock(mutex_);
+        std::size_t dropped = 0;
+        for (const Batch& batch : queue_) dropped += batch.Bytes();
+        queue_.clear();
+        queuedBytes_.fetch_sub(dropped, std::memory_order_relaxed);
+    }
+    discard_.store(true, std::memory_order_relaxed);
+    Stop();
+    std::error_code ec;
+    std::filesystem::remove(filename_, ec);
+    std::filesystem::remove(filename_ + ".part", ec);
+}
+
+// ============================================================
+// Capture (UI thread)
+// ============================================================
+
+void Autosave::Pump(const Canvas& canvas)
+{
+    if (!Ok()) return;
+
+    // Without a writer thread, writing what is queued comes first and
+    // capture gets what is left of the frame.
+    const auto now      = Clock::now();
+    const auto frameEnd = now + kFrameBudget;
+    if (!threaded_) {
+        WriteQueued(frameEnd);
+        if (!Ok()) return;
+    }
+
+    if (!capturing_) {
+        if (now - lastStart_ < interval_) return;
+        lastStart_ = now;
+        if (!Changed(canvas)) return;
+        Begin(canvas);
+    } else if (!SameStack(canvas)) {
+        Begin(canvas);   // layers added, removed or moved, or the canvas resized
+    }
+
+    Capture(canvas, frameEnd);
+    if (next_ == work_.size()) Commit(canvas);
+    Submit();
+}
+
+void Autosave::WriteQueued(Clock::time_point deadline)
+{
+    while (!queue_.empty() && Clock::now() < deadline) {
+        const Batch& batch = queue_.front();
+        try {
+            written_ = Write(batch, written_, deadline);
+        } catch (...) {
+            failed_.store(true, std::memory_order_relaxed);
+        }
+        if (Ok() && written_ < batch.tiles.size()) return;
+
+        queuedBytes_.fetch_sub(batch.Bytes(), std::memory_order_relaxed);
+        queue_.pop_front();
+        written_ = 0;
+    }
+}
+
+bool Autosave::Changed(const Canvas& canvas) const
+{
+    if (canvas.Revision() != committedRevision_ ||
+        static_cast<std::uint32_t>(canvas.Width())  != width_ ||
+        static_cast<std::uint32_t>(canvas.Height()) != height_) {
+        return true;
+    }
+    // Names, opacity, visibility and the like do not move the revision.
+    std::vector<std::uint8_t> records;
+    AppendLayerRecords(records, canvas.Layers());
+    return records != committedRecords_;
+}
+
+bool Autosave::SameStack(const Canvas& canvas) const
+{
+    const auto& layers = canvas.Layers();
+    if (static_cast<std::uint32_t>(canvas.Width())  != width_ ||
+        static_cast<std::uint32_t>(canvas.Height()) != height_ ||
+        layers.size() > positions_.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+        if (layers[i].zIndex != positions_[i].zIndex || layers[i].IsAdjustment() != positions_[i].adjustment) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Autosave::Begin(const Canvas& canvas)
+{
+    const auto& layers = canvas.Layers();
+    const auto  width  = static_cast<std::uint32_t>(canvas.Width());
+    const auto  height = static_cast<std::uint32_t>(canvas.Height());
+
+    work_.clear();
+    if (width != width_ || height != height_) {
+        // Everything journaled so far no longer fits: start over.
+        width_  = width;
+        height_ = height;
+        tilesX_ = (width  + kTile - 1) / kTile;
+        tilesY_ = (height + kTile - 1) / kTile;
+        positions_.clear();
+        batch_.reset = true;
+        for (std::uint32_t ty = 0; ty < tilesY_; ++ty) {
+            for (std::uint32_t tx = 0; tx < tilesX_; ++tx) work_.emplace_back(tx, ty);
+        }
+    } else {
+        canvas.CollectTilesChangedSince(committedRevision_, work_);
+    }
+    batch_.width  = width_;
+    batch_.height = height_;
+    startRevision_ = canvas.Revision();
+    next_          = 0;
+    capturing_     = true;
+
+    // Positions past the end stay until a commit drops them, as in the
+    // journal.
+    if (positions_.size() < layers.size()) positions_.resize(layers.size());
+    const std::size_t tiles = std::size_t{tilesX_} * tilesY_;
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+        const Layer& layer = layers[i];
+        Position&    pos   = positions_[i];
+        pos.zIndex     = layer.zIndex;
+        pos.adjustment = layer.IsAdjustment();
+        if (pos.hashes.size() != tiles) pos.hashes.assign(tiles, kEmptyTile);
+
+        if (!layer.IsPending()) {
+            pos.source.reset();
+            continue;
+        }
+        if (pos.source == layer.source && pos.sourceLayer == layer.sourceLayer) continue;
+
+        // A pending layer is journaled whole, straight from its source; it
+        // cannot change until it is materialized.
+        const std::size_t source = batch_.sources.size();
+        batch_.sources.emplace_back(layer.source, layer.sourceLayer);
+        for (std::uint32_t ty = 0; ty < tilesY_; ++ty) {
+            for (std::uint32_t tx = 0; tx < tilesX_; ++tx) {
+                std::uint64_t& hash = pos.hashes[std::size_t{ty} * tilesX_ + tx];
+                const bool     has  = layer.source->HasTile(layer.sourceLayer, tx, ty);
+                if (!has && hash == kEmptyTile) continue;
+                batch_.tiles.push_back({static_cast<std::uint32_t>(i), tx, ty, has ? source : kNone, kNone});
+                hash = has ? kSourceTile : kEmptyTile;
+            }
+        }
+        pos.source      = layer.source;
+        pos.sourceLayer = layer.sourceLayer;
+    }
+}
+
+void Autosave::Capture(const Canvas& canvas, Clock::time_point deadline)
+{
+    const auto&       layers = canvas.Layers();
+    const std::size_t plane  = std::size_t{width_} * height_;
+
+    while (next_ < work_.size()) {
+        if (Clock::now() >= deadline ||
+            queuedBytes_.load(std::memory_order_relaxed) + batch_.Bytes() > kMaxQueuedBytes) {
+            return;
+        }
+
+        const auto [tx, ty] = work_[next_++];
+        const std::uint32_t tw = std::min(kTile, width_  - tx * kTile);
+        const std::uint32_t th = std::min(kTile, height_ - ty * kTile);
+        const std::size_t   at = std::size_t{ty} * kTile * width_ + std::size_t{tx} * kTile;
+
+        for (std::size_t i = 0; i < layers.size(); ++i) {
+            const Layer& layer = layers[i];
+            if (layer.IsAdjustment() || layer.IsPending() || layer.pixelData.size() != plane) continue;
+
+            const Pixel*        origin = layer.pixelData.data() + at;
+            const std::uint64_t hash   = HashTile(origin, width_, tw, th);
+            std::uint64_t&      slot   = positions_[i].hashes[std::size_t{ty} * tilesX_ + tx];
+            if (hash == slot) continue;
+            slot = hash;
+
+            CapturedTile tile{static_cast<std::uint32_t>(i), tx, ty, kNone, kNone};
+            if (hash != kEmptyTile) {
+                tile.pixels = batch_.pixels.size();
+                for (std::uint32_t ly = 0; ly < th; ++ly) {
+                    batch_.pixels.insert(batch_.pixels.end(), origin + ly * width_, origin + ly * width_ + tw);
+                }
+            }
+            batch_.tiles.push_back(tile);
+        }
+    }
+}
+
+void Autosave::Commit(const Canvas& canvas)
+{
+    const auto& layers = canvas.Layers();
+
+    std::vector<std::uint8_t> records;
+    AppendLayerRecords(records, layers);
+
+    auto& payload = batch_.commit;
+    payload.clear();
+    Append(payload, width_);
+    Append(payload, height_);
+    Append<std::int32_t>(payload, canvas.ActiveLayerIndex());
+    Append<std::int32_t>(payload, canvas.NextLayerId());
+    Append(payload, static_cast<std::uint32_t>(layers.size()));
+    payload.insert(payload.end(), records.begin(), records.end());
+    batch_.commitLayers = static_cast<std::uint32_t>(layers.size());
+
+    positions_.resize(layers.size());
+    committedRecords_  = std::move(records);
+    committedRevision_ = startRevision_;
+    capturing_         = false;
+}
+
+void Autosave::Submit()
+{
+    if (batch_.Empty()) return;
+
+    Batch batch = std::move(batch_);
+    batch_        = Batch{};
+    batch_.width  = width_;
+    batch_.height = height_;
+    batch_.pixels.reserve(batch.pixels.size());   // the next frame likely copies as much
+
+    queuedBytes_.fetch_add(batch.Bytes(), std::memory_order_relaxed);
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(std::move(batch));
+    }
+    wake_.notify_one();
+}
+
+// ============================================================
+// Writer thread
+// ============================================================
+
+void Autosave::Run() noexcept
+{
+    for (;;) {
+        Batch batch;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return;   // stopping, and everything is written
+            batch = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        try {
+            Write(batch);
+        } catch (...) {
+            failed_.store(true, std::memory_order_relaxed);
+        }
+        queuedBytes_.fetch_sub(batch.Bytes(), std::memory_order_relaxed);
+    }
+}
+
+std::size_t Autosave::Write(const Batch& batch, std::size_t first, Clock::time_point deadline)
+{
+    if (!Ok()) return batch.tiles.size();
+
+    if (batch.reset && first == 0) {
+        AppendRawChunk(out_, kResetChunk, {});
+        index_.clear();
+        liveBytes_ = 0;
+    }
+
+    const std::uint32_t tilesX = (batch.width  + kTile - 1) / kTile;
+    const std::uint32_t tilesY = (batch.height + kTile - 1) / kTile;
+    for (std::size_t i = first; i < batch.tiles.size(); ++i) {
+        if (discard_.load(std::memory_order_relaxed)) return batch.tiles.size();
+        if (i > first && Clock::now() >= deadline) return i;
+
+        const CapturedTile& t = batch.tiles[i];
+
+        const std::uint32_t tw = std::min(kTile, batch.width  - t.tx * kTile);
+        const std::uint32_t th = std::min(kTile, batch.height - t.ty * kTile);
+        const std::size_t   n  = std::size_t{tw} * th;
+
+        std::span<const Pixel> pixels;
+        if (t.pixels != kNone) {
+            pixels = std::span(batch.pixels).subspan(t.pixels, n);
+        } else {
+            scratch_.assign(n, Pixel{0, 0, 0, 0});
+            if (t.source != kNone) {
+                // A damaged source tile is not journaled: whatever the
+                // journal already holds for it is a better recovery than
+                // the half-decoded buffer.
+                const auto& [source, sourceLayer] = batch.sources[t.source];
+                if (!source->DecodeTile(sourceLayer, t.tx, t.ty, scratch_)) continue;
+            }
+            pixels = scratch_;
+        }
+
+        const std::uint64_t offset = fileSize_ + out_.size();
+        AppendTileChunk(out_, pixels, t.layer, t.tx, t.ty);
+
+        if (index_.size() <= t.layer) index_.resize(t.layer + 1);
+        auto& refs = index_[t.layer];
+        if (refs.size() != std::size_t{tilesX} * tilesY) refs.assign(std::size_t{tilesX} * tilesY, ChunkRef{});
+        ChunkRef& ref = refs[std::size_t{t.ty} * tilesX + t.tx];
+        liveBytes_ -= ref.size;
+        const bool transparent = t.pixels == kNone && t.source == kNone;
+        ref = {offset, transparent ? 0u : static_cast<std::uint32_t>(fileSize_ + out_.size() - offset)};
+        liveBytes_ += ref.size;
+
+        if (out_.size() >= kWriteBlock && !Flush()) return batch.tiles.size();
+    }
+
+    if (batch.commit.empty()) {
+        Flush();
+        return batch.tiles.size();
+    }
+
+    lastCommit_.clear();
+    AppendRawChunk(lastCommit_, kCommitChunk, batch.commit);
+    out_.insert(out_.end(), lastCommit_.begin(), lastCommit_.end());
+    if (!Flush() || std::fflush(file_) != 0) {
+        failed_.store(true, std::memory_order_relaxed);
+        return batch.tiles.size();
+    }
+
+    // The commit drops layer positions past its layer count.
+    for (std::size_t i = batch.commitLayers; i < index_.size(); ++i) {
+        for (const ChunkRef& ref : index_[i]) liveBytes_ -= ref.size;
+    }
+    if (index_.size() > batch.commitLayers) index_.resize(batch.commitLayers);
+
+    // Compaction copies the whole journal in one go: too long a stall for
+    // Pump, so single-threaded builds let the journal grow instead.
+    const std::uint64_t live = kHeaderSize + liveBytes_ + lastCommit_.size();
+    if (threaded_ && !discard_.load(std::memory_order_relaxed) &&
+        fileSize_ > kCompactMinBytes && fileSize_ > kCompactRatio * live) {
+        Compact();
+    }
+    return batch.tiles.size();
+}
+
+bool Autosave::Flush()
+{
+    if (!out_.empty() && std::fwrite(out_.data(), 1, out_.size(), file_) != out_.size()) {
+        failed_.store(true, std::memory_order_relaxed);
+        out_.clear();
+        return false;
+    }
+    fileSize_ += out_.size();
+    out_.clear();
+    return true;
+}
+
+// Rewrite the journal as the latest chunk of every live tile plus the last
+// commit, beside the old one, and rename it over.  Chunks are copied as they
+// are: their CRCs cover only themselves.
+void Autosave::Compact()
+{
+    const std::string partName = filename_ + ".part";
+    auto compacted = index_;
+    std::uint64_t size = 0;
+    bool ok = false;
+    {
+        const MappedFile journal(filename_);
+        const auto       bytes = journal.Bytes();
+        exporter::BufferedWriter out(partName);
+
+        const auto header = JournalHeader();
+        out.WriteBytes(header.data(), header.size());
+        size = header.size();
+        ok   = journal.Ok();
+        for (auto& refs : compacted) {
+            for (ChunkRef& ref : refs) {
+                ok = ok && !discard_.load(std::memory_order_relaxed);
+                if (!ok) break;
+                if (ref.size == 0) continue;
+                ok = ref.offset + ref.size <= bytes.size();
+                if (!ok) break;
+                out.WriteBytes(bytes.data() + ref.offset, ref.size);
+                ref.offset = size;
+                size += ref.size;
+            }
+        }
+        out.WriteBytes(lastCommit_.data(), lastCommit_.size());
+        size += lastCommit_.size();
+        ok = out.Finish() && ok;
+    }
+
+    std::error_code ec;
+    if (ok) {
+        std::fclose(file_);
+        std::filesystem::rename(partName, filename_, ec);
+        file_ = std::fopen(filename_.c_str(), "ab");
+        if (ec || file_ == nullptr) {
+            failed_.store(true, std::memory_order_relaxed);
+            return;
+        }
+        index_    = std::move(compacted);
+        fileSize_ = size;
+    } else {
+        std::filesystem::remove(partName, ec);
+    }
+}
+
+// ============================================================
+// Recovery
+// ============================================================
+
+std::string AutosaveFilename(const std::string& directory)
+{
+    // The start time keeps the name of a later process that is given the
+    // same id apart from a journal left over by an earlier one.
+    static const std::string name = [] {
+        const auto started = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return std::string(kJournalPrefix) + std::to_string(ProcessId()) + "-" +
+               std::to_string(started) + std::string(kJournalExtension);
+    }();
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::vector<std::string> LeftoverAutosaves(const std::string& directory)
+{
+    namespace fs = std::filesystem;
+    const fs::path own = AutosaveFilename(directory);
+
+    std::vector<std::pair<fs::file_time_type, std::string>> found;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path&   path = it->path();
+        const std::string name = path.filename().string();
+        if (!name.starts_with(kJournalPrefix) || path.extension() != kJournalExtension || path == own) continue;
+
+        std::uint64_t id = 0;
+        const char*   first = name.data() + kJournalPrefix.size();
+        const auto [last, error] = std::from_chars(first, name.data() + name.size(), id);
+        if (error != std::errc{} || *last != '-') continue;
+        if (id != ProcessId() && ProcessRunning(id)) continue;   // another instance's live journal
+
+        std::error_code timeError;
+        found.emplace_back(it->last_write_time(timeError), path.string());
+    }
+    std::sort(found.begin(), found.end(), std::greater<>{});
+
+    std::vector<std::string> journals;
+    for (auto& [time, path] : found) journals.push_back(std::move(path));
+    return journals;
+}
+
+bool RecoverAutosave(const std::string& filename, CanvasSnapshot& project, int& nextLayerId)
+{
+    const MappedFile file(filename);
+    if (!file.Ok()) return false;
+    const auto bytes  = file.Bytes();
+    const auto header = JournalHeader();
+    if (bytes.size() < kHeaderSize || !std::equal(header.begin(), header.end(), bytes.begin())) return false;
+
+    // Committed state: pixels per layer position (empty while transparent)
+    // and the last layer table.
+    std::uint32_t                   width  = 0;
+    std::uint32_t                   height = 0;
+    std::vector<std::vector<Pixel>> planes;
+    CommitRecord                    state;
+    bool                            recovered = false;
+
+    std::vector<std::size_t> pending;   // tile chunks since the last commit
+    bool                     reset = false;
+    std::vector<Pixel>       tile;
+
+    ProjectChunk chunk;
+    for (std::size_t offset = kHeaderSize; offset < bytes.size() && ReadChunk(bytes, offset, chunk);
+         offset += chunk.size) {
+        if (chunk.layer == kResetChunk) {
+            pending.clear();
+            reset = true;
+            continue;
+        }
+        if (chunk.layer != kCommitChunk) {
+            pending.push_back(offset);
+            continue;
+        }
+
+        CommitRecord commit;
+        if (!ReadCommit(chunk.payload, commit)) break;
+        if (reset || commit.width != width || commit.height != height) {
+            if (!reset && recovered) break;   // a resize always follows a reset
+            planes.clear();
+            width  = commit.width;
+            height = commit.height;
+        }
+        planes.resize(commit.layers.size());
+
+        const std::uint32_t tilesX = (width  + kTile - 1) / kTile;
+        const std::uint32_t tilesY = (height + kTile - 1) / kTile;
+        for (const std::size_t at : pending) {
+            ProjectChunk t;
+            ReadChunk(bytes, at, t);
+            if (t.layer >= planes.size() || t.tx >= tilesX || t.ty >= tilesY) continue;
+            const std::uint32_t tw = std::min(kTile, width  - t.tx * kTile);
+            const std::uint32_t th = std::min(kTile, height - t.ty * kTile);
+            tile.resize(std::size_t{tw} * th);
+            if (!DecodeTileChunk(t, tile)) continue;
+
+            auto& plane = planes[t.layer];
+            const bool empty = std::all_of(tile.begin(), tile.end(), [](const Pixel& p) {
+                return p.r == 0 && p.g == 0 && p.b == 0 && p.a == 0;
+            });
+            if (plane.empty()) {
+                if (empty) continue;
+                plane.assign(std::size_t{width} * height, Pixel{0, 0, 0, 0});
+            }
+            Pixel* dst = plane.data() + std::size_t{t.ty} * kTile * width + std::size_t{t.tx} * kTile;
+            for (std::uint32_t ly = 0; ly < th; ++ly) {
+                std::copy_n(tile.data() + std::size_t{ly} * tw, tw, dst + std::size_t{ly} * width);
+            }
+        }
+
+        state     = std::move(commit);
+        recovered = true;
+        reset     = false;
+        pending.clear();
+    }
+    if (!recovered) return false;
+
+    for (std::size_t i = 0; i < state.layers.size(); ++i) {
+        Layer& layer = state.layers[i];
+        if (layer.IsAdjustment()) continue;
+        if (planes[i].empty()) layer.pixelData.assign(std::size_t{width} * height, Pixel{0, 0, 0, 0});
+        else                   layer.pixelData = std::move(planes[i]);
+    }
+
+    project.layers           = std::move(state.layers);
+    project.activeLayerIndex = std::clamp<int>(state.active, 0, static_cast<int>(project.layers.size()) - 1);
+    project.canvasWidth      = static_cast<int>(width);
+    project.canvasHeight     = static_cast<int>(height);
+    project.description.clear();
+    nextLayerId = state.nextId;
+    return true;
+}
+
+} // namespace pelpaint::core
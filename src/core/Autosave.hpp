@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "TileSource.hpp"
+#include "Types.hpp"
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// Autosave journal
+//
+// Crash recovery for the open canvas.  Every `interval` the tiles changed
+// since the previous autosave are appended to a journal file and closed by
+// a commit record; recovery replays the journal up to its last commit.
+//
+//   • Capture runs on the UI thread (Pump) within a fixed time budget per
+//     frame.  Changed tiles come from Canvas::CollectTilesChangedSince and
+//     are hashed per layer; only tiles whose hash moved since they were
+//     last journaled are copied.  A capture that does not fit in one frame
+//     carries on in the next, so a whole-canvas change on a 16K canvas
+//     costs the budget per frame, never a stall.
+//   • Copies go to a writer thread in immutable batches.  It encodes them
+//     as .pelp tile chunks (core/ProjectFile) and appends them to the
+//     journal.  Pending layers are not copied; the writer decodes them
+//     from their source.  Capture pauses while too much is queued.
+//   • Tiles are addressed by layer position.  A tile not written again
+//     keeps its content from the previous commit, a commit with fewer
+//     layers drops the rest, and a reset record (canvas resized) starts
+//     over from transparent.
+//   • When the journal has grown to several times the data it still
+//     describes, the writer rewrites it with the latest chunk of each tile
+//     and renames it over the old one.
+//
+// File: magic "PJNL", version, tile size, CRC-32, then chunks laid out as
+// in a project file.  Chunk layer 0xFFFFFFFE is a commit (canvas size,
+// active layer, next layer id, layer count, layer records), 0xFFFFFFFD a
+// reset.  Anything after the last commit, such as a chunk cut short by a
+// crash, is ignored.
+//
+// Single-threaded builds write the queue from Pump, tile by tile, within
+// the same frame budget as capture, and never compact.
+// ---------------------------------------------------------------------------
+
+class Autosave {
+public:
+    // Start a new journal at `filename`, replacing any existing one.
+    explicit Autosave(std::string filename,
+                      std::chrono::milliseconds interval = std::chrono::seconds(30));
+    ~Autosave();   // writes what is queued and stops the writer; the journal stays
+
+    Autosave(const Autosave&)            = delete;
+    Autosave& operator=(const Autosave&) = delete;
+
+    // Capture and hand over the next slice of work.  Once per frame, on the
+    // UI thread.
+    void Pump(const Canvas& canvas);
+
+    // Stop and delete the journal (clean exit, autosave switched off).
+    // Whatever is still queued is dropped rather than written first.
+    void Discard();
+
+    [[nodiscard]] const std::string& Filename() const noexcept { return filename_; }
+
+    // False once a write has failed; nothing more is journaled.
+    [[nodiscard]] bool Ok() const noexcept { return !failed_.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kNone = ~std::size_t{0};
+
+    struct CapturedTile {
+        std::uint32_t layer  = 0;
+        std::uint32_t tx     = 0;
+        std::uint32_t ty     = 0;
+        std::size_t   source = kNone;   // index into Batch::sources
+        std::size_t   pixels = kNone;   // offset into Batch::pixels; neither: transparent
+    };
+
+    // One frame's worth of captured work; never changes once queued.
+    struct Batch {
+        std::uint32_t             width  = 0;
+        std::uint32_t             height = 0;
+        bool                      reset  = false;   // written before the tiles
+        std::vector<CapturedTile> tiles;
+        std::vector<Pixel>        pixels;
+        std::vector<std::pair<std::shared_ptr<const TileSource>, std::uint32_t>> sources;
+        std::vector<std::uint8_t> commit;           // commit payload, if the batch ends a generation
+        std::uint32_t             commitLayers = 0;
+
+        [[nodiscard]] bool        Empty() const noexcept { return tiles.empty() && !reset && commit.empty(); }
+        [[nodiscard]] std::size_t Bytes() const noexcept;
+    };
+
+    // What the journal holds at one layer position, as seen from the UI
+    // side.  hashes[] per tile: kEmptyTile, kSourceTile or a content hash.
+    struct Position {
+        std::vector<std::uint64_t>        hashes;
+        std::shared_ptr<const TileSource> source;       // journaled whole while pending
+        std::uint32_t                     sourceLayer = 0;
+        std::int32_t                      zIndex      = 0;
+        bool                              adjustment  = false;
+    };
+
+    // Where the latest chunk of one tile sits in the journal.
+    struct ChunkRef {
+        std::uint64_t offset = 0;
+        std::uint32_t size   = 0;   // 0: none, or transparent
+    };
+
+    // ---- UI thread -----------------------------------------------------
+
+    [[nodiscard]] bool Changed(const Canvas& canvas) const;
+    [[nodiscard]] bool SameStack(const Canvas& canvas) const;
+    void Begin(const Canvas& canvas);
+    void Capture(const Canvas& canvas, Clock::time_point deadline);
+    void Commit(const Canvas& canvas);
+    void Submit();
+    void WriteQueued(Clock::time_point deadline);   // no writer thread
+    void Stop();
+
+    // ---- Writer thread -------------------------------------------------
+
+    void Run() noexcept;
+    // Write the tiles of `batch` from `first` on, then its commit; stops
+    // early at `deadline` and returns the first tile not yet written.
+    std::size_t Write(const Batch& batch, std::size_t first = 0,
+                      Clock::time_point deadline = Clock::time_point::max());
+    bool Flush();
+    void Compact();
+
+    std::string               filename_;
+    Clock::duration           interval_;
+
+    // UI side
+    std::uint32_t             width_  = 0;
+    std::uint32_t             height_ = 0;
+    std::uint32_t             tilesX_ = 0;
+    std::uint32_t             tilesY_ = 0;
+    std::vector<Position>     positions_;
+    std::vector<std::uint8_t> committedRecords_;     // layer records of the last commit
+    std::uint64_t             committedRevision_ = 0;
+    std::uint64_t             startRevision_     = 0;
+    Clock::time_point         lastStart_{};
+    bool                      capturing_ = false;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> work_;
+    std::size_t               next_ = 0;
+    Batch                     batch_;
+
+    // Writer side
+    std::FILE*                file_     = nullptr;
+    std::uint64_t             fileSize_ = 0;
+    std::uint64_t             liveBytes_ = 0;        // bytes a compacted journal would need
+    std::vector<std::vector<ChunkRef>> index_;       // per layer position, per tile
+    std::vector<std::uint8_t> lastCommit_;           // the last commit chunk
+    std::vector<std::uint8_t> out_;
+    std::vector<Pixel>        scratch_;
+
+    std::mutex                mutex_;
+    std::condition_variable   wake_;
+    std::deque<Batch>         queue_;
+    bool                      stop_ = false;
+    std::atomic<std::size_t>  queuedBytes_{0};
+    std::atomic<bool>         failed_{false};
+    std::atomic<bool>         discard_{false};   // Discard(): stop writing at once
+    bool                      threaded_ = false;   // writer_ runs; set before it starts
+    std::size_t               written_  = 0;       // tiles of queue_.front() written by Pump
+    std::thread               writer_;   // last: starts after everything above
+};
+
+// Every running instance journals to its own file in a shared directory,
+// named after its process id and start time.  A journal whose process is
+// no longer running was left by a session that did not exit cleanly.
+
+// This process's journal in `directory`.
+std::string AutosaveFilename(const std::string& directory);
+
+// Journals in `directory` whose process has exited, newest first.
+std::vector<std::string> LeftoverAutosaves(const std::string& directory);
+
+// Rebuild the canvas from the last commit in the journal `filename`.
+// Layers come back with their pixels.  False, with both untouched, when
+// there is no journal or it holds no complete commit.
+bool RecoverAutosave(const std::string& filename, CanvasSnapshot& project, int& nextLayerId);
+
+} // namespace pelpaint::core
@@ -1,9 +1,16 @@
 #include "Canvas.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <numeric>
+#include <system_error>
+
+#include "Parallel.hpp"
+#include "TileSource.hpp"
+#include "../tools/Filters.hpp"
 
 // Verify binary layout compatibility between pelpaint::Pixel and core::PixelRGBA8.
 // Both are plain 4-byte RGBA structs — safe to reinterpret between them.
@@ -14,6 +21,133 @@ static_assert(alignof(pelpaint::Pixel)       == alignof(pelpaint::core::PixelRGB
 
 namespace pelpaint {
 
+namespace {
+
+constexpr std::uint32_t kTileSize = core::ImageSurface::TileSize;
+
+// Clamp parameters to what per-tile evaluation supports.
+Adjustment NormalizeAdjustment(Adjustment adjustment)
+{
+    const int block = std::clamp(adjustment.blockSize, 1, static_cast<int>(kTileSize));
+    adjustment.blockSize = static_cast<int>(std::bit_floor(static_cast<unsigned>(block)));
+    return adjustment;
+}
+
+// Run an adjustment over the tw × th valid region of a composite tile.
+// Kernels expect a packed buffer, so the region is copied into scratch,
+// adjusted there and written back — mixed with the unadjusted colour when
+// the layer opacity is below 1.
+void ApplyAdjustmentToTile(const Layer& layer, Pixel* tile,
+                           std::uint32_t tw, std::uint32_t th,
+                           std::vector<Pixel>& scratch)
+{
+    if (layer.opacity <= 0.0f) return;
+
+    const std::size_t count = static_cast<std::size_t>(tw) * th;
+    scratch.resize(count);
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        std::copy_n(tile + static_cast<std::size_t>(ly) * kTileSize, tw,
+                    scratch.data() + static_cast<std::size_t>(ly) * tw);
+    }
+
+    tools::ApplyAdjustment(layer.adjustment, std::span<Pixel>(scratch.data(), count),
+                           static_cast<int>(tw), static_cast<int>(th));
+
+    const float alpha = std::min(1.0f, layer.opacity);
+    const float inv   = 1.0f - alpha;
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        const Pixel* src = scratch.data() + static_cast<std::size_t>(ly) * tw;
+        Pixel*       dst = tile + static_cast<std::size_t>(ly) * kTileSize;
+        if (alpha >= 1.0f) {
+            std::copy_n(src, tw, dst);
+            continue;
+        }
+        for (std::uint32_t lx = 0; lx < tw; ++lx) {
+            dst[lx].r = static_cast<uint8_t>(dst[lx].r * inv + src[lx].r * alpha);
+            dst[lx].g = static_cast<uint8_t>(dst[lx].g * inv + src[lx].g * alpha);
+            dst[lx].b = static_cast<uint8_t>(dst[lx].b * inv + src[lx].b * alpha);
+            dst[lx].a = static_cast<uint8_t>(dst[lx].a * inv + src[lx].a * alpha);
+        }
+    }
+}
+
+// A pixel layer as an undo snapshot holds it: an immutable copy that
+// consecutive snapshots share while the layer is not edited.
+class FrozenLayer final : public core::TileSource {
+public:
+    FrozenLayer(std::uint32_t w, std::uint32_t h, std::vector<Pixel> pixels) noexcept
+        : width_(w), height_(h), pixels_(std::move(pixels)) {}
+
+    [[nodiscard]] std::uint32_t Width()  const noexcept override { return width_;  }
+    [[nodiscard]] std::uint32_t Height() const noexcept override { return height_; }
+
+    [[nodiscard]] bool HasTile(std::uint32_t, std::uint32_t, std::uint32_t) const noexcept override { return true; }
+
+    bool DecodeTile(std::uint32_t, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const override
+    {
+        const std::uint32_t x0 = tx * kTileSize;
+        const std::uint32_t y0 = ty * kTileSize;
+        if (x0 >= width_ || y0 >= height_) return false;
+        const std::uint32_t tw = std::min(kTileSize, width_  - x0);
+        const std::uint32_t th = std::min(kTileSize, height_ - y0);
+        if (out.size() < std::size_t{tw} * th) return false;
+        for (std::uint32_t ly = 0; ly < th; ++ly) {
+            std::copy_n(pixels_.data() + static_cast<std::size_t>(y0 + ly) * width_ + x0, tw,
+                        out.data() + static_cast<std::size_t>(ly) * tw);
+        }
+        return true;
+    }
+
+    bool DecodeLayer(std::uint32_t, std::span<Pixel> out, bool) const override
+    {
+        if (out.size() != pixels_.size()) return false;
+        std::copy(pixels_.begin(), pixels_.end(), out.begin());
+        return true;
+    }
+
+    [[nodiscard]] bool InMemory() const noexcept override { return true; }
+
+    [[nodiscard]] const std::vector<Pixel>& Pixels() const noexcept { return pixels_; }
+
+private:
+    std::uint32_t      width_;
+    std::uint32_t      height_;
+    std::vector<Pixel> pixels_;
+};
+
+// Everything but the pixels of `layer`.
+Layer LayerRecord(const Layer& layer)
+{
+    Layer record;
+    record.name        = layer.name;
+    record.opacity     = layer.opacity;
+    record.visible     = layer.visible;
+    record.locked      = layer.locked;
+    record.zIndex      = layer.zIndex;
+    record.blendColor  = layer.blendColor;
+    record.blendMode   = layer.blendMode;
+    record.adjustment  = layer.adjustment;
+    record.source      = layer.source;
+    record.sourceLayer = layer.sourceLayer;
+    record.damaged     = layer.damaged;
+    return record;
+}
+
+// `layer` as a snapshot holds it: a pixel layer in memory becomes pending
+// on a frozen copy of its pixels; anything else is copied as it is.
+Layer FreezeLayer(const Layer& layer, int w, int h)
+{
+    if (layer.IsAdjustment() || layer.IsPending()) return layer;
+    Layer frozen = LayerRecord(layer);
+    frozen.source = std::make_shared<const FrozenLayer>(static_cast<std::uint32_t>(w),
+                                                        static_cast<std::uint32_t>(h),
+                                                        layer.pixelData);
+    frozen.sourceLayer = 0;
+    return frozen;
+}
+
+} // namespace
+
 // ============================================================
 // Construction
 // ============================================================
@@ -24,6 +158,7 @@ Canvas::Canvas(int w, int h)
     , compositeSurface_(static_cast<std::uint32_t>(w),
                         static_cast<std::uint32_t>(h))
 {
+    ResetTileRevisions();
     InitDefaultLayers();
 }
 
@@ -47,7 +182,7 @@ void Canvas::InitDefaultLayers()
 
     activeLayerIndex_ = 1;   // foreground is the default drawing surface
     nextLayerId_      = 3;
-    dirty_            = true;
+    SetDirty();
 }
 
 void Canvas::AddLayer(std::string_view name)
@@ -59,7 +194,41 @@ void Canvas::AddLayer(std::string_view name)
     Layer newLayer(layerName, width_, height_, zIndex);
     layers_.push_back(std::move(newLayer));
     activeLayerIndex_ = static_cast<int>(layers_.size()) - 1;
-    dirty_            = true;
+    SetDirty();
+}
+
+void Canvas::AddAdjustmentLayer(const Adjustment& adjustment, std::string_view name)
+{
+    if (adjustment.type == AdjustmentType::None) return;
+
+    const int zIndex = nextLayerId_++;
+    Layer layer;
+    layer.name       = name.empty() ? ("Adjustment_" + std::to_string(zIndex)) : std::string(name);
+    layer.zIndex     = zIndex;
+    layer.adjustment = NormalizeAdjustment(adjustment);
+    layers_.push_back(std::move(layer));
+    activeLayerIndex_ = static_cast<int>(layers_.size()) - 1;
+    InvalidateStack();
+}
+
+void Canvas::SetAdjustment(int index, const Adjustment& adjustment)
+{
+    if (index < 0 || index >= static_cast<int>(layers_.size())) return;
+    Layer& layer = layers_[index];
+    if (!layer.IsAdjustment() || adjustment.type == AdjustmentType::None) return;
+
+    Adjustment normalized = NormalizeAdjustment(adjustment);
+    if (normalized == layer.adjustment) return;
+    layer.adjustment = std::move(normalized);
+    InvalidateStack();
+}
+
+const Adjustment* Canvas::ActiveAdjustment() const noexcept
+{
+    if (activeLayerIndex_ < 0 || activeLayerIndex_ >= static_cast<int>(layers_.size()))
+        return nullptr;
+    const Layer& layer = layers_[activeLayerIndex_];
+    return layer.IsAdjustment() ? &layer.adjustment : nullptr;
 }
 
 void Canvas::RemoveLayer(int index)
@@ -70,7 +239,7 @@ void Canvas::RemoveLayer(int index)
     layers_.erase(layers_.begin() + index);
     if (activeLayerIndex_ >= static_cast<int>(layers_.size()))
         activeLayerIndex_ = static_cast<int>(layers_.size()) - 1;
-    dirty_ = true;
+    SetDirty();
 }
 
 void Canvas::ReorderLayers(int from, int to)
@@ -85,34 +254,135 @@ void Canvas::ReorderLayers(int from, int to)
         for (int i = from; i > to; --i) layers_[i] = std::move(layers_[i - 1]);
     layers_[to]      = std::move(tmp);
     activeLayerIndex_ = to;
-    dirty_            = true;
+    SetDirty();
 }
 
-Layer* Canvas::ActiveLayer() noexcept
+Layer* Canvas::ActiveLayer()
 {
     if (activeLayerIndex_ < 0 || activeLayerIndex_ >= static_cast<int>(layers_.size()))
         return nullptr;
-    return &layers_[activeLayerIndex_];
+    Layer& layer = layers_[activeLayerIndex_];
+    if (layer.IsAdjustment()) return nullptr;
+    MaterializeLayer(static_cast<std::size_t>(activeLayerIndex_));
+    ++pixelRevision_;   // the caller may write through the pointer
+    return &layer;
 }
 
 const Layer* Canvas::ActiveLayer() const noexcept
 {
     if (activeLayerIndex_ < 0 || activeLayerIndex_ >= static_cast<int>(layers_.size()))
         return nullptr;
-    return &layers_[activeLayerIndex_];
+    const Layer& layer = layers_[activeLayerIndex_];
+    if (layer.IsAdjustment() || layer.IsPending()) return nullptr;
+    return &layer;
 }
 
-void Canvas::SetActiveLayer(int i) noexcept
+bool Canvas::ActiveLayerPending() const noexcept
 {
-    if (i >= 0 && i < static_cast<int>(layers_.size()))
+    return activeLayerIndex_ >= 0 && activeLayerIndex_ < static_cast<int>(layers_.size())
+        && layers_[activeLayerIndex_].IsPending();
+}
+
+void Canvas::SetActiveLayer(int i)
+{
+    if (i >= 0 && i < static_cast<int>(layers_.size())) {
         activeLayerIndex_ = i;
+        PrefetchActiveLayer();
+    }
+}
+
+// ============================================================
+// Pending layers
+//
+// A layer opened from a project or imported from an image stays in its
+// source (Layer::source) until it is needed.  Composite() decodes just the
+// tiles it draws, straight from the source; anything that wants the
+// layer's pixelData goes through the non-const ActiveLayer() or
+// MaterializeLayers(), which decode the whole layer.  An active layer
+// pending on a file is decoded ahead on a background thread so that the
+// first stroke does not wait for it; an in-memory source is copied on
+// first use instead, which is what makes an imported image copy-on-write.
+// Tiles that fail to decode mark the layer damaged (Layer::damaged).
+// ============================================================
+
+void Canvas::MaterializeLayers()
+{
+    for (std::size_t i = 0; i < layers_.size(); ++i) MaterializeLayer(i);
+}
+
+bool Canvas::HasDamagedLayers() const noexcept
+{
+    return std::any_of(layers_.begin(), layers_.end(), [](const Layer& layer) { return layer.damaged; });
+}
+
+void Canvas::MaterializeLayer(std::size_t index)
+{
+    Layer& layer = layers_[index];
+    if (!layer.IsPending()) return;
+
+    if (prefetch_.valid() && prefetchSource_ == layer.source && prefetchLayer_ == layer.sourceLayer) {
+        DecodedLayer decoded = prefetch_.get();
+        prefetchSource_.reset();
+        layer.pixelData = std::move(decoded.pixels);
+        layer.damaged   = !decoded.ok;
+    } else {
+        const core::TileSource& source = *layer.source;
+        layer.pixelData.assign(static_cast<std::size_t>(source.Width()) * source.Height(), Pixel{0, 0, 0, 0});
+        layer.damaged = !source.DecodeLayer(layer.sourceLayer, layer.pixelData);
+    }
+    layer.source.reset();
+}
+
+void Canvas::PrefetchActiveLayer()
+{
+    if constexpr (!core::ThreadsAvailable) return;
+    if (!ActiveLayerPending()) return;
+
+    const Layer& layer = layers_[activeLayerIndex_];
+    if (layer.source->InMemory()) return;
+    if (prefetch_.valid()) {
+        if (prefetchSource_ == layer.source && prefetchLayer_ == layer.sourceLayer) return;
+        if (prefetch_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    }
+
+    try {
+        prefetch_ = std::async(std::launch::async, [source = layer.source, index = layer.sourceLayer] {
+            DecodedLayer decoded;
+            decoded.pixels.assign(static_cast<std::size_t>(source->Width()) * source->Height(),
+                                  Pixel{0, 0, 0, 0});
+            decoded.ok = source->DecodeLayer(index, decoded.pixels, false);
+            return decoded;
+        });
+        prefetchSource_ = layer.source;
+        prefetchLayer_  = layer.sourceLayer;
+    } catch (const std::system_error&) {
+        // No thread available: the layer is decoded on first use instead.
+        prefetch_ = {};
+        prefetchSource_.reset();
+    }
+}
+
+void Canvas::AdoptPrefetch()
+{
+    if (!prefetch_.valid() || prefetch_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    for (std::size_t i = 0; i < layers_.size(); ++i) {
+        const Layer& layer = layers_[i];
+        if (layer.source == prefetchSource_ && layer.sourceLayer == prefetchLayer_) {
+            MaterializeLayer(i);
+            return;
+        }
+    }
+    prefetch_ = {};   // the layer is gone or already decoded
+    prefetchSource_.reset();
 }
 
 // ============================================================
 // Pixel access
 // ============================================================
 
-void Canvas::PutPixel(int x, int y, const Pixel& color) noexcept
+void Canvas::PutPixel(int x, int y, const Pixel& color)
 {
     if (!IsValidCoord(x, y)) return;
 
@@ -120,10 +390,36 @@ void Canvas::PutPixel(int x, int y, const Pixel& color) noexcept
     if (!layer || layer->locked) return;
 
     BlendPixel(layer->pixelData[static_cast<std::size_t>(PixelIndex(x, y))], color);
+    MarkDirty(x, y);
+}
+
+void Canvas::MarkDirty(int x, int y) noexcept
+{
+    if (!IsValidCoord(x, y)) return;
+    const std::size_t tile =
+        static_cast<std::size_t>(static_cast<std::uint32_t>(y) / kTileSize) * compositeSurface_.TilesX() +
+        static_cast<std::uint32_t>(x) / kTileSize;
+    tileRevision_[tile] = ++revision_;
+    ++pixelRevision_;
     dirty_ = true;
 }
 
-Pixel Canvas::GetPixel(int x, int y) const noexcept
+void Canvas::MarkDirtyRect(int x0, int y0, int x1, int y1) noexcept
+{
+    x0 = std::max(x0, 0);      y0 = std::max(y0, 0);
+    x1 = std::min(x1, width_); y1 = std::min(y1, height_);
+    if (x0 >= x1 || y0 >= y1) return;
+
+    const std::uint64_t rev    = ++revision_;
+    const std::uint32_t tilesX = compositeSurface_.TilesX();
+    for (std::uint32_t ty = y0 / kTileSize; ty <= static_cast<std::uint32_t>(y1 - 1) / kTileSize; ++ty)
+        for (std::uint32_t tx = x0 / kTileSize; tx <= static_cast<std::uint32_t>(x1 - 1) / kTileSize; ++tx)
+            tileRevision_[static_cast<std::size_t>(ty) * tilesX + tx] = rev;
+    ++pixelRevision_;
+    dirty_ = true;
+}
+
+Pixel Canvas::GetPixel(int x, int y)
 {
     if (!IsValidCoord(x, y)) return {};
     const Layer* layer = ActiveLayer();
@@ -141,7 +437,7 @@ int Canvas::PixelIndex(int x, int y) const noexcept
     return y * width_ + x;
 }
 
-std::span<Pixel> Canvas::ActiveLayerSpan() noexcept
+std::span<Pixel> Canvas::ActiveLayerSpan()
 {
     Layer* layer = ActiveLayer();
     if (!layer) return {};
@@ -162,12 +458,42 @@ std::span<const Pixel> Canvas::ActiveLayerSpan() const noexcept
 // using direct TilePixelsMutable() writes — no flat intermediate buffer.
 //
 // Background colour (dark grey 30,30,30) is written first, then each
-// visible layer is alpha-blended on top.
+// visible layer is alpha-blended on top, one layer at a time per tile;
+// adjustment layers transform the tile accumulated so far.
+//
+// Only tiles whose input revision moved since they were last built are
+// recomputed; stale tiles are processed in parallel.
 // ============================================================
 
-void Canvas::Composite()
+std::size_t Canvas::Composite()
 {
-    if (width_ <= 0 || height_ <= 0) { dirty_ = false; return; }
+    return Composite(0, 0, width_, height_);
+}
+
+std::size_t Canvas::Composite(int x0, int y0, int x1, int y1)
+{
+    dirty_ = false;
+    if (width_ <= 0 || height_ <= 0) return 0;
+
+    // Called every frame: also the point where background layer decodes
+    // are collected and the next one started.
+    AdoptPrefetch();
+    PrefetchActiveLayer();
+
+    x0 = std::max(x0, 0);      y0 = std::max(y0, 0);
+    x1 = std::min(x1, width_); y1 = std::min(y1, height_);
+    if (x0 >= x1 || y0 >= y1) return 0;
+
+    const std::uint32_t tilesX = compositeSurface_.TilesX();
+
+    std::vector<std::size_t> stale;
+    for (std::uint32_t ty = y0 / kTileSize; ty <= static_cast<std::uint32_t>(y1 - 1) / kTileSize; ++ty) {
+        for (std::uint32_t tx = x0 / kTileSize; tx <= static_cast<std::uint32_t>(x1 - 1) / kTileSize; ++tx) {
+            const std::size_t idx = static_cast<std::size_t>(ty) * tilesX + tx;
+            if (compositeRevision_[idx] != TileInputRevision(idx)) stale.push_back(idx);
+        }
+    }
+    if (stale.empty()) return 0;
 
     // Sort layer pointers by ascending zIndex (stable, so equal z keeps order).
     std::vector<const Layer*> sorted;
@@ -178,62 +504,113 @@ void Canvas::Composite()
                          return a->zIndex < b->zIndex;
                      });
 
-    const std::uint32_t tilesX = compositeSurface_.TilesX();
-    const std::uint32_t tilesY = compositeSurface_.TilesY();
+    // Acquire tile buffers up front — TilePixelsMutable() allocates the tile
+    // and marks it dirty for upload, which must not race between workers.
+    std::vector<std::span<core::PixelRGBA8>> targets;
+    targets.reserve(stale.size());
+    for (const std::size_t idx : stale) {
+        targets.push_back(compositeSurface_.TilePixelsMutable(
+            static_cast<std::uint32_t>(idx % tilesX),
+            static_cast<std::uint32_t>(idx / tilesX)));
+    }
 
-    for (std::uint32_t ty = 0; ty < tilesY; ++ty) {
-        for (std::uint32_t tx = 0; tx < tilesX; ++tx) {
+    core::ParallelFor(0, stale.size(), [&](std::size_t lo, std::size_t hi) {
+        std::vector<Pixel> scratch;
+        for (std::size_t i = lo; i < hi; ++i) {
+            CompositeTile(sorted,
+                          static_cast<std::uint32_t>(stale[i] % tilesX),
+                          static_cast<std::uint32_t>(stale[i] / tilesX),
+                          targets[i], scratch);
+        }
+    }, 2);
 
-            const std::uint32_t tw     = compositeSurface_.TileWidth(tx);
-            const std::uint32_t th     = compositeSurface_.TileHeight(ty);
-            if (tw == 0 || th == 0) continue;
+    for (const std::size_t idx : stale) compositeRevision_[idx] = TileInputRevision(idx);
+    return stale.size();
+}
 
-            // Obtain a writable span directly into the tile's pixel buffer.
-            // TilePixelsMutable() allocates the tile if needed and marks it dirty.
-            auto tileSpan = compositeSurface_.TilePixelsMutable(tx, ty);
+void Canvas::CompositeTile(std::span<const Layer* const> sorted,
+                           std::uint32_t tx, std::uint32_t ty,
+                           std::span<core::PixelRGBA8> tileSpan,
+                           std::vector<Pixel>& scratch) const
+{
+    const std::uint32_t tw = compositeSurface_.TileWidth(tx);
+    const std::uint32_t th = compositeSurface_.TileHeight(ty);
+    if (tw == 0 || th == 0) return;
 
-            const std::uint32_t originX = tx * core::ImageSurface::TileSize;
-            const std::uint32_t originY = ty * core::ImageSurface::TileSize;
+    const std::uint32_t originX = tx * kTileSize;
+    const std::uint32_t originY = ty * kTileSize;
 
-            for (std::uint32_t ly = 0; ly < th; ++ly) {
-                for (std::uint32_t lx = 0; lx < tw; ++lx) {
+    // Tile layout: rows of TileSize pixels; edge tiles have right/bottom
+    // padding that is never written or uploaded.  Pixel and PixelRGBA8 share
+    // one layout (static_assert above), so blend straight into the tile.
+    Pixel* tile = reinterpret_cast<Pixel*>(tileSpan.data());
 
-                    const int px = static_cast<int>(originX + lx);
-                    const int py = static_cast<int>(originY + ly);
-                    const int flatIdx = py * width_ + px;
+    // Start with the canvas background colour.
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        std::fill_n(tile + static_cast<std::size_t>(ly) * kTileSize, tw, Pixel{30, 30, 30, 255});
+    }
 
-                    // Start with the canvas background colour.
-                    uint8_t r = 30, g = 30, b = 30, a = 255;
+    // Alpha-blend each visible layer from bottom to top.
+    for (const Layer* layer : sorted) {
+        if (!layer->visible) continue;
 
-                    // Alpha-blend each visible layer from bottom to top.
-                    for (const Layer* layer : sorted) {
-                        if (!layer->visible || layer->pixelData.empty()) continue;
+        if (layer->IsAdjustment()) {
+            ApplyAdjustmentToTile(*layer, tile, tw, th, scratch);
+            continue;
+        }
 
-                        const Pixel& src =
-                            layer->pixelData[static_cast<std::size_t>(flatIdx)];
-                        if (src.a == 0) continue;
+        // Source rows: the layer buffer, or for a pending layer this tile
+        // decoded from the project file into scratch.
+        const Pixel* srcPixels = nullptr;
+        std::size_t  stride    = static_cast<std::size_t>(width_);
+        if (layer->IsPending()) {
+            if (!layer->source->HasTile(layer->sourceLayer, tx, ty)) continue;
+            scratch.resize(static_cast<std::size_t>(tw) * th);
+            layer->source->DecodeTile(layer->sourceLayer, tx, ty, scratch);
+            srcPixels = scratch.data();
+            stride    = tw;
+        } else {
+            if (layer->pixelData.empty()) continue;
+            srcPixels = layer->pixelData.data() + static_cast<std::size_t>(originY) * width_ + originX;
+        }
+
+        for (std::uint32_t ly = 0; ly < th; ++ly) {
+            const Pixel* srcRow = srcPixels + ly * stride;
+            Pixel*       dstRow = tile + static_cast<std::size_t>(ly) * kTileSize;
 
-                        const float alpha = (src.a / 255.0f) * layer->opacity;
-                        const float inv   = 1.0f - alpha;
+            for (std::uint32_t lx = 0; lx < tw; ++lx) {
+                const Pixel& src = srcRow[lx];
+                if (src.a == 0) continue;
 
-                        r = static_cast<uint8_t>(r * inv + src.r * alpha);
-                        g = static_cast<uint8_t>(g * inv + src.g * alpha);
-                        b = static_cast<uint8_t>(b * inv + src.b * alpha);
-                        a = std::max(a, static_cast<uint8_t>(src.a * layer->opacity));
-                    }
+                const float alpha = (src.a / 255.0f) * layer->opacity;
+                const float inv   = 1.0f - alpha;
 
-                    // Write zero-copy into the tile buffer.
-                    // Tile layout: rows of TileSize pixels; edge tiles have
-                    // right/bottom padding that is never uploaded.
-                    const std::size_t tileIdx =
-                        core::ImageSurface::LocalIndex(lx, ly);
-                    tileSpan[tileIdx] = { r, g, b, a };
-                }
+                Pixel& dst = dstRow[lx];
+                dst.r = static_cast<uint8_t>(dst.r * inv + src.r * alpha);
+                dst.g = static_cast<uint8_t>(dst.g * inv + src.g * alpha);
+                dst.b = static_cast<uint8_t>(dst.b * inv + src.b * alpha);
+                dst.a = std::max(dst.a, static_cast<uint8_t>(src.a * layer->opacity));
             }
         }
     }
+}
 
-    dirty_ = false;
+// ============================================================
+// Change tracking
+// ============================================================
+
+void Canvas::CollectTilesChangedSince(std::uint64_t revision,
+                                      std::vector<std::pair<std::uint32_t, std::uint32_t>>& out) const
+{
+    out.clear();
+    const std::uint32_t tilesX = compositeSurface_.TilesX();
+    const std::uint32_t tilesY = compositeSurface_.TilesY();
+    for (std::uint32_t ty = 0; ty < tilesY; ++ty) {
+        for (std::uint32_t tx = 0; tx < tilesX; ++tx) {
+            if (TileInputRevision(static_cast<std::size_t>(ty) * tilesX + tx) > revision)
+                out.emplace_back(tx, ty);
+        }
+    }
 }
 
 // ============================================================
@@ -243,8 +620,11 @@ void Canvas::Composite()
 void Canvas::Resize(int newW, int newH)
 {
     if (newW <= 0 || newH <= 0) return;
+    MaterializeLayers();
 
     for (auto& layer : layers_) {
+        if (layer.IsAdjustment() || layer.pixelData.empty()) continue;
+
         std::vector<Pixel> newData(
             static_cast<std::size_t>(newW) * newH, Pixel{0, 0, 0, 0});
 
@@ -264,7 +644,26 @@ void Canvas::Resize(int newW, int newH)
     height_ = newH;
     compositeSurface_.Resize(static_cast<std::uint32_t>(newW),
                               static_cast<std::uint32_t>(newH));
-    dirty_ = true;
+    ResetTileRevisions();
+    SetDirty();
+}
+
+bool Canvas::ReplaceActiveLayer(std::shared_ptr<const core::TileSource> image)
+{
+    if (!image || image->Width() == 0 || image->Height() == 0) return false;
+    if (activeLayerIndex_ < 0 || activeLayerIndex_ >= static_cast<int>(layers_.size())) return false;
+    Layer& target = layers_[activeLayerIndex_];
+    if (target.IsAdjustment()) return false;
+
+    // Drop the old pixels first so Resize neither decodes nor copies them.
+    std::vector<Pixel>().swap(target.pixelData);
+    target.source.reset();
+    Resize(static_cast<int>(image->Width()), static_cast<int>(image->Height()));
+
+    target.source      = std::move(image);
+    target.sourceLayer = 0;
+    SetDirty();
+    return true;
 }
 
 void Canvas::Clear(const Pixel& color)
@@ -272,13 +671,44 @@ void Canvas::Clear(const Pixel& color)
     Layer* layer = ActiveLayer();
     if (layer) {
         std::fill(layer->pixelData.begin(), layer->pixelData.end(), color);
-        dirty_ = true;
+        SetDirty();
     }
 }
 
+// ============================================================
+// Snapshots
+//
+// A snapshot holds each pixel layer as a frozen copy (FrozenLayer), which
+// leaves the layer pending in the snapshot.  Restoring copies the pixels
+// back out at once, so the canvas never works on a frozen layer and
+// autosave sees ordinary pixel layers.  MakeAdjustmentSnapshot() reuses
+// the frozen copies of the previous snapshot when no pixel has been
+// written since it was taken (pixelRevision_), so an adjustment edit
+// after another costs no pixel copy.  Tools that push their snapshot
+// before the stroke leave the revision moved, and the next adjustment
+// snapshot copies again.
+// ============================================================
+
 void Canvas::RestoreFromSnapshot(const CanvasSnapshot& snap)
 {
-    layers_           = snap.layers;
+    layers_ = snap.layers;
+    RestoreSnapshotState(snap);
+}
+
+void Canvas::RestoreFromSnapshot(CanvasSnapshot&& snap)
+{
+    layers_ = std::move(snap.layers);
+    RestoreSnapshotState(snap);
+}
+
+void Canvas::RestoreSnapshotState(const CanvasSnapshot& snap)
+{
+    for (Layer& layer : layers_) {
+        const auto* frozen = dynamic_cast<const FrozenLayer*>(layer.source.get());
+        if (!frozen) continue;
+        layer.pixelData = frozen->Pixels();
+        layer.source.reset();
+    }
     activeLayerIndex_ = snap.activeLayerIndex;
 
     if (snap.canvasWidth  != width_ || snap.canvasHeight != height_) {
@@ -286,19 +716,60 @@ void Canvas::RestoreFromSnapshot(const CanvasSnapshot& snap)
         height_ = snap.canvasHeight;
         compositeSurface_.Resize(static_cast<std::uint32_t>(width_),
                                   static_cast<std::uint32_t>(height_));
+        ResetTileRevisions();
     }
-    dirty_ = true;
+    SetDirty();
+    PrefetchActiveLayer();
 }
 
 CanvasSnapshot Canvas::MakeSnapshot(std::string_view description) const
 {
-    return CanvasSnapshot{ layers_, activeLayerIndex_, width_, height_, description };
+    CanvasSnapshot snap({}, activeLayerIndex_, width_, height_, description);
+    snap.layers.reserve(layers_.size());
+    for (const Layer& layer : layers_) snap.layers.push_back(FreezeLayer(layer, width_, height_));
+    snap.pixelRevision = pixelRevision_;
+    return snap;
+}
+
+CanvasSnapshot Canvas::MakeAdjustmentSnapshot(const CanvasSnapshot& previous,
+                                              std::string_view description) const
+{
+    if (previous.pixelRevision != pixelRevision_ ||
+        previous.canvasWidth != width_ || previous.canvasHeight != height_) {
+        return MakeSnapshot(description);
+    }
+
+    CanvasSnapshot snap({}, activeLayerIndex_, width_, height_, description);
+    snap.pixelRevision = pixelRevision_;
+    snap.layers.reserve(layers_.size());
+    for (const Layer& layer : layers_) {
+        const auto before = std::find_if(previous.layers.begin(), previous.layers.end(),
+                                         [&](const Layer& l) { return l.zIndex == layer.zIndex; });
+        if (layer.IsAdjustment() || layer.IsPending() ||
+            before == previous.layers.end() || before->IsAdjustment() || !before->IsPending()) {
+            snap.layers.push_back(FreezeLayer(layer, width_, height_));
+            continue;
+        }
+        Layer shared = LayerRecord(layer);
+        shared.source      = before->source;
+        shared.sourceLayer = before->sourceLayer;
+        snap.layers.push_back(std::move(shared));
+    }
+    return snap;
 }
 
 // ============================================================
 // Private helpers
 // ============================================================
 
+void Canvas::ResetTileRevisions()
+{
+    const std::size_t tiles = static_cast<std::size_t>(compositeSurface_.TilesX())
+                            * compositeSurface_.TilesY();
+    tileRevision_.assign(tiles, 0);
+    compositeRevision_.assign(tiles, 0);
+}
+
 void Canvas::BlendPixel(Pixel& dst, const Pixel& src) noexcept
 {
     if (src.a == 0) {
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <future>
+#include <memory>
 #include <span>
+#include <utility>
 #include <string_view>
 #include <vector>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 
 #include "Types.hpp"
 #include "ImageSurface.hpp"
@@ -35,22 +39,56 @@ public:
     void RemoveLayer(int index);
     void ReorderLayers(int from, int to);
 
-    [[nodiscard]] Layer*       ActiveLayer()       noexcept;
+    // The active *pixel* layer.  Returns nullptr when the selected layer is
+    // an adjustment layer, so pixel tools and filters bail out naturally.
+    // A pending layer (opened from a project or imported, Layer::source) is
+    // decoded first, so callers always see pixelData; the const overload
+    // does not decode and returns nullptr while the layer is pending.
+    [[nodiscard]] Layer*       ActiveLayer();
     [[nodiscard]] const Layer* ActiveLayer() const noexcept;
 
+    // True while the active layer is still pending; lets per-frame readers
+    // (e.g. the colour histogram) wait instead of forcing a decode.
+    [[nodiscard]] bool ActiveLayerPending() const noexcept;
+
     [[nodiscard]] int  ActiveLayerIndex() const noexcept { return activeLayerIndex_; }
-    void               SetActiveLayer(int i) noexcept;
+    void               SetActiveLayer(int i);
+
+    // ---- Adjustment layers ---------------------------------------------
+    //
+    // Adjustment layers store parameters only (see Adjustment in Types.hpp)
+    // and are evaluated per tile inside Composite().  Pixelify block sizes
+    // are snapped to a power of two ≤ TileSize so blocks never straddle a
+    // composite tile.
+
+    // Append an adjustment layer on top of the stack and make it active.
+    void AddAdjustmentLayer(const Adjustment& adjustment, std::string_view name = "");
+
+    // Replace the parameters of an adjustment layer (no-op for pixel layers).
+    void SetAdjustment(int index, const Adjustment& adjustment);
+
+    // Parameters of the selected layer, or nullptr for a pixel layer.
+    [[nodiscard]] const Adjustment* ActiveAdjustment() const noexcept;
 
     // Direct (reference) access to the layer vector for LayerPanel widget
     // and CanvasSnapshot serialisation.  Avoid mutation from outside Canvas
-    // where possible; prefer the explicit helpers above.
+    // where possible; prefer the explicit helpers above.  Pending layers
+    // have no pixelData here — call MaterializeLayers() before touching the
+    // pixels of every layer.
     [[nodiscard]] std::vector<Layer>&       Layers()       noexcept { return layers_; }
     [[nodiscard]] const std::vector<Layer>& Layers() const noexcept { return layers_; }
 
+    // Decode every pending layer (in parallel, tile by tile).
+    void MaterializeLayers();
+
+    // True when a decoded layer had damaged tiles (Layer::damaged).
+    [[nodiscard]] bool HasDamagedLayers() const noexcept;
+
     // Mutable reference accessors used by the LayerPanel widget.
     // Staged migration: will be removed once LayerPanel accepts callbacks only.
     [[nodiscard]] int& ActiveLayerIndexRef() noexcept { return activeLayerIndex_; }
     [[nodiscard]] int& NextLayerIdRef()      noexcept { return nextLayerId_;      }
+    [[nodiscard]] int  NextLayerId()   const noexcept { return nextLayerId_;      }
 
     // ---- Pixel access --------------------------------------------------
     //
@@ -58,24 +96,32 @@ public:
     // It does NOT composite — call Composite() once per stroke/operation end
     // (or rely on the per-frame dirty check in PixelPaintApp::Draw()).
 
-    void                    PutPixel(int x, int y, const Pixel& color) noexcept;
-    [[nodiscard]] Pixel     GetPixel(int x, int y)                const noexcept;
+    void                    PutPixel(int x, int y, const Pixel& color);
+    [[nodiscard]] Pixel     GetPixel(int x, int y);
     [[nodiscard]] bool      IsValidCoord(int x, int y)            const noexcept;
     [[nodiscard]] int       PixelIndex(int x, int y)              const noexcept;
 
     // Zero-copy span over the active layer's pixel buffer.
     // Drawing algorithms (DrawingAlgorithms.hpp) write here directly,
     // bypassing PutPixel's per-call overhead.
-    [[nodiscard]] std::span<Pixel>       ActiveLayerSpan()       noexcept;
+    [[nodiscard]] std::span<Pixel>       ActiveLayerSpan();
     [[nodiscard]] std::span<const Pixel> ActiveLayerSpan() const noexcept;
 
     // ---- Composite -----------------------------------------------------
     //
     // Blends all visible layers (sorted by zIndex) into compositeSurface_
     // using direct TilePixelsMutable() writes — no intermediate flat buffer.
-    // Clears the dirty flag on return.
+    // Adjustment layers are applied to the tile accumulated so far.
+    //
+    // Each composite tile remembers the input revision it was built from and
+    // is only recomputed when that revision moves (see MarkDirty/SetDirty).
+    // The region overload limits work to tiles touching [x0,x1) × [y0,y1) —
+    // the canvas view passes the visible rect, exporters use the full
+    // overload.  Both clear the dirty flag and return the number of tiles
+    // rewritten.
 
-    void Composite();
+    std::size_t Composite();
+    std::size_t Composite(int x0, int y0, int x1, int y1);
 
     // Read-only access to the composite result.
     //   • GPU upload: iterate CollectDirtyTiles() then GetTileView()
@@ -89,29 +135,91 @@ public:
 
     // ---- Dirty flag ----------------------------------------------------
     //
-    // Set to true by PutPixel and by drawing algorithms via SetDirty().
+    // Set by PutPixel, drawing algorithms and any layer-stack change.
     // Cleared by Composite().
-    // PixelPaintApp::Draw() checks this once per frame and calls Composite()
-    // if true — giving live preview with exactly one composite per frame.
+    //
+    // SetDirty() invalidates every composite tile (use it after whole-layer
+    // edits or stack changes).  MarkDirty/MarkDirtyRect invalidate only the
+    // tiles covering the given pixels — drawing tools use these so a stroke
+    // recomposites just the tiles it touched.
 
     [[nodiscard]] bool IsDirty() const noexcept { return dirty_; }
-    void               SetDirty()      noexcept { dirty_ = true; }
+    void               SetDirty()      noexcept { ++pixelRevision_; InvalidateStack(); }
+    void               MarkDirty(int x, int y) noexcept;
+    void               MarkDirtyRect(int x0, int y0, int x1, int y1) noexcept;
+
+    // ---- Change tracking -----------------------------------------------
+    //
+    // Revision() is a monotonic counter bumped by every MarkDirty/SetDirty.
+    // Caches derived from layer pixels (e.g. tools::LayerHistogram) remember
+    // the revision they synced at and rescan only the tiles changed since.
+    // After a SetDirty() every tile counts as changed.
+
+    [[nodiscard]] std::uint64_t Revision() const noexcept { return revision_; }
+    void CollectTilesChangedSince(std::uint64_t revision,
+                                  std::vector<std::pair<std::uint32_t, std::uint32_t>>& out) const;
 
     // ---- Canvas-level operations ---------------------------------------
 
     void Resize(int newW, int newH);
     void Clear(const Pixel& color = {0, 0, 0, 255});
 
-    // Restore all state from an undo/redo snapshot.
+    // Resize the canvas to `image` and make it the active layer's content.
+    // The layer stays pending on the image until it is first edited, so
+    // snapshots taken before then share the image instead of copying it.
+    // False, with nothing changed, when the active layer is an adjustment.
+    bool ReplaceActiveLayer(std::shared_ptr<const core::TileSource> image);
+
+    // Restore all state from an undo/redo snapshot.  The rvalue overload
+    // takes the layers over without copying them (e.g. a loaded project).
     void RestoreFromSnapshot(const CanvasSnapshot& snap);
+    void RestoreFromSnapshot(CanvasSnapshot&& snap);
 
-    // Build a snapshot of the current state (for PushUndo).
+    // Build a snapshot of the current state (for PushUndo).  Pixel layers
+    // are copied once, into immutable buffers the snapshot shares.
     [[nodiscard]] CanvasSnapshot MakeSnapshot(std::string_view description = "") const;
 
+    // The same after an edit that touched only adjustment layers: pixel
+    // layers share the buffers of `previous` (the latest undo snapshot)
+    // when no pixel has been written since it was taken, and are copied
+    // as by MakeSnapshot() otherwise.
+    [[nodiscard]] CanvasSnapshot MakeAdjustmentSnapshot(const CanvasSnapshot& previous,
+                                                        std::string_view description = "") const;
+
 private:
     // Alpha-blend src over dst, respecting src.a.
     static void BlendPixel(Pixel& dst, const Pixel& src) noexcept;
 
+    // Evaluate the layer stack for one composite tile.
+    void CompositeTile(std::span<const Layer* const> sorted,
+                       std::uint32_t tx, std::uint32_t ty,
+                       std::span<core::PixelRGBA8> tile,
+                       std::vector<Pixel>& scratch) const;
+
+    // Adopt the snapshot's active layer and size once layers_ is set.
+    void RestoreSnapshotState(const CanvasSnapshot& snap);
+
+    // Decode a pending layer into pixelData.
+    void MaterializeLayer(std::size_t index);
+
+    // Start decoding the active layer on a background thread if it is
+    // pending on a file, so the first edit finds it ready.  One at a time.
+    void PrefetchActiveLayer();
+
+    // Hand a finished background decode to its layer, without waiting.
+    void AdoptPrefetch();
+
+    // Invalidate every composite tile without counting it as a pixel
+    // write (adjustment edits).
+    void InvalidateStack() noexcept { stackRevision_ = ++revision_; dirty_ = true; }
+
+    // Size the per-tile revision tables to the composite surface.
+    void ResetTileRevisions();
+
+    [[nodiscard]] std::uint64_t TileInputRevision(std::size_t tileIndex) const noexcept {
+        return std::max(tileRevision_[tileIndex], stackRevision_);
+    }
+
     int                width_           = 0;
     int                height_          = 0;
     std::vector<Layer> layers_;
@@ -123,6 +231,31 @@ private:
     core::ImageSurface compositeSurface_;
 
     bool               dirty_ = false;
+
+    // Tile cache keys.  revision_ is a monotonic counter; tileRevision_[i]
+    // is the revision of the last pixel write inside tile i, stackRevision_
+    // the revision of the last whole-canvas invalidation.  A composite tile
+    // is current when compositeRevision_[i] equals its input revision.
+    std::uint64_t              revision_      = 0;
+    std::uint64_t              stackRevision_ = 0;
+
+    // Bumped by everything that may write layer pixels: SetDirty,
+    // MarkDirty/MarkDirtyRect and the mutable pixel accessors.  Snapshots
+    // record it so MakeAdjustmentSnapshot() can tell whether the pixels of
+    // the previous one are still current.
+    std::uint64_t              pixelRevision_ = 0;
+    std::vector<std::uint64_t> tileRevision_;
+    std::vector<std::uint64_t> compositeRevision_;
+
+    // Background decode of one pending layer (PrefetchActiveLayer); the
+    // result belongs to whichever layer still has this source and index.
+    struct DecodedLayer {
+        std::vector<Pixel> pixels;
+        bool               ok = true;
+    };
+    std::future<DecodedLayer>               prefetch_;
+    std::shared_ptr<const core::TileSource> prefetchSource_;
+    std::uint32_t                           prefetchLayer_ = 0;
 };
 
 } // namespace pelpaint
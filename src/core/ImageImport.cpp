@@ -0,0 +1,907 @@
+#include "ImageImport.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+// stb_image decodes the formats that have no streaming decoder below.
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb/stb_image.h"
+
+static_assert(sizeof(pelpaint::Pixel) == sizeof(pelpaint::core::PixelRGBA8),
+              "imported tiles are copied straight into layer pixels");
+
+namespace pelpaint::core {
+
+namespace {
+
+constexpr std::uint32_t kTile         = ImageSurface::TileSize;
+constexpr std::size_t   kMaxPixels = std::size_t{1} << 30;   // 4 GiB of RGBA
+
+// Checked before anything is allocated, so a damaged or hostile header is
+// turned down instead of exhausting memory.
+[[nodiscard]] bool SizeOk(std::uint32_t width, std::uint32_t height) noexcept
+{
+    return width != 0 && height != 0 && width <= kMaxCanvasDimension && height <= kMaxCanvasDimension &&
+           std::size_t{width} * height <= kMaxPixels;
+}
+
+[[nodiscard]] std::uint32_t Be32(const std::uint8_t* p) noexcept
+{
+    return (std::uint32_t{p[0]} << 24) | (std::uint32_t{p[1]} << 16) | (std::uint32_t{p[2]} << 8) | p[3];
+}
+
+[[nodiscard]] std::uint32_t Be16(const std::uint8_t* p) noexcept
+{
+    return (std::uint32_t{p[0]} << 8) | p[1];
+}
+
+[[nodiscard]] std::uint32_t Le16(const std::uint8_t* p) noexcept
+{
+    return std::uint32_t{p[0]} | (std::uint32_t{p[1]} << 8);
+}
+
+// Copy one tile of `tiles` into dst (rows `stride` pixels apart).
+// Unallocated tiles are transparent.
+void CopyTile(const ImageSurface& tiles, std::uint32_t tx, std::uint32_t ty, Pixel* dst, std::size_t stride)
+{
+    const std::uint32_t tw  = tiles.TileWidth(tx);
+    const std::uint32_t th  = tiles.TileHeight(ty);
+    const auto          src = tiles.TilePixels(tx, ty);
+    const Pixel*        px  = reinterpret_cast<const Pixel*>(src.data());
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        Pixel* row = dst + ly * stride;
+        if (src.empty()) std::fill_n(row, tw, Pixel{0, 0, 0, 0});
+        else             std::copy_n(px + std::size_t{ly} * kTile, tw, row);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BandWriter
+//
+// Holds the rows of one band (TileSize rows) while a decoder fills them and
+// cuts the band into tiles once its last row is in.  Tiles without a single
+// non-transparent pixel are left unallocated.  Rows may arrive top-down or
+// bottom-up, as long as the rows of one band arrive together.
+// ---------------------------------------------------------------------------
+
+class BandWriter {
+public:
+    BandWriter(std::uint32_t width, std::uint32_t height)
+        : tiles_(width, height)
+        , band_(std::size_t{width} * kTile)
+    {}
+
+    [[nodiscard]] Pixel* Row(std::uint32_t y) noexcept
+    {
+        return band_.data() + std::size_t{y % kTile} * tiles_.Width();
+    }
+
+    void RowDone(std::uint32_t y)
+    {
+        const std::uint32_t ty = y / kTile;
+        if (++rows_ < tiles_.TileHeight(ty)) return;
+        Flush(ty);
+        rows_ = 0;
+    }
+
+    [[nodiscard]] ImageSurface Finish()
+    {
+        tiles_.ClearDirtyFlags();
+        return std::move(tiles_);
+    }
+
+private:
+    void Flush(std::uint32_t ty)
+    {
+        const std::size_t   width = tiles_.Width();
+        const std::uint32_t th    = tiles_.TileHeight(ty);
+        for (std::uint32_t tx = 0; tx < tiles_.TilesX(); ++tx) {
+            const std::uint32_t tw  = tiles_.TileWidth(tx);
+            const Pixel*        src = band_.data() + std::size_t{tx} * kTile;
+
+            std::uint8_t alpha = 0;
+            for (std::uint32_t ly = 0; ly < th && alpha == 0; ++ly) {
+                const Pixel* row = src + ly * width;
+                for (std::uint32_t lx = 0; lx < tw; ++lx) alpha |= row[lx].a;
+            }
+            if (alpha == 0) continue;
+
+            Pixel* dst = reinterpret_cast<Pixel*>(tiles_.TilePixelsMutable(tx, ty).data());
+            for (std::uint32_t ly = 0; ly < th; ++ly) {
+                std::memcpy(dst + std::size_t{ly} * kTile, src + ly * width, std::size_t{tw} * sizeof(Pixel));
+            }
+        }
+    }
+
+    ImageSurface       tiles_;
+    std::vector<Pixel> band_;
+    std::uint32_t      rows_ = 0;
+};
+
+// ============================================================
+// Inflate (RFC 1950/1951)
+//
+// Decompresses a zlib stream that may be split over several input spans
+// (PNG IDAT chunks) and hands the output to a sink in pieces, keeping only
+// the 32 KiB window the format needs.  Huffman codes of up to kFastBits
+// bits decode with one table lookup; longer ones walk the canonical code.
+// ============================================================
+
+constexpr std::array<std::uint16_t, 29> kLengthBase = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+constexpr std::array<std::uint8_t, 29> kLengthExtra = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+constexpr std::array<std::uint16_t, 30> kDistBase = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+constexpr std::array<std::uint8_t, 30> kDistExtra = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+constexpr std::array<std::uint8_t, 19> kCodeLengthOrder = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct HuffmanTable {
+    static constexpr int kFastBits = 10;
+    static constexpr int kMaxBits  = 15;
+
+    std::array<std::uint16_t, 1u << kFastBits> fast{};     // (length << 9) | symbol, 0 for longer codes
+    std::array<std::uint16_t, kMaxBits + 1>    count{};    // codes per length
+    std::array<std::uint16_t, 288>             symbols{};  // symbols in code order
+
+    // False for an over-subscribed code.  Incomplete codes are accepted
+    // (a distance code may have a single symbol).
+    bool Build(const std::uint8_t* lengths, std::size_t n)
+    {
+        fast.fill(0);
+        count.fill(0);
+        for (std::size_t i = 0; i < n; ++i) ++count[lengths[i]];
+        count[0] = 0;
+
+        int left = 1;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            left = (left << 1) - count[len];
+            if (left < 0) return false;
+        }
+
+        std::array<std::uint16_t, kMaxBits + 1> offset{};
+        std::array<std::uint32_t, kMaxBits + 1> next{};
+        std::uint32_t code = 0;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            code = (code + count[len - 1]) << 1;
+            next[len] = code;
+            if (len < kMaxBits) offset[len + 1] = static_cast<std::uint16_t>(offset[len] + count[len]);
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const int len = lengths[i];
+            if (len == 0) continue;
+            symbols[offset[len]++] = static_cast<std::uint16_t>(i);
+
+            const std::uint32_t c = next[len]++;
+            if (len > kFastBits) continue;
+            std::uint32_t reversed = 0;   // codes are sent most significant bit first
+            for (int b = 0; b < len; ++b) reversed |= ((c >> b) & 1u) << (len - 1 - b);
+            for (std::uint32_t k = reversed; k < fast.size(); k += 1u << len) {
+                fast[k] = static_cast<std::uint16_t>((len << 9) | i);
+            }
+        }
+        return true;
+    }
+};
+
+class Inflater {
+public:
+    explicit Inflater(std::span<const std::span<const std::uint8_t>> input) noexcept
+        : input_(input)
+    {}
+
+    // Inflate the whole stream; sink(const uint8_t*, size_t) receives the
+    // output in order.  False on a malformed or truncated stream.
+    template <typename Sink>
+    bool Run(Sink&& sink)
+    {
+        const std::uint32_t cmf = Bits(8);
+        const std::uint32_t flg = Bits(8);
+        if ((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 32) != 0) return false;
+
+        for (bool last = false; !last;) {
+            last = Bits(1) != 0;
+            bool ok = false;
+            switch (Bits(2)) {
+                case 0: ok = Stored(sink); break;
+                case 1: ok = Codes(sink, FixedLiterals(), FixedDistances()); break;
+                case 2: ok = Dynamic(sink); break;
+                default: break;
+            }
+            if (!ok || Overrun()) return false;
+        }
+        if (pos_ > flushed_) sink(out_.data() + flushed_, pos_ - flushed_);
+        return true;
+    }
+
+private:
+    static constexpr std::size_t kWindow = std::size_t{1} << 15;
+    static constexpr std::size_t kBuffer = 4 * kWindow;
+
+    static const HuffmanTable& FixedLiterals()
+    {
+        static const HuffmanTable table = [] {
+            std::array<std::uint8_t, 288> lengths{};
+            std::fill(lengths.begin(),       lengths.begin() + 144, 8);
+            std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+            std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+            std::fill(lengths.begin() + 280, lengths.end(),         8);
+            HuffmanTable t;
+            t.Build(lengths.data(), lengths.size());
+            return t;
+        }();
+        return table;
+    }
+
+    static const HuffmanTable& FixedDistances()
+    {
+        static const HuffmanTable table = [] {
+            std::array<std::uint8_t, 30> lengths{};
+            lengths.fill(5);
+            HuffmanTable t;
+            t.Build(lengths.data(), lengths.size());
+            return t;
+        }();
+        return table;
+    }
+
+    // ---- Bit input ---------------------------------------------------------
+
+    // Past the end of the input zeros are read and counted; a refill may run
+    // up to 8 bytes ahead, so only more than that means a truncated stream.
+    [[nodiscard]] bool Overrun() const noexcept { return overrun_ > 8; }
+
+    std::uint8_t NextByte() noexcept
+    {
+        while (cur_ == end_) {
+            if (next_ >= input_.size()) { ++overrun_; return 0; }
+            cur_ = input_[next_].data();
+            end_ = cur_ + input_[next_].size();
+            ++next_;
+        }
+        return *cur_++;
+    }
+
+    void Refill() noexcept
+    {
+        while (bitCount_ <= 56) {
+            bits_ |= std::uint64_t{NextByte()} << bitCount_;
+            bitCount_ += 8;
+        }
+    }
+
+    std::uint32_t Bits(int n) noexcept
+    {
+        if (bitCount_ < n) Refill();
+        const auto v = static_cast<std::uint32_t>(bits_ & ((std::uint64_t{1} << n) - 1));
+        bits_ >>= n;
+        bitCount_ -= n;
+        return v;
+    }
+
+    int Decode(const HuffmanTable& table) noexcept
+    {
+        if (bitCount_ < HuffmanTable::kMaxBits) Refill();
+        if (const std::uint16_t e = table.fast[bits_ & (table.fast.size() - 1)]) {
+            const int len = e >> 9;
+            bits_ >>= len;
+            bitCount_ -= len;
+            return e & 511;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= HuffmanTable::kMaxBits; ++len) {
+            code |= static_cast<int>((bits_ >> (len - 1)) & 1u);
+            const int count = table.count[len];
+            if (code - first < count) {
+                bits_ >>= len;
+                bitCount_ -= len;
+                return table.symbols[index + code - first];
+            }
+            index += count;
+            first  = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    // ---- Output window -----------------------------------------------------
+
+    // Make room for n more bytes, handing everything not yet flushed to the
+    // sink and keeping the last kWindow bytes for back-references.
+    template <typename Sink>
+    void Reserve(Sink& sink, std::size_t n)
+    {
+        if (pos_ + n <= out_.size()) return;
+        sink(out_.data() + flushed_, pos_ - flushed_);
+        std::memmove(out_.data(), out_.data() + pos_ - kWindow, kWindow);
+        pos_     = kWindow;
+        flushed_ = kWindow;
+    }
+
+    // ---- Blocks ------------------------------------------------------------
+
+    template <typename Sink>
+    bool Stored(Sink& sink)
+    {
+        Bits(bitCount_ % 8);
+        const std::uint32_t len  = Bits(16);
+        const std::uint32_t nlen = Bits(16);
+        if ((len ^ 0xFFFFu) != nlen) return false;
+        for (std::uint32_t i = 0; i < len; ++i) {
+            Reserve(sink, 1);
+            out_[pos_++] = static_cast<std::uint8_t>(Bits(8));
+        }
+        return !Overrun();
+    }
+
+    template <typename Sink>
+    bool Dynamic(Sink& sink)
+    {
+        const std::uint32_t literals  = Bits(5) + 257;
+        const std::uint32_t distances = Bits(5) + 1;
+        const std::uint32_t codes     = Bits(4) + 4;
+        if (literals > 286 || distances > 30) return false;
+
+        std::array<std::uint8_t, 19> codeLengths{};
+        for (std::uint32_t i = 0; i < codes; ++i) codeLengths[kCodeLengthOrder[i]] = static_cast<std::uint8_t>(Bits(3));
+        HuffmanTable lengthCode;
+        if (!lengthCode.Build(codeLengths.data(), codeLengths.size())) return false;
+
+        std::array<std::uint8_t, 286 + 30> lengths{};
+        for (std::uint32_t i = 0; i < literals + distances;) {
+            const int symbol = Decode(lengthCode);
+            if (symbol < 0 || Overrun()) return false;
+            if (symbol < 16) {
+                lengths[i++] = static_cast<std::uint8_t>(symbol);
+                continue;
+            }
+            std::uint8_t  value  = 0;
+            std::uint32_t repeat = 0;
+            if (symbol == 16) {
+                if (i == 0) return false;
+                value  = lengths[i - 1];
+                repeat = 3 + Bits(2);
+            } else if (symbol == 17) {
+                repeat = 3 + Bits(3);
+            } else {
+                repeat = 11 + Bits(7);
+            }
+            if (i + repeat > literals + distances) return false;
+            std::fill_n(lengths.begin() + i, repeat, value);
+            i += repeat;
+        }
+        if (lengths[256] == 0) return false;   // no end-of-block code
+
+        HuffmanTable literal, distance;
+        return literal.Build(lengths.data(), literals)
+            && distance.Build(lengths.data() + literals, distances)
+            && Codes(sink, literal, distance);
+    }
+
+    template <typename Sink>
+    bool Codes(Sink& sink, const HuffmanTable& literal, const HuffmanTable& distance)
+    {
+        for (;;) {
+            if (Overrun()) return false;
+            int symbol = Decode(literal);
+            if (symbol < 256) {
+                if (symbol < 0) return false;
+                Reserve(sink, 1);
+                out_[pos_++] = static_cast<std::uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) return true;
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            const std::size_t length = kLengthBase[symbol] + Bits(kLengthExtra[symbol]);
+
+            const int d = Decode(distance);
+            if (d < 0 || d >= 30) return false;
+            const std::size_t dist = kDistBase[d] + Bits(kDistExtra[d]);
+
+            Reserve(sink, length);
+            if (dist > pos_) return false;
+            std::uint8_t*       dst = out_.data() + pos_;
+            const std::uint8_t* src = dst - dist;
+            if (dist >= length) {
+                std::memcpy(dst, src, length);
+            } else {
+                for (std::size_t i = 0; i < length; ++i) dst[i] = src[i];   // overlapping run
+            }
+            pos_ += length;
+        }
+    }
+
+    std::span<const std::span<const std::uint8_t>> input_;
+    std::size_t         next_     = 0;
+    const std::uint8_t* cur_      = nullptr;
+    const std::uint8_t* end_      = nullptr;
+    std::size_t         overrun_  = 0;
+    std::uint64_t       bits_     = 0;
+    int                 bitCount_ = 0;
+
+    std::vector<std::uint8_t> out_ = std::vector<std::uint8_t>(kBuffer);
+    std::size_t               pos_     = 0;
+    std::size_t               flushed_ = 0;
+};
+
+// ============================================================
+// PNG
+//
+// The IDAT stream is inflated straight into a scanline buffer; each
+// scanline is unfiltered against the previous one, converted to RGBA and
+// written into the band.  Only two scanlines and the inflate window are
+// held besides the tiles.
+// ============================================================
+
+constexpr std::uint8_t kPngSignature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+struct PngHeader {
+    std::uint32_t width     = 0;
+    std::uint32_t height    = 0;
+    std::uint32_t depth     = 0;
+    std::uint32_t colorType = 0;
+    std::uint32_t channels  = 0;
+
+    std::array<Pixel, 256>        palette{};
+    std::uint32_t                 paletteSize = 0;
+    bool                          hasKey      = false;   // tRNS colour key (grey / RGB)
+    std::array<std::uint32_t, 3>  key{};
+};
+
+[[nodiscard]] std::uint8_t Paeth(int a, int b, int c) noexcept
+{
+    const int p  = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<std::uint8_t>(a);
+    return static_cast<std::uint8_t>(pb <= pc ? b : c);
+}
+
+bool Unfilter(std::uint8_t filter, std::uint8_t* row, const std::uint8_t* prev, std::size_t n, std::size_t bpp) noexcept
+{
+    switch (filter) {
+        case 0:
+            return true;
+        case 1:
+            for (std::size_t i = bpp; i < n; ++i) row[i] = static_cast<std::uint8_t>(row[i] + row[i - bpp]);
+            return true;
+        case 2:
+            for (std::size_t i = 0; i < n; ++i) row[i] = static_cast<std::uint8_t>(row[i] + prev[i]);
+            return true;
+        case 3:
+            for (std::size_t i = 0; i < bpp; ++i) row[i] = static_cast<std::uint8_t>(row[i] + (prev[i] >> 1));
+            for (std::size_t i = bpp; i < n; ++i) row[i] = static_cast<std::uint8_t>(row[i] + ((row[i - bpp] + prev[i]) >> 1));
+            return true;
+        case 4:
+            for (std::size_t i = 0; i < bpp; ++i) row[i] = static_cast<std::uint8_t>(row[i] + prev[i]);
+            for (std::size_t i = bpp; i < n; ++i) row[i] = static_cast<std::uint8_t>(row[i] + Paeth(row[i - bpp], prev[i], prev[i - bpp]));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Convert one unfiltered scanline to RGBA.
+void ConvertPngRow(const PngHeader& png, const std::uint8_t* src, Pixel* dst) noexcept
+{
+    const std::uint32_t w = png.width;
+
+    if (png.depth == 8) {
+        switch (png.colorType) {
+            case 6:
+                std::memcpy(dst, src, std::size_t{w} * sizeof(Pixel));
+                return;
+            case 2:
+                for (std::uint32_t x = 0; x < w; ++x, src += 3) {
+                    const bool clear = png.hasKey && src[0] == png.key[0] && src[1] == png.key[1] && src[2] == png.key[2];
+                    dst[x] = Pixel(src[0], src[1], src[2], clear ? 0 : 255);
+                }
+                return;
+            case 0:
+                for (std::uint32_t x = 0; x < w; ++x) {
+                    const std::uint8_t g = src[x];
+                    dst[x] = Pixel(g, g, g, png.hasKey && g == png.key[0] ? 0 : 255);
+                }
+                return;
+            case 4:
+                for (std::uint32_t x = 0; x < w; ++x, src += 2) dst[x] = Pixel(src[0], src[0], src[0], src[1]);
+                return;
+            case 3:
+                for (std::uint32_t x = 0; x < w; ++x) dst[x] = png.palette[src[x]];
+                return;
+            default:
+                return;
+        }
+    }
+
+    // 1/2/4 and 16 bits per sample: read samples one by one.  16-bit samples
+    // keep their high byte; low-depth grey is scaled up to 0–255.
+    const std::uint32_t depth = png.depth;
+    const std::uint32_t mask  = (1u << std::min<std::uint32_t>(depth, 16)) - 1;
+    const auto sample = [&](std::size_t i) -> std::uint32_t {
+        if (depth == 16) return Be16(src + 2 * i);
+        const std::size_t bit = i * depth;
+        return (src[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+    };
+    const auto to8 = [&](std::uint32_t v) -> std::uint8_t {
+        return static_cast<std::uint8_t>(depth == 16 ? v >> 8 : v * (255 / mask));
+    };
+
+    for (std::uint32_t x = 0; x < w; ++x) {
+        const std::size_t s = std::size_t{x} * png.channels;
+        switch (png.colorType) {
+            case 0: {
+                const std::uint32_t g = sample(s);
+                const std::uint8_t  v = to8(g);
+                dst[x] = Pixel(v, v, v, png.hasKey && g == png.key[0] ? 0 : 255);
+                break;
+            }
+            case 2: {
+                const std::uint32_t r = sample(s), g = sample(s + 1), b = sample(s + 2);
+                const bool clear = png.hasKey && r == png.key[0] && g == png.key[1] && b == png.key[2];
+                dst[x] = Pixel(to8(r), to8(g), to8(b), clear ? 0 : 255);
+                break;
+            }
+            case 3:
+                dst[x] = png.palette[sample(s) & 255];
+                break;
+            case 4: {
+                const std::uint8_t v = to8(sample(s));
+                dst[x] = Pixel(v, v, v, to8(sample(s + 1)));
+                break;
+            }
+            case 6:
+                dst[x] = Pixel(to8(sample(s)), to8(sample(s + 1)), to8(sample(s + 2)), to8(sample(s + 3)));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// False for damaged files and for what is left to stb_image (interlacing,
+// unknown critical chunks such as Apple's CgBI).
+bool DecodePng(std::span<const std::uint8_t> file, ImageSurface& out)
+{
+    if (file.size() < 8 || std::memcmp(file.data(), kPngSignature, 8) != 0) return false;
+
+    PngHeader png;
+    bool      haveHeader = false;
+    std::vector<std::span<const std::uint8_t>> idat;
+
+    for (std::size_t pos = 8; pos + 12 <= file.size();) {
+        const std::uint8_t* chunk = file.data() + pos;
+        const std::uint32_t size  = Be32(chunk);
+        if (size > file.size() - pos - 12) return false;
+        const std::uint8_t* data = chunk + 8;
+        const std::string_view type(reinterpret_cast<const char*>(chunk + 4), 4);
+        pos += 12 + std::size_t{size};
+
+        if (type == "IHDR") {
+            if (haveHeader || size != 13) return false;
+            png.width     = Be32(data);
+            png.height    = Be32(data + 4);
+            png.depth     = data[8];
+            png.colorType = data[9];
+            if (data[10] != 0 || data[11] != 0 || data[12] != 0) return false;   // compression, filter, interlace
+            haveHeader = true;
+        } else if (!haveHeader) {
+            return false;
+        } else if (type == "PLTE") {
+            if (size % 3 != 0 || size > 3 * 256) return false;
+            png.paletteSize = size / 3;
+            for (std::uint32_t i = 0; i < png.paletteSize; ++i) {
+                png.palette[i] = Pixel(data[3 * i], data[3 * i + 1], data[3 * i + 2], 255);
+            }
+        } else if (type == "tRNS") {
+            if (png.colorType == 3) {
+                for (std::uint32_t i = 0; i < std::min<std::uint32_t>(size, 256); ++i) png.palette[i].a = data[i];
+            } else if (png.colorType == 0 && size == 2) {
+                png.key[0] = Be16(data);
+                png.hasKey = true;
+            } else if (png.colorType == 2 && size == 6) {
+                png.key = {Be16(data), Be16(data + 2), Be16(data + 4)};
+                png.hasKey = true;
+            }
+        } else if (type == "IDAT") {
+            idat.emplace_back(data, size);
+        } else if (type == "IEND") {
+            break;
+        } else if (!(type[0] & 0x20)) {
+            return false;   // unknown critical chunk
+        }
+    }
+    if (!haveHeader || idat.empty()) return false;
+    if (!SizeOk(png.width, png.height)) return false;
+
+    switch (png.colorType) {
+        case 0: png.channels = 1; break;
+        case 2: png.channels = 3; break;
+        case 3: png.channels = 1; break;
+        case 4: png.channels = 2; break;
+        case 6: png.channels = 4; break;
+        default: return false;
+    }
+    const std::uint32_t d = png.depth;
+    const bool depthOk = png.colorType == 0 ? (d == 1 || d == 2 || d == 4 || d == 8 || d == 16)
+                       : png.colorType == 3 ? (d == 1 || d == 2 || d == 4 || d == 8)
+                       :                      (d == 8 || d == 16);
+    if (!depthOk || (png.colorType == 3 && png.paletteSize == 0)) return false;
+    if (png.depth == 8 && png.hasKey) {
+        for (auto& k : png.key) if (k > 255) png.hasKey = false;   // can never match
+    }
+
+    const std::size_t bitsPerPixel = std::size_t{png.channels} * png.depth;
+    const std::size_t rowBytes     = (std::size_t{png.width} * bitsPerPixel + 7) / 8;
+    const std::size_t filterStride = std::max<std::size_t>(1, bitsPerPixel / 8);
+
+    BandWriter band(png.width, png.height);
+    std::vector<std::uint8_t> row(rowBytes + 1), prev(rowBytes + 1, 0);   // filter byte first
+    std::size_t   filled = 0;
+    std::uint32_t y      = 0;
+    bool          ok     = true;
+
+    Inflater inflater(idat);
+    const bool inflated = inflater.Run([&](const std::uint8_t* data, std::size_t n) {
+        while (n > 0 && y < png.height && ok) {
+            const std::size_t take = std::min(n, row.size() - filled);
+            std::memcpy(row.data() + filled, data, take);
+            filled += take;
+            data   += take;
+            n      -= take;
+            if (filled < row.size()) return;
+
+            ok = Unfilter(row[0], row.data() + 1, prev.data() + 1, rowBytes, filterStride);
+            ConvertPngRow(png, row.data() + 1, band.Row(y));
+            band.RowDone(y);
+            row.swap(prev);
+            filled = 0;
+            ++y;
+        }
+    });
+    if (!inflated || !ok || y < png.height) return false;
+
+    out = band.Finish();
+    return true;
+}
+
+// ============================================================
+// TGA
+//
+// Rows are decoded in file order (bottom-up unless the descriptor says
+// otherwise) straight into the band.  RLE packets may run across rows.
+// ============================================================
+
+bool DecodeTga(std::span<const std::uint8_t> file, ImageSurface& out)
+{
+    if (file.size() < 18) return false;
+    const std::uint8_t* h = file.data();
+
+    const std::uint32_t idLength  = h[0];
+    const std::uint32_t mapType   = h[1];
+    const std::uint32_t type      = h[2];
+    const std::uint32_t mapFirst  = Le16(h + 3);
+    const std::uint32_t mapLength = Le16(h + 5);
+    const std::uint32_t mapDepth  = h[7];
+    const std::uint32_t width     = Le16(h + 12);
+    const std::uint32_t height    = Le16(h + 14);
+    const std::uint32_t depth     = h[16];
+    const bool          topDown   = (h[17] & 0x20) != 0;
+
+    const bool          rle  = type >= 9;
+    const std::uint32_t kind = rle ? type - 8 : type;   // 1 colour-mapped, 2 true-colour, 3 grey
+    if (!SizeOk(width, height)) return false;
+
+    const auto validColor = [](std::uint32_t bits) { return bits == 15 || bits == 16 || bits == 24 || bits == 32; };
+    if (kind == 1) {
+        if (mapType != 1 || depth != 8 || !validColor(mapDepth)) return false;
+    } else if (kind == 2) {
+        if (!validColor(depth)) return false;
+    } else if (kind == 3) {
+        if (depth != 8) return false;
+    } else {
+        return false;
+    }
+
+    // 15/16-bit colour is 5:5:5; the attribute bit is ignored, as stb_image does.
+    const auto color = [](const std::uint8_t* p, std::uint32_t bits) {
+        if (bits <= 16) {
+            const std::uint32_t v = Le16(p);
+            return Pixel(static_cast<std::uint8_t>(((v >> 10) & 31) * 255 / 31),
+                         static_cast<std::uint8_t>(((v >> 5) & 31) * 255 / 31),
+                         static_cast<std::uint8_t>((v & 31) * 255 / 31), 255);
+        }
+        return Pixel(p[2], p[1], p[0], bits == 32 ? p[3] : 255);
+    };
+
+    std::size_t pos = 18 + idLength;
+    std::vector<Pixel> palette;
+    if (mapType == 1) {
+        const std::size_t entry = (mapDepth + 7) / 8;
+        if (pos + entry * mapLength > file.size()) return false;
+        palette.resize(mapLength);
+        for (std::uint32_t i = 0; i < mapLength; ++i) palette[i] = color(file.data() + pos + i * entry, mapDepth);
+        pos += entry * mapLength;
+    }
+
+    const std::size_t bpp = (depth + 7) / 8;
+    const auto pixelAt = [&](const std::uint8_t* p) {
+        if (kind == 3) return Pixel(p[0], p[0], p[0], 255);
+        if (kind == 2) return color(p, depth);
+        if (p[0] < mapFirst || p[0] - mapFirst >= palette.size()) return Pixel{0, 0, 0, 0};
+        return palette[p[0] - mapFirst];
+    };
+
+    BandWriter    band(width, height);
+    std::uint32_t packet = 0;      // pixels left in the current RLE packet
+    bool          repeat = false;
+    Pixel         runPixel{0, 0, 0, 0};
+
+    for (std::uint32_t r = 0; r < height; ++r) {
+        const std::uint32_t y   = topDown ? r : height - 1 - r;
+        Pixel*              dst = band.Row(y);
+
+        if (!rle) {
+            if (pos + bpp * width > file.size()) return false;
+            const std::uint8_t* src = file.data() + pos;
+            if (kind == 2 && depth == 32) {
+                for (std::uint32_t x = 0; x < width; ++x, src += 4) dst[x] = Pixel(src[2], src[1], src[0], src[3]);
+            } else if (kind == 2 && depth == 24) {
+                for (std::uint32_t x = 0; x < width; ++x, src += 3) dst[x] = Pixel(src[2], src[1], src[0], 255);
+            } else {
+                for (std::uint32_t x = 0; x < width; ++x, src += bpp) dst[x] = pixelAt(src);
+            }
+            pos += bpp * width;
+        } else {
+            for (std::uint32_t x = 0; x < width;) {
+                if (packet == 0) {
+                    if (pos >= file.size()) return false;
+                    const std::uint8_t header = file[pos++];
+                    packet = (header & 0x7Fu) + 1;
+                    repeat = (header & 0x80u) != 0;
+                    if (repeat) {
+                        if (pos + bpp > file.size()) return false;
+                        runPixel = pixelAt(file.data() + pos);
+                        pos += bpp;
+                    }
+                }
+                const std::uint32_t n = std::min(packet, width - x);
+                if (repeat) {
+                    std::fill_n(dst + x, n, runPixel);
+                } else {
+                    if (pos + bpp * n > file.size()) return false;
+                    for (std::uint32_t i = 0; i < n; ++i, pos += bpp) dst[x + i] = pixelAt(file.data() + pos);
+                }
+                x      += n;
+                packet -= n;
+            }
+        }
+        band.RowDone(y);
+    }
+
+    out = band.Finish();
+    return true;
+}
+
+// ============================================================
+// stb_image fallback
+//
+// Decodes the whole image at once, then cuts it into tiles band by band.
+// ============================================================
+
+bool DecodeWithStb(const std::string& filename, ImageSurface& out)
+{
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+    if (!data) return false;
+    if (!SizeOk(static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height))) {
+        stbi_image_free(data);
+        return false;
+    }
+
+    BandWriter band(static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height));
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * sizeof(Pixel);
+    for (std::uint32_t y = 0; y < static_cast<std::uint32_t>(height); ++y) {
+        std::memcpy(band.Row(y), data + y * rowBytes, rowBytes);
+        band.RowDone(y);
+    }
+    stbi_image_free(data);
+
+    out = band.Finish();
+    return true;
+}
+
+[[nodiscard]] bool IsTga(const std::string& filename)
+{
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".tga";
+}
+
+} // namespace
+
+// ============================================================
+// ImportedImage
+// ============================================================
+
+bool ImportedImage::HasTile(std::uint32_t, std::uint32_t tx, std::uint32_t ty) const noexcept
+{
+    return tiles_.HasTile(tx, ty);
+}
+
+bool ImportedImage::DecodeTile(std::uint32_t, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const
+{
+    const std::uint32_t tw = tiles_.TileWidth(tx);
+    const std::uint32_t th = tiles_.TileHeight(ty);
+    if (tw == 0 || th == 0 || out.size() < std::size_t{tw} * th) return false;
+    CopyTile(tiles_, tx, ty, out.data(), tw);
+    return true;
+}
+
+bool ImportedImage::DecodeLayer(std::uint32_t, std::span<Pixel> out, bool parallel) const
+{
+    const std::size_t width = tiles_.Width();
+    if (out.size() != width * tiles_.Height()) return false;
+
+    const auto copyRows = [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t ty = lo; ty < hi; ++ty) {
+            for (std::uint32_t tx = 0; tx < tiles_.TilesX(); ++tx) {
+                if (!tiles_.HasTile(tx, static_cast<std::uint32_t>(ty))) continue;
+                CopyTile(tiles_, tx, static_cast<std::uint32_t>(ty),
+                         out.data() + ty * kTile * width + std::size_t{tx} * kTile, width);
+            }
+        }
+    };
+    if (parallel) ParallelFor(0, tiles_.TilesY(), copyRows);
+    else          copyRows(0, tiles_.TilesY());
+    return true;
+}
+
+// ============================================================
+// ImportImage
+// ============================================================
+
+std::shared_ptr<const ImportedImage> ImportImage(const std::string& filename)
+{
+    try {
+        ImageSurface tiles;
+        bool         ok = false;
+        {
+            const MappedFile file(filename);
+            if (!file.Ok()) return nullptr;
+            const auto bytes = file.Bytes();
+            if (bytes.size() >= 8 && std::memcmp(bytes.data(), kPngSignature, 8) == 0) ok = DecodePng(bytes, tiles);
+            else if (IsTga(filename))                                                  ok = DecodeTga(bytes, tiles);
+        }
+        // Other formats, and anything the decoders above turned down.
+        if (!ok) ok = DecodeWithStb(filename, tiles);
+        if (!ok) return nullptr;
+        return std::make_shared<const ImportedImage>(std::move(tiles));
+    } catch (const std::bad_alloc&) {
+        return nullptr;   // an image within the limits that still does not fit
+    }
+}
+
+} // namespace pelpaint::core
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+
+#include "ImageSurface.hpp"
+#include "TileSource.hpp"
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// Image import
+//
+// Decodes an image file straight into TileSize × TileSize tiles.  Rows are
+// decoded one band (a row of tiles) at a time and each band is cut into
+// tiles as soon as it is complete; fully transparent tiles are not stored.
+// Peak memory is the tiles plus one band, not a full-image decode buffer
+// followed by a copy.
+//
+//   PNG  all colour types and bit depths, decoded as the compressed stream
+//        is inflated.  Interlaced files fall back to stb_image.
+//   TGA  true-colour, grey and colour-mapped, raw or RLE, either row order.
+//   Anything else stb_image reads (JPEG, BMP, GIF, ...) is decoded whole by
+//   stb_image and then cut into tiles band by band.
+//
+// The result is immutable and backs a pending layer (Canvas::
+// ReplaceActiveLayer) until it is first edited.
+// ---------------------------------------------------------------------------
+
+class ImportedImage final : public TileSource {
+public:
+    explicit ImportedImage(ImageSurface tiles) noexcept : tiles_(std::move(tiles)) {}
+
+    [[nodiscard]] std::uint32_t Width()  const noexcept override { return tiles_.Width();  }
+    [[nodiscard]] std::uint32_t Height() const noexcept override { return tiles_.Height(); }
+
+    // An image has a single layer; `layer` is ignored.
+    [[nodiscard]] bool HasTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty) const noexcept override;
+    bool DecodeTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const override;
+    bool DecodeLayer(std::uint32_t layer, std::span<Pixel> out, bool parallel = true) const override;
+
+    [[nodiscard]] bool InMemory() const noexcept override { return true; }
+
+    [[nodiscard]] const ImageSurface& Tiles() const noexcept { return tiles_; }
+
+private:
+    ImageSurface tiles_;
+};
+
+// Decode `filename`.  nullptr when the file is missing, not an image,
+// damaged, or too large: a side over kMaxCanvasDimension, over 2^30
+// pixels, or more than there is memory for.
+[[nodiscard]] std::shared_ptr<const ImportedImage> ImportImage(const std::string& filename);
+
+} // namespace pelpaint::core
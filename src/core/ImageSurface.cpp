@@ -1,5 +1,7 @@
 #include "ImageSurface.hpp"
 
+#include <atomic>
+
 namespace pelpaint::core {
 
 ImageSurface::ImageSurface(std::uint32_t width, std::uint32_t height) {
@@ -19,9 +21,8 @@ void ImageSurface::Resize(std::uint32_t width, std::uint32_t height) {
 void ImageSurface::Clear(PixelRGBA8 color) {
     if (color.isTransparent()) {
         for (auto& tile : m_tiles) {
-            tile.pixels.clear();
-            tile.allocated = false;
-            tile.dirty     = false;
+            tile.pixels.reset();
+            tile.dirty = false;
         }
         return;
     }
@@ -29,7 +30,7 @@ void ImageSurface::Clear(PixelRGBA8 color) {
     for (std::uint32_t ty = 0; ty < m_tilesY; ++ty) {
         for (std::uint32_t tx = 0; tx < m_tilesX; ++tx) {
             Tile& tile = EnsureTile(tx, ty);
-            std::fill(tile.pixels.begin(), tile.pixels.end(), color);
+            tile.pixels->fill(color);
             tile.dirty = true;
         }
     }
@@ -59,21 +60,17 @@ PixelRGBA8 ImageSurface::GetPixel(std::uint32_t x, std::uint32_t y) const noexce
     if (!IsValidCoord(x, y)) return {};
 
     const Tile* tile = GetTile(TileX(x), TileY(y));
-    if (!tile || !tile->allocated) return {};
+    if (!tile || !tile->Allocated()) return {};
 
-    const std::size_t idx = LocalIndex(LocalX(x), LocalY(y));
-    return (idx < tile->pixels.size()) ? tile->pixels[idx] : PixelRGBA8{};
+    return (*tile->pixels)[LocalIndex(LocalX(x), LocalY(y))];
 }
 
 void ImageSurface::SetPixel(std::uint32_t x, std::uint32_t y, PixelRGBA8 color) {
     if (!IsValidCoord(x, y)) return;
 
     Tile& tile = EnsureTile(TileX(x), TileY(y));
-    const std::size_t idx = LocalIndex(LocalX(x), LocalY(y));
-    if (idx < tile.pixels.size()) {
-        tile.pixels[idx] = color;
-        tile.dirty = true;
-    }
+    (*tile.pixels)[LocalIndex(LocalX(x), LocalY(y))] = color;
+    tile.dirty = true;
 }
 
 // ---- Zero-copy tile access ---------------------------------------------
@@ -82,36 +79,36 @@ std::span<PixelRGBA8> ImageSurface::TilePixelsMutable(std::uint32_t tx,
                                                         std::uint32_t ty) {
     Tile& tile = EnsureTile(tx, ty);
     tile.dirty = true;   // caller will write into it — mark dirty up front
-    return std::span<PixelRGBA8>(tile.pixels.data(), tile.pixels.size());
+    return std::span<PixelRGBA8>(tile.pixels->data(), tile.pixels->size());
 }
 
 std::span<const PixelRGBA8> ImageSurface::TilePixels(std::uint32_t tx,
                                                        std::uint32_t ty) const noexcept {
     const Tile* tile = GetTile(tx, ty);
-    if (!tile || !tile->allocated || tile->pixels.empty()) return {};
-    return std::span<const PixelRGBA8>(tile->pixels.data(), tile->pixels.size());
+    if (!tile || !tile->Allocated()) return {};
+    return std::span<const PixelRGBA8>(tile->pixels->data(), tile->pixels->size());
 }
 
 // ---- Dirty tracking ----------------------------------------------------
 
 bool ImageSurface::HasTile(std::uint32_t tx, std::uint32_t ty) const noexcept {
     const Tile* tile = GetTile(tx, ty);
-    return tile && tile->allocated;
+    return tile && tile->Allocated();
 }
 
 bool ImageSurface::IsTileDirty(std::uint32_t tx, std::uint32_t ty) const noexcept {
     const Tile* tile = GetTile(tx, ty);
-    return tile && tile->allocated && tile->dirty;
+    return tile && tile->Allocated() && tile->dirty;
 }
 
 void ImageSurface::MarkTileDirty(std::uint32_t tx, std::uint32_t ty) noexcept {
     Tile* tile = GetTileMut(tx, ty);
-    if (tile && tile->allocated) tile->dirty = true;
+    if (tile && tile->Allocated()) tile->dirty = true;
 }
 
 void ImageSurface::MarkAllDirty() noexcept {
     for (auto& tile : m_tiles) {
-        if (tile.allocated) tile.dirty = true;
+        if (tile.Allocated()) tile.dirty = true;
     }
 }
 
@@ -123,7 +120,7 @@ ImageSurface::CollectDirtyTiles() const {
     for (std::uint32_t ty = 0; ty < m_tilesY; ++ty) {
         for (std::uint32_t tx = 0; tx < m_tilesX; ++tx) {
             const Tile* tile = GetTile(tx, ty);
-            if (tile && tile->allocated && tile->dirty) {
+            if (tile && tile->Allocated() && tile->dirty) {
                 result.emplace_back(tx, ty);
             }
         }
@@ -140,7 +137,7 @@ void ImageSurface::ClearDirtyFlags() noexcept {
 bool ImageSurface::GetTileView(std::uint32_t tx, std::uint32_t ty,
                                 ImageView& outView) const noexcept {
     const Tile* tile = GetTile(tx, ty);
-    if (!tile || !tile->allocated || tile->pixels.empty()) {
+    if (!tile || !tile->Allocated()) {
         outView = {};
         return false;
     }
@@ -149,7 +146,7 @@ bool ImageSurface::GetTileView(std::uint32_t tx, std::uint32_t ty,
     const std::uint32_t h = TileHeight(ty);
     if (w == 0 || h == 0) { outView = {}; return false; }
 
-    outView.data   = reinterpret_cast<const std::uint8_t*>(tile->pixels.data());
+    outView.data   = reinterpret_cast<const std::uint8_t*>(tile->pixels->data());
     outView.width  = w;
     outView.height = h;
     // stride is always TileSize*4: GL_UNPACK_ROW_LENGTH handles the padding
@@ -170,7 +167,7 @@ ImageView ImageSurface::Flatten() const {
     for (std::uint32_t ty = 0; ty < m_tilesY; ++ty) {
         for (std::uint32_t tx = 0; tx < m_tilesX; ++tx) {
             const Tile* tile = GetTile(tx, ty);
-            if (!tile || !tile->allocated) continue;
+            if (!tile || !tile->Allocated()) continue;
 
             const std::uint32_t tw   = TileWidth(tx);
             const std::uint32_t th   = TileHeight(ty);
@@ -183,7 +180,7 @@ ImageView ImageSurface::Flatten() const {
                         static_cast<std::size_t>(ly) * TileSize + lx;
                     const std::size_t dstIdx =
                         static_cast<std::size_t>(toy + ly) * m_width + (tox + lx);
-                    m_flattenScratch[dstIdx] = tile->pixels[srcIdx];
+                    m_flattenScratch[dstIdx] = (*tile->pixels)[srcIdx];
                 }
             }
         }
@@ -219,11 +216,17 @@ ImageSurface::Tile& ImageSurface::EnsureTile(std::uint32_t tx,
     const std::uint32_t idx = TileIndex(tx, ty, m_tilesX);
     Tile& tile = m_tiles[idx];
 
-    if (!tile.allocated) {
-        tile.pixels.assign(static_cast<std::size_t>(TileSize) * TileSize,
-                           PixelRGBA8{0, 0, 0, 0});
-        tile.allocated = true;
-        tile.dirty     = true;
+    if (!tile.pixels) {
+        tile.pixels = std::make_shared<TileData>();
+        tile.pixels->fill(PixelRGBA8{0, 0, 0, 0});
+        tile.dirty  = true;
+    } else if (tile.pixels.use_count() > 1) {
+        // Shared with a snapshot: copy before writing.
+        tile.pixels = std::make_shared<TileData>(*tile.pixels);
+    } else {
+        // Sole owner.  Pairs with the release in the snapshot's last
+        // reference drop, so its reads finish before our writes.
+        std::atomic_thread_fence(std::memory_order_acquire);
     }
     return tile;
 }
@@ -240,4 +243,19 @@ ImageSurface::Tile* ImageSurface::GetTileMut(std::uint32_t tx,
     return &m_tiles[TileIndex(tx, ty, m_tilesX)];
 }
 
+// Snapshot: shares the tile buffers; EnsureTile copies one before writing.
+ImageSurface ImageSurface::Snapshot() const {
+    ImageSurface copy;
+    copy.m_width  = m_width;
+    copy.m_height = m_height;
+    copy.m_tilesX = m_tilesX;
+    copy.m_tilesY = m_tilesY;
+    copy.m_tiles.resize(m_tiles.size());
+
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+        copy.m_tiles[i].pixels = m_tiles[i].pixels;
+    }
+    return copy;
+}
+
 } // namespace pelpaint::core
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <vector>
 #include <utility>
@@ -49,10 +51,13 @@ struct PixelRGBA8 {
 //   • Canvas pixels are split into TileSize × TileSize tiles.
 //   • Tiles are lazily allocated (transparent pixels require no storage).
 //   • Each tile tracks a dirty flag for incremental GPU upload.
+//   • Tile buffers are reference-counted and copied on write, so a
+//     Snapshot() shares them until one side changes a tile.
 //
 // Zero-copy access
 //   • TilePixelsMutable(tx,ty) — returns std::span<PixelRGBA8> directly into
-//     the tile's vector; the tile is allocated and marked dirty automatically.
+//     the tile's buffer; the tile is allocated (or unshared) and marked dirty
+//     automatically.
 //   • TilePixels(tx,ty)        — returns std::span<const PixelRGBA8>; returns
 //     an empty span for unallocated (all-transparent) tiles.
 //   • GetTileView(tx,ty,out)   — fills an ImageView for GPU upload (read-only).
@@ -112,7 +117,8 @@ public:
     // ---- Zero-copy tile access -----------------------------------------
 
     // Returns a writable span over the full TileSize×TileSize pixel buffer of
-    // tile (tx, ty).  The tile is allocated if needed and marked dirty.
+    // tile (tx, ty).  The tile is allocated if needed, copied first if a
+    // snapshot shares it, and marked dirty.
     // Span length is always TileSize*TileSize; edge tiles carry zero-padding
     // in the right/bottom margin (transparent) that must not be uploaded.
     [[nodiscard]] std::span<PixelRGBA8>       TilePixelsMutable(std::uint32_t tx,
@@ -148,13 +154,24 @@ public:
     // to Flatten() or Resize().  No heap allocation on repeat calls.
     [[nodiscard]] ImageView Flatten() const;
 
+    // Independent copy of the dimensions and allocated tiles, for work that
+    // outlives the current frame (background export).  Costs one pointer
+    // copy per tile: both surfaces share the buffers, and whichever writes
+    // a tile first copies it, so the snapshot can be read on another thread
+    // while this surface is drawn on.  Dirty flags and the flatten scratch
+    // are not carried over.
+    [[nodiscard]] ImageSurface Snapshot() const;
+
 private:
     // ---- Internal tile bookkeeping -------------------------------------
 
+    using TileData = std::array<PixelRGBA8, static_cast<std::size_t>(TileSize) * TileSize>;
+
     struct Tile {
-        std::vector<PixelRGBA8> pixels;    // TileSize*TileSize entries when allocated
-        bool                    allocated = false;
-        bool                    dirty     = false;
+        std::shared_ptr<TileData> pixels;   // null until allocated; shared with snapshots
+        bool                      dirty = false;
+
+        [[nodiscard]] bool Allocated() const noexcept { return pixels != nullptr; }
     };
 
     static std::uint32_t TileCountX(std::uint32_t width)  noexcept;
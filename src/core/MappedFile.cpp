@@ -0,0 +1,83 @@
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define PELPAINT_MMAP 1
+#endif
+
+namespace pelpaint::core {
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#if defined(PELPAINT_MMAP)
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        const auto size = static_cast<std::size_t>(info.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            bytes_  = std::span(static_cast<const std::uint8_t*>(data), size);
+            mapped_ = true;
+        }
+    }
+    ::close(fd);   // the mapping keeps the file open
+#else
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(filename, ec);
+    if (ec || size == 0) return;
+
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) return;
+    buffer_.resize(static_cast<std::size_t>(size));
+    if (std::fread(buffer_.data(), 1, buffer_.size(), file) == buffer_.size()) {
+        bytes_ = buffer_;
+    } else {
+        buffer_.clear();
+    }
+    std::fclose(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes_(std::exchange(other.bytes_, {}))
+    , mapped_(std::exchange(other.mapped_, false))
+    , buffer_(std::move(other.buffer_))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        bytes_  = std::exchange(other.bytes_, {});
+        mapped_ = std::exchange(other.mapped_, false);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+void MappedFile::Close() noexcept
+{
+#if defined(PELPAINT_MMAP)
+    if (mapped_) ::munmap(const_cast<std::uint8_t*>(bytes_.data()), bytes_.size());
+#endif
+    bytes_  = {};
+    mapped_ = false;
+    buffer_.clear();
+}
+
+} // namespace pelpaint::core
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// MappedFile
+//
+// Read-only view of a whole file.  On POSIX systems the file is memory-
+// mapped, so opening costs nothing and pages are read from disk only when
+// touched.  Elsewhere it is read into memory: Windows cannot replace a file
+// that is mapped (saving over an open project would fail), and Emscripten
+// has no real mmap.
+//
+// The mapping is private and read-only.  Files are only ever replaced by
+// rename (see SaveProject), never rewritten in place, so a mapped file does
+// not change under the reader.
+// ---------------------------------------------------------------------------
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool Ok() const noexcept { return !bytes_.empty(); }
+    [[nodiscard]] std::span<const std::uint8_t> Bytes() const noexcept { return bytes_; }
+
+private:
+    void Close() noexcept;
+
+    std::span<const std::uint8_t> bytes_;
+    bool                          mapped_ = false;
+    std::vector<std::uint8_t>     buffer_;   // when not mapped
+};
+
+} // namespace pelpaint::core
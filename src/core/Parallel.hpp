@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// Parallel helpers
+//
+// ParallelFor(begin, end, fn) splits [begin, end) into contiguous bands and
+// calls fn(bandBegin, bandEnd) once per band, one band per worker thread.
+//   • The calling thread always processes the first band itself.
+//   • Bands never overlap, so fn may write to disjoint rows without locking.
+//   • Single-threaded builds (Emscripten without pthreads) and ranges smaller
+//     than 2 * minGrain run as a single serial call.
+//   • If a worker thread cannot be spawned its band runs inline instead.
+//   • Nested calls (fn itself calling ParallelFor, e.g. a filter kernel run
+//     per composite tile) execute serially inside the enclosing band.
+//
+// fn must not throw — an exception escaping a worker calls std::terminate.
+// ---------------------------------------------------------------------------
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+inline constexpr bool ThreadsAvailable = false;
+#else
+inline constexpr bool ThreadsAvailable = true;
+#endif
+
+namespace detail {
+
+inline thread_local bool insideParallelFor = false;
+
+struct ParallelScope {
+    bool previous;
+    ParallelScope() noexcept : previous(insideParallelFor) { insideParallelFor = true; }
+    ~ParallelScope() { insideParallelFor = previous; }
+    ParallelScope(const ParallelScope&)            = delete;
+    ParallelScope& operator=(const ParallelScope&) = delete;
+};
+
+} // namespace detail
+
+[[nodiscard]] inline unsigned WorkerCount() noexcept
+{
+    if constexpr (!ThreadsAvailable) return 1;
+    const unsigned hw = std::thread::hardware_concurrency();
+    return std::clamp(hw, 1u, 64u);
+}
+
+template<typename Fn>
+void ParallelFor(std::size_t begin, std::size_t end, Fn&& fn, std::size_t minGrain = 1)
+{
+    if (end <= begin) return;
+
+    const std::size_t count   = end - begin;
+    const std::size_t grain   = std::max<std::size_t>(1, minGrain);
+    const std::size_t maxBand = std::max<std::size_t>(1, count / grain);
+    const std::size_t bands   = std::min<std::size_t>(WorkerCount(), maxBand);
+
+    if (bands <= 1 || detail::insideParallelFor) {
+        fn(begin, end);
+        return;
+    }
+
+    const std::size_t bandSize = (count + bands - 1) / bands;
+
+    std::vector<std::thread> workers;
+    workers.reserve(bands - 1);
+
+    for (std::size_t b = 1; b < bands; ++b) {
+        const std::size_t lo = begin + b * bandSize;
+        const std::size_t hi = std::min(end, lo + bandSize);
+        if (lo >= hi) break;
+        try {
+            workers.emplace_back([&fn, lo, hi] {
+                detail::ParallelScope scope;
+                fn(lo, hi);
+            });
+        } catch (const std::system_error&) {
+            detail::ParallelScope scope;
+            fn(lo, hi);
+        }
+    }
+
+    {
+        detail::ParallelScope scope;
+        fn(begin, std::min(end, begin + bandSize));
+    }
+
+    for (auto& w : workers) w.join();
+}
+
+} // namespace pelpaint::core
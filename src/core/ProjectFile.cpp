@@ -0,0 +1,764 @@
+#include "ProjectFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include "ImageSurface.hpp"
+#include "Parallel.hpp"
+#include "../export/BufferedWriter.hpp"
+#include "../export/Deflate.hpp"
+
+namespace pelpaint::core {
+
+namespace {
+
+using exporter::Crc32;
+using exporter::PutLittleEndian;
+
+constexpr char          kMagic[4]      = {'P', 'E', 'L', 'P'};
+constexpr std::uint16_t kHeaderSize    = 36;      // including its CRC
+constexpr std::size_t   kChunkHeader   = 13;      // layer, tx, ty, codec, size
+constexpr std::uint32_t kEndOfChunks   = 0xFFFFFFFFu;
+constexpr std::uint32_t kTile          = ImageSurface::TileSize;
+constexpr std::size_t   kTilePixels    = std::size_t{kTile} * kTile;
+constexpr std::uint32_t kMaxPacket     = 128;
+constexpr std::uint32_t kMaxDimension  = kMaxCanvasDimension;
+constexpr std::uint32_t kMaxLayers     = 4096;
+constexpr std::size_t   kTilesPerBatch = 256;     // per worker, per save batch
+constexpr char          kIndexMagic[4] = {'P', 'I', 'D', 'X'};
+constexpr std::size_t   kIndexEntry    = 16;      // layer, tx, ty, offset
+constexpr std::size_t   kFooterSize    = 20;      // count, offset, CRC, magic
+
+enum class TileCodec : std::uint8_t {
+    Raw   = 0,
+    Solid = 1,
+    Rle   = 2,
+};
+
+static_assert(sizeof(Pixel) == 4, "tile codecs treat a pixel as 32 bits");
+
+using TilePixels = std::array<std::uint32_t, kTilePixels>;
+
+// ---- Little-endian packing -------------------------------------------------
+
+template <typename T>
+void Append(std::vector<std::uint8_t>& out, T value)
+{
+    const std::size_t at = out.size();
+    out.resize(at + sizeof(T));
+    PutLittleEndian(out.data() + at, value);
+}
+
+// 64-bit values are stored as two 32-bit halves, low first.
+void Append64(std::vector<std::uint8_t>& out, std::uint64_t value)
+{
+    Append(out, static_cast<std::uint32_t>(value));
+    Append(out, static_cast<std::uint32_t>(value >> 32));
+}
+
+void AppendCrc(std::vector<std::uint8_t>& out, std::size_t from)
+{
+    Append(out, Crc32(0, std::span(out.data() + from, out.size() - from)));
+}
+
+// Bounds-checked cursor over the file.  Reading past the end returns zeros
+// and clears Ok(), so a parser can check once after a group of reads.
+class ByteReader {
+public:
+    explicit ByteReader(std::span<const std::uint8_t> data) : data_(data) {}
+
+    [[nodiscard]] bool        Ok()       const noexcept { return ok_; }
+    [[nodiscard]] std::size_t Position() const noexcept { return pos_; }
+
+    template <typename T>
+    T Get() noexcept
+    {
+        if constexpr (sizeof(T) == 8) {
+            const std::uint64_t lo = Get<std::uint32_t>();
+            const std::uint64_t hi = Get<std::uint32_t>();
+            return std::bit_cast<T>(lo | hi << 32);
+        } else {
+            using Bits = std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                         std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint32_t>>;
+            const auto bytes = Bytes(sizeof(T));
+            if (bytes.empty()) return T{};
+            Bits bits;
+            std::memcpy(&bits, bytes.data(), sizeof(bits));
+            if constexpr (std::endian::native == std::endian::big) bits = std::byteswap(bits);
+            return std::bit_cast<T>(bits);
+        }
+    }
+
+    std::span<const std::uint8_t> Bytes(std::size_t count) noexcept
+    {
+        if (!ok_ || count > data_.size() - pos_) {
+            ok_ = false;
+            return {};
+        }
+        const auto bytes = data_.subspan(pos_, count);
+        pos_ += count;
+        return bytes;
+    }
+
+    void Seek(std::size_t pos) noexcept
+    {
+        if (pos > data_.size()) ok_ = false;
+        else                    pos_ = pos;
+    }
+
+    // True when the CRC-32 stored at the cursor matches bytes [from, cursor).
+    bool CheckCrc(std::size_t from) noexcept
+    {
+        const std::uint32_t actual = Crc32(0, data_.subspan(from, pos_ - from));
+        return Get<std::uint32_t>() == actual && ok_;
+    }
+
+private:
+    std::span<const std::uint8_t> data_;
+    std::size_t                   pos_ = 0;
+    bool                          ok_  = true;
+};
+
+// ---- Layer table -----------------------------------------------------------
+
+void AppendLayerRecord(std::vector<std::uint8_t>& out, const Layer& layer)
+{
+    const std::size_t start = out.size();
+    Append<std::uint32_t>(out, 0);   // record size, patched below
+
+    const auto nameSize = static_cast<std::uint16_t>(std::min<std::size_t>(layer.name.size(), 0xFFFF));
+    Append(out, nameSize);
+    out.insert(out.end(), layer.name.begin(), layer.name.begin() + nameSize);
+
+    Append(out, layer.opacity);
+    Append<std::uint8_t>(out, (layer.visible ? 1u : 0u) | (layer.locked ? 2u : 0u));
+    Append<std::int32_t>(out, layer.zIndex);
+    Append(out, layer.blendColor.r);
+    Append(out, layer.blendColor.g);
+    Append(out, layer.blendColor.b);
+    Append(out, layer.blendColor.a);
+    Append<std::int32_t>(out, layer.blendMode);
+
+    const Adjustment& adj = layer.adjustment;
+    Append(out, static_cast<std::uint8_t>(adj.type));
+    Append<std::int32_t>(out, adj.blockSize);
+    Append<std::uint8_t>(out, adj.preserveAlpha ? 1 : 0);
+    Append(out, static_cast<std::uint8_t>(adj.match));
+    Append(out, static_cast<std::uint32_t>(adj.palette.size()));
+    for (const Pixel& p : adj.palette) {
+        out.insert(out.end(), {p.r, p.g, p.b, p.a});
+    }
+
+    PutLittleEndian(out.data() + start, static_cast<std::uint32_t>(out.size() - start));
+}
+
+bool ReadLayerRecord(ByteReader& in, Layer& layer)
+{
+    const std::size_t   start = in.Position();
+    const std::uint32_t size  = in.Get<std::uint32_t>();
+
+    const auto name = in.Bytes(in.Get<std::uint16_t>());
+    layer.name.assign(name.begin(), name.end());
+
+    layer.opacity = in.Get<float>();
+    const auto flags = in.Get<std::uint8_t>();
+    layer.visible      = (flags & 1u) != 0;
+    layer.locked       = (flags & 2u) != 0;
+    layer.zIndex       = in.Get<std::int32_t>();
+    layer.blendColor.r = in.Get<float>();
+    layer.blendColor.g = in.Get<float>();
+    layer.blendColor.b = in.Get<float>();
+    layer.blendColor.a = in.Get<float>();
+    layer.blendMode    = in.Get<std::int32_t>();
+
+    Adjustment& adj = layer.adjustment;
+    const auto type  = in.Get<std::uint8_t>();
+    adj.blockSize     = in.Get<std::int32_t>();
+    adj.preserveAlpha = in.Get<std::uint8_t>() != 0;
+    const auto match = in.Get<std::uint8_t>();
+    if (type > static_cast<std::uint8_t>(AdjustmentType::Pixelify) ||
+        match > static_cast<std::uint8_t>(ColorMatchMode::Oklab)) {
+        return false;
+    }
+    adj.type  = static_cast<AdjustmentType>(type);
+    adj.match = static_cast<ColorMatchMode>(match);
+
+    const std::uint32_t paletteSize = in.Get<std::uint32_t>();
+    if (paletteSize > 0xFFFF) return false;
+    const auto palette = in.Bytes(std::size_t{paletteSize} * 4);
+    adj.palette.resize(palette.size() / 4);
+    for (std::size_t i = 0; i < adj.palette.size(); ++i) {
+        adj.palette[i] = Pixel(palette[i * 4], palette[i * 4 + 1], palette[i * 4 + 2], palette[i * 4 + 3]);
+    }
+
+    // Fields added by later versions are skipped.
+    if (!in.Ok() || in.Position() > start + size) return false;
+    in.Seek(start + size);
+    return in.Ok();
+}
+
+// ---- Tile codecs -----------------------------------------------------------
+
+// Append the RLE packets for `px` to `out`.  Gives up (false) as soon as
+// the packets are no smaller than the raw pixels.
+bool EncodeRle(std::span<const std::uint32_t> px, std::vector<std::uint8_t>& out)
+{
+    const std::size_t start = out.size();
+    const std::size_t limit = px.size_bytes();
+    const std::size_t n     = px.size();
+
+    const auto appendPixels = [&out](const std::uint32_t* p, std::size_t count) {
+        const std::size_t at = out.size();
+        out.resize(at + count * 4);
+        std::memcpy(out.data() + at, p, count * 4);
+    };
+
+    for (std::size_t i = 0; i < n;) {
+        std::size_t run = 1;
+        while (i + run < n && run < kMaxPacket && px[i + run] == px[i]) ++run;
+
+        if (run >= 2) {
+            out.push_back(static_cast<std::uint8_t>(0x80u | (run - 1)));
+            appendPixels(&px[i], 1);
+            i += run;
+        } else {
+            // Literal pixels up to the next pair of equal neighbours.
+            std::size_t count = 1;
+            while (i + count < n && count < kMaxPacket &&
+                   !(i + count + 1 < n && px[i + count] == px[i + count + 1])) {
+                ++count;
+            }
+            out.push_back(static_cast<std::uint8_t>(count - 1));
+            appendPixels(&px[i], count);
+            i += count;
+        }
+        if (out.size() - start >= limit) return false;
+    }
+    return true;
+}
+
+bool DecodeRle(std::span<const std::uint8_t> payload, std::span<std::uint32_t> px)
+{
+    std::size_t in  = 0;
+    std::size_t out = 0;
+    while (in < payload.size()) {
+        const std::uint8_t  header = payload[in++];
+        const std::size_t   count  = (header & 0x7Fu) + 1u;
+        const bool          run    = (header & 0x80u) != 0;
+        const std::size_t   bytes  = run ? 4 : count * 4;
+        if (count > px.size() - out || bytes > payload.size() - in) return false;
+
+        if (run) {
+            std::uint32_t value;
+            std::memcpy(&value, payload.data() + in, 4);
+            std::fill_n(px.data() + out, count, value);
+        } else {
+            std::memcpy(px.data() + out, payload.data() + in, bytes);
+        }
+        in  += bytes;
+        out += count;
+    }
+    return out == px.size();
+}
+
+// Copy the tw × th pixels at `origin` (rows `stride` apart) into px.
+std::span<const std::uint32_t> GatherTile(const Pixel* origin, std::size_t stride,
+                                          std::uint32_t tw, std::uint32_t th, TilePixels& px)
+{
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        std::memcpy(px.data() + std::size_t{ly} * tw, origin + ly * stride, std::size_t{tw} * 4);
+    }
+    return std::span<const std::uint32_t>(px.data(), std::size_t{tw} * th);
+}
+
+// Compress one tile into a complete chunk appended to `chunk`.  Nothing is
+// appended for a fully transparent tile unless `keepEmpty` is set.
+void EncodeTile(std::span<const std::uint32_t> px, std::uint32_t layerIndex,
+                std::uint32_t tx, std::uint32_t ty, std::vector<std::uint8_t>& chunk,
+                bool keepEmpty = false)
+{
+    const bool solid = std::all_of(px.begin(), px.end(), [first = px[0]](std::uint32_t p) { return p == first; });
+    if (solid && px[0] == 0 && !keepEmpty) return;
+
+    const std::size_t start = chunk.size();
+    Append(chunk, layerIndex);
+    Append(chunk, static_cast<std::uint16_t>(tx));
+    Append(chunk, static_cast<std::uint16_t>(ty));
+    Append(chunk, static_cast<std::uint8_t>(TileCodec::Raw));
+    Append<std::uint32_t>(chunk, 0);   // payload size, patched below
+
+    const std::size_t payload = start + kChunkHeader;
+    TileCodec codec = TileCodec::Solid;
+    if (solid) {
+        chunk.resize(payload + 4);
+        std::memcpy(chunk.data() + payload, px.data(), 4);
+    } else if (EncodeRle(px, chunk)) {
+        codec = TileCodec::Rle;
+    } else {
+        codec = TileCodec::Raw;
+        chunk.resize(payload + px.size_bytes());
+        std::memcpy(chunk.data() + payload, px.data(), px.size_bytes());
+    }
+
+    chunk[payload - 5] = static_cast<std::uint8_t>(codec);
+    PutLittleEndian(chunk.data() + payload - 4, static_cast<std::uint32_t>(chunk.size() - payload));
+    AppendCrc(chunk, start);
+}
+
+bool DecodePayload(TileCodec codec, std::span<const std::uint8_t> payload, std::span<std::uint32_t> px)
+{
+    switch (codec) {
+        case TileCodec::Raw:
+            if (payload.size() != px.size_bytes()) return false;
+            std::memcpy(px.data(), payload.data(), payload.size());
+            return true;
+        case TileCodec::Solid: {
+            if (payload.size() != 4) return false;
+            std::uint32_t value = 0;
+            std::memcpy(&value, payload.data(), 4);
+            std::fill(px.begin(), px.end(), value);
+            return true;
+        }
+        case TileCodec::Rle:
+            return DecodeRle(payload, px);
+    }
+    return false;
+}
+
+void ClearRows(Pixel* dst, std::size_t stride, std::uint32_t tw, std::uint32_t th)
+{
+    for (std::uint32_t ly = 0; ly < th; ++ly) std::fill_n(dst + ly * stride, tw, Pixel{0, 0, 0, 0});
+}
+
+// Directory entries, if the file ends with a valid one, passed to
+// add(layer, tx, ty, offset).  False when there is no directory or it is
+// damaged; entries already passed must then be discarded.
+template <typename Add>
+bool ReadDirectory(std::span<const std::uint8_t> file, std::size_t tableEnd, Add&& add)
+{
+    if (file.size() < tableEnd + kFooterSize) return false;
+    const std::size_t footer = file.size() - kFooterSize;
+    if (std::memcmp(file.data() + file.size() - sizeof(kIndexMagic), kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        return false;
+    }
+
+    ByteReader in(file);
+    in.Seek(footer);
+    const std::uint32_t count  = in.Get<std::uint32_t>();
+    const std::uint64_t offset = in.Get<std::uint64_t>();
+    if (offset < tableEnd || offset > footer || (footer - offset) != std::uint64_t{count} * kIndexEntry ||
+        !in.CheckCrc(static_cast<std::size_t>(offset))) {
+        return false;
+    }
+
+    in.Seek(static_cast<std::size_t>(offset));
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const auto layer = in.Get<std::uint32_t>();
+        const auto tx    = in.Get<std::uint16_t>();
+        const auto ty    = in.Get<std::uint16_t>();
+        const auto at    = in.Get<std::uint64_t>();
+        if (!add(layer, tx, ty, at)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ============================================================
+// ProjectReader
+// ============================================================
+
+bool ProjectReader::HasTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty) const noexcept
+{
+    const std::size_t slot = (std::size_t{layer} * tilesY_ + ty) * tilesX_ + tx;
+    return slot < chunks_.size() && chunks_[slot] != kNoChunk;
+}
+
+bool ProjectReader::DecodeTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const
+{
+    if (tx >= tilesX_ || ty >= tilesY_) return false;
+    const std::uint32_t tw = std::min(kTile, width_  - tx * kTile);
+    const std::uint32_t th = std::min(kTile, height_ - ty * kTile);
+    if (out.size() < std::size_t{tw} * th) return false;
+    return DecodeInto(layer, tx, ty, out.data(), tw);
+}
+
+bool ProjectReader::DecodeLayer(std::uint32_t layer, std::span<Pixel> out, bool parallel) const
+{
+    if (out.size() != std::size_t{width_} * height_) return false;
+
+    std::atomic<bool> ok{true};
+    const auto decodeRows = [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t ty = lo; ty < hi; ++ty) {
+            for (std::uint32_t tx = 0; tx < tilesX_; ++tx) {
+                if (!HasTile(layer, tx, static_cast<std::uint32_t>(ty))) continue;
+                Pixel* dst = out.data() + ty * kTile * width_ + std::size_t{tx} * kTile;
+                if (!DecodeInto(layer, tx, static_cast<std::uint32_t>(ty), dst, width_)) {
+                    ok.store(false, std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+    if (parallel) ParallelFor(0, tilesY_, decodeRows);
+    else          decodeRows(0, tilesY_);
+    return ok.load();
+}
+
+bool ProjectReader::DecodeInto(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty,
+                               Pixel* dst, std::size_t stride) const
+{
+    const std::uint32_t tw = std::min(kTile, width_  - tx * kTile);
+    const std::uint32_t th = std::min(kTile, height_ - ty * kTile);
+
+    if (!HasTile(layer, tx, ty)) {
+        ClearRows(dst, stride, tw, th);
+        return true;
+    }
+
+    const std::size_t offset = static_cast<std::size_t>(chunks_[(std::size_t{layer} * tilesY_ + ty) * tilesX_ + tx]);
+    ByteReader in(file_.Bytes());
+    in.Seek(offset);
+    const auto chunkLayer = in.Get<std::uint32_t>();
+    const auto chunkX     = in.Get<std::uint16_t>();
+    const auto chunkY     = in.Get<std::uint16_t>();
+    const auto codec      = static_cast<TileCodec>(in.Get<std::uint8_t>());
+    const auto payload    = in.Bytes(in.Get<std::uint32_t>());
+
+    TilePixels pixels;
+    const std::span<std::uint32_t> px(pixels.data(), std::size_t{tw} * th);
+
+    const bool ok = in.Ok() && chunkLayer == layer && chunkX == tx && chunkY == ty && in.CheckCrc(offset) &&
+                    DecodePayload(codec, payload, px);
+    if (!ok) {
+        ClearRows(dst, stride, tw, th);
+        return false;
+    }
+
+    for (std::uint32_t ly = 0; ly < th; ++ly) {
+        std::memcpy(static_cast<void*>(dst + ly * stride), px.data() + std::size_t{ly} * tw, std::size_t{tw} * 4);
+    }
+    return true;
+}
+
+// ============================================================
+// Chunks
+// ============================================================
+
+static_assert(kProjectChunkHeader == kChunkHeader);
+
+void AppendTileChunk(std::vector<std::uint8_t>& out, std::span<const Pixel> tile,
+                     std::uint32_t layer, std::uint32_t tx, std::uint32_t ty)
+{
+    if (tile.empty() || tile.size() > kTilePixels) return;
+    TilePixels px;
+    std::memcpy(px.data(), tile.data(), tile.size_bytes());
+    EncodeTile(std::span<const std::uint32_t>(px.data(), tile.size()), layer, tx, ty, out, true);
+}
+
+void AppendRawChunk(std::vector<std::uint8_t>& out, std::uint32_t layer, std::span<const std::uint8_t> payload)
+{
+    const std::size_t start = out.size();
+    Append(out, layer);
+    Append<std::uint16_t>(out, 0);
+    Append<std::uint16_t>(out, 0);
+    Append(out, static_cast<std::uint8_t>(TileCodec::Raw));
+    Append(out, static_cast<std::uint32_t>(payload.size()));
+    out.insert(out.end(), payload.begin(), payload.end());
+    AppendCrc(out, start);
+}
+
+bool ReadChunk(std::span<const std::uint8_t> bytes, std::size_t offset, ProjectChunk& chunk)
+{
+    ByteReader in(bytes);
+    in.Seek(offset);
+    chunk.layer   = in.Get<std::uint32_t>();
+    chunk.tx      = in.Get<std::uint16_t>();
+    chunk.ty      = in.Get<std::uint16_t>();
+    chunk.codec   = in.Get<std::uint8_t>();
+    chunk.payload = in.Bytes(in.Get<std::uint32_t>());
+    if (!in.CheckCrc(offset)) return false;
+    chunk.size = in.Position() - offset;
+    return true;
+}
+
+bool DecodeTileChunk(const ProjectChunk& chunk, std::span<Pixel> tile)
+{
+    if (tile.empty() || tile.size() > kTilePixels) return false;
+    TilePixels px;
+    const std::span<std::uint32_t> decoded(px.data(), tile.size());
+    if (!DecodePayload(static_cast<TileCodec>(chunk.codec), chunk.payload, decoded)) return false;
+    std::memcpy(static_cast<void*>(tile.data()), px.data(), tile.size_bytes());
+    return true;
+}
+
+void AppendLayerRecords(std::vector<std::uint8_t>& out, std::span<const Layer> layers)
+{
+    for (const Layer& layer : layers) AppendLayerRecord(out, layer);
+}
+
+bool ReadLayerRecords(std::span<const std::uint8_t> bytes, std::uint32_t count, std::vector<Layer>& layers)
+{
+    if (count > kMaxLayers) return false;
+    ByteReader in(bytes);
+    std::vector<Layer> read(count);
+    for (Layer& layer : read) {
+        if (!ReadLayerRecord(in, layer)) return false;
+    }
+    if (in.Position() != bytes.size()) return false;
+    layers = std::move(read);
+    return true;
+}
+
+// ============================================================
+// Save
+// ============================================================
+
+bool SaveProject(const std::string& filename, const Canvas& canvas, bool writeDamaged, bool* damaged)
+{
+    const auto& layers = canvas.Layers();
+    const auto  width  = static_cast<std::uint32_t>(canvas.Width());
+    const auto  height = static_cast<std::uint32_t>(canvas.Height());
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension ||
+        layers.empty() || layers.size() > kMaxLayers) {
+        return false;
+    }
+
+    const std::string partName = filename + ".part";
+    bool ok = false;
+    {
+        exporter::BufferedWriter out(partName);
+        std::vector<std::uint8_t> bytes;
+        std::uint64_t offset = 0;   // bytes written so far
+        const auto write = [&](const std::vector<std::uint8_t>& data) {
+            out.WriteBytes(data.data(), data.size());
+            offset += data.size();
+        };
+
+        // Header
+        bytes.insert(bytes.end(), std::begin(kMagic), std::end(kMagic));
+        Append(bytes, kProjectVersion);
+        Append(bytes, kHeaderSize);
+        Append(bytes, width);
+        Append(bytes, height);
+        Append(bytes, kTile);
+        Append(bytes, static_cast<std::uint32_t>(layers.size()));
+        Append<std::int32_t>(bytes, canvas.ActiveLayerIndex());
+        Append<std::int32_t>(bytes, canvas.NextLayerId());
+        AppendCrc(bytes, 0);
+        write(bytes);
+
+        // Layer table
+        bytes.clear();
+        Append<std::uint32_t>(bytes, 0);
+        for (const Layer& layer : layers) AppendLayerRecord(bytes, layer);
+        PutLittleEndian(bytes.data(), static_cast<std::uint32_t>(bytes.size() - 4));
+        AppendCrc(bytes, 4);
+        write(bytes);
+
+        // Tile chunks, encoded a batch at a time on every worker and written
+        // in order.  The directory collects where each one landed.
+        struct TileRef { std::uint32_t layer, tx, ty; };
+        const std::uint32_t tilesX = (width  + kTile - 1) / kTile;
+        const std::uint32_t tilesY = (height + kTile - 1) / kTile;
+        std::vector<TileRef> tiles;
+        for (std::uint32_t i = 0; i < layers.size(); ++i) {
+            const Layer& layer = layers[i];
+            if (!layer.IsPending() && layer.pixelData.size() != std::size_t{width} * height) continue;
+            for (std::uint32_t ty = 0; ty < tilesY; ++ty) {
+                for (std::uint32_t tx = 0; tx < tilesX; ++tx) {
+                    if (layer.IsPending() && !layer.source->HasTile(layer.sourceLayer, tx, ty)) continue;
+                    tiles.push_back({i, tx, ty});
+                }
+            }
+        }
+
+        std::vector<std::vector<std::uint8_t>> chunks(std::min(tiles.size(), WorkerCount() * kTilesPerBatch));
+        std::vector<std::uint8_t> directory;
+        std::uint32_t written = 0;
+        std::atomic<bool> damagedTile{false};
+        const auto stop = [&] { return !out.Ok() || (damagedTile.load() && !writeDamaged); };
+        for (std::size_t begin = 0; begin < tiles.size() && !stop(); begin += chunks.size()) {
+            const std::size_t count = std::min(chunks.size(), tiles.size() - begin);
+            ParallelFor(0, count, [&](std::size_t lo, std::size_t hi) {
+                TilePixels         px;
+                std::vector<Pixel> decoded;
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const TileRef& t     = tiles[begin + i];
+                    const Layer&   layer = layers[t.layer];
+                    const std::uint32_t tw = std::min(kTile, width  - t.tx * kTile);
+                    const std::uint32_t th = std::min(kTile, height - t.ty * kTile);
+
+                    std::span<const std::uint32_t> pixels;
+                    if (layer.IsPending()) {
+                        decoded.resize(std::size_t{tw} * th);
+                        if (!layer.source->DecodeTile(layer.sourceLayer, t.tx, t.ty, decoded))
+                            damagedTile.store(true, std::memory_order_relaxed);
+                        pixels = GatherTile(decoded.data(), tw, tw, th, px);
+                    } else {
+                        const Pixel* origin = layer.pixelData.data() + std::size_t{t.ty} * kTile * width + t.tx * kTile;
+                        pixels = GatherTile(origin, width, tw, th, px);
+                    }
+                    chunks[i].clear();
+                    EncodeTile(pixels, t.layer, t.tx, t.ty, chunks[i]);
+                }
+            }, 16);
+            if (stop()) break;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (chunks[i].empty()) continue;
+                const TileRef& t = tiles[begin + i];
+                Append(directory, t.layer);
+                Append(directory, static_cast<std::uint16_t>(t.tx));
+                Append(directory, static_cast<std::uint16_t>(t.ty));
+                Append64(directory, offset);
+                write(chunks[i]);
+                ++written;
+            }
+        }
+
+        if (damaged) *damaged = damagedTile.load();
+
+        // End chunk
+        bytes.clear();
+        Append(bytes, kEndOfChunks);
+        Append<std::uint16_t>(bytes, 0);
+        Append<std::uint16_t>(bytes, 0);
+        Append(bytes, static_cast<std::uint8_t>(TileCodec::Raw));
+        Append<std::uint32_t>(bytes, 4);
+        Append(bytes, written);
+        AppendCrc(bytes, 0);
+        write(bytes);
+
+        // Directory and footer
+        const std::uint64_t directoryOffset = offset;
+        Append(directory, written);
+        Append64(directory, directoryOffset);
+        AppendCrc(directory, 0);
+        directory.insert(directory.end(), std::begin(kIndexMagic), std::end(kIndexMagic));
+        write(directory);
+
+        ok = !stop() && out.Finish();
+    }
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(partName, filename, ec);
+        ok = !ec;
+    }
+    if (!ok) std::filesystem::remove(partName, ec);
+    return ok;
+}
+
+// ============================================================
+// Open / load
+// ============================================================
+
+bool OpenProject(const std::string& filename, CanvasSnapshot& project, int& nextLayerId)
+{
+    auto reader = std::make_shared<ProjectReader>();
+    reader->file_ = MappedFile(filename);
+    if (!reader->file_.Ok()) return false;
+    const auto file = reader->file_.Bytes();
+    ByteReader in(file);
+
+    // Header
+    const auto magic = in.Bytes(sizeof(kMagic));
+    if (magic.empty() || std::memcmp(magic.data(), kMagic, sizeof(kMagic)) != 0) return false;
+    const auto version    = in.Get<std::uint16_t>();
+    const auto headerSize = in.Get<std::uint16_t>();
+    const auto width      = in.Get<std::uint32_t>();
+    const auto height     = in.Get<std::uint32_t>();
+    const auto tileSize   = in.Get<std::uint32_t>();
+    const auto layerCount = in.Get<std::uint32_t>();
+    const auto active     = in.Get<std::int32_t>();
+    const auto nextId     = in.Get<std::int32_t>();
+    if (version == 0 || version > kProjectVersion || headerSize < kHeaderSize) return false;
+    in.Seek(headerSize - 4u);
+    if (!in.CheckCrc(0)) return false;
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension ||
+        tileSize != kTile || layerCount == 0 || layerCount > kMaxLayers) {
+        return false;
+    }
+
+    // Layer table
+    const std::uint32_t tableSize  = in.Get<std::uint32_t>();
+    const std::size_t   tableStart = in.Position();
+    std::vector<Layer> layers(layerCount);
+    for (Layer& layer : layers) {
+        if (!ReadLayerRecord(in, layer)) return false;
+    }
+    if (in.Position() != tableStart + tableSize || !in.CheckCrc(tableStart)) return false;
+    const std::size_t tableEnd = in.Position();
+
+    // Tile index: from the directory when there is one, else by walking
+    // the chunk headers.  Payloads are not touched.
+    reader->width_  = width;
+    reader->height_ = height;
+    reader->tilesX_ = (width  + kTile - 1) / kTile;
+    reader->tilesY_ = (height + kTile - 1) / kTile;
+    auto& chunks = reader->chunks_;
+    const auto addChunk = [&](std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, std::uint64_t offset) {
+        if (layer >= layerCount || layers[layer].IsAdjustment() ||
+            tx >= reader->tilesX_ || ty >= reader->tilesY_ ||
+            offset < tableEnd || offset + kChunkHeader > file.size()) {
+            return false;
+        }
+        std::uint64_t& slot = chunks[(std::size_t{layer} * reader->tilesY_ + ty) * reader->tilesX_ + tx];
+        if (slot != ProjectReader::kNoChunk) return false;
+        slot = offset;
+        return true;
+    };
+
+    chunks.assign(std::size_t{layerCount} * reader->tilesY_ * reader->tilesX_, ProjectReader::kNoChunk);
+    if (!ReadDirectory(file, tableEnd, addChunk)) {
+        std::fill(chunks.begin(), chunks.end(), ProjectReader::kNoChunk);
+        std::uint32_t found = 0;
+        for (;;) {
+            const std::size_t offset = in.Position();
+            const auto layer = in.Get<std::uint32_t>();
+            const auto tx    = in.Get<std::uint16_t>();
+            const auto ty    = in.Get<std::uint16_t>();
+            in.Get<std::uint8_t>();   // codec
+            const auto size  = in.Get<std::uint32_t>();
+            const auto payload = in.Bytes(size);
+            in.Get<std::uint32_t>();  // CRC
+            if (!in.Ok()) return false;
+
+            if (layer == kEndOfChunks) {
+                ByteReader end(file);
+                end.Seek(offset + kChunkHeader + size);
+                std::uint32_t count = 0;
+                if (size == 4) std::memcpy(&count, payload.data(), 4);
+                if constexpr (std::endian::native == std::endian::big) count = std::byteswap(count);
+                if (size != 4 || !end.CheckCrc(offset) || count != found) return false;
+                break;
+            }
+            if (!addChunk(layer, tx, ty, offset)) return false;
+            ++found;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < layerCount; ++i) {
+        if (layers[i].IsAdjustment()) continue;
+        layers[i].source      = reader;
+        layers[i].sourceLayer = i;
+    }
+
+    project.layers           = std::move(layers);
+    project.activeLayerIndex = std::clamp<int>(active, 0, static_cast<int>(layerCount) - 1);
+    project.canvasWidth      = static_cast<int>(width);
+    project.canvasHeight     = static_cast<int>(height);
+    project.description.clear();
+    nextLayerId = nextId;
+    return true;
+}
+
+} // namespace pelpaint::core
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "MappedFile.hpp"
+#include "TileSource.hpp"
+#include "Types.hpp"
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// Native project file (.pelp)
+//
+// Stores the whole layer stack: every layer's pixels, name, opacity,
+// visibility, lock, z-order, tint, blend mode and adjustment parameters.
+// All values are little-endian.
+//
+//   Header       magic "PELP", version, canvas size, tile size, layer count,
+//                active layer, next layer id, CRC-32.
+//   Layer table  byte size, one record per layer in stack order, CRC-32.
+//   Tile chunks  layer, tile x/y, codec, payload size, payload, CRC-32 of
+//                everything before it in the chunk.  One chunk per
+//                non-empty TileSize × TileSize tile of a pixel layer, in
+//                any order.  Fully transparent tiles are not stored.
+//   End chunk    a chunk whose layer is 0xFFFFFFFF; its payload is the
+//                number of tile chunks.  A file cut short has none.
+//   Directory    optional: layer, tile x/y and file offset of every tile
+//                chunk, then a footer (entry count, directory offset,
+//                CRC-32, magic "PIDX") that ends the file.
+//
+// Each tile is compressed on its own with the cheapest of three codecs:
+//   Raw    the pixels as they are.
+//   Solid  one pixel for a tile of a single colour.
+//   Rle    packets of up to 128 pixels, either one pixel repeated or
+//          literal pixels (the TGA scheme on whole 32-bit pixels).
+// Tiles are independent, so both directions run in parallel
+// (core::ParallelFor).  Saving encodes batches of tiles on all workers and
+// writes them in order.
+//
+// Opening is lazy.  The file is mapped (MappedFile) and only the header,
+// the layer table and the directory are read; files without a directory
+// have their chunk headers scanned instead.  Pixel layers come back
+// pending (Layer::source) and a tile is decoded, and its CRC checked, only
+// when something reads it.
+//
+// A reader accepts any version up to kProjectVersion.  New fields go at
+// the end of the header or of a layer record, so older files stay
+// readable.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::uint16_t kProjectVersion = 1;
+
+// Tile index of an opened project.  Immutable once opened, so any thread
+// may decode from it.  Layers are numbered as in the file; decoding checks
+// each tile's CRC.
+class ProjectReader final : public TileSource {
+public:
+    [[nodiscard]] std::uint32_t Width()  const noexcept override { return width_;  }
+    [[nodiscard]] std::uint32_t Height() const noexcept override { return height_; }
+
+    [[nodiscard]] bool HasTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty) const noexcept override;
+    bool DecodeTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const override;
+    bool DecodeLayer(std::uint32_t layer, std::span<Pixel> out, bool parallel = true) const override;
+
+private:
+    friend bool OpenProject(const std::string&, CanvasSnapshot&, int&);
+
+    bool DecodeInto(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, Pixel* dst, std::size_t stride) const;
+
+    static constexpr std::uint64_t kNoChunk = ~std::uint64_t{0};
+
+    MappedFile                 file_;
+    std::uint32_t              width_  = 0;
+    std::uint32_t              height_ = 0;
+    std::uint32_t              tilesX_ = 0;
+    std::uint32_t              tilesY_ = 0;
+    std::vector<std::uint64_t> chunks_;   // chunk offset per layer and tile, or kNoChunk
+};
+
+// Write the canvas to `filename`.  Pending layers are decoded from their
+// source tile by tile as they are written.  The file is written beside the
+// target and renamed over it at the end, so a failed save leaves the old
+// file intact.  A pending tile that fails to decode fails the save, with
+// `*damaged` set, unless `writeDamaged` asks for it to be written
+// transparent.
+bool SaveProject(const std::string& filename, const Canvas& canvas,
+                 bool writeDamaged = false, bool* damaged = nullptr);
+
+// Open a project lazily: `project` gets the layer stack with every pixel
+// layer pending on the file, `nextLayerId` the layer-id counter.  False,
+// with both untouched, when the file is missing, from a newer version or
+// its header, layer table or tile index is damaged.  Damaged tiles are
+// only found when decoded and then read as transparent.
+bool OpenProject(const std::string& filename, CanvasSnapshot& project, int& nextLayerId);
+
+// ---------------------------------------------------------------------------
+// Chunks
+//
+// The autosave journal (core/Autosave) appends the same tile chunks and
+// layer records to a file of its own.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::size_t kProjectChunkHeader = 13;   // layer, tile x/y, codec, payload size
+
+// A chunk as read back.  `size` covers header, payload and CRC.
+struct ProjectChunk {
+    std::uint32_t                 layer = 0;
+    std::uint32_t                 tx    = 0;
+    std::uint32_t                 ty    = 0;
+    std::uint8_t                  codec = 0;
+    std::span<const std::uint8_t> payload;
+    std::size_t                   size  = 0;
+};
+
+// Append a tile chunk for `tile` (tile width × height, rows packed).
+// Unlike in a saved project, a fully transparent tile gets a chunk too.
+void AppendTileChunk(std::vector<std::uint8_t>& out, std::span<const Pixel> tile,
+                     std::uint32_t layer, std::uint32_t tx, std::uint32_t ty);
+
+// Append a chunk with an uncompressed payload, tagged with `layer`.
+void AppendRawChunk(std::vector<std::uint8_t>& out, std::uint32_t layer, std::span<const std::uint8_t> payload);
+
+// Read the chunk at `offset`.  False when it is cut short or fails its CRC.
+bool ReadChunk(std::span<const std::uint8_t> bytes, std::size_t offset, ProjectChunk& chunk);
+
+// Decode a tile chunk's payload into `tile`.  False when it does not fit.
+bool DecodeTileChunk(const ProjectChunk& chunk, std::span<Pixel> tile);
+
+// Layer records as in the layer table; `bytes` must hold exactly `count`.
+// Pixels are not part of a record.
+void AppendLayerRecords(std::vector<std::uint8_t>& out, std::span<const Layer> layers);
+bool ReadLayerRecords(std::span<const std::uint8_t> bytes, std::uint32_t count, std::vector<Layer>& layers);
+
+} // namespace pelpaint::core
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "../ColorPalettes.hpp"
+
+namespace pelpaint::core {
+
+// ---------------------------------------------------------------------------
+// TileSource
+//
+// Read-only pixels that a pending layer (Layer::source) is backed by until
+// it is materialized: a project file (ProjectReader) or an imported image
+// (ImportedImage).  Pixels are addressed in TileSize × TileSize tiles, by
+// the source's own layer index.  Sources never change once built, so any
+// thread may read them and any number of layers and snapshots may share
+// one.
+// ---------------------------------------------------------------------------
+
+// Largest canvas side.  Project files, the autosave journal and image
+// import all refuse anything bigger.
+inline constexpr std::uint32_t kMaxCanvasDimension = 65536;
+
+class TileSource {
+public:
+    virtual ~TileSource() = default;
+
+    [[nodiscard]] virtual std::uint32_t Width()  const noexcept = 0;
+    [[nodiscard]] virtual std::uint32_t Height() const noexcept = 0;
+
+    // False for tiles that are fully transparent.
+    [[nodiscard]] virtual bool HasTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty) const noexcept = 0;
+
+    // Decode one tile into `out` (tile width × tile height, rows packed).
+    // Tiles without data come back transparent.  False, with the tile
+    // transparent, when its data is damaged.
+    virtual bool DecodeTile(std::uint32_t layer, std::uint32_t tx, std::uint32_t ty, std::span<Pixel> out) const = 0;
+
+    // Decode a whole layer into `out` (width × height, already transparent),
+    // on every worker unless `parallel` is false.  False when any tile was
+    // damaged; the rest of the layer is still decoded.
+    virtual bool DecodeLayer(std::uint32_t layer, std::span<Pixel> out, bool parallel = true) const = 0;
+
+    // True when the pixels already sit in memory, so materializing a layer
+    // is a plain copy.  Such layers are not decoded ahead of use: that would
+    // hold the pixels twice before anything was edited.
+    [[nodiscard]] virtual bool InMemory() const noexcept { return false; }
+};
+
+} // namespace pelpaint::core
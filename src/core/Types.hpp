@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -10,6 +11,7 @@
 
 namespace pelpaint {
 
+namespace core { class TileSource; }
 
 struct Point2f {
     float x = 0.0f;
@@ -48,15 +50,67 @@ struct ImageView {
     }
 };
 
+// ---------------------------------------------------------------------------
+// Palette matching metric
+//
+// Rgb   — Euclidean RGBA distance; fastest, the historical default.
+// Oklab — Euclidean distance in OKLab (plus alpha); perceptually even, so
+//         dark and saturated colours map to the entry a viewer would pick.
+// ---------------------------------------------------------------------------
+
+enum class ColorMatchMode {
+    Rgb,
+    Oklab,
+};
+
+// ---------------------------------------------------------------------------
+// Adjustment layers
+//
+// A layer whose adjustment.type is not None holds no pixels.  Canvas applies
+// the operation to the composite of everything below it, one 64×64 tile at a
+// time, when the composite is evaluated — the source layers stay untouched.
+// ---------------------------------------------------------------------------
+
+enum class AdjustmentType {
+    None,           // ordinary pixel layer
+    Grayscale,
+    PaletteMap,
+    OrderedDither,
+    Pixelify,
+};
+
+struct Adjustment {
+    AdjustmentType     type          = AdjustmentType::None;
+    std::vector<Pixel> palette;               // PaletteMap / OrderedDither; optional for Pixelify
+    int                blockSize     = 4;     // Pixelify — power of two, at most the tile size
+    bool               preserveAlpha = true;  // OrderedDither
+    ColorMatchMode     match         = ColorMatchMode::Rgb;   // any palette lookup
+
+    [[nodiscard]] bool operator==(const Adjustment&) const = default;
+};
+
 struct Layer {
     std::string        name;
-    std::vector<Pixel> pixelData;    // RGBA pixel buffer (w * h entries)
+    std::vector<Pixel> pixelData;    // RGBA pixel buffer (w * h entries); empty for adjustments
     float              opacity   = 1.0f;
     bool               visible   = true;
     bool               locked    = false;
     int                zIndex    = 0;
     Color4f            blendColor;   // tint; default opaque white
     int                blendMode = 0; // 0=Normal 1=Multiply 2=Screen 3=Overlay
+    Adjustment         adjustment;   // type None for pixel layers
+
+    // A layer opened from a project file or imported from an image keeps
+    // its pixels there until they are needed: while `source` is set,
+    // pixelData is empty and the pixels are layer `sourceLayer` of the
+    // source.  Canvas decodes it on first access (see Canvas::ActiveLayer);
+    // copies, undo snapshots included, share the source.
+    std::shared_ptr<const core::TileSource> source;
+    std::uint32_t                           sourceLayer = 0;
+
+    // Set when decoding the source found damaged tiles; they were left
+    // transparent, and saving writes them that way.
+    bool damaged = false;
 
     Layer() = default;
 
@@ -79,6 +133,12 @@ struct Layer {
         const std::size_t i = static_cast<std::size_t>(y) * w + x;
         if (i < pixelData.size()) pixelData[i] = color;
     }
+
+    [[nodiscard]] bool IsAdjustment() const noexcept {
+        return adjustment.type != AdjustmentType::None;
+    }
+
+    [[nodiscard]] bool IsPending() const noexcept { return source != nullptr; }
 };
 
 struct CanvasSnapshot {
@@ -87,6 +147,7 @@ struct CanvasSnapshot {
     int                canvasWidth      = 0;
     int                canvasHeight     = 0;
     std::string        description;
+    std::uint64_t      pixelRevision    = 0;   // Canvas pixel revision when taken; 0: unknown
 
     CanvasSnapshot() = default;
 
@@ -0,0 +1,44 @@
+#include "BufferedWriter.hpp"
+
+#include <algorithm>
+
+namespace pelpaint::exporter {
+
+BufferedWriter::BufferedWriter(const std::string& filename, std::size_t bufferSize)
+    : file_(std::fopen(filename.c_str(), "wb"))
+    , buffer_(std::max(bufferSize, kNumberReserve * 2))
+{
+    if (file_) std::setvbuf(file_, nullptr, _IONBF, 0);   // we already buffer
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    Finish();
+}
+
+bool BufferedWriter::Flush()
+{
+    if (!Ok()) return false;
+    if (used_ > 0 && std::fwrite(buffer_.data(), 1, used_, file_) != used_) failed_ = true;
+    used_ = 0;
+    return !failed_;
+}
+
+BufferedWriter& BufferedWriter::WriteDirect(const char* data, std::size_t size)
+{
+    if (Ok() && std::fwrite(data, 1, size, file_) != size) failed_ = true;
+    return *this;
+}
+
+bool BufferedWriter::Finish()
+{
+    if (file_) {
+        Flush();
+        if (std::fclose(file_) != 0) failed_ = true;
+        file_   = nullptr;
+        closed_ = true;
+    }
+    return closed_ && !failed_;
+}
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// BufferedWriter
+//
+// Output file for exporters that emit millions of small tokens.  Text and
+// numbers are appended to one reusable in-memory block and handed to the OS
+// in large writes; numbers are formatted with std::to_chars, so there is no
+// locale lookup, no stream state and nothing (precision, fixed) that can leak
+// from one call to the next.
+//
+// Errors are sticky: once a write fails every later call is a no-op and
+// Finish() returns false.
+// ---------------------------------------------------------------------------
+
+class BufferedWriter {
+public:
+    static constexpr std::size_t DefaultBufferSize = std::size_t{1} << 20;
+
+    explicit BufferedWriter(const std::string& filename,
+                            std::size_t bufferSize = DefaultBufferSize);
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter&)            = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    [[nodiscard]] bool Ok() const noexcept { return file_ != nullptr && !failed_; }
+
+    BufferedWriter& Write(std::string_view text) {
+        if (text.size() > Free() && !Flush()) return *this;
+        if (text.size() > buffer_.size()) return WriteDirect(text.data(), text.size());
+        std::char_traits<char>::copy(buffer_.data() + used_, text.data(), text.size());
+        used_ += text.size();
+        return *this;
+    }
+
+    BufferedWriter& Write(char c) {
+        if (Free() == 0 && !Flush()) return *this;
+        buffer_[used_++] = c;
+        return *this;
+    }
+
+    BufferedWriter& WriteBytes(const void* data, std::size_t size) {
+        return Write(std::string_view(static_cast<const char*>(data), size));
+    }
+
+    template <std::integral T>
+    BufferedWriter& Int(T value) {
+        if (Free() < kNumberReserve && !Flush()) return *this;
+        const auto result = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value);
+        used_ = static_cast<std::size_t>(result.ptr - buffer_.data());
+        return *this;
+    }
+
+    // Fixed-point with exactly `decimals` digits after the point.
+    BufferedWriter& Fixed(double value, int decimals) {
+        if (Free() < kNumberReserve && !Flush()) return *this;
+        const auto result = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(),
+                                          value, std::chars_format::fixed, decimals);
+        if (result.ec == std::errc{}) used_ = static_cast<std::size_t>(result.ptr - buffer_.data());
+        else                          failed_ = true;
+        return *this;
+    }
+
+    // Shortest representation that round-trips.
+    BufferedWriter& Float(float value) {
+        if (Free() < kNumberReserve && !Flush()) return *this;
+        const auto result = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value);
+        used_ = static_cast<std::size_t>(result.ptr - buffer_.data());
+        return *this;
+    }
+
+    // Flush and close.  Returns true when every byte reached the file.
+    bool Finish();
+
+private:
+    // Longest to_chars output we ask for (a fixed double with a few decimals
+    // can reach ~330 chars in the worst case; anything we export is far
+    // shorter, but the reserve must be safe).
+    static constexpr std::size_t kNumberReserve = 384;
+
+    [[nodiscard]] std::size_t Free() const noexcept { return buffer_.size() - used_; }
+
+    // Hand the buffered bytes to the file.  False once a write has failed.
+    bool Flush();
+    BufferedWriter& WriteDirect(const char* data, std::size_t size);
+
+    std::FILE*        file_   = nullptr;
+    std::vector<char> buffer_;
+    std::size_t       used_   = 0;
+    bool              failed_ = false;
+    bool              closed_ = false;
+};
+
+// Store a scalar little-endian at dst and return the byte after it; for
+// packing binary records before WriteBytes().
+template <typename T>
+    requires (std::is_arithmetic_v<T> && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4))
+std::uint8_t* PutLittleEndian(std::uint8_t* dst, T value) noexcept
+{
+    using Bits = std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                 std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint32_t>>;
+    auto bits = std::bit_cast<Bits>(value);
+    if constexpr (std::endian::native == std::endian::big) bits = std::byteswap(bits);
+    std::memcpy(dst, &bits, sizeof(bits));
+    return dst + sizeof(bits);
+}
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,580 @@
+#include "Deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace pelpaint::exporter {
+
+namespace {
+
+constexpr std::size_t kMinMatch  = 3;
+constexpr std::size_t kMaxMatch  = 258;
+constexpr int         kHashBits  = 15;
+
+struct MatchParams {
+    int         maxChain;    // candidates tried per position
+    std::size_t niceMatch;   // stop searching at this length
+    std::size_t lazyLimit;   // take longer matches without a lazy look (0: greedy)
+};
+
+constexpr MatchParams kFastParams  = { 6, 32, 0 };
+constexpr MatchParams kSmallParams = { 256, kMaxMatch, 128 };
+
+// Symbols per Huffman block: long enough to amortise the code tables,
+// short enough to follow changes in the data.
+constexpr std::size_t kBlockSymbols = std::size_t{1} << 15;
+
+constexpr int kLitLenCodes = 286;
+constexpr int kDistCodes   = 30;
+constexpr int kMaxBits     = 15;
+constexpr int kMaxCodeLenBits = 7;
+
+constexpr std::array<std::uint16_t, 29> kLengthBase = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+constexpr std::array<std::uint8_t, 29> kLengthExtra = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+constexpr std::array<std::uint16_t, 30> kDistBase = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+constexpr std::array<std::uint8_t, 30> kDistExtra = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+constexpr std::array<std::uint8_t, 19> kCodeLenOrder = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// Length → length code (0..28) and distance → distance code (0..29).
+struct CodeTables {
+    std::array<std::uint8_t, kMaxMatch + 1> lengthCode{};
+    std::array<std::uint8_t, 512>           distCode{};   // [d-1] below 257, [256 + ((d-1) >> 7)] above
+
+    constexpr CodeTables() {
+        for (int c = 0; c < 29; ++c) {
+            const int end = c + 1 < 29 ? kLengthBase[c + 1] : kMaxMatch + 1;
+            for (int len = kLengthBase[c]; len < end; ++len) lengthCode[len] = static_cast<std::uint8_t>(c);
+        }
+        lengthCode[kMaxMatch] = 28;
+        for (int c = 0; c < 30; ++c) {
+            const int end = kDistBase[c] + (1 << kDistExtra[c]);
+            for (int d = kDistBase[c]; d < end; ++d) {
+                if (d <= 256) distCode[d - 1] = static_cast<std::uint8_t>(c);
+                else          distCode[256 + ((d - 1) >> 7)] = static_cast<std::uint8_t>(c);
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr int Dist(std::uint32_t d) const noexcept {
+        return d <= 256 ? distCode[d - 1] : distCode[256 + ((d - 1) >> 7)];
+    }
+};
+
+constexpr CodeTables kCodes;
+
+// One LZ77 output symbol: a literal (dist == 0) or a back-reference.
+struct Symbol {
+    std::uint16_t litLen;
+    std::uint16_t dist;
+};
+
+// ============================================================
+// Bit output (LSB first, as deflate packs it)
+// ============================================================
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    void Put(std::uint32_t bits, int count) {
+        acc_ |= static_cast<std::uint64_t>(bits) << used_;
+        used_ += count;
+        while (used_ >= 8) {
+            out_.push_back(static_cast<std::uint8_t>(acc_));
+            acc_ >>= 8;
+            used_ -= 8;
+        }
+    }
+
+    void AlignToByte() {
+        if (used_ > 0) out_.push_back(static_cast<std::uint8_t>(acc_));
+        acc_  = 0;
+        used_ = 0;
+    }
+
+    void Bytes(const std::uint8_t* data, std::size_t size) {
+        out_.insert(out_.end(), data, data + size);
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+    std::uint64_t              acc_  = 0;
+    int                        used_ = 0;
+};
+
+// ============================================================
+// Huffman codes
+// ============================================================
+
+struct Code {
+    std::uint16_t bits = 0;   // bit-reversed, ready for BitWriter::Put
+    std::uint8_t  len  = 0;
+};
+
+// Optimal code lengths of at most maxBits for `freq` (package-merge).
+// Unused symbols get length 0; at least two symbols must be used.
+void BuildLengths(std::span<const std::uint32_t> freq, int maxBits, std::span<std::uint8_t> lengths)
+{
+    std::fill(lengths.begin(), lengths.end(), std::uint8_t{0});
+
+    struct Node {
+        std::uint64_t weight;
+        int           leaf;          // symbol, or -1 for a package
+        int           left, right;   // package children (node indices)
+    };
+    std::vector<Node> nodes;
+    std::vector<int>  leaves;
+    for (std::size_t s = 0; s < freq.size(); ++s) {
+        if (freq[s] == 0) continue;
+        leaves.push_back(static_cast<int>(nodes.size()));
+        nodes.push_back({ freq[s], static_cast<int>(s), -1, -1 });
+    }
+    std::stable_sort(leaves.begin(), leaves.end(),
+                     [&](int a, int b) { return nodes[a].weight < nodes[b].weight; });
+
+    if (leaves.size() == 1) {
+        lengths[nodes[leaves[0]].leaf] = 1;
+        return;
+    }
+    if (leaves.empty()) return;
+
+    std::vector<int> list = leaves, packages, merged;
+    for (int level = 1; level < maxBits; ++level) {
+        packages.clear();
+        for (std::size_t i = 0; i + 1 < list.size(); i += 2) {
+            packages.push_back(static_cast<int>(nodes.size()));
+            nodes.push_back({ nodes[list[i]].weight + nodes[list[i + 1]].weight, -1, list[i], list[i + 1] });
+        }
+        merged.resize(leaves.size() + packages.size());
+        std::merge(leaves.begin(), leaves.end(), packages.begin(), packages.end(), merged.begin(),
+                   [&](int a, int b) { return nodes[a].weight < nodes[b].weight; });
+        list.swap(merged);
+    }
+
+    // Each appearance of a leaf among the first 2n - 2 items adds one bit.
+    std::vector<int> stack;
+    for (std::size_t i = 0; i < 2 * leaves.size() - 2; ++i) {
+        stack.push_back(list[i]);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.leaf >= 0) {
+                ++lengths[node.leaf];
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+}
+
+[[nodiscard]] constexpr std::uint16_t ReverseBits(std::uint16_t code, int len) noexcept
+{
+    std::uint16_t out = 0;
+    for (int i = 0; i < len; ++i, code >>= 1) out = static_cast<std::uint16_t>(out << 1 | (code & 1u));
+    return out;
+}
+
+// Canonical codes from lengths (RFC 1951 3.2.2), bit-reversed for output.
+void AssignCodes(std::span<const std::uint8_t> lengths, std::span<Code> codes)
+{
+    std::array<std::uint16_t, kMaxBits + 2> count{}, next{};
+    for (std::uint8_t len : lengths) ++count[len];
+    count[0] = 0;
+    std::uint16_t code = 0;
+    for (int bits = 1; bits <= kMaxBits; ++bits) {
+        code = static_cast<std::uint16_t>((code + count[bits - 1]) << 1);
+        next[bits] = code;
+    }
+    for (std::size_t s = 0; s < lengths.size(); ++s) {
+        const int len = lengths[s];
+        codes[s] = {};
+        if (len == 0) continue;
+        const std::uint16_t c = next[len]++;
+        codes[s].bits = ReverseBits(c, len);
+        codes[s].len  = static_cast<std::uint8_t>(len);
+    }
+}
+
+// ============================================================
+// LZ77
+// ============================================================
+
+[[nodiscard]] std::size_t MatchLength(const std::uint8_t* a, const std::uint8_t* b, std::size_t limit) noexcept
+{
+    std::size_t n = 0;
+    while (n + 8 <= limit) {
+        std::uint64_t x, y;
+        std::memcpy(&x, a + n, 8);
+        std::memcpy(&y, b + n, 8);
+        if (x != y) {
+            const std::uint64_t diff = x ^ y;
+            if constexpr (std::endian::native == std::endian::little) return n + std::countr_zero(diff) / 8;
+            else                                                      return n + std::countl_zero(diff) / 8;
+        }
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) ++n;
+    return n;
+}
+
+class Matcher {
+public:
+    Matcher(std::span<const std::uint8_t> data, const MatchParams& params)
+        : data_(data), params_(params), head_(std::size_t{1} << kHashBits, -1), prev_(data.size(), -1) {}
+
+    // Link position p into its hash chain; returns the previous chain head.
+    std::int32_t Insert(std::size_t p) noexcept {
+        const std::uint32_t h = Hash(p);
+        const std::int32_t  first = head_[h];
+        prev_[p] = first;
+        head_[h] = static_cast<std::int32_t>(p);
+        return first;
+    }
+
+    // Longest match for position p along the chain starting at `candidate`.
+    std::size_t Longest(std::size_t p, std::int32_t candidate, std::uint32_t& dist) const noexcept {
+        const std::size_t limit = std::min(kMaxMatch, data_.size() - p);
+        if (limit < kMinMatch) return 0;
+
+        const std::uint8_t* cur  = data_.data() + p;
+        std::size_t         best = kMinMatch - 1;
+        for (int chain = params_.maxChain; candidate >= 0 && chain > 0; --chain) {
+            const std::size_t c = static_cast<std::size_t>(candidate);
+            if (p - c > kDeflateWindow) break;
+            const std::uint8_t* ref = data_.data() + c;
+            if (ref[best] == cur[best] && ref[0] == cur[0]) {
+                const std::size_t len = MatchLength(ref, cur, limit);
+                if (len > best) {
+                    best = len;
+                    dist = static_cast<std::uint32_t>(p - c);
+                    if (len >= params_.niceMatch || len == limit) break;
+                }
+            }
+            candidate = prev_[c];
+        }
+        return best >= kMinMatch ? best : 0;
+    }
+
+private:
+    [[nodiscard]] std::uint32_t Hash(std::size_t p) const noexcept {
+        const std::uint32_t v = static_cast<std::uint32_t>(data_[p]) << 16 |
+                                static_cast<std::uint32_t>(data_[p + 1]) << 8 | data_[p + 2];
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    std::span<const std::uint8_t> data_;
+    MatchParams                   params_;
+    std::vector<std::int32_t>     head_;
+    std::vector<std::int32_t>     prev_;
+};
+
+// Matching over data[start, end).  Greedy when params.lazyLimit is 0;
+// otherwise with one step of lazy evaluation (a match is deferred when the
+// next position has a longer one).
+void Tokenize(std::span<const std::uint8_t> data, std::size_t start, const MatchParams& params,
+              std::vector<Symbol>& out)
+{
+    const std::size_t end = data.size();
+    Matcher matcher(data, params);
+    for (std::size_t p = 0; p < start && p + kMinMatch <= end; ++p) matcher.Insert(p);
+
+    if (params.lazyLimit == 0) {
+        std::size_t p = start;
+        while (p < end) {
+            std::size_t   len  = 0;
+            std::uint32_t dist = 0;
+            if (p + kMinMatch <= end) len = matcher.Longest(p, matcher.Insert(p), dist);
+            if (len == 0) {
+                out.push_back({ data[p], 0 });
+                ++p;
+                continue;
+            }
+            out.push_back({ static_cast<std::uint16_t>(len), static_cast<std::uint16_t>(dist) });
+            // Positions inside short matches are linked; long runs are skipped.
+            if (len <= params.niceMatch) {
+                for (std::size_t q = p + 1; q < p + len && q + kMinMatch <= end; ++q) matcher.Insert(q);
+            }
+            p += len;
+        }
+        return;
+    }
+
+    bool          pending = false;   // data[p - 1] is not emitted yet
+    std::size_t   pendLen = 0;
+    std::uint32_t pendDist = 0;
+
+    std::size_t p = start;
+    while (p < end) {
+        std::size_t   len  = 0;
+        std::uint32_t dist = 0;
+        if (p + kMinMatch <= end) {
+            const std::int32_t candidate = matcher.Insert(p);
+            if (!(pending && pendLen >= params.lazyLimit)) len = matcher.Longest(p, candidate, dist);
+        }
+
+        if (pending && pendLen >= kMinMatch && pendLen >= len) {
+            out.push_back({ static_cast<std::uint16_t>(pendLen), static_cast<std::uint16_t>(pendDist) });
+            const std::size_t stop = p - 1 + pendLen;
+            for (std::size_t q = p + 1; q < stop && q + kMinMatch <= end; ++q) matcher.Insert(q);
+            p = stop;
+            pending = false;
+        } else {
+            if (pending) out.push_back({ data[p - 1], 0 });
+            pending  = true;
+            pendLen  = len;
+            pendDist = dist;
+            ++p;
+        }
+    }
+    if (pending) out.push_back({ data[end - 1], 0 });
+}
+
+// ============================================================
+// Blocks
+// ============================================================
+
+void WriteStored(BitWriter& bw, const std::uint8_t* data, std::size_t size, bool final)
+{
+    do {
+        const std::size_t piece = std::min<std::size_t>(size, 65535);
+        size -= piece;
+        bw.Put(final && size == 0 ? 1u : 0u, 1);
+        bw.Put(0, 2);
+        bw.AlignToByte();
+        const std::uint8_t header[4] = {
+            static_cast<std::uint8_t>(piece), static_cast<std::uint8_t>(piece >> 8),
+            static_cast<std::uint8_t>(~piece), static_cast<std::uint8_t>(~piece >> 8) };
+        bw.Bytes(header, 4);
+        bw.Bytes(data, piece);
+        data += piece;
+    } while (size > 0);
+}
+
+// Make sure at least two symbols are in use so every code is complete.
+void EnsureTwoSymbols(std::span<std::uint32_t> freq)
+{
+    int used = 0;
+    for (std::uint32_t f : freq) used += f != 0;
+    for (std::size_t s = 0; used < 2 && s < freq.size(); ++s) {
+        if (freq[s] == 0) { freq[s] = 1; ++used; }
+    }
+}
+
+// One block: dynamic Huffman, or stored when that is smaller.
+void WriteBlock(BitWriter& bw, std::span<const Symbol> symbols,
+                const std::uint8_t* raw, std::size_t rawSize, bool final)
+{
+    std::array<std::uint32_t, kLitLenCodes> litFreq{};
+    std::array<std::uint32_t, kDistCodes>   distFreq{};
+    for (const Symbol& s : symbols) {
+        if (s.dist == 0) {
+            ++litFreq[s.litLen];
+        } else {
+            ++litFreq[257 + kCodes.lengthCode[s.litLen]];
+            ++distFreq[kCodes.Dist(s.dist)];
+        }
+    }
+    litFreq[256] = 1;
+    EnsureTwoSymbols(litFreq);
+    EnsureTwoSymbols(distFreq);
+
+    std::array<std::uint8_t, kLitLenCodes> litLen{};
+    std::array<std::uint8_t, kDistCodes>   distLen{};
+    BuildLengths(litFreq, kMaxBits, litLen);
+    BuildLengths(distFreq, kMaxBits, distLen);
+
+    int hlit = kLitLenCodes;
+    while (hlit > 257 && litLen[hlit - 1] == 0) --hlit;
+    int hdist = kDistCodes;
+    while (hdist > 1 && distLen[hdist - 1] == 0) --hdist;
+
+    // Run-length code the two length tables as one sequence.
+    std::array<std::uint8_t, kLitLenCodes + kDistCodes> all{};
+    std::copy_n(litLen.begin(), hlit, all.begin());
+    std::copy_n(distLen.begin(), hdist, all.begin() + hlit);
+    const int total = hlit + hdist;
+
+    struct LenSymbol { std::uint8_t sym, extra; };
+    std::vector<LenSymbol> lenSymbols;
+    std::array<std::uint32_t, 19> clFreq{};
+    for (int i = 0; i < total;) {
+        const std::uint8_t v = all[i];
+        int run = 1;
+        while (i + run < total && all[i + run] == v) ++run;
+        i += run;
+        if (v == 0) {
+            while (run >= 11) { const int n = std::min(run, 138); lenSymbols.push_back({ 18, static_cast<std::uint8_t>(n - 11) }); run -= n; }
+            if (run >= 3)     { lenSymbols.push_back({ 17, static_cast<std::uint8_t>(run - 3) }); run = 0; }
+        } else {
+            lenSymbols.push_back({ v, 0 });
+            --run;
+            while (run >= 3) { const int n = std::min(run, 6); lenSymbols.push_back({ 16, static_cast<std::uint8_t>(n - 3) }); run -= n; }
+        }
+        while (run-- > 0) lenSymbols.push_back({ v, 0 });
+    }
+    for (const LenSymbol& s : lenSymbols) ++clFreq[s.sym];
+    EnsureTwoSymbols(clFreq);
+
+    std::array<std::uint8_t, 19> clLen{};
+    BuildLengths(clFreq, kMaxCodeLenBits, clLen);
+    int hclen = 19;
+    while (hclen > 4 && clLen[kCodeLenOrder[hclen - 1]] == 0) --hclen;
+
+    // Compare sizes in bits.
+    std::uint64_t dynamicBits = 3 + 14 + 3 * static_cast<std::uint64_t>(hclen);
+    for (const LenSymbol& s : lenSymbols)
+        dynamicBits += clLen[s.sym] + (s.sym == 16 ? 2 : s.sym == 17 ? 3 : s.sym == 18 ? 7 : 0);
+    for (int c = 0; c < kLitLenCodes; ++c)
+        dynamicBits += static_cast<std::uint64_t>(litFreq[c]) * (litLen[c] + (c > 256 ? kLengthExtra[c - 257] : 0));
+    for (int c = 0; c < kDistCodes; ++c)
+        dynamicBits += static_cast<std::uint64_t>(distFreq[c]) * (distLen[c] + kDistExtra[c]);
+    const std::uint64_t storedBits = (rawSize + 5 * (rawSize / 65535 + 1)) * 8 + 7;
+
+    if (storedBits < dynamicBits) {
+        WriteStored(bw, raw, rawSize, final);
+        return;
+    }
+
+    std::array<Code, kLitLenCodes> litCodes;
+    std::array<Code, kDistCodes>   distCodes;
+    std::array<Code, 19>           clCodes;
+    AssignCodes(litLen, litCodes);
+    AssignCodes(distLen, distCodes);
+    AssignCodes(clLen, clCodes);
+
+    bw.Put(final ? 1u : 0u, 1);
+    bw.Put(2, 2);
+    bw.Put(static_cast<std::uint32_t>(hlit - 257), 5);
+    bw.Put(static_cast<std::uint32_t>(hdist - 1), 5);
+    bw.Put(static_cast<std::uint32_t>(hclen - 4), 4);
+    for (int i = 0; i < hclen; ++i) bw.Put(clLen[kCodeLenOrder[i]], 3);
+    for (const LenSymbol& s : lenSymbols) {
+        bw.Put(clCodes[s.sym].bits, clCodes[s.sym].len);
+        if (s.sym == 16)      bw.Put(s.extra, 2);
+        else if (s.sym == 17) bw.Put(s.extra, 3);
+        else if (s.sym == 18) bw.Put(s.extra, 7);
+    }
+
+    for (const Symbol& s : symbols) {
+        if (s.dist == 0) {
+            bw.Put(litCodes[s.litLen].bits, litCodes[s.litLen].len);
+            continue;
+        }
+        const int lc = kCodes.lengthCode[s.litLen];
+        bw.Put(litCodes[257 + lc].bits, litCodes[257 + lc].len);
+        bw.Put(s.litLen - kLengthBase[lc], kLengthExtra[lc]);
+        const int dc = kCodes.Dist(s.dist);
+        bw.Put(distCodes[dc].bits, distCodes[dc].len);
+        bw.Put(s.dist - kDistBase[dc], kDistExtra[dc]);
+    }
+    bw.Put(litCodes[256].bits, litCodes[256].len);
+}
+
+} // namespace
+
+void DeflateChunk(std::span<const std::uint8_t> history,
+                  std::span<const std::uint8_t> input,
+                  bool last,
+                  std::vector<std::uint8_t>& out,
+                  DeflateLevel level)
+{
+    if (history.size() > kDeflateWindow) history = history.last(kDeflateWindow);
+
+    std::vector<std::uint8_t> data;
+    data.reserve(history.size() + input.size());
+    data.insert(data.end(), history.begin(), history.end());
+    data.insert(data.end(), input.begin(), input.end());
+
+    std::vector<Symbol> symbols;
+    symbols.reserve(input.size() / 2);
+    Tokenize(data, history.size(), level == DeflateLevel::Fast ? kFastParams : kSmallParams, symbols);
+
+    BitWriter bw(out);
+    const std::uint8_t* raw = input.data();
+    for (std::size_t s0 = 0; s0 < symbols.size(); s0 += kBlockSymbols) {
+        const std::size_t s1 = std::min(symbols.size(), s0 + kBlockSymbols);
+        std::size_t rawSize = 0;
+        for (std::size_t i = s0; i < s1; ++i) rawSize += symbols[i].dist == 0 ? 1 : symbols[i].litLen;
+
+        WriteBlock(bw, std::span(symbols).subspan(s0, s1 - s0), raw, rawSize, last && s1 == symbols.size());
+        raw += rawSize;
+    }
+
+    if (last) {
+        if (symbols.empty()) WriteStored(bw, nullptr, 0, true);
+        bw.AlignToByte();
+    } else {
+        WriteStored(bw, nullptr, 0, false);   // sync flush: byte-aligned
+    }
+}
+
+// ============================================================
+// Checksums
+// ============================================================
+
+std::uint32_t Adler32(std::uint32_t adler, std::span<const std::uint8_t> data) noexcept
+{
+    constexpr std::uint32_t kMod  = 65521;
+    constexpr std::size_t   kNMax = 5552;   // largest run before the sums can overflow
+
+    std::uint32_t a = adler & 0xFFFFu, b = adler >> 16;
+    while (!data.empty()) {
+        const std::size_t n = std::min(kNMax, data.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= kMod;
+        b %= kMod;
+        data = data.subspan(n);
+    }
+    return b << 16 | a;
+}
+
+std::uint32_t Crc32(std::uint32_t crc, std::span<const std::uint8_t> data) noexcept
+{
+    // Slicing-by-8: table k advances the CRC over a byte followed by k zero
+    // bytes, so eight input bytes fold in with eight independent lookups.
+    static constexpr auto kTables = [] {
+        std::array<std::array<std::uint32_t, 256>, 8> tables{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            tables[0][n] = c;
+        }
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            for (std::size_t t = 1; t < 8; ++t) {
+                tables[t][n] = tables[0][tables[t - 1][n] & 0xFFu] ^ (tables[t - 1][n] >> 8);
+            }
+        }
+        return tables;
+    }();
+
+    const std::uint8_t* p   = data.data();
+    std::size_t         len = data.size();
+
+    crc = ~crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        const std::uint32_t lo = crc ^ (std::uint32_t{p[0]} | std::uint32_t{p[1]} << 8 |
+                                        std::uint32_t{p[2]} << 16 | std::uint32_t{p[3]} << 24);
+        crc = kTables[7][lo & 0xFFu] ^ kTables[6][(lo >> 8) & 0xFFu] ^
+              kTables[5][(lo >> 16) & 0xFFu] ^ kTables[4][lo >> 24] ^
+              kTables[3][p[4]] ^ kTables[2][p[5]] ^ kTables[1][p[6]] ^ kTables[0][p[7]];
+    }
+    for (; len > 0; ++p, --len) crc = kTables[0][(crc ^ *p) & 0xFFu] ^ (crc >> 8);
+    return ~crc;
+}
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Deflate (RFC 1951) compressor for the PNG writer
+//
+// Input is compressed in chunks.  A chunk may match into `history`, the up
+// to 32 KiB of stream that precede it.  A chunk that is not the last ends
+// byte-aligned on an empty stored block (a sync flush).  So independently
+// compressed chunks, concatenated in order, form one valid deflate stream.
+//
+// LZ77 uses hash chains.  Each block of symbols gets its own
+// length-limited Huffman codes, or is stored raw when that is smaller
+// (e.g. noise).
+//
+//   Fast  — short chains and greedy matching.  Several times quicker, for
+//           saves that happen often.
+//   Small — long chains with lazy matching, about zlib level 9.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::size_t kDeflateWindow = 32768;
+
+enum class DeflateLevel {
+    Fast,
+    Small,
+};
+
+void DeflateChunk(std::span<const std::uint8_t> history,
+                  std::span<const std::uint8_t> input,
+                  bool last,
+                  std::vector<std::uint8_t>& out,
+                  DeflateLevel level = DeflateLevel::Small);
+
+// Running checksums: pass the previous value (1 for Adler-32, 0 for CRC-32
+// at the start) and the next piece of data.
+[[nodiscard]] std::uint32_t Adler32(std::uint32_t adler, std::span<const std::uint8_t> data) noexcept;
+[[nodiscard]] std::uint32_t Crc32(std::uint32_t crc, std::span<const std::uint8_t> data) noexcept;
+
+} // namespace pelpaint::exporter
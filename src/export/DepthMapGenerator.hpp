@@ -3,6 +3,7 @@
 #include "../ColorPalettes.hpp"
 #include "../PixelPaintView.hpp"
 #include "ExportUtils.hpp"
+#include "../core/Parallel.hpp"
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -14,6 +15,11 @@
 namespace pelpaint::exporter {
     class DepthMapGenerator {
     public:
+    // Depth of a cell = its area average of luma × alpha coverage, in 0..1:
+    // transparent pixels count as zero depth, so partly covered edge cells
+    // sit proportionally lower instead of snapping to their centre pixel.
+    // Cell sums come from a luma summed-area table, so every cell is O(1)
+    // whatever the grid size.
     static bool BuildDepthMap(const pelpaint::ImageView& view,
                                      std::uint32_t gridSize,
                                      std::vector<float>& outDepthMap)
@@ -26,45 +32,75 @@ namespace pelpaint::exporter {
         const std::size_t sampleW = SampleWidth(view.width, gridSize);
         const std::size_t sampleH = SampleHeight(view.height, gridSize);
 
+        std::vector<std::uint64_t> sat;
         try {
             outDepthMap.resize(sampleW * sampleH);
+            BuildLumaSAT(view, sat);
         } catch (...) {
             return false;
         }
 
-        // Fast depth map: one sample per cell, taken from cell center.
-        // TODO: average/coverage-weighted sampling if desired.
-        for (std::size_t sy = 0; sy < sampleH; ++sy) {
-            const std::uint32_t baseY = static_cast<std::uint32_t>(sy * gridSize);
-            const std::uint32_t centerY = ClampU32(
-                baseY + (gridSize / 2u),
-                0u,
-                view.height - 1u
-            );
+        const std::size_t satW = static_cast<std::size_t>(view.width) + 1u;
 
-            for (std::size_t sx = 0; sx < sampleW; ++sx) {
-                const std::uint32_t baseX = static_cast<std::uint32_t>(sx * gridSize);
-                const std::uint32_t centerX = ClampU32(
-                    baseX + (gridSize / 2u),
-                    0u,
-                    view.width - 1u
-                );
+        core::ParallelFor(0, sampleH, [&](std::size_t y0, std::size_t y1) {
+            for (std::size_t sy = y0; sy < y1; ++sy) {
+                const std::size_t top    = sy * gridSize;
+                const std::size_t bottom = std::min<std::size_t>(top + gridSize, view.height);
+                const std::uint64_t* rowTop    = sat.data() + top * satW;
+                const std::uint64_t* rowBottom = sat.data() + bottom * satW;
 
-                std::uint8_t r = 0, g = 0, b = 0, a = 255;
-                if (!ReadPixelRGBA8(view, centerX, centerY, r, g, b, a)) {
-                    return false;
+                for (std::size_t sx = 0; sx < sampleW; ++sx) {
+                    const std::size_t left  = sx * gridSize;
+                    const std::size_t right = std::min<std::size_t>(left + gridSize, view.width);
+
+                    const std::uint64_t sum = rowBottom[right] - rowBottom[left] - rowTop[right] + rowTop[left];
+                    outDepthMap[sy * sampleW + sx] = CellDepth(sum, (right - left) * (bottom - top));
                 }
+            }
+        }, 8);
 
-                // Ignore alpha by treating fully transparent as zero depth.
-                // TODO: add background masking / custom rules here.
-                float depth = (a == 0) ? 0.0f : (LumaFromRGBA(r, g, b) / 255.0f);
+        return true;
+    }
+
+    // Depth of a cell from its sum of luma × alpha over `area` pixels.
+    static float CellDepth(std::uint64_t sum, std::size_t area) noexcept
+    {
+        constexpr double kFullScale = 255.0 * 255.0;   // luma 255 at alpha 255
+        return Clamp01(static_cast<float>(sum / (static_cast<double>(area) * kFullScale)));
+    }
 
-                depth = Clamp01(depth);
-                outDepthMap[sy * sampleW + sx] = depth;
+    // Summed-area table of luma × alpha, (width + 1) × (height + 1) with a
+    // zero first row and column.  Rows are weighted and prefix-summed in
+    // parallel, then the vertical pass adds each row to the one above in
+    // parallel column strips (a contiguous add the compiler vectorises).
+    static void BuildLumaSAT(const pelpaint::ImageView& view, std::vector<std::uint64_t>& sat)
+    {
+        const std::size_t satW = static_cast<std::size_t>(view.width) + 1u;
+        const std::size_t satH = static_cast<std::size_t>(view.height) + 1u;
+        sat.assign(satW * satH, 0);
+
+        core::ParallelFor(0, view.height, [&](std::size_t y0, std::size_t y1) {
+            for (std::size_t y = y0; y < y1; ++y) {
+                const std::uint8_t* src = view.data + y * view.stride;
+                std::uint64_t*      dst = sat.data() + (y + 1u) * satW + 1u;
+                std::uint64_t       run = 0;
+                for (std::uint32_t x = 0; x < view.width; ++x, src += view.channels) {
+                    run += static_cast<std::uint64_t>(LumaFromRGBA8(src[0], src[1], src[2])) * src[3];
+                    dst[x] = run;
+                }
             }
-        }
+        }, 16);
 
-        return true;
+        constexpr std::size_t kStrip = 1024;   // columns per task
+        core::ParallelFor(0, (satW + kStrip - 1) / kStrip, [&](std::size_t s0, std::size_t s1) {
+            const std::size_t c0 = s0 * kStrip;
+            const std::size_t c1 = std::min(satW, s1 * kStrip);
+            for (std::size_t y = 2; y < satH; ++y) {
+                const std::uint64_t* above = sat.data() + (y - 1u) * satW;
+                std::uint64_t*       row   = sat.data() + y * satW;
+                for (std::size_t x = c0; x < c1; ++x) row[x] += above[x];
+            }
+        });
     }
   };
 } // namespace pelpaint::exporter
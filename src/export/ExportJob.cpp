@@ -0,0 +1,74 @@
+#include "ExportJob.hpp"
+#include "../core/Parallel.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace pelpaint::exporter {
+
+    namespace {
+
+        // Numbers the temporary files, so jobs writing the same target do
+        // not write into each other's.
+        std::atomic<std::uint32_t> jobCounter{0};
+
+    } // namespace
+
+    ExportJob::ExportJob(std::string filename, core::ImageSurface snapshot, Task task)
+        : filename_(std::move(filename))
+        , partial_(filename_ + "." + std::to_string(jobCounter.fetch_add(1, std::memory_order_relaxed)) + ".part")
+        , snapshot_(std::move(snapshot))
+        , task_(std::move(task))
+    {
+        if constexpr (core::ThreadsAvailable) {
+            try {
+                worker_ = std::thread([this] { Run(); });
+                return;
+            } catch (const std::system_error&) {
+                // fall through and export inline
+            }
+        }
+        Run();
+    }
+
+    ExportJob::~ExportJob()
+    {
+        progress_.Cancel();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void ExportJob::Run() noexcept
+    {
+        ExportState result = ExportState::Failed;
+
+        try {
+            const bool ok = !progress_.Cancelled() && task_(partial_, snapshot_, progress_);
+
+            if (progress_.Cancelled()) {
+                result = ExportState::Cancelled;
+            } else if (ok) {
+                std::error_code ec;
+                std::filesystem::rename(partial_, filename_, ec);
+                if (!ec) result = ExportState::Succeeded;
+            }
+        } catch (...) {
+            result = ExportState::Failed;
+        }
+
+        if (result != ExportState::Succeeded) {
+            std::error_code ec;
+            std::filesystem::remove(partial_, ec);
+        }
+
+        // Release the pixels now rather than when the UI drops the job.
+        snapshot_ = {};
+        task_     = nullptr;
+
+        if (result == ExportState::Succeeded) progress_.Report(1.0f);
+        state_.store(result, std::memory_order_release);
+    }
+
+} // namespace pelpaint::exporter
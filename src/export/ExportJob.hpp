@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "../core/ImageSurface.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Background export
+//
+// An ExportJob owns a snapshot of the composite surface (ImageSurface::
+// Snapshot, taken on the UI thread when the job is created) and runs one
+// encoder against it on a worker thread, so the canvas stays editable while
+// the file is written.
+//
+//   • The worker calls the task with a path and the snapshot.  Streaming
+//     encoders read it a tile row at a time (RowBands), so no full-size
+//     flattened copy is made unless the task itself needs one.
+//   • The task writes to "<filename>.<n>.part", n numbering the jobs, so
+//     two jobs for one target never share it.  That file is renamed over
+//     the target only on success; the job that finishes last wins.  Failed
+//     and cancelled jobs remove it, so the target is never left
+//     half-written.
+//   • Progress and cancellation go through ExportProgress.  Tasks report at
+//     their own phase boundaries and poll Cancelled() between phases.  A
+//     cancel takes effect at the next such check.  If the encoder finishes
+//     anyway, its output is discarded.
+//
+// Single-threaded builds run the task inline in the constructor.
+// ---------------------------------------------------------------------------
+
+class ExportProgress {
+public:
+    // Fraction of the work done, 0..1.
+    void  Report(float fraction) noexcept { fraction_.store(fraction, std::memory_order_relaxed); }
+    [[nodiscard]] float Fraction() const noexcept { return fraction_.load(std::memory_order_relaxed); }
+
+    void  Cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+    [[nodiscard]] bool Cancelled() const noexcept { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<float> fraction_{0.0f};
+    std::atomic<bool>  cancelled_{false};
+};
+
+enum class ExportState {
+    Running,
+    Succeeded,
+    Failed,
+    Cancelled,
+};
+
+class ExportJob {
+public:
+    // Writes `path` from `image`; returns false on failure.  Runs on the
+    // worker thread, so it must only touch what it captured by value.
+    using Task = std::function<bool(const std::string& path,
+                                    const core::ImageSurface& image,
+                                    ExportProgress& progress)>;
+
+    ExportJob(std::string filename, core::ImageSurface snapshot, Task task);
+    ~ExportJob();   // cancels and waits for the worker
+
+    ExportJob(const ExportJob&)            = delete;
+    ExportJob& operator=(const ExportJob&) = delete;
+
+    [[nodiscard]] const std::string& Filename() const noexcept { return filename_; }
+    [[nodiscard]] float       Progress() const noexcept { return progress_.Fraction(); }
+    [[nodiscard]] ExportState State()    const noexcept { return state_.load(std::memory_order_acquire); }
+    [[nodiscard]] bool        Finished() const noexcept { return State() != ExportState::Running; }
+    [[nodiscard]] bool        CancelRequested() const noexcept { return progress_.Cancelled(); }
+
+    void Cancel() noexcept { progress_.Cancel(); }
+
+private:
+    void Run() noexcept;
+
+    std::string              filename_;
+    std::string              partial_;    // what the task writes
+    core::ImageSurface       snapshot_;
+    Task                     task_;
+    ExportProgress           progress_;
+    std::atomic<ExportState> state_{ExportState::Running};
+    std::thread              worker_;   // last: starts after everything above
+};
+
+} // namespace pelpaint::exporter
@@ -31,6 +31,11 @@ static inline float LumaFromRGBA(std::uint8_t r, std::uint8_t g, std::uint8_t b)
            (0.0722f * static_cast<float>(b));
 }
 
+// Integer Rec.709 luma in 0..255 (weights 54/183/19 out of 256).
+static inline std::uint32_t LumaFromRGBA8(std::uint8_t r, std::uint8_t g, std::uint8_t b) noexcept {
+    return (54u * r + 183u * g + 19u * b + 128u) >> 8;
+}
+
 static inline bool ReadPixelRGBA8(const pelpaint::ImageView& view,
                                  std::uint32_t x,
                                  std::uint32_t y,
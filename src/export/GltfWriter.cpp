@@ -0,0 +1,301 @@
+#include "GltfWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+#include "BufferedWriter.hpp"
+
+namespace pelpaint::exporter {
+
+namespace {
+
+constexpr std::uint32_t kGlbMagic   = 0x46546C67;   // "glTF"
+constexpr std::uint32_t kGlbVersion = 2;
+constexpr std::uint32_t kChunkJson  = 0x4E4F534A;   // "JSON"
+constexpr std::uint32_t kChunkBin   = 0x004E4942;   // "BIN\0"
+
+constexpr int kByte          = 5120;
+constexpr int kUnsignedByte  = 5121;
+constexpr int kUnsignedShort = 5123;
+constexpr int kUnsignedInt   = 5125;
+constexpr int kFloat         = 5126;
+
+constexpr int kArrayBuffer        = 34962;
+constexpr int kElementArrayBuffer = 34963;
+
+constexpr int kModeLines     = 1;
+constexpr int kModeTriangles = 4;
+
+constexpr float kQuantMax = 65535.0f;
+
+// Binary records are packed into a scratch block of this size and written
+// in one call.
+constexpr std::size_t kBlockBytes = std::size_t{1} << 20;
+
+constexpr std::size_t PadTo4(std::size_t n) noexcept { return (n + 3) & ~std::size_t{3}; }
+
+// glTF vertex colours are linear; ours are sRGB.
+const std::array<std::uint8_t, 256>& SrgbToLinearTable()
+{
+    static const std::array<std::uint8_t, 256> table = [] {
+        std::array<std::uint8_t, 256> t{};
+        for (int i = 0; i < 256; ++i) {
+            const float c = static_cast<float>(i) / 255.0f;
+            const float l = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            t[i] = static_cast<std::uint8_t>(std::lround(l * 255.0f));
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Minimal JSON formatting into one string (no DOM).
+struct JsonText {
+    std::string text;
+
+    JsonText& Put(std::string_view s) { text.append(s); return *this; }
+
+    JsonText& Int(std::int64_t value) {
+        std::array<char, 24> buf;
+        const auto result = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+        text.append(buf.data(), result.ptr);
+        return *this;
+    }
+
+    JsonText& Float(float value) {
+        std::array<char, 32> buf;
+        const auto result = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+        text.append(buf.data(), result.ptr);
+        return *this;
+    }
+
+    JsonText& Vec3(const std::array<float, 3>& v) {
+        return Put("[").Float(v[0]).Put(",").Float(v[1]).Put(",").Float(v[2]).Put("]");
+    }
+};
+
+struct Layout {
+    std::size_t stride       = 0;
+    std::size_t normalOffset = 0;
+    std::size_t colorOffset  = 0;
+};
+
+Layout MakeLayout(const GlbOptions& options)
+{
+    Layout layout;
+    if (options.quantize) {
+        layout.normalOffset = 8;    // u16 × 3 + 2 pad
+        layout.colorOffset  = 12;   // i8 × 3 + 1 pad
+    } else {
+        layout.normalOffset = 12;
+        layout.colorOffset  = 24;
+    }
+    layout.stride = layout.colorOffset + (options.vertexColors ? 4 : 0);
+    return layout;
+}
+
+void Accessor(JsonText& json, int bufferView, std::size_t byteOffset, int componentType,
+              bool normalized, std::size_t count, std::string_view type)
+{
+    json.Put("{\"bufferView\":").Int(bufferView)
+        .Put(",\"byteOffset\":").Int(static_cast<std::int64_t>(byteOffset))
+        .Put(",\"componentType\":").Int(componentType);
+    if (normalized) json.Put(",\"normalized\":true");
+    json.Put(",\"count\":").Int(static_cast<std::int64_t>(count))
+        .Put(",\"type\":\"").Put(type).Put("\"");
+}
+
+} // namespace
+
+bool WriteGlb(const std::string& filename, const MeshData& mesh, const GlbOptions& options)
+{
+    const std::size_t vertexCount = mesh.vertices.size();
+    const std::size_t indexCount  = mesh.indices.size();
+    if (vertexCount == 0 || indexCount == 0) return false;
+    if (indexCount % (options.lines ? 2u : 3u) != 0u) return false;
+    if (vertexCount > std::numeric_limits<std::uint32_t>::max()) return false;
+
+    // ---- Bounds (POSITION needs min/max; quantization maps them to 0..65535)
+    std::array<float, 3> lo{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::max() };
+    std::array<float, 3> hi{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                             std::numeric_limits<float>::lowest() };
+    for (const MeshVertex& v : mesh.vertices) {
+        lo = { std::min(lo[0], v.x), std::min(lo[1], v.y), std::min(lo[2], v.z) };
+        hi = { std::max(hi[0], v.x), std::max(hi[1], v.y), std::max(hi[2], v.z) };
+    }
+    for (int i = 0; i < 3; ++i)
+        if (!std::isfinite(lo[i]) || !std::isfinite(hi[i])) return false;
+
+    std::array<float, 3> step{ 1.0f, 1.0f, 1.0f };   // world units per quantization step
+    std::array<float, 3> inv{ 0.0f, 0.0f, 0.0f };
+    std::array<float, 3> qMax{ 0.0f, 0.0f, 0.0f };
+    // One scale for all three axes, set by the largest extent: the node
+    // transform then leaves normal directions alone, so they are stored as
+    // they are (a per-axis scale would skew them).
+    const float extent = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] });
+    if (extent > 0.0f) {
+        for (int i = 0; i < 3; ++i) {
+            step[i] = extent / kQuantMax;
+            inv[i]  = kQuantMax / extent;
+            qMax[i] = static_cast<float>(std::lround((hi[i] - lo[i]) * inv[i]));
+        }
+    }
+
+    // ---- Buffer layout
+    const Layout      layout      = MakeLayout(options);
+    const bool        shortIndex  = vertexCount <= 0xFFFF;
+    const std::size_t indexSize   = shortIndex ? 2 : 4;
+    const std::size_t vertexBytes = vertexCount * layout.stride;
+    const std::size_t indexBytes  = indexCount * indexSize;
+    const std::size_t binBytes    = vertexBytes + PadTo4(indexBytes);
+
+    // ---- JSON chunk
+    JsonText json;
+    json.text.reserve(2048);
+    json.Put("{\"asset\":{\"version\":\"2.0\",\"generator\":\"pelpaint\"}");
+    if (options.quantize)
+        json.Put(",\"extensionsUsed\":[\"KHR_mesh_quantization\"]"
+                 ",\"extensionsRequired\":[\"KHR_mesh_quantization\"]");
+    json.Put(",\"scene\":0,\"scenes\":[{\"nodes\":[0]}]");
+
+    json.Put(",\"nodes\":[{\"mesh\":0");
+    if (options.quantize) {
+        json.Put(",\"translation\":").Vec3({ lo[0], -lo[1], lo[2] })
+            .Put(",\"scale\":").Vec3({ step[0], -step[1], step[2] });
+    } else {
+        json.Put(",\"scale\":[1,-1,1]");
+    }
+    json.Put("}]");
+
+    const int colorAccessor = options.vertexColors ? 2 : -1;
+    const int indexAccessor = options.vertexColors ? 3 : 2;
+    json.Put(",\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1");
+    if (colorAccessor >= 0) json.Put(",\"COLOR_0\":").Int(colorAccessor);
+    json.Put("},\"indices\":").Int(indexAccessor)
+        .Put(",\"mode\":").Int(options.lines ? kModeLines : kModeTriangles)
+        .Put(",\"material\":0}]}]");
+    json.Put(",\"materials\":[{\"doubleSided\":true,\"pbrMetallicRoughness\":{\"metallicFactor\":0}}]");
+
+    json.Put(",\"buffers\":[{\"byteLength\":").Int(static_cast<std::int64_t>(binBytes)).Put("}]");
+    json.Put(",\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":")
+        .Int(static_cast<std::int64_t>(vertexBytes))
+        .Put(",\"byteStride\":").Int(static_cast<std::int64_t>(layout.stride))
+        .Put(",\"target\":").Int(kArrayBuffer)
+        .Put("},{\"buffer\":0,\"byteOffset\":").Int(static_cast<std::int64_t>(vertexBytes))
+        .Put(",\"byteLength\":").Int(static_cast<std::int64_t>(indexBytes))
+        .Put(",\"target\":").Int(kElementArrayBuffer).Put("}]");
+
+    json.Put(",\"accessors\":[");
+    Accessor(json, 0, 0, options.quantize ? kUnsignedShort : kFloat, false, vertexCount, "VEC3");
+    if (options.quantize) json.Put(",\"min\":[0,0,0],\"max\":").Vec3(qMax).Put("},");
+    else                  json.Put(",\"min\":").Vec3(lo).Put(",\"max\":").Vec3(hi).Put("},");
+    Accessor(json, 0, layout.normalOffset, options.quantize ? kByte : kFloat, options.quantize,
+             vertexCount, "VEC3");
+    json.Put("},");
+    if (colorAccessor >= 0) {
+        Accessor(json, 0, layout.colorOffset, kUnsignedByte, true, vertexCount, "VEC4");
+        json.Put("},");
+    }
+    Accessor(json, 1, 0, shortIndex ? kUnsignedShort : kUnsignedInt, false, indexCount, "SCALAR");
+    json.Put("}]}");
+
+    json.text.resize(PadTo4(json.text.size()), ' ');
+
+    // ---- File
+    BufferedWriter file(filename);
+    if (!file.Ok()) return false;
+
+    const std::size_t totalBytes = 12 + 8 + json.text.size() + 8 + binBytes;
+    if (totalBytes > std::numeric_limits<std::uint32_t>::max()) return false;
+
+    std::array<std::uint8_t, 20> header;
+    std::uint8_t* h = header.data();
+    h = PutLittleEndian(h, kGlbMagic);
+    h = PutLittleEndian(h, kGlbVersion);
+    h = PutLittleEndian(h, static_cast<std::uint32_t>(totalBytes));
+    h = PutLittleEndian(h, static_cast<std::uint32_t>(json.text.size()));
+    PutLittleEndian(h, kChunkJson);
+    file.WriteBytes(header.data(), header.size());
+    file.Write(json.text);
+
+    h = header.data();
+    h = PutLittleEndian(h, static_cast<std::uint32_t>(binBytes));
+    PutLittleEndian(h, kChunkBin);
+    file.WriteBytes(header.data(), 8);
+
+    std::vector<std::uint8_t> block(kBlockBytes);
+
+    // Packs `count` records of `recordBytes` via pack(index, dst) and writes
+    // them a block at a time.
+    const auto writeRecords = [&](std::size_t count, std::size_t recordBytes, auto&& pack) {
+        const std::size_t perBlock = block.size() / recordBytes;
+        for (std::size_t first = 0; first < count; first += perBlock) {
+            const std::size_t last = std::min(count, first + perBlock);
+            std::uint8_t* dst = block.data();
+            for (std::size_t i = first; i < last; ++i) dst = pack(i, dst);
+            file.WriteBytes(block.data(), static_cast<std::size_t>(dst - block.data()));
+        }
+    };
+
+    const auto& linear = SrgbToLinearTable();
+    writeRecords(vertexCount, layout.stride, [&](std::size_t i, std::uint8_t* dst) {
+        const MeshVertex& v = mesh.vertices[i];
+        if (options.quantize) {
+            const auto quant = [&](float p, int axis) {
+                return static_cast<std::uint16_t>(std::clamp(std::lround((p - lo[axis]) * inv[axis]), 0L, 65535L));
+            };
+            const auto snorm = [](float n) {
+                return static_cast<std::int8_t>(std::lround(std::clamp(n, -1.0f, 1.0f) * 127.0f));
+            };
+            dst = PutLittleEndian(dst, quant(v.x, 0));
+            dst = PutLittleEndian(dst, quant(v.y, 1));
+            dst = PutLittleEndian(dst, quant(v.z, 2));
+            dst = PutLittleEndian(dst, std::uint16_t{ 0 });
+            dst = PutLittleEndian(dst, snorm(v.nx));
+            dst = PutLittleEndian(dst, snorm(v.ny));
+            dst = PutLittleEndian(dst, snorm(v.nz));
+            dst = PutLittleEndian(dst, std::int8_t{ 0 });
+        } else {
+            dst = PutLittleEndian(dst, v.x);
+            dst = PutLittleEndian(dst, v.y);
+            dst = PutLittleEndian(dst, v.z);
+            dst = PutLittleEndian(dst, v.nx);
+            dst = PutLittleEndian(dst, v.ny);
+            dst = PutLittleEndian(dst, v.nz);
+        }
+        if (options.vertexColors) {
+            dst[0] = linear[v.r];
+            dst[1] = linear[v.g];
+            dst[2] = linear[v.b];
+            dst[3] = v.a;
+            dst += 4;
+        }
+        return dst;
+    });
+
+    const std::uint32_t* idx = mesh.indices.data();
+    if (shortIndex) {
+        writeRecords(indexCount, 2, [&](std::size_t i, std::uint8_t* dst) {
+            return PutLittleEndian(dst, static_cast<std::uint16_t>(idx[i]));
+        });
+    } else if constexpr (std::endian::native == std::endian::little) {
+        file.WriteBytes(idx, indexBytes);
+    } else {
+        writeRecords(indexCount, 4, [&](std::size_t i, std::uint8_t* dst) {
+            return PutLittleEndian(dst, idx[i]);
+        });
+    }
+
+    static constexpr std::uint8_t kZero[4] = {};
+    file.WriteBytes(kZero, PadTo4(indexBytes) - indexBytes);
+
+    return file.Finish();
+}
+
+} // namespace pelpaint::exporter
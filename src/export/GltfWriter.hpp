@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include "MeshData.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// GLB (binary glTF 2.0)
+//
+// One mesh, one primitive, one interleaved vertex buffer:
+//
+//               position        normal              colour
+//   float       f32 × 3         f32 × 3             u8 × 4 normalized   (28 B)
+//   quantize    u16 × 3 + pad   i8 × 3 normalized   u8 × 4 normalized   (16 B)
+//               + pad
+//
+// Quantized positions span the mesh bounds and are mapped back by the node
+// transform (KHR_mesh_quantization, listed as required).  The scale is the
+// same on every axis, so normals need no correction.  Indices are uint16
+// when every vertex fits, uint32 otherwise.  The node also flips Y so the
+// image (Y down) reads upright in Y-up viewers.
+//
+// The JSON chunk is formatted straight into a string (sizes are known up
+// front, there is no DOM), then the binary chunk is streamed in blocks.
+// ---------------------------------------------------------------------------
+
+struct GlbOptions {
+    bool lines        = false;   // LINES primitive (Wireframe index pairs)
+    bool vertexColors = true;    // COLOR_0; otherwise no colour attribute
+    bool quantize     = false;   // u16 positions, i8 normals
+};
+
+bool WriteGlb(const std::string& filename, const MeshData& mesh, const GlbOptions& options = {});
+
+} // namespace pelpaint::exporter
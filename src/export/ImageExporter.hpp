@@ -4,238 +4,183 @@
 #include "../PixelPaintView.hpp"
 #include "DepthMapGenerator.hpp"
 #include "ExportUtils.hpp"
-#include "stb/stb_image_write.h"
+#include "JpegWriter.hpp"
+#include "PngWriter.hpp"
+#include "RectDecomposition.hpp"
+#include "RowBands.hpp"
+#include "SvgWriter.hpp"
+#include "TgaWriter.hpp"
 #include <string>
 #include <vector>
 #include <cstdint>
-#include <fstream>
-#include <sstream>
-#include <iomanip>
 #include <algorithm>
 
 namespace pelpaint::exporter {
 
 class ImageExporter {
-private:
-    /**
-     * Efficiently read a pelpaint::Pixel from an ImageView at a specific coordinate.
-     */
-    static inline pelpaint::Pixel ReadPixel(const pelpaint::ImageView& view, std::uint32_t x, std::uint32_t y) noexcept {
-        const std::uint8_t* p = view.data + (y * view.stride) + (x * view.channels);
-        return pelpaint::Pixel(p[0], p[1], p[2], p[3]);
-    }
-
 public:
     /**
-     * Optimized SVG Export using a Greedy Rectangle Merging algorithm.
+     * Pixel-exact SVG: one <rect> per merged rectangle (RectDecomposition).
      * Uses ImageView for efficient, non-owning access to image data.
-     * Optimized with std::uint8_t visited buffer for faster access in hot loops.
      */
-    static bool SaveToSVGOptimized(const std::string& filename, const pelpaint::ImageView& view) {
+    static bool SaveToSVGOptimized(const std::string& filename, const pelpaint::ImageView& view,
+                                   RectMergeMode merge = RectMergeMode::Rows) {
         if (!view.valid() || view.channels != 4) return false;
 
-        std::ofstream file(filename, std::ios::out | std::ios::trunc);
-        if (!file) return false;
-
-        file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-        file << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 "
-             << view.width << " " << view.height << "\" shape-rendering=\"crispEdges\">\n";
-
-        // Using uint8_t instead of vector<bool> for better performance in tight loops
-        std::vector<std::uint8_t> visited(view.width * view.height, 0);
-
-        for (std::uint32_t y = 0; y < view.height; ++y) {
-            for (std::uint32_t x = 0; x < view.width; ++x) {
-                std::uint32_t idx = y * view.width + x;
-
-                if (visited[idx]) continue;
-
-                pelpaint::Pixel p = ReadPixel(view, x, y);
-
-                // Skip transparent pixels
-                if (p.a == 0) {
-                    visited[idx] = 1;
-                    continue;
-                }
-
-                // Greedy Merge Width:
-                std::uint32_t rectW = 1;
-                while (x + rectW < view.width) {
-                    std::uint32_t nextIdx = y * view.width + (x + rectW);
-                    if (visited[nextIdx]) break;
-
-                    if (ReadPixel(view, x + rectW, y) == p) {
-                        rectW++;
-                    } else {
-                        break;
-                    }
-                }
-
-                // Greedy Merge Height:
-                std::uint32_t rectH = 1;
-                while (y + rectH < view.height) {
-                    bool rowMatches = true;
-                    for (std::uint32_t k = 0; k < rectW; ++k) {
-                        std::uint32_t checkIdx = (y + rectH) * view.width + (x + k);
-                        if (visited[checkIdx] || !(ReadPixel(view, x + k, y + rectH) == p)) {
-                            rowMatches = false;
-                            break;
-                        }
-                    }
-                    if (rowMatches) {
-                        rectH++;
-                    } else {
-                        break;
-                    }
-                }
-
-                // Mark visited area
-                for (std::uint32_t j = 0; j < rectH; ++j) {
-                    for (std::uint32_t i = 0; i < rectW; ++i) {
-                        visited[(y + j) * view.width + (x + i)] = 1;
-                    }
-                }
-
-                file << "<rect x=\"" << x << "\" y=\"" << y
-                     << "\" width=\"" << rectW << "\" height=\"" << rectH
-                     << "\" fill=\"rgb(" << (int)p.r << "," << (int)p.g << "," << (int)p.b << ")\"";
-
-                if (p.a < 255) {
-                    file << " fill-opacity=\"" << std::fixed << std::setprecision(3) << (p.a / 255.0f) << "\"";
-                }
-                file << "/>\n";
-            }
-        }
+        RowBands bands(view);
+        return SaveToSVGOptimized(filename, bands, merge);
+    }
 
-        file << "</svg>\n";
-        file.close();
-        return !file.fail();
+    static bool SaveToSVGOptimized(const std::string& filename, RowBands& bands,
+                                   RectMergeMode merge = RectMergeMode::Rows) {
+        return SaveRectsSVG(filename, bands, merge, true);
     }
 
     /**
-     * Vector-style SVG using optimized merging and smoothed styling.
+     * Vector-style SVG using the same merged rectangles with smoothed styling.
      * Includes slight rounding and overlap to prevent rendering artifacts.
      */
-    static bool SaveToSVGVector(const std::string& filename, const pelpaint::ImageView& view) {
+    static bool SaveToSVGVector(const std::string& filename, const pelpaint::ImageView& view,
+                                RectMergeMode merge = RectMergeMode::Rows) {
         if (!view.valid() || view.channels != 4) return false;
 
-        std::ofstream file(filename, std::ios::out | std::ios::trunc);
-        if (!file) return false;
-
-        file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-        file << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 "
-             << view.width << " " << view.height << "\">\n";
-
-        std::vector<std::uint8_t> visited(view.width * view.height, 0);
-
-        for (std::uint32_t y = 0; y < view.height; ++y) {
-            for (std::uint32_t x = 0; x < view.width; ++x) {
-                std::uint32_t idx = y * view.width + x;
-
-                if (visited[idx]) continue;
+        RowBands bands(view);
+        return SaveToSVGVector(filename, bands, merge);
+    }
 
-                pelpaint::Pixel p = ReadPixel(view, x, y);
-                if (p.a == 0) { visited[idx] = 1; continue; }
+    static bool SaveToSVGVector(const std::string& filename, RowBands& bands,
+                                RectMergeMode merge = RectMergeMode::Rows) {
+        return SaveRectsSVG(filename, bands, merge, false);
+    }
 
-                std::uint32_t rectW = 1;
-                while (x + rectW < view.width) {
-                    if (visited[y * view.width + (x + rectW)]) break;
-                    if (ReadPixel(view, x + rectW, y) == p) rectW++; else break;
-                }
+    /**
+     * PNG, TGA and JPEG are streamed band by band (PngWriter, TgaWriter,
+     * JpegWriter), so a surface export never holds more than one tile row.
+     */
+    static bool SaveToPNG(const std::string& filename, const pelpaint::ImageView& view,
+                          const PngOptions& options = {}) {
+        if (!view.valid() || view.channels != 4) return false;
 
-                std::uint32_t rectH = 1;
-                while (y + rectH < view.height) {
-                    bool rowMatches = true;
-                    for (std::uint32_t k = 0; k < rectW; ++k) {
-                        if (visited[(y + rectH) * view.width + (x + k)] || !(ReadPixel(view, x + k, y + rectH) == p)) {
-                            rowMatches = false; break;
-                        }
-                    }
-                    if (rowMatches) rectH++; else break;
-                }
+        RowBands bands(view);
+        return WritePng(filename, bands, options);
+    }
 
-                for (std::uint32_t j = 0; j < rectH; ++j) {
-                    for (std::uint32_t i = 0; i < rectW; ++i) visited[(y + j) * view.width + (x + i)] = 1;
-                }
+    static bool SaveToPNG(const std::string& filename, RowBands& bands,
+                          const PngOptions& options = {}) {
+        return WritePng(filename, bands, options);
+    }
 
-                file << "<rect x=\"" << x << "\" y=\"" << y
-                     << "\" width=\"" << rectW + 0.05 << "\" height=\"" << rectH + 0.05
-                     << "\" rx=\"0.4\" ry=\"0.4\" fill=\"rgb(" << (int)p.r << "," << (int)p.g << "," << (int)p.b << ")\"";
+    static bool SaveToTGA(const std::string& filename, const pelpaint::ImageView& view,
+                          const TgaOptions& options = {}) {
+        if (!view.valid() || view.channels != 4) return false;
 
-                if (p.a < 255) {
-                    file << " fill-opacity=\"" << std::fixed << std::setprecision(3) << (p.a / 255.0f) << "\"";
-                }
-                file << "/>\n";
-            }
-        }
+        RowBands bands(view);
+        return WriteTga(filename, bands, options);
+    }
 
-        file << "</svg>\n";
-        file.close();
-        return !file.fail();
+    static bool SaveToTGA(const std::string& filename, RowBands& bands,
+                          const TgaOptions& options = {}) {
+        return WriteTga(filename, bands, options);
     }
 
-    static bool SaveToPNG(const std::string& filename, const pelpaint::ImageView& view) {
-        if (!view.valid() || view.channels < 4) return false;
-
-        return stbi_write_png(
-            filename.c_str(),
-            static_cast<int>(view.width),
-            static_cast<int>(view.height),
-            4,
-            view.data,
-            static_cast<int>(view.stride)
-        ) != 0;
+    static bool SaveToJPEG(const std::string& filename, RowBands& bands,
+                           const JpegOptions& options = {}) {
+        return WriteJpeg(filename, bands, options);
     }
 
-    static bool SaveToTGA(const std::string& filename, const pelpaint::ImageView& view) {
-        if (!view.valid() || view.channels < 4) return false;
+    static bool SaveDepthMap(const pelpaint::ImageView& view,
+                             std::uint32_t gridSize,
+                             const std::string& filename)
+    {
+        if (!view.valid() || view.channels != 4) return false;
 
-        return stbi_write_tga(
-            filename.c_str(),
-            static_cast<int>(view.width),
-            static_cast<int>(view.height),
-            4,
-            view.data
-        ) != 0;
+        RowBands bands(view);
+        return SaveDepthMap(bands, gridSize, filename);
     }
 
-    static bool SaveDepthMap(const pelpaint::ImageView& view,
+    /**
+     * Depth map as an 8-bit grey PNG, one pixel per grid cell.  Cell sums
+     * accumulate band by band and each row of cells is written as soon as
+     * its last image row has been read; the values match BuildDepthMap.
+     */
+    static bool SaveDepthMap(RowBands& bands,
                              std::uint32_t gridSize,
                              const std::string& filename)
     {
-        if (!view.valid() || gridSize == 0) return false;
+        if (!bands.Valid() || gridSize == 0) return false;
+
+        const std::uint32_t width   = bands.Width();
+        const std::uint32_t height  = bands.Height();
+        const std::size_t   sampleW = SampleWidth(width, gridSize);
+        const std::size_t   sampleH = SampleHeight(height, gridSize);
+
+        PngWriter png(filename, static_cast<std::uint32_t>(sampleW), static_cast<std::uint32_t>(sampleH),
+                      PngFormat::Gray8);
+        if (!png.Ok()) return false;
+
+        std::vector<std::uint64_t> sums(sampleW, 0);
+        std::vector<std::uint8_t>  gray(sampleW);
+
+        pelpaint::ImageView band;
+        std::uint32_t       top = 0;
+        while (bands.Next(band, top)) {
+            for (std::uint32_t y = 0; y < band.height; ++y) {
+                const std::uint8_t* src = band.data + static_cast<std::size_t>(y) * band.stride;
+                for (std::size_t sx = 0; sx < sampleW; ++sx) {
+                    const std::uint32_t left  = static_cast<std::uint32_t>(sx) * gridSize;
+                    const std::uint32_t right = std::min(left + gridSize, width);
+                    std::uint64_t sum = 0;
+                    for (std::uint32_t x = left; x < right; ++x) {
+                        const std::uint8_t* p = src + static_cast<std::size_t>(x) * 4;
+                        sum += static_cast<std::uint64_t>(LumaFromRGBA8(p[0], p[1], p[2])) * p[3];
+                    }
+                    sums[sx] += sum;
+                }
 
-        std::vector<float> depthMap;
-        if (!DepthMapGenerator::BuildDepthMap(view, gridSize, depthMap)) {
-            return false;
+                // Emit the cell row once its last image row is in.
+                const std::uint32_t row     = top + y;
+                const std::uint32_t cellTop = row / gridSize * gridSize;
+                if (row + 1 != height && row + 1 - cellTop != gridSize) continue;
+
+                const std::size_t rows = row + 1 - cellTop;
+                for (std::size_t sx = 0; sx < sampleW; ++sx) {
+                    const std::size_t left  = sx * gridSize;
+                    const std::size_t right = std::min<std::size_t>(left + gridSize, width);
+                    gray[sx] = DepthToGray(DepthMapGenerator::CellDepth(sums[sx], (right - left) * rows));
+                    sums[sx] = 0;
+                }
+                png.Row(gray.data());
+            }
         }
 
-        const std::size_t sampleW = SampleWidth(view.width, gridSize);
-        const std::size_t sampleH = SampleHeight(view.height, gridSize);
+        return png.Finish();
+    }
+
+private:
+    static std::uint8_t DepthToGray(float depth) noexcept {
+        const int v = static_cast<int>(Clamp01(depth) * 255.0f + 0.5f);
+        return static_cast<std::uint8_t>(std::min(std::max(v, 0), 255));
+    }
 
-        if (depthMap.size() != sampleW * sampleH) return false;
+    static bool SaveRectsSVG(const std::string& filename, RowBands& bands,
+                             RectMergeMode merge, bool pixelExact) {
+        if (!bands.Valid()) return false;
 
-        std::vector<std::uint8_t> gray;
-        try {
-            gray.resize(depthMap.size());
-        } catch (...) {
-            return false;
-        }
+        SvgWriter svg(filename);
+        if (!svg.Ok()) return false;
+        svg.Begin(bands.Width(), bands.Height(), pixelExact);
+
+        std::vector<pelpaint::Pixel>  colors;
+        std::vector<LabeledRect>      rects;
+        DecomposeRects(bands, merge, colors, rects);
+        if (bands.Cancelled()) return false;
 
-        for (std::size_t i = 0; i < depthMap.size(); ++i) {
-            const float d = Clamp01(depthMap[i]);
-            const int v = static_cast<int>(d * 255.0f + 0.5f);
-            gray[i] = static_cast<std::uint8_t>(std::min(std::max(v, 0), 255));
+        for (const LabeledRect& r : rects) {
+            if (pixelExact) svg.Rect(r.x, r.y, r.w, r.h, colors[r.label]);
+            else            svg.RoundedRect(r.x, r.y, r.w, r.h, 0.05, colors[r.label]);
         }
 
-        return stbi_write_png(
-            filename.c_str(),
-            static_cast<int>(sampleW),
-            static_cast<int>(sampleH),
-            1,
-            gray.data(),
-            static_cast<int>(sampleW)
-        ) != 0;
+        return svg.End();
     }
 };
 } // namespace pelpaint::exporter
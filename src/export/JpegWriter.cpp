@@ -0,0 +1,437 @@
+#include "JpegWriter.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PELPAINT_JPEG_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define PELPAINT_JPEG_NEON 1
+#endif
+
+namespace pelpaint::exporter {
+
+    namespace {
+
+        constexpr std::uint8_t kZigZag[64] = {
+             0,  1,  5,  6, 14, 15, 27, 28,  2,  4,  7, 13, 16, 26, 29, 42,
+             3,  8, 12, 17, 25, 30, 41, 43,  9, 11, 18, 24, 31, 40, 44, 53,
+            10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60,
+            21, 34, 37, 47, 50, 56, 59, 61, 35, 36, 48, 49, 57, 58, 62, 63,
+        };
+
+        // Annex K tables: code counts per length 1..16, then the symbols.
+        constexpr std::uint8_t kDcLumCounts[16]   = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+        constexpr std::uint8_t kDcLumValues[12]   = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+        constexpr std::uint8_t kDcChromCounts[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+        constexpr std::uint8_t kDcChromValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+        constexpr std::uint8_t kAcLumCounts[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+        constexpr std::uint8_t kAcLumValues[162] = {
+            0x01,0x02,0x03,0x00,0x04,0x11,0x05,0x12,0x21,0x31,0x41,0x06,0x13,0x51,0x61,0x07,0x22,0x71,0x14,0x32,0x81,0x91,0xa1,0x08,
+            0x23,0x42,0xb1,0xc1,0x15,0x52,0xd1,0xf0,0x24,0x33,0x62,0x72,0x82,0x09,0x0a,0x16,0x17,0x18,0x19,0x1a,0x25,0x26,0x27,0x28,
+            0x29,0x2a,0x34,0x35,0x36,0x37,0x38,0x39,0x3a,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x53,0x54,0x55,0x56,0x57,0x58,0x59,
+            0x5a,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7a,0x83,0x84,0x85,0x86,0x87,0x88,0x89,
+            0x8a,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9a,0xa2,0xa3,0xa4,0xa5,0xa6,0xa7,0xa8,0xa9,0xaa,0xb2,0xb3,0xb4,0xb5,0xb6,
+            0xb7,0xb8,0xb9,0xba,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7,0xc8,0xc9,0xca,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,0xe1,0xe2,
+            0xe3,0xe4,0xe5,0xe6,0xe7,0xe8,0xe9,0xea,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,
+        };
+        constexpr std::uint8_t kAcChromCounts[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+        constexpr std::uint8_t kAcChromValues[162] = {
+            0x00,0x01,0x02,0x03,0x11,0x04,0x05,0x21,0x31,0x06,0x12,0x41,0x51,0x07,0x61,0x71,0x13,0x22,0x32,0x81,0x08,0x14,0x42,0x91,
+            0xa1,0xb1,0xc1,0x09,0x23,0x33,0x52,0xf0,0x15,0x62,0x72,0xd1,0x0a,0x16,0x24,0x34,0xe1,0x25,0xf1,0x17,0x18,0x19,0x1a,0x26,
+            0x27,0x28,0x29,0x2a,0x35,0x36,0x37,0x38,0x39,0x3a,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x53,0x54,0x55,0x56,0x57,0x58,
+            0x59,0x5a,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7a,0x82,0x83,0x84,0x85,0x86,0x87,
+            0x88,0x89,0x8a,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9a,0xa2,0xa3,0xa4,0xa5,0xa6,0xa7,0xa8,0xa9,0xaa,0xb2,0xb3,0xb4,
+            0xb5,0xb6,0xb7,0xb8,0xb9,0xba,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7,0xc8,0xc9,0xca,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,
+            0xe2,0xe3,0xe4,0xe5,0xe6,0xe7,0xe8,0xe9,0xea,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,
+        };
+
+        constexpr int kLumQuant[64] = {
+            16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+            14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+            18, 22, 37, 56, 68,109,103, 77, 24, 35, 55, 64, 81,104,113, 92,
+            49, 64, 78, 87,103,121,120,101, 72, 92, 95, 98,112,100,103, 99,
+        };
+        constexpr int kChromQuant[64] = {
+            17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+            24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+            99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+            99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+        };
+
+        // AAN scale factors × √8.
+        constexpr float kAanScale[8] = {
+            1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f,
+            1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f,
+        };
+
+        template <typename Table>
+        void BuildHuffman(const std::uint8_t (&counts)[16], const std::uint8_t* values, Table& table)
+        {
+            std::uint16_t code = 0;
+            std::size_t   k    = 0;
+            for (std::uint16_t length = 1; length <= 16; ++length) {
+                for (std::uint8_t i = 0; i < counts[length - 1]; ++i) {
+                    table[values[k++]] = { code++, length };
+                }
+                code = static_cast<std::uint16_t>(code << 1);
+            }
+        }
+
+        // One 8-point AAN forward DCT, in place along `step`.
+        void Dct8(float* d, int step) noexcept
+        {
+            const float tmp0 = d[0 * step] + d[7 * step];
+            const float tmp7 = d[0 * step] - d[7 * step];
+            const float tmp1 = d[1 * step] + d[6 * step];
+            const float tmp6 = d[1 * step] - d[6 * step];
+            const float tmp2 = d[2 * step] + d[5 * step];
+            const float tmp5 = d[2 * step] - d[5 * step];
+            const float tmp3 = d[3 * step] + d[4 * step];
+            const float tmp4 = d[3 * step] - d[4 * step];
+
+            // Even part
+            float tmp10 = tmp0 + tmp3;
+            const float tmp13 = tmp0 - tmp3;
+            float tmp11 = tmp1 + tmp2;
+            float tmp12 = tmp1 - tmp2;
+
+            d[0 * step] = tmp10 + tmp11;
+            d[4 * step] = tmp10 - tmp11;
+
+            const float z1 = (tmp12 + tmp13) * 0.707106781f;
+            d[2 * step] = tmp13 + z1;
+            d[6 * step] = tmp13 - z1;
+
+            // Odd part
+            tmp10 = tmp4 + tmp5;
+            tmp11 = tmp5 + tmp6;
+            tmp12 = tmp6 + tmp7;
+
+            const float z5 = (tmp10 - tmp12) * 0.382683433f;
+            const float z2 = tmp10 * 0.541196100f + z5;
+            const float z4 = tmp12 * 1.306562965f + z5;
+            const float z3 = tmp11 * 0.707106781f;
+
+            const float z11 = tmp7 + z3;
+            const float z13 = tmp7 - z3;
+
+            d[5 * step] = z13 + z2;
+            d[3 * step] = z13 - z2;
+            d[1 * step] = z11 + z4;
+            d[7 * step] = z11 - z4;
+        }
+
+        // Magnitude category and value bits of a coefficient.
+        void ValueBits(int value, std::uint32_t& bits, std::uint32_t& length) noexcept
+        {
+            std::uint32_t magnitude = static_cast<std::uint32_t>(value < 0 ? -value : value);
+            length = 0;
+            while (magnitude) {
+                ++length;
+                magnitude >>= 1;
+            }
+            const int v = value < 0 ? value - 1 : value;
+            bits = static_cast<std::uint32_t>(v) & ((1u << length) - 1);
+        }
+
+        // RGBA → Y, Cb, Cr (JFIF, Y centred on 0), translucent pixels
+        // composited over `matte`.  The SIMD paths do the same float
+        // operations in the same order as the scalar one.
+        void ConvertRow(const std::uint8_t* rgba, std::uint32_t width, const float (&matte)[3],
+                        float* y, float* u, float* v) noexcept
+        {
+            std::uint32_t x = 0;
+#if defined(PELPAINT_JPEG_SSE2)
+            const __m128i byteMask = _mm_set1_epi32(0xFF);
+            const __m128  mr = _mm_set1_ps(matte[0]), mg = _mm_set1_ps(matte[1]), mb = _mm_set1_ps(matte[2]);
+            const __m128  k255 = _mm_set1_ps(255.0f), k128 = _mm_set1_ps(128.0f);
+            for (; x + 4 <= width; x += 4) {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x * 4));
+                const __m128  a = _mm_div_ps(_mm_cvtepi32_ps(_mm_srli_epi32(p, 24)), k255);
+                __m128 r = _mm_cvtepi32_ps(_mm_and_si128(p, byteMask));
+                __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 8), byteMask));
+                __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask));
+                r = _mm_add_ps(mr, _mm_mul_ps(_mm_sub_ps(r, mr), a));
+                g = _mm_add_ps(mg, _mm_mul_ps(_mm_sub_ps(g, mg), a));
+                b = _mm_add_ps(mb, _mm_mul_ps(_mm_sub_ps(b, mb), a));
+
+                const __m128 yy = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.29900f), r),
+                                                                   _mm_mul_ps(_mm_set1_ps(0.58700f), g)),
+                                                        _mm_mul_ps(_mm_set1_ps(0.11400f), b)), k128);
+                const __m128 uu = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(-0.16874f), r),
+                                                        _mm_mul_ps(_mm_set1_ps(0.33126f), g)),
+                                             _mm_mul_ps(_mm_set1_ps(0.50000f), b));
+                const __m128 vv = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(0.50000f), r),
+                                                        _mm_mul_ps(_mm_set1_ps(0.41869f), g)),
+                                             _mm_mul_ps(_mm_set1_ps(0.08131f), b));
+                _mm_storeu_ps(y + x, yy);
+                _mm_storeu_ps(u + x, uu);
+                _mm_storeu_ps(v + x, vv);
+            }
+#elif defined(PELPAINT_JPEG_NEON)
+            const float32x4_t mr = vdupq_n_f32(matte[0]), mg = vdupq_n_f32(matte[1]), mb = vdupq_n_f32(matte[2]);
+            const float32x4_t k255 = vdupq_n_f32(255.0f), k128 = vdupq_n_f32(128.0f);
+            const auto channel = [](uint16x8_t c, bool high) {
+                return vcvtq_f32_u32(vmovl_u16(high ? vget_high_u16(c) : vget_low_u16(c)));
+            };
+            for (; x + 8 <= width; x += 8) {
+                const uint8x8x4_t p = vld4_u8(rgba + x * 4);
+                const uint16x8_t r16 = vmovl_u8(p.val[0]), g16 = vmovl_u8(p.val[1]);
+                const uint16x8_t b16 = vmovl_u8(p.val[2]), a16 = vmovl_u8(p.val[3]);
+                for (int half = 0; half < 2; ++half) {
+                    const float32x4_t a = vdivq_f32(channel(a16, half), k255);
+                    const float32x4_t r = vaddq_f32(mr, vmulq_f32(vsubq_f32(channel(r16, half), mr), a));
+                    const float32x4_t g = vaddq_f32(mg, vmulq_f32(vsubq_f32(channel(g16, half), mg), a));
+                    const float32x4_t b = vaddq_f32(mb, vmulq_f32(vsubq_f32(channel(b16, half), mb), a));
+
+                    const float32x4_t yy = vsubq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(r, 0.29900f),
+                                                                         vmulq_n_f32(g, 0.58700f)),
+                                                               vmulq_n_f32(b, 0.11400f)), k128);
+                    const float32x4_t uu = vaddq_f32(vsubq_f32(vmulq_n_f32(r, -0.16874f),
+                                                               vmulq_n_f32(g, 0.33126f)),
+                                                     vmulq_n_f32(b, 0.50000f));
+                    const float32x4_t vv = vsubq_f32(vsubq_f32(vmulq_n_f32(r, 0.50000f),
+                                                               vmulq_n_f32(g, 0.41869f)),
+                                                     vmulq_n_f32(b, 0.08131f));
+                    vst1q_f32(y + x + half * 4, yy);
+                    vst1q_f32(u + x + half * 4, uu);
+                    vst1q_f32(v + x + half * 4, vv);
+                }
+            }
+#endif
+            for (; x < width; ++x) {
+                const std::uint8_t* p = rgba + x * 4;
+                const float a = static_cast<float>(p[3]) / 255.0f;
+                const float r = matte[0] + (static_cast<float>(p[0]) - matte[0]) * a;
+                const float g = matte[1] + (static_cast<float>(p[1]) - matte[1]) * a;
+                const float b = matte[2] + (static_cast<float>(p[2]) - matte[2]) * a;
+                y[x] = 0.29900f * r + 0.58700f * g + 0.11400f * b - 128.0f;
+                u[x] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+                v[x] = 0.50000f * r - 0.41869f * g - 0.08131f * b;
+            }
+        }
+
+    } // namespace
+
+    JpegWriter::JpegWriter(const std::string& filename, std::uint32_t width, std::uint32_t height,
+                           const JpegOptions& options)
+        : out_(filename)
+        , width_(width)
+        , height_(height)
+        , matte_{ static_cast<float>(options.matte[0]), static_cast<float>(options.matte[1]),
+                  static_cast<float>(options.matte[2]) }
+    {
+        int quality = options.quality ? options.quality : 90;
+        const bool subsample = quality <= 90;
+        quality = std::clamp(quality, 1, 100);
+        quality = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+        mcuSize_     = subsample ? 16u : 8u;
+        paddedWidth_ = (width_ + mcuSize_ - 1) / mcuSize_ * mcuSize_;
+        const std::size_t planeSize = static_cast<std::size_t>(paddedWidth_) * mcuSize_;
+        y_.resize(planeSize);
+        u_.resize(planeSize);
+        v_.resize(planeSize);
+
+        std::uint8_t quantY[64], quantUV[64];
+        for (int i = 0; i < 64; ++i) {
+            quantY[kZigZag[i]]  = static_cast<std::uint8_t>(std::clamp((kLumQuant[i] * quality + 50) / 100, 1, 255));
+            quantUV[kZigZag[i]] = static_cast<std::uint8_t>(std::clamp((kChromQuant[i] * quality + 50) / 100, 1, 255));
+        }
+        for (int row = 0, k = 0; row < 8; ++row) {
+            for (int col = 0; col < 8; ++col, ++k) {
+                fdtblY_[k]  = 1.0f / (quantY[kZigZag[k]] * kAanScale[row] * kAanScale[col]);
+                fdtblUV_[k] = 1.0f / (quantUV[kZigZag[k]] * kAanScale[row] * kAanScale[col]);
+            }
+        }
+
+        BuildHuffman(kDcLumCounts, kDcLumValues, dcY_);
+        BuildHuffman(kAcLumCounts, kAcLumValues, acY_);
+        BuildHuffman(kDcChromCounts, kDcChromValues, dcUV_);
+        BuildHuffman(kAcChromCounts, kAcChromValues, acUV_);
+
+        // SOI, JFIF APP0, DQT
+        static constexpr std::uint8_t kHead0[] = {
+            0xFF,0xD8,0xFF,0xE0,0,0x10,'J','F','I','F',0,1,1,0,0,1,0,1,0,0,0xFF,0xDB,0,0x84,0,
+        };
+        out_.WriteBytes(kHead0, sizeof(kHead0));
+        out_.WriteBytes(quantY, sizeof(quantY));
+        out_.Write(char{1});
+        out_.WriteBytes(quantUV, sizeof(quantUV));
+
+        // SOF0, DHT
+        const std::uint8_t head1[] = {
+            0xFF,0xC0,0,0x11,8,
+            static_cast<std::uint8_t>(height_ >> 8), static_cast<std::uint8_t>(height_),
+            static_cast<std::uint8_t>(width_ >> 8),  static_cast<std::uint8_t>(width_),
+            3,1,static_cast<std::uint8_t>(subsample ? 0x22 : 0x11),0,2,0x11,1,3,0x11,1,
+            0xFF,0xC4,0x01,0xA2,0,
+        };
+        out_.WriteBytes(head1, sizeof(head1));
+        out_.WriteBytes(kDcLumCounts, sizeof(kDcLumCounts));
+        out_.WriteBytes(kDcLumValues, sizeof(kDcLumValues));
+        out_.Write(char{0x10});
+        out_.WriteBytes(kAcLumCounts, sizeof(kAcLumCounts));
+        out_.WriteBytes(kAcLumValues, sizeof(kAcLumValues));
+        out_.Write(char{1});
+        out_.WriteBytes(kDcChromCounts, sizeof(kDcChromCounts));
+        out_.WriteBytes(kDcChromValues, sizeof(kDcChromValues));
+        out_.Write(char{0x11});
+        out_.WriteBytes(kAcChromCounts, sizeof(kAcChromCounts));
+        out_.WriteBytes(kAcChromValues, sizeof(kAcChromValues));
+
+        // SOS
+        static constexpr std::uint8_t kHead2[] = { 0xFF,0xDA,0,0xC,3,1,0,2,0x11,3,0x11,0,0x3F,0 };
+        out_.WriteBytes(kHead2, sizeof(kHead2));
+    }
+
+    void JpegWriter::Row(const std::uint8_t* rgba)
+    {
+        if (rows_ >= height_) return;
+        ++rows_;
+
+        const std::size_t base = static_cast<std::size_t>(stripRows_) * paddedWidth_;
+        float* y = y_.data() + base;
+        float* u = u_.data() + base;
+        float* v = v_.data() + base;
+        ConvertRow(rgba, width_, matte_, y, u, v);
+        // Columns past the edge repeat the last pixel.
+        std::fill(y + width_, y + paddedWidth_, y[width_ - 1]);
+        std::fill(u + width_, u + paddedWidth_, u[width_ - 1]);
+        std::fill(v + width_, v + paddedWidth_, v[width_ - 1]);
+
+        if (++stripRows_ == mcuSize_) EncodeStrip();
+    }
+
+    void JpegWriter::EncodeStrip()
+    {
+        // Rows past the bottom edge repeat the last row.
+        for (std::uint32_t row = stripRows_; row < mcuSize_; ++row) {
+            const std::size_t src = static_cast<std::size_t>(stripRows_ - 1) * paddedWidth_;
+            const std::size_t dst = static_cast<std::size_t>(row) * paddedWidth_;
+            std::copy_n(y_.begin() + src, paddedWidth_, y_.begin() + dst);
+            std::copy_n(u_.begin() + src, paddedWidth_, u_.begin() + dst);
+            std::copy_n(v_.begin() + src, paddedWidth_, v_.begin() + dst);
+        }
+        stripRows_ = 0;
+
+        const int stride = static_cast<int>(paddedWidth_);
+        for (std::uint32_t x = 0; x < paddedWidth_; x += mcuSize_) {
+            if (mcuSize_ == 16) {
+                float* y = y_.data() + x;
+                dcPredY_ = EncodeBlock(y,                   stride, fdtblY_, dcPredY_, dcY_, acY_);
+                dcPredY_ = EncodeBlock(y + 8,               stride, fdtblY_, dcPredY_, dcY_, acY_);
+                dcPredY_ = EncodeBlock(y + 8 * stride,      stride, fdtblY_, dcPredY_, dcY_, acY_);
+                dcPredY_ = EncodeBlock(y + 8 * stride + 8,  stride, fdtblY_, dcPredY_, dcY_, acY_);
+
+                float subU[64], subV[64];
+                for (int yy = 0, pos = 0; yy < 8; ++yy) {
+                    for (int xx = 0; xx < 8; ++xx, ++pos) {
+                        const std::size_t j = static_cast<std::size_t>(yy * 2) * paddedWidth_ + x + xx * 2;
+                        subU[pos] = (u_[j] + u_[j + 1] + u_[j + paddedWidth_] + u_[j + paddedWidth_ + 1]) * 0.25f;
+                        subV[pos] = (v_[j] + v_[j + 1] + v_[j + paddedWidth_] + v_[j + paddedWidth_ + 1]) * 0.25f;
+                    }
+                }
+                dcPredU_ = EncodeBlock(subU, 8, fdtblUV_, dcPredU_, dcUV_, acUV_);
+                dcPredV_ = EncodeBlock(subV, 8, fdtblUV_, dcPredV_, dcUV_, acUV_);
+            } else {
+                dcPredY_ = EncodeBlock(y_.data() + x, stride, fdtblY_,  dcPredY_, dcY_,  acY_);
+                dcPredU_ = EncodeBlock(u_.data() + x, stride, fdtblUV_, dcPredU_, dcUV_, acUV_);
+                dcPredV_ = EncodeBlock(v_.data() + x, stride, fdtblUV_, dcPredV_, dcUV_, acUV_);
+            }
+        }
+    }
+
+    // Transform, quantise and entropy-code one 8×8 block (destroys `block`).
+    // Returns its DC value, the predictor for the next block.
+    int JpegWriter::EncodeBlock(float* block, int stride, const float* fdtbl, int dc,
+                                const HuffCode* dcTable, const HuffCode* acTable)
+    {
+        for (int row = 0; row < 8; ++row) Dct8(block + row * stride, 1);
+        for (int col = 0; col < 8; ++col) Dct8(block + col, stride);
+
+        int coeffs[64];
+        for (int y = 0, j = 0; y < 8; ++y) {
+            for (int x = 0; x < 8; ++x, ++j) {
+                const float v = block[y * stride + x] * fdtbl[j];
+                coeffs[kZigZag[j]] = static_cast<int>(v < 0 ? v - 0.5f : v + 0.5f);
+            }
+        }
+
+        std::uint32_t bits, length;
+        const int diff = coeffs[0] - dc;
+        if (diff == 0) {
+            PutBits(dcTable[0].code, dcTable[0].length);
+        } else {
+            ValueBits(diff, bits, length);
+            PutBits(dcTable[length].code, dcTable[length].length);
+            PutBits(bits, length);
+        }
+
+        int last = 63;
+        while (last > 0 && coeffs[last] == 0) --last;
+
+        for (int i = 1; i <= last; ++i) {
+            int zeros = 0;
+            while (coeffs[i] == 0) {
+                ++zeros;
+                ++i;
+            }
+            for (; zeros >= 16; zeros -= 16) PutBits(acTable[0xF0].code, acTable[0xF0].length);
+            ValueBits(coeffs[i], bits, length);
+            const HuffCode& symbol = acTable[(zeros << 4) + static_cast<int>(length)];
+            PutBits(symbol.code, symbol.length);
+            PutBits(bits, length);
+        }
+        if (last != 63) PutBits(acTable[0].code, acTable[0].length);
+
+        return coeffs[0];
+    }
+
+    void JpegWriter::PutBits(std::uint32_t code, std::uint32_t length)
+    {
+        bitCount_  += length;
+        bitBuffer_ |= code << (24 - bitCount_);
+        while (bitCount_ >= 8) {
+            const auto c = static_cast<char>((bitBuffer_ >> 16) & 0xFF);
+            out_.Write(c);
+            if (c == static_cast<char>(0xFF)) out_.Write(char{0});   // byte stuffing
+            bitBuffer_ <<= 8;
+            bitCount_  -= 8;
+        }
+    }
+
+    bool JpegWriter::Finish()
+    {
+        if (rows_ != height_ || height_ == 0) {
+            out_.Finish();
+            return false;
+        }
+        if (stripRows_ > 0) EncodeStrip();
+
+        PutBits(0x7F, 7);   // pad the last byte with ones
+        out_.Write(static_cast<char>(0xFF)).Write(static_cast<char>(0xD9));
+        return out_.Finish();
+    }
+
+    bool WriteJpeg(const std::string& filename, RowBands& bands, const JpegOptions& options)
+    {
+        if (!bands.Valid() || bands.Width() > 0xFFFF || bands.Height() > 0xFFFF) return false;
+
+        JpegWriter jpeg(filename, bands.Width(), bands.Height(), options);
+        if (!jpeg.Ok()) return false;
+
+        pelpaint::ImageView band;
+        std::uint32_t       top = 0;
+        while (bands.Next(band, top)) {
+            for (std::uint32_t y = 0; y < band.height; ++y) {
+                jpeg.Row(band.data + static_cast<std::size_t>(y) * band.stride);
+            }
+        }
+        return jpeg.Finish();
+    }
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BufferedWriter.hpp"
+#include "RowBands.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Streaming baseline JPEG
+//
+// The same encoder as stb_image_write: the same tables, quality scaling,
+// float AAN DCT and 4:2:0 chroma below quality 91.  The difference is that
+// it is fed a row at a time.  Each RGBA row is converted straight into the
+// Y/Cb/Cr planes of the current strip (SSE2 4 pixels per step, NEON 8).
+// Rows collect until one MCU row (8 or 16 image rows) is complete, then
+// that strip is encoded and its buffer reused.
+//
+// JPEG has no alpha, so translucent pixels are composited over `matte`.
+// Opaque pixels are unchanged, and the output for an opaque image is
+// byte-identical to stb's.
+// ---------------------------------------------------------------------------
+
+struct JpegOptions {
+    int          quality  = 90;                   // 1..100 (0 means 90, as in stb)
+    std::uint8_t matte[3] = { 255, 255, 255 };    // RGB behind translucent pixels
+};
+
+class JpegWriter {
+public:
+    JpegWriter(const std::string& filename, std::uint32_t width, std::uint32_t height,
+               const JpegOptions& options = {});
+
+    JpegWriter(const JpegWriter&)            = delete;
+    JpegWriter& operator=(const JpegWriter&) = delete;
+
+    [[nodiscard]] bool Ok() const noexcept { return out_.Ok(); }
+
+    // Next row: width × 4 bytes, RGBA.
+    void Row(const std::uint8_t* rgba);
+
+    // Encode the last strip and close the file.  False when a write failed
+    // or fewer than `height` rows were given.
+    bool Finish();
+
+private:
+    struct HuffCode {
+        std::uint16_t code = 0;
+        std::uint16_t length = 0;
+    };
+
+    void EncodeStrip();
+    int  EncodeBlock(float* block, int stride, const float* fdtbl, int dc,
+                     const HuffCode* dcTable, const HuffCode* acTable);
+    void PutBits(std::uint32_t code, std::uint32_t length);
+
+    BufferedWriter out_;
+    std::uint32_t  width_;
+    std::uint32_t  height_;
+    std::uint32_t  mcuSize_;             // 16 with chroma subsampling, else 8
+    std::uint32_t  paddedWidth_;         // width rounded up to whole MCUs
+    std::uint32_t  rows_      = 0;       // rows received
+    std::uint32_t  stripRows_ = 0;       // rows in the current strip
+    float          matte_[3];
+
+    // Current strip as Y, Cb, Cr planes (paddedWidth_ × mcuSize_ floats each).
+    std::vector<float> y_, u_, v_;
+
+    float fdtblY_[64];
+    float fdtblUV_[64];
+    HuffCode dcY_[256], acY_[256], dcUV_[256], acUV_[256];
+
+    int           dcPredY_  = 0;
+    int           dcPredU_  = 0;
+    int           dcPredV_  = 0;
+    std::uint32_t bitBuffer_ = 0;
+    std::uint32_t bitCount_  = 0;
+};
+
+bool WriteJpeg(const std::string& filename, RowBands& bands, const JpegOptions& options = {});
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Mesh built by MeshExporter and consumed by the file writers (PLY, GLB).
+// indices are triangles, or line pairs for Wireframe.
+// ---------------------------------------------------------------------------
+
+struct MeshVertex {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float nx = 0.0f;
+    float ny = 0.0f;
+    float nz = 1.0f;
+    float u = 0.0f;
+    float v = 0.0f;
+    std::uint8_t r = 255;
+    std::uint8_t g = 255;
+    std::uint8_t b = 255;
+    std::uint8_t a = 255;
+};
+
+struct MeshData {
+    std::vector<MeshVertex> vertices;
+    std::vector<std::uint32_t> indices;
+};
+
+} // namespace pelpaint::exporter
@@ -1,28 +1,137 @@
 #include "MeshExporter.hpp"
+#include "BufferedWriter.hpp"
+#include "MeshData.hpp"
+#include "MeshSimplify.hpp"
 #include "DepthMapGenerator.hpp"
+#include "ExportJob.hpp"
 #include "ExportUtils.hpp"
+#include "GltfWriter.hpp"
+#include "RectDecomposition.hpp"
+#include "../core/Parallel.hpp"
+
+#include <atomic>
+#include <bit>
 
 namespace pelpaint::exporter {
 
-    struct MeshVertex {
-        float x = 0.0f;
-        float y = 0.0f;
-        float z = 0.0f;
-        float nx = 0.0f;
-        float ny = 0.0f;
-        float nz = 1.0f;
-        float u = 0.0f;
-        float v = 0.0f;
-        std::uint8_t r = 255;
-        std::uint8_t g = 255;
-        std::uint8_t b = 255;
-        std::uint8_t a = 255;
-    };
+    // ============================================================
+    // PLY writers
+    // ============================================================
 
-    struct MeshData {
-        std::vector<MeshVertex> vertices;
-        std::vector<std::uint32_t> indices;
-    };
+    // Binary PLY record sizes: 6 floats + 4 uchar per vertex, a uchar count
+    // and 3 ints per face, 2 ints per edge.
+    constexpr std::size_t kPlyVertexBytes = 6 * sizeof(float) + 4;
+    constexpr std::size_t kPlyFaceBytes   = 1 + 3 * sizeof(std::uint32_t);
+    constexpr std::size_t kPlyEdgeBytes   = 2 * sizeof(std::uint32_t);
+
+    // Records are packed into a scratch block of this many bytes and written
+    // in one call.
+    constexpr std::size_t kPlyBlockBytes = std::size_t{1} << 20;
+
+    static void WritePlyHeader(BufferedWriter& file, const MeshData& mesh, bool binary, bool edges)
+    {
+        file.Write("ply\n");
+        file.Write(binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
+        file.Write("comment generated by pelpaint\n");
+        file.Write("element vertex ").Int(mesh.vertices.size()).Write('\n');
+        file.Write("property float x\n"
+                   "property float y\n"
+                   "property float z\n"
+                   "property float nx\n"
+                   "property float ny\n"
+                   "property float nz\n"
+                   "property uchar red\n"
+                   "property uchar green\n"
+                   "property uchar blue\n"
+                   "property uchar alpha\n");
+
+        if (edges) {
+            file.Write("element edge ").Int(mesh.indices.size() / 2u).Write('\n');
+            file.Write("property int vertex1\n"
+                       "property int vertex2\n");
+        } else {
+            file.Write("element face ").Int(mesh.indices.size() / 3u).Write('\n');
+            file.Write("property list uchar int vertex_indices\n");
+        }
+
+        file.Write("end_header\n");
+    }
+
+    static void WritePlyAscii(BufferedWriter& file, const MeshData& mesh, bool writeColors, bool edges)
+    {
+        for (const auto& v : mesh.vertices) {
+            file.Float(v.x).Write(' ').Float(v.y).Write(' ').Float(v.z).Write(' ')
+                .Float(v.nx).Write(' ').Float(v.ny).Write(' ').Float(v.nz).Write(' ');
+            if (writeColors) {
+                file.Int(v.r).Write(' ').Int(v.g).Write(' ').Int(v.b).Write(' ').Int(v.a).Write('\n');
+            } else {
+                file.Write("255 255 255 255\n");
+            }
+        }
+
+        if (edges) {
+            for (std::size_t i = 0; i + 1 < mesh.indices.size(); i += 2) {
+                file.Int(mesh.indices[i]).Write(' ').Int(mesh.indices[i + 1]).Write('\n');
+            }
+        } else {
+            for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                file.Write("3 ").Int(mesh.indices[i]).Write(' ')
+                    .Int(mesh.indices[i + 1]).Write(' ').Int(mesh.indices[i + 2]).Write('\n');
+            }
+        }
+    }
+
+    static void WritePlyBinary(BufferedWriter& file, const MeshData& mesh, bool writeColors, bool edges)
+    {
+        std::vector<std::uint8_t> block(kPlyBlockBytes);
+
+        // Packs `count` records of `recordBytes` each via pack(index, dst) and
+        // writes them a block at a time.
+        const auto writeRecords = [&](std::size_t count, std::size_t recordBytes, auto&& pack) {
+            const std::size_t perBlock = block.size() / recordBytes;
+            for (std::size_t first = 0; first < count; first += perBlock) {
+                const std::size_t last = std::min(count, first + perBlock);
+                std::uint8_t* dst = block.data();
+                for (std::size_t i = first; i < last; ++i) dst = pack(i, dst);
+                file.WriteBytes(block.data(), static_cast<std::size_t>(dst - block.data()));
+            }
+        };
+
+        writeRecords(mesh.vertices.size(), kPlyVertexBytes, [&](std::size_t i, std::uint8_t* dst) {
+            const MeshVertex& v = mesh.vertices[i];
+            dst = PutLittleEndian(dst, v.x);
+            dst = PutLittleEndian(dst, v.y);
+            dst = PutLittleEndian(dst, v.z);
+            dst = PutLittleEndian(dst, v.nx);
+            dst = PutLittleEndian(dst, v.ny);
+            dst = PutLittleEndian(dst, v.nz);
+            dst[0] = writeColors ? v.r : 255;
+            dst[1] = writeColors ? v.g : 255;
+            dst[2] = writeColors ? v.b : 255;
+            dst[3] = writeColors ? v.a : 255;
+            return dst + 4;
+        });
+
+        const std::uint32_t* idx = mesh.indices.data();
+        if (edges) {
+            if constexpr (std::endian::native == std::endian::little) {
+                // Edge records are exactly the index pairs.
+                file.WriteBytes(idx, mesh.indices.size() * sizeof(std::uint32_t));
+            } else {
+                writeRecords(mesh.indices.size() / 2u, kPlyEdgeBytes, [&](std::size_t i, std::uint8_t* dst) {
+                    dst = PutLittleEndian(dst, idx[2 * i]);
+                    return PutLittleEndian(dst, idx[2 * i + 1]);
+                });
+            }
+        } else {
+            writeRecords(mesh.indices.size() / 3u, kPlyFaceBytes, [&](std::size_t i, std::uint8_t* dst) {
+                *dst++ = 3;
+                dst = PutLittleEndian(dst, idx[3 * i]);
+                dst = PutLittleEndian(dst, idx[3 * i + 1]);
+                return PutLittleEndian(dst, idx[3 * i + 2]);
+            });
+        }
+    }
 
     bool MeshExporter::SaveAsMesh(const std::string& filename,
                                   const pelpaint::ImageView& view,
@@ -33,10 +142,18 @@ namespace pelpaint::exporter {
 
         if (!view.valid() || options.gridSize == 0) return false;
 
+        // Progress marks after each phase; a cancelled job stops at the next one.
+        const auto phaseDone = [&](float fraction) {
+            if (!options.progress) return true;
+            options.progress->Report(fraction);
+            return !options.progress->Cancelled();
+        };
+
         std::vector<float> depthMap;
         if (!DepthMapGenerator::BuildDepthMap(view, options.gridSize, depthMap)) {
             return false;
         }
+        if (!phaseDone(0.1f)) return false;
 
         MeshData mesh;
         switch (options.mode) {
@@ -49,146 +166,136 @@ namespace pelpaint::exporter {
                     return false;
                 break;
             case MeshMode::LoPoly:
-                // TODO
-                return false;
+                if (!BuildLoPolyMesh(view, depthMap, options.gridSize, options.depthScale,
+                                     options.targetTriangles, options.maxError, mesh))
+                    return false;
+                break;
             case MeshMode::PixelPerfect:
-                if (!BuildPixelPerfectMesh(view, depthMap, options.gridSize, options.depthScale, mesh))
+                if (!BuildPixelPerfectMesh(view, depthMap, options.gridSize, options.depthScale, mesh,
+                                           options.optimizeMesh ? RectMergeMode::NearMinimal : RectMergeMode::Rows))
                     return false;
                 break;
         }
 
-        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
-        if (!file.is_open()) return false;
-
-        const bool writeColors = options.useVertexColors;
-
         if (options.mode == MeshMode::Wireframe) {
             if ((mesh.indices.size() % 2u) != 0u) return false;
         } else {
             if ((mesh.indices.size() % 3u) != 0u) return false;
         }
 
-        file << "ply\n";
-        file << "format ascii 1.0\n";
-        file << "comment generated by pelpaint\n";
-        file << "element vertex " << mesh.vertices.size() << "\n";
-        file << "property float x\n";
-        file << "property float y\n";
-        file << "property float z\n";
-        file << "property float nx\n";
-        file << "property float ny\n";
-        file << "property float nz\n";
-        file << "property uchar red\n";
-        file << "property uchar green\n";
-        file << "property uchar blue\n";
-        file << "property uchar alpha\n";
+        if (!phaseDone(0.7f)) return false;
 
-        if (options.mode == MeshMode::Wireframe) {
-            const std::size_t edgeCount = mesh.indices.size() / 2u;
-            file << "element edge " << edgeCount << "\n";
-            file << "property int vertex1\n";
-            file << "property int vertex2\n";
-        } else {
-            const std::size_t faceCount = mesh.indices.size() / 3u;
-            file << "element face " << faceCount << "\n";
-            file << "property list uchar int vertex_indices\n";
-        }
+        const bool edges = options.mode == MeshMode::Wireframe;
 
-        file << "end_header\n";
-
-        for (const auto& v : mesh.vertices) {
-            const std::uint8_t r = writeColors ? v.r : 255;
-            const std::uint8_t g = writeColors ? v.g : 255;
-            const std::uint8_t b = writeColors ? v.b : 255;
-            const std::uint8_t a = writeColors ? v.a : 255;
-
-            file << v.x << ' ' << v.y << ' ' << v.z << ' '
-                 << v.nx << ' ' << v.ny << ' ' << v.nz << ' '
-                 << int(r) << ' ' << int(g) << ' ' << int(b) << ' ' << int(a) << '\n';
+        if (options.format == MeshFileFormat::Glb) {
+            GlbOptions glb;
+            glb.lines        = edges;
+            glb.vertexColors = options.useVertexColors;
+            glb.quantize     = options.quantize;
+            return WriteGlb(filename, mesh, glb);
         }
 
-        if (options.mode == MeshMode::Wireframe) {
-            for (std::size_t i = 0; i + 1 < mesh.indices.size(); i += 2) {
-                file << mesh.indices[i] << ' ' << mesh.indices[i + 1] << '\n';
-            }
-        } else {
-            for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
-                file << "3 " << mesh.indices[i] << ' ' << mesh.indices[i + 1] << ' ' << mesh.indices[i + 2] << '\n';
-            }
-        }
+        BufferedWriter file(filename);
+        if (!file.Ok()) return false;
+
+        const bool binary = options.format == MeshFileFormat::PlyBinary;
+        WritePlyHeader(file, mesh, binary, edges);
+        if (binary) WritePlyBinary(file, mesh, options.useVertexColors, edges);
+        else        WritePlyAscii(file, mesh, options.useVertexColors, edges);
 
-        return file.good();
+        return file.Finish();
     }
 
 
-    static bool BuildMergedRects(std::span<const PixelCell> cells,
-                                 std::uint32_t sampleW,
-                                 std::uint32_t sampleH,
-                                 std::vector<MergeRect>& outRects)
+    // ============================================================
+    // Grid meshes (Solid / Wireframe)
+    //
+    // Output sizes follow from the sample grid, so vertices, normals and
+    // indices are written in parallel row bands straight into preallocated
+    // storage.
+    // ============================================================
+
+    // Rows per band below which threading does not pay.
+    constexpr std::size_t kGridMinRows = 16;
+
+    // One vertex per sample, coloured from the source pixel; with
+    // withNormals, the depth-gradient normal as well.
+    static bool FillGridVertices(const pelpaint::ImageView& view,
+                                 std::span<const float> depthMap,
+                                 std::uint32_t gridSize,
+                                 float depthScale,
+                                 std::size_t sampleW,
+                                 std::size_t sampleH,
+                                 bool withNormals,
+                                 std::vector<MeshVertex>& vertices)
     {
-        outRects.clear();
+        std::atomic<bool> failed{ false };
 
-        if (sampleW == 0 || sampleH == 0) return false;
-        if (cells.size() != static_cast<std::size_t>(sampleW) * sampleH) return false;
+        core::ParallelFor(0, sampleH, [&](std::size_t y0, std::size_t y1) {
+            for (std::size_t sy = y0; sy < y1; ++sy) {
+                const std::uint32_t pxY = std::min<std::uint32_t>(static_cast<std::uint32_t>(sy * gridSize), view.height - 1u);
+                const float v = (sampleH > 1) ? (static_cast<float>(sy) / static_cast<float>(sampleH - 1u)) : 0.0f;
 
-        std::vector<std::uint8_t> visited(cells.size(), 0);
-
-        auto idxOf = [sampleW](std::uint32_t x, std::uint32_t y) noexcept -> std::size_t {
-            return static_cast<std::size_t>(y) * sampleW + x;
-        };
+                const std::size_t ym1 = (sy > 0) ? sy - 1 : sy;
+                const std::size_t yp1 = (sy + 1 < sampleH) ? sy + 1 : sy;
 
-        auto sameCell = [](const PixelCell& a, const PixelCell& b) noexcept -> bool {
-            return a.valid == b.valid &&
-                   a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
-                   // optionally add depth quantization here:
-                   // && std::abs(a.depth - b.depth) < 0.02f;
-        };
+                for (std::size_t sx = 0; sx < sampleW; ++sx) {
+                    const std::uint32_t pxX = std::min<std::uint32_t>(static_cast<std::uint32_t>(sx * gridSize), view.width - 1u);
+                    const float u = (sampleW > 1) ? (static_cast<float>(sx) / static_cast<float>(sampleW - 1u)) : 0.0f;
 
-        for (std::uint32_t y = 0; y < sampleH; ++y) {
-            for (std::uint32_t x = 0; x < sampleW; ++x) {
-                const std::size_t idx = idxOf(x, y);
-                if (visited[idx]) continue;
+                    const std::size_t idx = sy * sampleW + sx;
 
-                const PixelCell& seed = cells[idx];
-                visited[idx] = 1;
+                    MeshVertex vtx{};
+                    vtx.x = static_cast<float>(pxX);
+                    vtx.y = static_cast<float>(pxY);
+                    vtx.z = depthMap[idx] * depthScale;
 
-                if (!seed.valid) continue;
+                    // UVs reserved for later.
+                    vtx.u = u;
+                    vtx.v = v;
 
-                // Expand width
-                std::uint32_t w = 1;
-                while (x + w < sampleW) {
-                    const std::size_t nidx = idxOf(x + w, y);
-                    if (visited[nidx] || !sameCell(cells[nidx], seed)) break;
-                    ++w;
-                }
+                    // Vertex color from source image
+                    if (!ReadPixelRGBA8(view, pxX, pxY, vtx.r, vtx.g, vtx.b, vtx.a)) {
+                        failed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
 
-                // Expand height
-                std::uint32_t h = 1;
-                while (y + h < sampleH) {
-                    bool rowMatches = true;
-                    for (std::uint32_t dx = 0; dx < w; ++dx) {
-                        const std::size_t cidx = idxOf(x + dx, y + h);
-                        if (visited[cidx] || !sameCell(cells[cidx], seed)) {
-                            rowMatches = false;
-                            break;
+                    if (withNormals) {
+                        const std::size_t xm1 = (sx > 0) ? sx - 1 : sx;
+                        const std::size_t xp1 = (sx + 1 < sampleW) ? sx + 1 : sx;
+
+                        const float hl = depthMap[sy * sampleW + xm1] * depthScale;
+                        const float hr = depthMap[sy * sampleW + xp1] * depthScale;
+                        const float hd = depthMap[ym1 * sampleW + sx] * depthScale;
+                        const float hu = depthMap[yp1 * sampleW + sx] * depthScale;
+
+                        // Gradient-based normal; z = 2 is a strength bias for smoother normals
+                        float nx = hl - hr;
+                        float ny = hd - hu;
+                        float nz = 2.0f;
+
+                        const float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+                        if (len > 0.0f) {
+                            nx /= len;
+                            ny /= len;
+                            nz /= len;
+                        } else {
+                            nx = 0.0f;
+                            ny = 0.0f;
+                            nz = 1.0f;
                         }
-                    }
-                    if (!rowMatches) break;
-                    ++h;
-                }
 
-                // Mark region visited
-                for (std::uint32_t dy = 0; dy < h; ++dy) {
-                    for (std::uint32_t dx = 0; dx < w; ++dx) {
-                        visited[idxOf(x + dx, y + dy)] = 1;
+                        vtx.nx = nx;
+                        vtx.ny = ny;
+                        vtx.nz = nz;
                     }
-                }
 
-                outRects.push_back(MergeRect{ x, y, w, h, seed });
+                    vertices[idx] = vtx;
+                }
             }
-        }
+        }, kGridMinRows);
 
-        return true;
+        return !failed.load(std::memory_order_relaxed);
     }
 
     bool MeshExporter::BuildSolidMesh(const pelpaint::ImageView& view,
@@ -211,107 +318,30 @@ namespace pelpaint::exporter {
 
         try {
             outMesh.vertices.resize(sampleW * sampleH);
-            outMesh.indices.reserve((sampleW - 1u) * (sampleH - 1u) * 6u);
+            outMesh.indices.resize((sampleW - 1u) * (sampleH - 1u) * 6u);
         } catch (...) {
             return false;
         }
 
-        // Build vertices
-        for (std::size_t sy = 0; sy < sampleH; ++sy) {
-            const std::uint32_t pxY = std::min<std::uint32_t>(static_cast<std::uint32_t>(sy * gridSize), view.height - 1u);
-            const float v = (sampleH > 1) ? (static_cast<float>(sy) / static_cast<float>(sampleH - 1u)) : 0.0f;
-
-            for (std::size_t sx = 0; sx < sampleW; ++sx) {
-                const std::uint32_t pxX = std::min<std::uint32_t>(static_cast<std::uint32_t>(sx * gridSize), view.width - 1u);
-                const float u = (sampleW > 1) ? (static_cast<float>(sx) / static_cast<float>(sampleW - 1u)) : 0.0f;
-
-                const std::size_t idx = sy * sampleW + sx;
-                const float z = depthMap[idx] * depthScale;
-
-                MeshVertex vtx{};
-                vtx.x = static_cast<float>(pxX);
-                vtx.y = static_cast<float>(pxY);
-                vtx.z = z;
-
-                // UVs reserved for later.
-                vtx.u = u;
-                vtx.v = v;
-
-                // Vertex color from source image
-                std::uint8_t r = 255, g = 255, b = 255, a = 255;
-                if (!ReadPixelRGBA8(view, pxX, pxY, r, g, b, a)) return false;
-
-                vtx.r = r;
-                vtx.g = g;
-                vtx.b = b;
-                vtx.a = a;
-
-                outMesh.vertices[idx] = vtx;
-            }
-        }
-
-        // Build triangle indices
-        auto vertexIndex = [sampleW](std::size_t x, std::size_t y) noexcept -> std::uint32_t {
-            return static_cast<std::uint32_t>(y * sampleW + x);
-        };
-
-        for (std::size_t y = 0; y + 1 < sampleH; ++y) {
-            for (std::size_t x = 0; x + 1 < sampleW; ++x) {
-                const std::uint32_t i0 = vertexIndex(x, y);
-                const std::uint32_t i1 = vertexIndex(x + 1, y);
-                const std::uint32_t i2 = vertexIndex(x + 1, y + 1);
-                const std::uint32_t i3 = vertexIndex(x, y + 1);
-
-                // Two triangles per grid cell
-                outMesh.indices.push_back(i0);
-                outMesh.indices.push_back(i1);
-                outMesh.indices.push_back(i2);
-
-                outMesh.indices.push_back(i0);
-                outMesh.indices.push_back(i2);
-                outMesh.indices.push_back(i3);
-            }
+        if (!FillGridVertices(view, depthMap, gridSize, depthScale, sampleW, sampleH, true, outMesh.vertices)) {
+            return false;
         }
 
-        // Compute normals
-        for (std::size_t sy = 0; sy < sampleH; ++sy) {
-            for (std::size_t sx = 0; sx < sampleW; ++sx) {
-                const std::size_t idx = sy * sampleW + sx;
-
-                const std::size_t xm1 = (sx > 0) ? sx - 1 : sx;
-                const std::size_t xp1 = (sx + 1 < sampleW) ? sx + 1 : sx;
-                const std::size_t ym1 = (sy > 0) ? sy - 1 : sy;
-                const std::size_t yp1 = (sy + 1 < sampleH) ? sy + 1 : sy;
-
-                const float hl = depthMap[sy * sampleW + xm1] * depthScale;
-                const float hr = depthMap[sy * sampleW + xp1] * depthScale;
-                const float hd = depthMap[ym1 * sampleW + sx] * depthScale;
-                const float hu = depthMap[yp1 * sampleW + sx] * depthScale;
-
-                // Gradient-based normal
-                const float dx = hl - hr;
-                const float dy = hd - hu;
-
-                float nx = dx;
-                float ny = dy;
-                float nz = 2.0f; // strength bias for smoother normals
-
-                const float len = std::sqrt(nx * nx + ny * ny + nz * nz);
-                if (len > 0.0f) {
-                    nx /= len;
-                    ny /= len;
-                    nz /= len;
-                } else {
-                    nx = 0.0f;
-                    ny = 0.0f;
-                    nz = 1.0f;
+        // Two triangles per grid cell, six indices per cell in row order.
+        core::ParallelFor(0, sampleH - 1u, [&](std::size_t y0, std::size_t y1) {
+            std::uint32_t* out = outMesh.indices.data() + y0 * (sampleW - 1u) * 6u;
+            for (std::size_t y = y0; y < y1; ++y) {
+                for (std::size_t x = 0; x + 1 < sampleW; ++x) {
+                    const auto i0 = static_cast<std::uint32_t>(y * sampleW + x);
+                    const auto i1 = i0 + 1u;
+                    const auto i3 = static_cast<std::uint32_t>(i0 + sampleW);
+                    const auto i2 = i3 + 1u;
+
+                    *out++ = i0; *out++ = i1; *out++ = i2;
+                    *out++ = i0; *out++ = i2; *out++ = i3;
                 }
-
-                outMesh.vertices[idx].nx = nx;
-                outMesh.vertices[idx].ny = ny;
-                outMesh.vertices[idx].nz = nz;
             }
-        }
+        }, kGridMinRows);
 
         return true;
     }
@@ -334,90 +364,100 @@ namespace pelpaint::exporter {
         if (depthMap.size() != sampleW * sampleH) return false;
         if (sampleW < 2 || sampleH < 2) return false;
 
+        // Line list: all horizontal segments (row by row), then all vertical.
+        const std::size_t horizontal = sampleH * (sampleW - 1u) * 2u;
+        const std::size_t vertical   = (sampleH - 1u) * sampleW * 2u;
+
         try {
             outMesh.vertices.resize(sampleW * sampleH);
-            // Wireframe line list: each cell contributes edges
-            outMesh.indices.reserve((sampleW - 1u) * (sampleH - 1u) * 8u);
+            outMesh.indices.resize(horizontal + vertical);
         } catch (...) {
             return false;
         }
 
-        // Build vertices same as solid
-        for (std::size_t sy = 0; sy < sampleH; ++sy) {
-            const std::uint32_t pxY = std::min<std::uint32_t>(static_cast<std::uint32_t>(sy * gridSize), view.height - 1u);
-            const float v = (sampleH > 1) ? (static_cast<float>(sy) / static_cast<float>(sampleH - 1u)) : 0.0f;
+        if (!FillGridVertices(view, depthMap, gridSize, depthScale, sampleW, sampleH, false, outMesh.vertices)) {
+            return false;
+        }
 
-            for (std::size_t sx = 0; sx < sampleW; ++sx) {
-                const std::uint32_t pxX = std::min<std::uint32_t>(static_cast<std::uint32_t>(sx * gridSize), view.width - 1u);
-                const float u = (sampleW > 1) ? (static_cast<float>(sx) / static_cast<float>(sampleW - 1u)) : 0.0f;
+        core::ParallelFor(0, sampleH, [&](std::size_t y0, std::size_t y1) {
+            for (std::size_t y = y0; y < y1; ++y) {
+                const auto row = static_cast<std::uint32_t>(y * sampleW);
 
-                const std::size_t idx = sy * sampleW + sx;
-                const float z = depthMap[idx] * depthScale;
+                std::uint32_t* h = outMesh.indices.data() + y * (sampleW - 1u) * 2u;
+                for (std::uint32_t x = 0; x + 1 < sampleW; ++x) {
+                    *h++ = row + x;
+                    *h++ = row + x + 1u;
+                }
+
+                if (y + 1 < sampleH) {
+                    std::uint32_t* v = outMesh.indices.data() + horizontal + y * sampleW * 2u;
+                    for (std::uint32_t x = 0; x < sampleW; ++x) {
+                        *v++ = row + x;
+                        *v++ = static_cast<std::uint32_t>(row + x + sampleW);
+                    }
+                }
+            }
+        }, kGridMinRows);
 
-                MeshVertex vtx{};
-                vtx.x = static_cast<float>(pxX);
-                vtx.y = static_cast<float>(pxY);
-                vtx.z = z;
-                vtx.u = u;
-                vtx.v = v;
+        return true;
+    }
 
-                std::uint8_t r = 255, g = 255, b = 255, a = 255;
-                if (!ReadPixelRGBA8(view, pxX, pxY, r, g, b, a)) return false;
+    bool MeshExporter::BuildLoPolyMesh(const pelpaint::ImageView& view,
+                                       std::span<const float> depthMap,
+                                       std::uint32_t gridSize,
+                                       float depthScale,
+                                       std::size_t targetTriangles,
+                                       float maxError,
+                                       MeshData& outMesh)
+    {
+        MeshData dense;
+        if (!BuildSolidMesh(view, depthMap, gridSize, depthScale, dense)) return false;
 
-                vtx.r = r;
-                vtx.g = g;
-                vtx.b = b;
-                vtx.a = a;
+        SimplifyOptions simplify;
+        simplify.targetTriangles = std::max<std::size_t>(targetTriangles, 1u);
+        simplify.maxError        = maxError;
+        simplify.preserveColors  = true;
+        simplify.heightfield     = true;
+        if (!SimplifyMesh(dense, simplify)) return false;
 
-                outMesh.vertices[idx] = vtx;
-            }
+        // Angular look: every triangle gets its own vertices and face normal.
+        outMesh.vertices.clear();
+        outMesh.indices.clear();
+        try {
+            outMesh.vertices.reserve(dense.indices.size());
+            outMesh.indices.reserve(dense.indices.size());
+        } catch (...) {
+            return false;
         }
 
-        auto vertexIndex = [sampleW](std::size_t x, std::size_t y) noexcept -> std::uint32_t {
-            return static_cast<std::uint32_t>(y * sampleW + x);
-        };
-
-        // Emit grid line segments:
-        // horizontal lines
-        for (std::size_t y = 0; y < sampleH; ++y) {
-            for (std::size_t x = 0; x + 1 < sampleW; ++x) {
-                outMesh.indices.push_back(vertexIndex(x, y));
-                outMesh.indices.push_back(vertexIndex(x + 1, y));
+        for (std::size_t i = 0; i + 2 < dense.indices.size(); i += 3) {
+            const MeshVertex& a = dense.vertices[dense.indices[i]];
+            const MeshVertex& b = dense.vertices[dense.indices[i + 1]];
+            const MeshVertex& c = dense.vertices[dense.indices[i + 2]];
+
+            float nx = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+            float ny = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+            float nz = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            const float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+            if (len > 0.0f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
             }
-        }
 
-        // vertical lines
-        for (std::size_t y = 0; y + 1 < sampleH; ++y) {
-            for (std::size_t x = 0; x < sampleW; ++x) {
-                outMesh.indices.push_back(vertexIndex(x, y));
-                outMesh.indices.push_back(vertexIndex(x, y + 1));
+            for (const MeshVertex* src : { &a, &b, &c }) {
+                MeshVertex vtx = *src;
+                vtx.nx = nx;
+                vtx.ny = ny;
+                vtx.nz = nz;
+                outMesh.indices.push_back(static_cast<std::uint32_t>(outMesh.vertices.size()));
+                outMesh.vertices.push_back(vtx);
             }
         }
 
         return true;
     }
 
-    static std::uint32_t PushVertex(MeshData& mesh,
-                                    float x, float y, float z,
-                                    float nx, float ny, float nz,
-                                    std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a)
-    {
-        MeshVertex vtx{};
-        vtx.x = x;
-        vtx.y = y;
-        vtx.z = z;
-        vtx.nx = nx;
-        vtx.ny = ny;
-        vtx.nz = nz;
-        vtx.r = r;
-        vtx.g = g;
-        vtx.b = b;
-        vtx.a = a;
-
-        mesh.vertices.push_back(vtx);
-        return static_cast<std::uint32_t>(mesh.vertices.size() - 1u);
-    }
-
     static bool BuildPixelCells(const pelpaint::ImageView& view,
                                 std::span<const float> depthMap,
                                 std::uint32_t gridSize,
@@ -477,57 +517,258 @@ namespace pelpaint::exporter {
         return true;
     }
 
-    static void PushQuad(MeshData& mesh,
-                         std::uint32_t i0, std::uint32_t i1,
-                         std::uint32_t i2, std::uint32_t i3);
+    // ============================================================
+    // Greedy voxel meshing (PixelPerfect)
+    //
+    // Every valid cell is a column from z = 0 to its depth.  Tops merge
+    // into rectangles of equal colour and depth, bottoms into rectangles
+    // of equal colour; side faces are only emitted where a column stands
+    // above its neighbour (or the outside), and strips with the same
+    // colour and z span are merged along each boundary line.  Vertices are
+    // welded by grid position, face direction and colour.
+    // ============================================================
+
+    enum class FaceDir : std::uint8_t { PosZ, NegZ, PosX, NegX, PosY, NegY };
+
+    class VertexWelder {
+    public:
+        VertexWelder(MeshData& mesh, std::uint32_t gridSize, float depthScale)
+            : mesh_(mesh), gridSize_(static_cast<float>(gridSize)), depthScale_(depthScale)
+        {
+            slots_.assign(std::size_t{1} << 12, kEmpty);
+        }
+
+        // (gx, gy) on the cell grid, z in depth units.
+        std::uint32_t Vertex(std::uint32_t gx, std::uint32_t gy, float z, FaceDir dir, const PixelCell& color)
+        {
+            const Key key{ gx, gy, std::bit_cast<std::uint32_t>(z),
+                           static_cast<std::uint32_t>(color.r) << 24 | static_cast<std::uint32_t>(color.g) << 16 |
+                           static_cast<std::uint32_t>(color.b) << 8  | color.a,
+                           static_cast<std::uint32_t>(dir) };
+
+            const std::size_t mask = slots_.size() - 1;
+            std::size_t slot = Hash(key) & mask;
+            while (slots_[slot] != kEmpty) {
+                if (keys_[slots_[slot]] == key) return slots_[slot];
+                slot = (slot + 1) & mask;
+            }
+
+            const auto index = static_cast<std::uint32_t>(mesh_.vertices.size());
+            slots_[slot] = index;
+            keys_.push_back(key);
+            if (keys_.size() * 2 > slots_.size()) Grow();
+
+            static constexpr float kNormals[6][3] = {
+                { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 },
+            };
+            const float* n = kNormals[static_cast<int>(dir)];
+            const float  s = depthScale_ < 0.0f ? -1.0f : 1.0f;   // mirrored in z
+
+            MeshVertex vtx{};
+            vtx.x  = static_cast<float>(gx) * gridSize_;
+            vtx.y  = static_cast<float>(gy) * gridSize_;
+            vtx.z  = z * depthScale_;
+            vtx.nx = n[0];
+            vtx.ny = n[1];
+            vtx.nz = n[2] * s;
+            vtx.r  = color.r;
+            vtx.g  = color.g;
+            vtx.b  = color.b;
+            vtx.a  = color.a;
+            mesh_.vertices.push_back(vtx);
+            return index;
+        }
+
+        // Two triangles; corners counter-clockwise seen from outside.
+        void Quad(const std::uint32_t (&i)[4])
+        {
+            if (depthScale_ < 0.0f) {
+                mesh_.indices.insert(mesh_.indices.end(), { i[0], i[2], i[1], i[0], i[3], i[2] });
+            } else {
+                mesh_.indices.insert(mesh_.indices.end(), { i[0], i[1], i[2], i[0], i[2], i[3] });
+            }
+        }
+
+    private:
+        static constexpr std::uint32_t kEmpty = 0xFFFFFFFFu;
+
+        struct Key {
+            std::uint32_t x, y, z, rgba, dir;
+            bool operator==(const Key&) const = default;
+        };
+
+        static std::size_t Hash(const Key& k) noexcept
+        {
+            std::uint64_t h = (static_cast<std::uint64_t>(k.x) << 32 | k.y) ^
+                              ((static_cast<std::uint64_t>(k.z) << 32 | k.rgba) + k.dir) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+            return static_cast<std::size_t>(h ^ (h >> 31));
+        }
+
+        // Open addressing, linear probing; slots hold vertex indices and the
+        // keys live alongside the vertices.
+        void Grow()
+        {
+            slots_.assign(slots_.size() * 2, kEmpty);
+            const std::size_t mask = slots_.size() - 1;
+            for (std::uint32_t i = 0; i < keys_.size(); ++i) {
+                std::size_t slot = Hash(keys_[i]) & mask;
+                while (slots_[slot] != kEmpty) slot = (slot + 1) & mask;
+                slots_[slot] = i;
+            }
+        }
+
+        MeshData& mesh_;
+        float gridSize_;
+        float depthScale_;
+        std::vector<std::uint32_t> slots_;
+        std::vector<Key>           keys_;   // per vertex
+    };
+
+    // Horizontal faces (tops at the cell depth, bottoms at 0).
+    static void EmitCaps(VertexWelder& welder, std::span<const PixelCell> cells,
+                         std::uint32_t sampleW, std::uint32_t sampleH, RectMergeMode merge)
+    {
+        std::vector<std::uint32_t> labels(cells.size(), kNoLabel);
+        std::vector<LabeledRect>   rects;
+
+        // Tops: colour and depth must both match.
+        std::unordered_map<std::uint64_t, std::uint32_t> topIndex;
+        std::vector<std::size_t>                         topCell;   // label -> a cell with it
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            const PixelCell& c = cells[i];
+            if (!c.valid) continue;
+            const std::uint64_t key = static_cast<std::uint64_t>(std::bit_cast<std::uint32_t>(c.depth)) << 32 |
+                                      static_cast<std::uint32_t>(c.r) << 24 | static_cast<std::uint32_t>(c.g) << 16 |
+                                      static_cast<std::uint32_t>(c.b) << 8  | c.a;
+            const auto [it, inserted] = topIndex.try_emplace(key, static_cast<std::uint32_t>(topCell.size()));
+            if (inserted) topCell.push_back(i);
+            labels[i] = it->second;
+        }
+        DecomposeRects(labels, sampleW, sampleH, merge, rects);
+        for (const LabeledRect& r : rects) {
+            const PixelCell& c = cells[topCell[r.label]];
+            welder.Quad({ welder.Vertex(r.x,       r.y,       c.depth, FaceDir::PosZ, c),
+                          welder.Vertex(r.x + r.w, r.y,       c.depth, FaceDir::PosZ, c),
+                          welder.Vertex(r.x + r.w, r.y + r.h, c.depth, FaceDir::PosZ, c),
+                          welder.Vertex(r.x,       r.y + r.h, c.depth, FaceDir::PosZ, c) });
+        }
+
+        // Bottoms: colour only.
+        ColorLabeler             labeler;
+        std::vector<std::size_t> bottomCell;
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            const PixelCell& c = cells[i];
+            if (!c.valid) continue;
+            labels[i] = labeler.Label(pelpaint::Pixel(c.r, c.g, c.b, c.a));
+            if (labels[i] == bottomCell.size()) bottomCell.push_back(i);
+        }
+        DecomposeRects(labels, sampleW, sampleH, merge, rects);
+        for (const LabeledRect& r : rects) {
+            const PixelCell& c = cells[bottomCell[r.label]];
+            welder.Quad({ welder.Vertex(r.x,       r.y + r.h, 0.0f, FaceDir::NegZ, c),
+                          welder.Vertex(r.x + r.w, r.y + r.h, 0.0f, FaceDir::NegZ, c),
+                          welder.Vertex(r.x + r.w, r.y,       0.0f, FaceDir::NegZ, c),
+                          welder.Vertex(r.x,       r.y,       0.0f, FaceDir::NegZ, c) });
+        }
+    }
+
+    // Exposed side strip between two neighbouring columns on one boundary
+    // line; `owner` is the taller column.
+    struct SideStrip {
+        const PixelCell* owner = nullptr;
+        float zLo = 0.0f;
+        float zHi = 0.0f;
+        bool  positive = false;   // faces +x / +y
+
+        bool Continues(const SideStrip& o) const noexcept
+        {
+            return owner && o.owner && positive == o.positive && zLo == o.zLo && zHi == o.zHi &&
+                   owner->r == o.owner->r && owner->g == o.owner->g &&
+                   owner->b == o.owner->b && owner->a == o.owner->a;
+        }
+    };
 
-    static void EmitPrism(MeshData& mesh,
-                          float x0, float y0, float x1, float y1,
-                          float z0, float z1,
-                          std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a)
+    static SideStrip ExposedSide(const PixelCell* before, const PixelCell* after)
     {
-        // Top face vertices
-        const std::uint32_t t0 = PushVertex(mesh, x0, y0, z1, 0, 0, 1, r, g, b, a);
-        const std::uint32_t t1 = PushVertex(mesh, x1, y0, z1, 0, 0, 1, r, g, b, a);
-        const std::uint32_t t2 = PushVertex(mesh, x1, y1, z1, 0, 0, 1, r, g, b, a);
-        const std::uint32_t t3 = PushVertex(mesh, x0, y1, z1, 0, 0, 1, r, g, b, a);
-
-        // Bottom face
-        const std::uint32_t b0 = PushVertex(mesh, x0, y0, z0, 0, 0, -1, r, g, b, a);
-        const std::uint32_t b1 = PushVertex(mesh, x1, y0, z0, 0, 0, -1, r, g, b, a);
-        const std::uint32_t b2 = PushVertex(mesh, x1, y1, z0, 0, 0, -1, r, g, b, a);
-        const std::uint32_t b3 = PushVertex(mesh, x0, y1, z0, 0, 0, -1, r, g, b, a);
-
-        // Top
-        PushQuad(mesh, t0, t1, t2, t3);
-        // Bottom
-        PushQuad(mesh, b3, b2, b1, b0);
-
-        // Sides
-        PushQuad(mesh, b0, b1, t1, t0); // front
-        PushQuad(mesh, b1, b2, t2, t1); // right
-        PushQuad(mesh, b2, b3, t3, t2); // back
-        PushQuad(mesh, b3, b0, t0, t3); // left
+        const float hb = before && before->valid ? before->depth : 0.0f;
+        const float ha = after  && after->valid  ? after->depth  : 0.0f;
+        SideStrip s;
+        if (before && before->valid && hb > ha) s = { before, ha, hb, true };
+        else if (after && after->valid && ha > hb) s = { after, hb, ha, false };
+        return s;
     }
 
-    static void PushQuad(MeshData& mesh,
-                         std::uint32_t i0, std::uint32_t i1,
-                         std::uint32_t i2, std::uint32_t i3)
+    // Vertical faces: for each boundary line, runs of identical strips along
+    // the line become one quad.
+    static void EmitSides(VertexWelder& welder, std::span<const PixelCell> cells,
+                          std::uint32_t sampleW, std::uint32_t sampleH)
     {
-        mesh.indices.push_back(i0);
-        mesh.indices.push_back(i1);
-        mesh.indices.push_back(i2);
+        const auto cellAt = [&](std::int64_t x, std::int64_t y) -> const PixelCell* {
+            if (x < 0 || y < 0 || x >= sampleW || y >= sampleH) return nullptr;
+            return &cells[static_cast<std::size_t>(y) * sampleW + static_cast<std::size_t>(x)];
+        };
+
+        // Lines x = bx: strips span y.
+        for (std::uint32_t bx = 0; bx <= sampleW; ++bx) {
+            std::uint32_t y = 0;
+            while (y < sampleH) {
+                const SideStrip s = ExposedSide(cellAt(std::int64_t{bx} - 1, y), cellAt(bx, y));
+                std::uint32_t end = y + 1;
+                if (s.owner) {
+                    while (end < sampleH && s.Continues(ExposedSide(cellAt(std::int64_t{bx} - 1, end), cellAt(bx, end))))
+                        ++end;
+                    const PixelCell& c = *s.owner;
+                    if (s.positive) {
+                        welder.Quad({ welder.Vertex(bx, y,   s.zLo, FaceDir::PosX, c),
+                                      welder.Vertex(bx, end, s.zLo, FaceDir::PosX, c),
+                                      welder.Vertex(bx, end, s.zHi, FaceDir::PosX, c),
+                                      welder.Vertex(bx, y,   s.zHi, FaceDir::PosX, c) });
+                    } else {
+                        welder.Quad({ welder.Vertex(bx, end, s.zLo, FaceDir::NegX, c),
+                                      welder.Vertex(bx, y,   s.zLo, FaceDir::NegX, c),
+                                      welder.Vertex(bx, y,   s.zHi, FaceDir::NegX, c),
+                                      welder.Vertex(bx, end, s.zHi, FaceDir::NegX, c) });
+                    }
+                }
+                y = end;
+            }
+        }
 
-        mesh.indices.push_back(i0);
-        mesh.indices.push_back(i2);
-        mesh.indices.push_back(i3);
+        // Lines y = by: strips span x.
+        for (std::uint32_t by = 0; by <= sampleH; ++by) {
+            std::uint32_t x = 0;
+            while (x < sampleW) {
+                const SideStrip s = ExposedSide(cellAt(x, std::int64_t{by} - 1), cellAt(x, by));
+                std::uint32_t end = x + 1;
+                if (s.owner) {
+                    while (end < sampleW && s.Continues(ExposedSide(cellAt(end, std::int64_t{by} - 1), cellAt(end, by))))
+                        ++end;
+                    const PixelCell& c = *s.owner;
+                    if (s.positive) {
+                        welder.Quad({ welder.Vertex(end, by, s.zLo, FaceDir::PosY, c),
+                                      welder.Vertex(x,   by, s.zLo, FaceDir::PosY, c),
+                                      welder.Vertex(x,   by, s.zHi, FaceDir::PosY, c),
+                                      welder.Vertex(end, by, s.zHi, FaceDir::PosY, c) });
+                    } else {
+                        welder.Quad({ welder.Vertex(x,   by, s.zLo, FaceDir::NegY, c),
+                                      welder.Vertex(end, by, s.zLo, FaceDir::NegY, c),
+                                      welder.Vertex(end, by, s.zHi, FaceDir::NegY, c),
+                                      welder.Vertex(x,   by, s.zHi, FaceDir::NegY, c) });
+                    }
+                }
+                x = end;
+            }
+        }
     }
 
     bool MeshExporter::BuildPixelPerfectMesh(const pelpaint::ImageView& view,
                                              std::span<const float> depthMap,
                                              std::uint32_t gridSize,
                                              float depthScale,
-                                             MeshData& outMesh)
+                                             MeshData& outMesh,
+                                             RectMergeMode merge)
     {
         outMesh.vertices.clear();
         outMesh.indices.clear();
@@ -546,34 +787,19 @@ namespace pelpaint::exporter {
             return false;
         }
 
-        std::vector<MergeRect> rects;
-        if (!BuildMergedRects(cells, static_cast<std::uint32_t>(sampleW), static_cast<std::uint32_t>(sampleH), rects)) {
-            return false;
-        }
+        const auto w = static_cast<std::uint32_t>(sampleW);
+        const auto h = static_cast<std::uint32_t>(sampleH);
 
         try {
-            // Rough reserve estimate: 8 verts per prism, 12 triangles = 36 indices
-            outMesh.vertices.reserve(rects.size() * 8u);
-            outMesh.indices.reserve(rects.size() * 36u);
+            VertexWelder welder(outMesh, gridSize, depthScale);
+            EmitCaps(welder, cells, w, h, merge);
+            EmitSides(welder, cells, w, h);
         } catch (...) {
+            outMesh.vertices.clear();
+            outMesh.indices.clear();
             return false;
         }
 
-        for (const auto& rect : rects) {
-            const float x0 = static_cast<float>(rect.x * gridSize);
-            const float y0 = static_cast<float>(rect.y * gridSize);
-            const float x1 = static_cast<float>((rect.x + rect.w) * gridSize);
-            const float y1 = static_cast<float>((rect.y + rect.h) * gridSize);
-
-            const float z0 = 0.0f;
-            const float z1 = rect.cell.depth * depthScale;
-
-            EmitPrism(outMesh,
-                      x0, y0, x1, y1,
-                      z0, z1,
-                      rect.cell.r, rect.cell.g, rect.cell.b, rect.cell.a);
-        }
-
         return true;
     }
 } // namespace pelpaint::exporter
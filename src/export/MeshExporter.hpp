@@ -1,4 +1,5 @@
 #include "../PixelPaintView.hpp"
+#include "RectDecomposition.hpp"
 #include <cstdint>
 #include <span>
 #include <string>
@@ -13,25 +14,32 @@ enum class MeshMode {
     PixelPerfect, // merged block/cube mesh by color
 };
 
+enum class MeshFileFormat {
+    PlyBinary,    // binary_little_endian PLY
+    PlyAscii,     // ascii PLY
+    Glb,          // binary glTF 2.0 (GltfWriter)
+};
+
 struct PixelCell {
     bool valid = false;
     float depth = 0.0f;
     std::uint8_t r = 0, g = 0, b = 0, a = 0;
 };
 
-struct MergeRect {
-    std::uint32_t x = 0, y = 0, w = 0, h = 0;
-    PixelCell cell;
-};
-
 struct MeshData;
+class ExportProgress;
 
 struct MeshExportOptions {
     MeshMode mode = MeshMode::Solid;
+    MeshFileFormat format = MeshFileFormat::PlyBinary;
     std::uint32_t gridSize = 1;   // cell size in pixels
     float depthScale = 1.0f;
     bool useVertexColors = true;
-    bool optimizeMesh = true;
+    bool optimizeMesh = true;     // near-minimal rect merge (PixelPerfect)
+    bool quantize = false;        // GLB: u16 positions, i8 normals (KHR_mesh_quantization)
+    std::uint32_t targetTriangles = 4000;   // LoPoly
+    float maxError = 0.0f;        // LoPoly: stop above this quadric error (0 = no bound)
+    ExportProgress* progress = nullptr;   // background export: phase progress, cancel checks
 };
 
 class MeshExporter {
@@ -56,11 +64,20 @@ public:
                                    float depthScale,
                                    MeshData& outMesh);
 
+    static bool BuildLoPolyMesh(const pelpaint::ImageView& view,
+                                std::span<const float> depthMap,
+                                std::uint32_t gridSize,
+                                float depthScale,
+                                std::size_t targetTriangles,
+                                float maxError,
+                                MeshData& outMesh);
+
     static bool BuildPixelPerfectMesh(const pelpaint::ImageView& view,
                                       std::span<const float> depthMap,
                                       std::uint32_t gridSize,
                                       float depthScale,
-                                      MeshData& outMesh);
+                                      MeshData& outMesh,
+                                      RectMergeMode merge = RectMergeMode::Rows);
 };
 
 } // namespace pelpaint::exporter
@@ -0,0 +1,441 @@
+#include "MeshSimplify.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace pelpaint::exporter {
+
+namespace {
+
+constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+
+// Weight of border / colour-boundary constraint planes relative to the
+// surface planes (both scale with edge length squared).
+constexpr double kBoundaryWeight = 100.0;
+
+// A collapse may not turn any remaining triangle by more than ~78°.
+constexpr double kMinNormalCos = 0.2;
+
+// Tie-break towards short edges (squared length), so flat regions, where
+// every collapse is free, are decimated evenly instead of into one fan.
+constexpr double kLengthBias = 1e-3;
+
+struct Vec3 {
+    double x = 0, y = 0, z = 0;
+
+    Vec3 operator-(const Vec3& o) const noexcept { return { x - o.x, y - o.y, z - o.z }; }
+    Vec3 operator+(const Vec3& o) const noexcept { return { x + o.x, y + o.y, z + o.z }; }
+    Vec3 operator*(double s) const noexcept { return { x * s, y * s, z * s }; }
+    double Dot(const Vec3& o) const noexcept { return x * o.x + y * o.y + z * o.z; }
+    Vec3 Cross(const Vec3& o) const noexcept { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+    double Length() const noexcept { return std::sqrt(Dot(*this)); }
+};
+
+// Symmetric 4×4 error quadric of weighted planes ax + by + cz + d = 0.
+struct Quadric {
+    double aa = 0, ab = 0, ac = 0, ad = 0;
+    double bb = 0, bc = 0, bd = 0;
+    double cc = 0, cd = 0;
+    double dd = 0;
+
+    static Quadric Plane(const Vec3& n, double d, double w) noexcept
+    {
+        Quadric q;
+        q.aa = w * n.x * n.x; q.ab = w * n.x * n.y; q.ac = w * n.x * n.z; q.ad = w * n.x * d;
+        q.bb = w * n.y * n.y; q.bc = w * n.y * n.z; q.bd = w * n.y * d;
+        q.cc = w * n.z * n.z; q.cd = w * n.z * d;
+        q.dd = w * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) noexcept
+    {
+        aa += o.aa; ab += o.ab; ac += o.ac; ad += o.ad;
+        bb += o.bb; bc += o.bc; bd += o.bd;
+        cc += o.cc; cd += o.cd;
+        dd += o.dd;
+        return *this;
+    }
+
+    double Error(const Vec3& p) const noexcept
+    {
+        const double e = aa * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                       + bb * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                       + cc * p.z * p.z + 2 * cd * p.z
+                       + dd;
+        return std::max(e, 0.0);
+    }
+};
+
+struct Candidate {
+    float         cost;
+    std::uint32_t from, to;
+    std::uint32_t fromStamp, toStamp;
+    bool          reversible;   // to → from is worth trying if this fails
+
+    bool operator>(const Candidate& o) const noexcept { return cost > o.cost; }
+};
+
+class Simplifier {
+public:
+    Simplifier(MeshData& mesh, const SimplifyOptions& options)
+        : mesh_(mesh), options_(options),
+          vertexCount_(static_cast<std::uint32_t>(mesh.vertices.size())),
+          liveTriangles_(mesh.indices.size() / 3)
+    {
+    }
+
+    void Run()
+    {
+        BuildAdjacency();
+        BuildQuadrics();
+        SeedCandidates();
+
+        while (liveTriangles_ > options_.targetTriangles && !heap_.empty()) {
+            const Candidate c = heap_.top();
+            heap_.pop();
+            if (options_.maxError > 0.0 && c.cost > options_.maxError) break;
+            if (stamp_[c.from] != c.fromStamp || stamp_[c.to] != c.toStamp) continue;
+            if (CanCollapse(c.from, c.to)) {
+                Collapse(c.from, c.to);
+            } else if (c.reversible) {
+                heap_.push({ Cost(c.to, c.from), c.to, c.from, c.toStamp, c.fromStamp, false });
+            }
+        }
+
+        Compact();
+    }
+
+private:
+    // ---- Topology ------------------------------------------------------
+
+    Vec3 Position(std::uint32_t v) const noexcept
+    {
+        const MeshVertex& p = mesh_.vertices[v];
+        return { p.x, p.y, p.z };
+    }
+
+    bool SameColor(std::uint32_t a, std::uint32_t b) const noexcept
+    {
+        const MeshVertex& p = mesh_.vertices[a];
+        const MeshVertex& q = mesh_.vertices[b];
+        return p.r == q.r && p.g == q.g && p.b == q.b && p.a == q.a;
+    }
+
+    std::uint32_t Corner(std::uint32_t c) const noexcept { return mesh_.indices[c]; }
+    static std::uint32_t NextCorner(std::uint32_t c) noexcept { return c - c % 3 + (c + 1) % 3; }
+    static std::uint32_t PrevCorner(std::uint32_t c) noexcept { return c - c % 3 + (c + 2) % 3; }
+
+    // Visits the corners of v's live triangles; dead ones are unlinked on
+    // the way.
+    template <typename Fn>
+    void ForEachCorner(std::uint32_t v, Fn&& fn)
+    {
+        std::uint32_t* link = &head_[v];
+        while (*link != kNone) {
+            const std::uint32_t c = *link;
+            if (!alive_[c / 3]) { *link = next_[c]; continue; }
+            fn(c);
+            link = &next_[c];
+        }
+    }
+
+    void BuildAdjacency()
+    {
+        const std::size_t corners = mesh_.indices.size();
+        head_.assign(vertexCount_, kNone);
+        next_.assign(corners, kNone);
+        alive_.assign(corners / 3, 1);
+        stamp_.assign(vertexCount_, 0);
+        border_.assign(vertexCount_, 0);
+        borderEdge_.assign(corners, 0);
+        locked_.assign(vertexCount_, 0);
+
+        for (std::uint32_t c = static_cast<std::uint32_t>(corners); c-- > 0;) {
+            next_[c]         = head_[Corner(c)];
+            head_[Corner(c)] = c;
+        }
+
+        // Edge a→b is a border when no triangle has b→a.
+        for (std::uint32_t c = 0; c < corners; ++c) {
+            const std::uint32_t a = Corner(c);
+            const std::uint32_t b = Corner(NextCorner(c));
+            bool twin = false;
+            ForEachCorner(b, [&](std::uint32_t cb) { twin |= Corner(NextCorner(cb)) == a; });
+            if (!twin) {
+                borderEdge_[c] = 1;
+                border_[a] = border_[b] = 1;
+            }
+        }
+
+        // Border corners (two non-collinear border edges) never move.
+        std::vector<Vec3> direction(vertexCount_);
+        for (std::uint32_t c = 0; c < corners; ++c) {
+            if (!borderEdge_[c]) continue;
+            const std::uint32_t a = Corner(c), b = Corner(NextCorner(c));
+            const Vec3 e = Position(b) - Position(a);
+            for (std::uint32_t v : { a, b }) {
+                Vec3& d = direction[v];
+                if (d.Dot(d) == 0.0) d = e;
+                else if (d.Cross(e).Length() > 1e-9 * d.Length() * e.Length()) locked_[v] = 1;
+            }
+        }
+    }
+
+    // Constraint plane through edge a–b, perpendicular to the triangle.
+    void AddEdgeConstraint(std::uint32_t a, std::uint32_t b, const Vec3& faceNormal)
+    {
+        const Vec3   pa = Position(a);
+        const Vec3   e  = Position(b) - pa;
+        Vec3         n  = e.Cross(faceNormal);
+        const double len = n.Length();
+        if (len <= 0.0) return;
+        n = n * (1.0 / len);
+        const Quadric q = Quadric::Plane(n, -n.Dot(pa), kBoundaryWeight * e.Dot(e));
+        quadric_[a] += q;
+        quadric_[b] += q;
+    }
+
+    void BuildQuadrics()
+    {
+        quadric_.assign(vertexCount_, Quadric{});
+        for (std::uint32_t t = 0; t < alive_.size(); ++t) {
+            const std::uint32_t v[3] = { Corner(3 * t), Corner(3 * t + 1), Corner(3 * t + 2) };
+            const Vec3 p0 = Position(v[0]);
+            Vec3       n  = (Position(v[1]) - p0).Cross(Position(v[2]) - p0);
+            const double len = n.Length();
+            if (len <= 0.0) continue;
+            n = n * (1.0 / len);
+
+            const Quadric q = Quadric::Plane(n, -n.Dot(p0), 0.5 * len);   // area weighted
+            for (std::uint32_t k : v) quadric_[k] += q;
+
+            for (int k = 0; k < 3; ++k) {
+                const std::uint32_t a = v[k], b = v[(k + 1) % 3], o = v[(k + 2) % 3];
+                const bool colorEdge = options_.preserveColors && SameColor(a, b) && !SameColor(a, o);
+                if (borderEdge_[3 * t + k] || colorEdge) AddEdgeConstraint(a, b, n);
+            }
+        }
+    }
+
+    // A vertex with a differently coloured neighbour.
+    bool OnColorBoundary(std::uint32_t v)
+    {
+        bool boundary = false;
+        ForEachCorner(v, [&](std::uint32_t c) {
+            boundary |= !SameColor(v, Corner(NextCorner(c))) || !SameColor(v, Corner(PrevCorner(c)));
+        });
+        return boundary;
+    }
+
+    bool CanCollapse(std::uint32_t u, std::uint32_t v)
+    {
+        if (!MayCollapse(u, v)) return false;
+
+        // Triangles on the edge, whether it is a border edge, and whether a
+        // colour boundary runs along it.
+        int  shared = 0;
+        bool edgeOnColorBoundary = false;
+        neighborsU_.clear();
+        ForEachCorner(u, [&](std::uint32_t c) {
+            const std::uint32_t a = Corner(NextCorner(c)), b = Corner(PrevCorner(c));
+            neighborsU_.push_back(a);
+            neighborsU_.push_back(b);
+            if (a == v || b == v) {
+                ++shared;
+                edgeOnColorBoundary |= !SameColor(u, a == v ? b : a);
+            }
+        });
+        if (shared == 0) return false;
+
+        if (border_[u] && !(border_[v] && shared == 1)) return false;
+        if (options_.preserveColors && OnColorBoundary(u) && !edgeOnColorBoundary) return false;
+
+        // Link condition: u and v may only share the neighbours opposite the
+        // edge, or the collapse pinches the surface.
+        std::sort(neighborsU_.begin(), neighborsU_.end());
+        neighborsU_.erase(std::unique(neighborsU_.begin(), neighborsU_.end()), neighborsU_.end());
+        neighborsV_.clear();
+        ForEachCorner(v, [&](std::uint32_t c) {
+            neighborsV_.push_back(Corner(NextCorner(c)));
+            neighborsV_.push_back(Corner(PrevCorner(c)));
+        });
+        std::sort(neighborsV_.begin(), neighborsV_.end());
+        neighborsV_.erase(std::unique(neighborsV_.begin(), neighborsV_.end()), neighborsV_.end());
+        std::size_t common = 0;
+        for (std::size_t i = 0, j = 0; i < neighborsU_.size() && j < neighborsV_.size();) {
+            if      (neighborsU_[i] < neighborsV_[j]) ++i;
+            else if (neighborsV_[j] < neighborsU_[i]) ++j;
+            else { ++common; ++i; ++j; }
+        }
+        if (common != static_cast<std::size_t>(shared)) return false;
+
+        // No remaining triangle may flip or degenerate.
+        const Vec3 pv = Position(v);
+        bool ok = true;
+        ForEachCorner(u, [&](std::uint32_t c) {
+            if (!ok) return;
+            const std::uint32_t a = Corner(NextCorner(c)), b = Corner(PrevCorner(c));
+            if (a == v || b == v) return;
+            const Vec3 pa = Position(a), pb = Position(b);
+            const Vec3 before = (pa - Position(u)).Cross(pb - Position(u));
+            const Vec3 after  = (pa - pv).Cross(pb - pv);
+            const double lb = before.Length(), la = after.Length();
+            if (la <= 1e-12 * std::max(lb, 1.0) || before.Dot(after) < kMinNormalCos * lb * la) ok = false;
+            if (options_.heightfield && after.z <= 0.0) ok = false;
+        });
+        return ok;
+    }
+
+    // Filters that do not depend on the neighbourhood; the full
+    // CanCollapse() runs when the candidate is popped.
+    bool MayCollapse(std::uint32_t u, std::uint32_t v) const noexcept
+    {
+        if (options_.preserveColors && !SameColor(u, v)) return false;
+        if (locked_[u]) return false;
+        return !border_[u] || border_[v];
+    }
+
+    float Cost(std::uint32_t u, std::uint32_t v) const noexcept
+    {
+        Quadric q = quadric_[u];
+        q += quadric_[v];
+        const Vec3 e = Position(u) - Position(v);
+        return static_cast<float>(q.Error(Position(v)) + kLengthBias * e.Dot(e));
+    }
+
+    // Cheaper direction of edge a–b; the other one is kept as a fallback.
+    void PushEdge(std::uint32_t a, std::uint32_t b)
+    {
+        const bool toB = MayCollapse(a, b);
+        const bool toA = MayCollapse(b, a);
+        if (!toB && !toA) return;
+
+        const float costB = toB ? Cost(a, b) : std::numeric_limits<float>::infinity();
+        const float costA = toA ? Cost(b, a) : std::numeric_limits<float>::infinity();
+        if (costB <= costA) heap_.push({ costB, a, b, stamp_[a], stamp_[b], toA });
+        else                heap_.push({ costA, b, a, stamp_[b], stamp_[a], toB });
+    }
+
+    void SeedCandidates()
+    {
+        for (std::uint32_t c = 0; c < mesh_.indices.size(); ++c) {
+            const std::uint32_t a = Corner(c), b = Corner(NextCorner(c));
+            // Interior edges appear once per direction; keep one of them.
+            if (a < b || borderEdge_[c]) PushEdge(a, b);
+        }
+    }
+
+    void Collapse(std::uint32_t u, std::uint32_t v)
+    {
+        scratch_.clear();
+        ForEachCorner(u, [&](std::uint32_t c) { scratch_.push_back(c); });
+
+        for (std::uint32_t c : scratch_) {
+            const std::uint32_t t = c / 3;
+            if (Corner(NextCorner(c)) == v || Corner(PrevCorner(c)) == v) {
+                alive_[t] = 0;
+                --liveTriangles_;
+                continue;
+            }
+            mesh_.indices[c] = v;
+            next_[c]  = head_[v];
+            head_[v]  = c;
+        }
+        head_[u] = kNone;
+
+        quadric_[v] += quadric_[u];
+        border_[v]  |= border_[u];
+        ++stamp_[u];
+        ++stamp_[v];
+
+        scratch_.clear();
+        ForEachCorner(v, [&](std::uint32_t c) {
+            scratch_.push_back(Corner(NextCorner(c)));
+            scratch_.push_back(Corner(PrevCorner(c)));
+        });
+        std::sort(scratch_.begin(), scratch_.end());
+        scratch_.erase(std::unique(scratch_.begin(), scratch_.end()), scratch_.end());
+        for (std::uint32_t w : scratch_) PushEdge(v, w);
+    }
+
+    // Drop dead triangles and unreferenced vertices; smooth normals.
+    void Compact()
+    {
+        std::vector<std::uint32_t> remap(vertexCount_, kNone);
+        std::vector<MeshVertex>    vertices;
+        std::vector<std::uint32_t> indices;
+        indices.reserve(liveTriangles_ * 3);
+
+        for (std::uint32_t t = 0; t < alive_.size(); ++t) {
+            if (!alive_[t]) continue;
+            for (int k = 0; k < 3; ++k) {
+                const std::uint32_t v = Corner(3 * t + k);
+                if (remap[v] == kNone) {
+                    remap[v] = static_cast<std::uint32_t>(vertices.size());
+                    vertices.push_back(mesh_.vertices[v]);
+                }
+                indices.push_back(remap[v]);
+            }
+        }
+
+        std::vector<Vec3> normals(vertices.size());
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            const auto p = [&](std::size_t k) {
+                const MeshVertex& m = vertices[indices[i + k]];
+                return Vec3{ m.x, m.y, m.z };
+            };
+            const Vec3 n = (p(1) - p(0)).Cross(p(2) - p(0));   // area weighted
+            for (int k = 0; k < 3; ++k) normals[indices[i + k]] = normals[indices[i + k]] + n;
+        }
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            const double len = normals[i].Length();
+            if (len <= 0.0) continue;
+            vertices[i].nx = static_cast<float>(normals[i].x / len);
+            vertices[i].ny = static_cast<float>(normals[i].y / len);
+            vertices[i].nz = static_cast<float>(normals[i].z / len);
+        }
+
+        mesh_.vertices = std::move(vertices);
+        mesh_.indices  = std::move(indices);
+    }
+
+    MeshData&              mesh_;
+    const SimplifyOptions& options_;
+    std::uint32_t          vertexCount_;
+    std::size_t            liveTriangles_;
+
+    std::vector<std::uint32_t> head_;         // per vertex: first corner
+    std::vector<std::uint32_t> next_;         // per corner: next corner of the same vertex
+    std::vector<std::uint8_t>  alive_;        // per triangle
+    std::vector<std::uint8_t>  borderEdge_;   // per corner: edge to the next corner is a border
+    std::vector<std::uint8_t>  border_;       // per vertex
+    std::vector<std::uint8_t>  locked_;       // per vertex: border corner
+    std::vector<std::uint32_t> stamp_;        // per vertex: bumped on every change
+    std::vector<Quadric>       quadric_;
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> heap_;
+
+    std::vector<std::uint32_t> neighborsU_, neighborsV_, scratch_;
+};
+
+} // namespace
+
+bool SimplifyMesh(MeshData& mesh, const SimplifyOptions& options)
+{
+    if (mesh.indices.empty() || mesh.indices.size() % 3u != 0u) return false;
+    if (mesh.vertices.size() >= kNone || mesh.indices.size() >= kNone) return false;
+    for (std::uint32_t i : mesh.indices)
+        if (i >= mesh.vertices.size()) return false;
+
+    Simplifier(mesh, options).Run();
+    return true;
+}
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MeshData.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Quadric error mesh simplification
+//
+// Garland–Heckbert edge collapse on an indexed triangle mesh.  Each vertex
+// carries the area-weighted quadric of its triangles' planes; candidate
+// collapses sit in a binary heap ordered by the quadric error of the merged
+// vertex and are invalidated lazily, so the whole pass is O(n log n).
+//
+// Collapses are half-edge (a vertex merges into a neighbour and keeps that
+// neighbour's position and colour), so no new colours appear.  Mesh borders
+// and, with preserveColors, colour boundaries are held in place by
+// constraint planes and may only slide along themselves (border corners
+// stay put); collapses that flip a triangle or make the surface
+// non-manifold are rejected.  Costs include a small edge-length term so
+// free collapses spread evenly.
+//
+// On return the mesh is compacted and vertex normals are recomputed.
+// ---------------------------------------------------------------------------
+
+struct SimplifyOptions {
+    std::size_t targetTriangles = 4000;
+    double      maxError        = 0.0;    // stop once the cheapest collapse costs more (0: no bound)
+    bool        preserveColors  = true;   // never merge differently coloured vertices
+    bool        heightfield     = false;  // keep every triangle facing +z (no folds seen from above)
+};
+
+bool SimplifyMesh(MeshData& mesh, const SimplifyOptions& options);
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,368 @@
+#include "PngWriter.hpp"
+#include "../core/Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+namespace pelpaint::exporter {
+
+    // Filtered bytes per compressed chunk (one parallel deflate task).
+    constexpr std::size_t kPngChunkBytes = std::size_t{256} << 10;
+
+    // Share of the progress range spent counting colours for indexed output.
+    constexpr float kPaletteScanShare = 0.2f;
+
+    static std::uint8_t* PutBigEndian32(std::uint8_t* dst, std::uint32_t value) noexcept
+    {
+        dst[0] = static_cast<std::uint8_t>(value >> 24);
+        dst[1] = static_cast<std::uint8_t>(value >> 16);
+        dst[2] = static_cast<std::uint8_t>(value >> 8);
+        dst[3] = static_cast<std::uint8_t>(value);
+        return dst + 4;
+    }
+
+    static std::uint8_t Paeth(int a, int b, int c) noexcept
+    {
+        const int p  = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return static_cast<std::uint8_t>(a);
+        return static_cast<std::uint8_t>(pb <= pc ? b : c);
+    }
+
+    // Write the cheapest filtering of `row` (n bytes, `up` is the raw row
+    // above) to dst as filter byte + n bytes.  Cost is the sum of absolute
+    // residuals as signed bytes.  `scratch` holds 5 × (n + 1) bytes.
+    static void FilterRow(const std::uint8_t* row, const std::uint8_t* up, std::size_t bpp, std::size_t n,
+                          std::uint8_t* dst, std::uint8_t* scratch) noexcept
+    {
+        std::uint8_t* cand[5];
+        for (std::size_t f = 0; f < 5; ++f) {
+            cand[f] = scratch + f * (n + 1);
+            *cand[f]++ = static_cast<std::uint8_t>(f);
+        }
+
+        const std::size_t head = std::min(bpp, n);
+        for (std::size_t i = 0; i < n; ++i) cand[0][i] = row[i];
+        for (std::size_t i = 0; i < n; ++i) cand[2][i] = static_cast<std::uint8_t>(row[i] - up[i]);
+        for (std::size_t i = 0; i < head; ++i) {
+            cand[1][i] = row[i];
+            cand[3][i] = static_cast<std::uint8_t>(row[i] - (up[i] >> 1));
+            cand[4][i] = static_cast<std::uint8_t>(row[i] - up[i]);
+        }
+        for (std::size_t i = head; i < n; ++i) {
+            cand[1][i] = static_cast<std::uint8_t>(row[i] - row[i - bpp]);
+            cand[3][i] = static_cast<std::uint8_t>(row[i] - ((row[i - bpp] + up[i]) >> 1));
+            cand[4][i] = static_cast<std::uint8_t>(row[i] - Paeth(row[i - bpp], up[i], up[i - bpp]));
+        }
+
+        std::uint32_t bestCost   = UINT32_MAX;
+        std::size_t   bestFilter = 0;
+        for (std::size_t f = 0; f < 5; ++f) {
+            std::uint32_t cost = 0;
+            for (std::size_t i = 0; i < n; ++i) cost += static_cast<std::uint32_t>(std::abs(static_cast<std::int8_t>(cand[f][i])));
+            if (cost < bestCost) {
+                bestCost   = cost;
+                bestFilter = f;
+            }
+        }
+        std::memcpy(dst, scratch + bestFilter * (n + 1), n + 1);
+    }
+
+    PngWriter::PngWriter(const std::string& filename, std::uint32_t width, std::uint32_t height, PngFormat format,
+                         PngLevel level, std::span<const core::PixelRGBA8> palette)
+        : out_(filename)
+        , width_(width)
+        , height_(height)
+        , format_(format)
+        , level_(level)
+    {
+        if (format_ == PngFormat::Indexed) {
+            valid_ = !palette.empty() && palette.size() <= 256;
+            bitDepth_ = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : palette.size() <= 16 ? 4 : 8;
+        }
+        const std::size_t bitsPerPixel = format_ == PngFormat::Rgba8 ? 32 : bitDepth_;
+        rowBytes_ = (static_cast<std::size_t>(width_) * bitsPerPixel + 7) / 8;
+        prevRow_.assign(rowBytes_, 0);
+
+        const std::size_t chunkRows = std::max<std::size_t>(1, kPngChunkBytes / (rowBytes_ + 1));
+        batchRows_ = chunkRows * core::WorkerCount();
+        raw_.resize(batchRows_ * rowBytes_);
+
+        static constexpr std::uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out_.WriteBytes(kSignature, sizeof(kSignature));
+
+        std::uint8_t ihdr[13];
+        std::uint8_t* p = PutBigEndian32(ihdr, width_);
+        p = PutBigEndian32(p, height_);
+        p[0] = static_cast<std::uint8_t>(bitDepth_);
+        p[1] = format_ == PngFormat::Rgba8 ? 6 : format_ == PngFormat::Indexed ? 3 : 0;   // colour type
+        p[2] = p[3] = p[4] = 0;                             // deflate, adaptive filters, no interlace
+        WriteChunk("IHDR", ihdr, sizeof(ihdr));
+
+        if (format_ == PngFormat::Indexed && valid_) {
+            std::vector<std::uint8_t> plte, trns;
+            for (const core::PixelRGBA8& c : palette) {
+                plte.insert(plte.end(), { c.r, c.g, c.b });
+                trns.push_back(c.a);
+            }
+            while (!trns.empty() && trns.back() == 255) trns.pop_back();
+            WriteChunk("PLTE", plte.data(), plte.size());
+            if (!trns.empty()) WriteChunk("tRNS", trns.data(), trns.size());
+        }
+    }
+
+    void PngWriter::Row(const std::uint8_t* pixels)
+    {
+        if (rows_ >= height_ || !valid_) return;
+        ++rows_;
+
+        if (batchCount_ == batchRows_) FlushBatch(false);
+        PackRow(pixels, raw_.data() + batchCount_ * rowBytes_);
+        ++batchCount_;
+    }
+
+    // Scanline bytes of one input row: a copy, or indices packed MSB first.
+    void PngWriter::PackRow(const std::uint8_t* pixels, std::uint8_t* dst) const noexcept
+    {
+        if (format_ != PngFormat::Indexed || bitDepth_ == 8) {
+            std::memcpy(dst, pixels, rowBytes_);
+            return;
+        }
+        const std::uint32_t perByte = 8 / bitDepth_;
+        std::memset(dst, 0, rowBytes_);
+        for (std::uint32_t x = 0; x < width_; ++x) {
+            const std::uint32_t shift = 8 - bitDepth_ * (x % perByte + 1);
+            dst[x / perByte] |= static_cast<std::uint8_t>(pixels[x] << shift);
+        }
+    }
+
+    void PngWriter::FlushBatch(bool last)
+    {
+        const std::size_t stride = rowBytes_ + 1;
+        const std::size_t bpp    = format_ == PngFormat::Rgba8 ? 4 : 1;
+        filtered_.resize(batchCount_ * stride);
+
+        core::ParallelFor(0, batchCount_, [&](std::size_t r0, std::size_t r1) {
+            std::vector<std::uint8_t> scratch(5 * stride);
+            for (std::size_t r = r0; r < r1; ++r) {
+                const std::uint8_t* up = r == 0 ? prevRow_.data() : raw_.data() + (r - 1) * rowBytes_;
+                FilterRow(raw_.data() + r * rowBytes_, up, bpp, rowBytes_, filtered_.data() + r * stride, scratch.data());
+            }
+        }, 16);
+
+        const std::size_t total  = filtered_.size();
+        const std::size_t chunks = std::max<std::size_t>(1, (total + kPngChunkBytes - 1) / kPngChunkBytes);
+        compressed_.resize(chunks);
+        const std::span<const std::uint8_t> data(filtered_);
+
+        core::ParallelFor(0, chunks, [&](std::size_t c0, std::size_t c1) {
+            for (std::size_t c = c0; c < c1; ++c) {
+                const std::size_t begin = c * kPngChunkBytes;
+                const std::size_t end   = std::min(total, begin + kPngChunkBytes);
+                const std::size_t keep  = std::min(begin, kDeflateWindow);
+                const std::span<const std::uint8_t> history =
+                    c == 0 ? std::span<const std::uint8_t>(history_) : data.subspan(begin - keep, keep);
+
+                compressed_[c].clear();
+                DeflateChunk(history, data.subspan(begin, end - begin), last && c + 1 == chunks, compressed_[c], level_);
+            }
+        });
+
+        adler_ = Adler32(adler_, data);
+        for (std::size_t c = 0; c < chunks; ++c) {
+            std::vector<std::uint8_t>& chunk = compressed_[c];
+            if (!started_) {
+                // zlib header: deflate, 32 KiB window, level hint
+                const std::uint8_t header[2] = { 0x78, static_cast<std::uint8_t>(level_ == PngLevel::Fast ? 0x01 : 0xDA) };
+                chunk.insert(chunk.begin(), header, header + 2);
+                started_ = true;
+            }
+            if (last && c + 1 == chunks) {
+                std::uint8_t trailer[4];
+                PutBigEndian32(trailer, adler_);
+                chunk.insert(chunk.end(), trailer, trailer + 4);
+            }
+            if (!chunk.empty()) WriteChunk("IDAT", chunk.data(), chunk.size());
+        }
+
+        if (!last) {
+            // Carry the window and the last raw row into the next batch.
+            const std::size_t fromBatch   = std::min(kDeflateWindow, total);
+            const std::size_t fromHistory = std::min(history_.size(), kDeflateWindow - fromBatch);
+            history_.erase(history_.begin(), history_.end() - static_cast<std::ptrdiff_t>(fromHistory));
+            history_.insert(history_.end(), filtered_.end() - static_cast<std::ptrdiff_t>(fromBatch), filtered_.end());
+            if (batchCount_ > 0) std::memcpy(prevRow_.data(), raw_.data() + (batchCount_ - 1) * rowBytes_, rowBytes_);
+        }
+        batchCount_ = 0;
+    }
+
+    void PngWriter::WriteChunk(const char (&type)[5], const std::uint8_t* data, std::size_t size)
+    {
+        std::uint8_t header[8];
+        PutBigEndian32(header, static_cast<std::uint32_t>(size));
+        std::copy_n(type, 4, header + 4);
+        out_.WriteBytes(header, sizeof(header));
+        out_.WriteBytes(data, size);
+
+        std::uint32_t crc = Crc32(0, std::span(header + 4, 4));
+        crc = Crc32(crc, std::span(data, size));
+        std::uint8_t trailer[4];
+        PutBigEndian32(trailer, crc);
+        out_.WriteBytes(trailer, sizeof(trailer));
+    }
+
+    bool PngWriter::Finish()
+    {
+        if (rows_ != height_ || !valid_) {
+            out_.Finish();
+            return false;
+        }
+        FlushBatch(true);
+        WriteChunk("IEND", nullptr, 0);
+        return out_.Finish();
+    }
+
+    // ---------------------------------------------------------------------------
+    // Palette detection for WritePng
+    // ---------------------------------------------------------------------------
+
+    namespace {
+
+        // Colour → palette index for up to 256 colours: open addressing at
+        // load ≤ 0.5, with the last lookup cached for runs.
+        class PaletteMap {
+        public:
+            static constexpr std::size_t kMaxColors = 256;
+
+            // Index of `key`, adding it if there is room; -1 when full.
+            int Lookup(std::uint32_t key) noexcept
+            {
+                if (key == lastKey_ && lastIndex_ >= 0) return lastIndex_;
+                std::size_t slot = Hash(key);
+                while (used_[slot]) {
+                    if (keys_[slot] == key) return Remember(key, index_[slot]);
+                    slot = (slot + 1) & (kSlots - 1);
+                }
+                if (colors_.size() == kMaxColors) return -1;
+                used_[slot]  = true;
+                keys_[slot]  = key;
+                index_[slot] = static_cast<std::uint8_t>(colors_.size());
+                colors_.push_back(key);
+                return Remember(key, index_[slot]);
+            }
+
+            [[nodiscard]] const std::vector<std::uint32_t>& Colors() const noexcept { return colors_; }
+
+            // Renumber so that colours[i] gets index i.
+            void Reorder(const std::vector<std::uint32_t>& colors) noexcept
+            {
+                colors_ = colors;
+                for (std::size_t i = 0; i < colors_.size(); ++i) {
+                    std::size_t slot = Hash(colors_[i]);
+                    while (!used_[slot] || keys_[slot] != colors_[i]) slot = (slot + 1) & (kSlots - 1);
+                    index_[slot] = static_cast<std::uint8_t>(i);
+                }
+                lastIndex_ = -1;
+            }
+
+        private:
+            static constexpr std::size_t kSlots = 2 * kMaxColors;
+
+            static std::size_t Hash(std::uint32_t key) noexcept { return (key * 2654435761u) >> 23; }
+
+            int Remember(std::uint32_t key, std::uint8_t index) noexcept
+            {
+                lastKey_   = key;
+                lastIndex_ = index;
+                return index;
+            }
+
+            std::array<std::uint32_t, kSlots> keys_{};
+            std::array<std::uint8_t,  kSlots> index_{};
+            std::array<bool,          kSlots> used_{};
+            std::vector<std::uint32_t>        colors_;
+            std::uint32_t                     lastKey_   = 0;
+            int                               lastIndex_ = -1;
+        };
+
+        std::uint32_t PixelKey(const std::uint8_t* p) noexcept
+        {
+            std::uint32_t key;
+            std::memcpy(&key, p, 4);
+            return key;
+        }
+
+        // First pass: true when the image has at most 256 colours.
+        bool CollectPalette(RowBands& bands, PaletteMap& map)
+        {
+            pelpaint::ImageView band;
+            std::uint32_t       top = 0;
+            while (bands.Next(band, top)) {
+                for (std::uint32_t y = 0; y < band.height; ++y) {
+                    const std::uint8_t* row = band.data + static_cast<std::size_t>(y) * band.stride;
+                    for (std::uint32_t x = 0; x < band.width; ++x) {
+                        if (map.Lookup(PixelKey(row + x * 4)) < 0) return false;
+                    }
+                }
+            }
+            return !bands.Cancelled();
+        }
+
+    } // namespace
+
+    bool WritePng(const std::string& filename, RowBands& bands, const PngOptions& options)
+    {
+        if (!bands.Valid()) return false;
+
+        const float from = bands.ProgressFrom();
+        const float to   = bands.ProgressTo();
+
+        PaletteMap map;
+        std::vector<core::PixelRGBA8> palette;
+        if (options.indexed) {
+            bands.SetProgressRange(from, from + (to - from) * kPaletteScanShare);
+            const bool fits = CollectPalette(bands, map);
+            if (bands.Cancelled()) return false;
+            bands.Rewind();
+            bands.SetProgressRange(from + (to - from) * kPaletteScanShare, to);
+
+            if (fits) {
+                // Translucent entries first keeps tRNS short.
+                std::vector<std::uint32_t> colors = map.Colors();
+                std::stable_partition(colors.begin(), colors.end(), [](std::uint32_t key) {
+                    return std::bit_cast<core::PixelRGBA8>(key).a != 255;
+                });
+                map.Reorder(colors);
+                for (std::uint32_t key : colors) palette.push_back(std::bit_cast<core::PixelRGBA8>(key));
+            }
+        }
+
+        const PngFormat format = palette.empty() ? PngFormat::Rgba8 : PngFormat::Indexed;
+        PngWriter png(filename, bands.Width(), bands.Height(), format, options.level, palette);
+        if (!png.Ok()) return false;
+
+        std::vector<std::uint8_t> indices(format == PngFormat::Indexed ? bands.Width() : 0);
+        pelpaint::ImageView band;
+        std::uint32_t       top = 0;
+        while (bands.Next(band, top)) {
+            for (std::uint32_t y = 0; y < band.height; ++y) {
+                const std::uint8_t* row = band.data + static_cast<std::size_t>(y) * band.stride;
+                if (format == PngFormat::Rgba8) {
+                    png.Row(row);
+                    continue;
+                }
+                for (std::uint32_t x = 0; x < band.width; ++x) {
+                    indices[x] = static_cast<std::uint8_t>(map.Lookup(PixelKey(row + x * 4)));
+                }
+                png.Row(indices.data());
+            }
+        }
+        return png.Finish();
+    }
+
+} // namespace pelpaint::exporter
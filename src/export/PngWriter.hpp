@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "BufferedWriter.hpp"
+#include "Deflate.hpp"
+#include "RowBands.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Streaming PNG
+//
+// Rows go in one at a time, top to bottom, and are collected into batches
+// of one 256 KiB chunk per worker thread.  A full batch is processed in
+// parallel twice:
+//   • Rows are filtered.  Each row uses whichever of the five PNG filters
+//     gives the smallest sum of absolute residuals.  A filter needs only the
+//     raw row above, so every row is independent.
+//   • Chunks are deflated (Deflate.hpp).  Each chunk is primed with the
+//     32 KiB of filtered data before it and ends on a sync flush.
+// The compressed chunks are then written in order as IDATs of one zlib
+// stream.  Memory is one batch, whatever the image size.
+//
+// Indexed images take one palette index per pixel.  They are written with
+// the smallest bit depth (1, 2, 4 or 8) that holds the palette, plus PLTE,
+// and tRNS when any palette entry is not opaque.
+// ---------------------------------------------------------------------------
+
+enum class PngFormat {
+    Gray8,     // 1 byte per pixel
+    Rgba8,     // 4 bytes per pixel
+    Indexed,   // 1 palette index per pixel
+};
+
+using PngLevel = DeflateLevel;
+
+class PngWriter {
+public:
+    // `palette` (at most 256 entries) is required for Indexed and ignored
+    // otherwise.
+    PngWriter(const std::string& filename, std::uint32_t width, std::uint32_t height, PngFormat format,
+              PngLevel level = PngLevel::Small, std::span<const core::PixelRGBA8> palette = {});
+
+    PngWriter(const PngWriter&)            = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    [[nodiscard]] bool Ok() const noexcept { return out_.Ok() && valid_; }
+
+    // Next row: width × (1 or 4) bytes.
+    void Row(const std::uint8_t* pixels);
+
+    // Compress what is left and close the file.  False when a write failed
+    // or fewer than `height` rows were given.
+    bool Finish();
+
+private:
+    void PackRow(const std::uint8_t* pixels, std::uint8_t* dst) const noexcept;
+    void FlushBatch(bool last);
+    void WriteChunk(const char (&type)[5], const std::uint8_t* data, std::size_t size);
+
+    BufferedWriter out_;
+    std::uint32_t  width_;
+    std::uint32_t  height_;
+    PngFormat      format_;
+    PngLevel       level_;
+    std::uint32_t  bitDepth_   = 8;
+    std::size_t    rowBytes_   = 0;       // packed scanline, without the filter byte
+    std::size_t    batchRows_  = 0;       // rows per batch
+    std::uint32_t  rows_       = 0;
+    std::uint32_t  adler_      = 1;
+    bool           started_    = false;   // zlib header written
+    bool           valid_      = true;
+
+    std::vector<std::uint8_t> prevRow_;      // raw row above the batch (zeros before the first)
+    std::vector<std::uint8_t> raw_;          // batch rows, packed, unfiltered
+    std::size_t               batchCount_ = 0;
+    std::vector<std::uint8_t> filtered_;     // batch rows with filter bytes
+    std::vector<std::uint8_t> history_;      // last 32 KiB of filtered data before the batch
+    std::vector<std::vector<std::uint8_t>> compressed_;   // one per chunk
+};
+
+struct PngOptions {
+    PngLevel level   = PngLevel::Small;
+    bool     indexed = true;   // write PLTE when the image has ≤ 256 colours
+};
+
+// RGBA PNG from row bands.  With options.indexed a first pass over the bands
+// collects the colours, and images with at most 256 are written indexed.
+bool WritePng(const std::string& filename, RowBands& bands, const PngOptions& options = {});
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,251 @@
+#include "RectDecomposition.hpp"
+
+#include <algorithm>
+
+#include "RowBands.hpp"
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::exporter {
+
+namespace {
+
+// Rows per band below which splitting is not worth the stitching.
+constexpr std::uint32_t kMinBandRows = 32;
+
+struct Band {
+    std::vector<LabeledRect> rects;
+    std::vector<std::size_t> firstRow;   // rects starting on the band's first row, by x
+    std::vector<std::size_t> open;       // rects touching the band's last row, by x
+};
+
+// Row-run stacking over rows [y0, y1), whose labels start at `labels`.
+// Rects still open from an earlier call on the rows above carry on.
+void StackRows(std::span<const std::uint32_t> labels, std::uint32_t width,
+               std::uint32_t y0, std::uint32_t y1, Band& band)
+{
+    std::vector<std::size_t> next;
+    for (std::uint32_t y = y0; y < y1; ++y) {
+        const std::uint32_t* row = labels.data() + static_cast<std::size_t>(y - y0) * width;
+        next.clear();
+
+        // open is sorted by x, and so are this row's runs: one forward walk.
+        std::size_t   o = 0;
+        std::uint32_t x = 0;
+        while (x < width) {
+            const std::uint32_t label = row[x];
+            std::uint32_t       end   = x + 1;
+            while (end < width && row[end] == label) ++end;
+
+            if (label != kNoLabel) {
+                while (o < band.open.size() && band.rects[band.open[o]].x < x) ++o;
+                LabeledRect* above = o < band.open.size() ? &band.rects[band.open[o]] : nullptr;
+                if (above && above->x == x && above->w == end - x && above->label == label) {
+                    ++above->h;
+                    next.push_back(band.open[o++]);
+                } else {
+                    next.push_back(band.rects.size());
+                    if (y == y0) band.firstRow.push_back(band.rects.size());
+                    band.rects.push_back({ x, y, end - x, 1, label });
+                }
+            }
+            x = end;
+        }
+        band.open.swap(next);
+    }
+}
+
+// Decompose by rows, in parallel bands joined at the seams.
+void DecomposeRows(std::span<const std::uint32_t> labels, std::uint32_t width, std::uint32_t height,
+                   std::vector<LabeledRect>& out)
+{
+    out.clear();
+
+    const std::uint32_t bandCount = std::clamp<std::uint32_t>(
+        height / kMinBandRows, 1, core::WorkerCount());
+    const std::uint32_t bandRows  = (height + bandCount - 1) / bandCount;
+
+    std::vector<Band> bands(bandCount);
+    core::ParallelFor(0, bandCount, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; ++b) {
+            const std::uint32_t y0 = static_cast<std::uint32_t>(b) * bandRows;
+            const std::uint32_t y1 = std::min(height, y0 + bandRows);
+            if (y0 < y1) {
+                StackRows(labels.subspan(static_cast<std::size_t>(y0) * width,
+                                         static_cast<std::size_t>(y1 - y0) * width),
+                          width, y0, y1, bands[b]);
+            }
+        }
+    });
+
+    // Seams: a rect on a band's first row continues the rect above it when
+    // extent and label match.  `open` holds out-indices touching the seam.
+    std::vector<std::size_t> open, remap;
+    for (Band& band : bands) {
+        remap.assign(band.rects.size(), 0);
+        std::vector<std::uint8_t> merged(band.rects.size(), 0);
+
+        std::size_t o = 0;
+        for (std::size_t i : band.firstRow) {
+            const LabeledRect& r = band.rects[i];
+            while (o < open.size() && out[open[o]].x < r.x) ++o;
+            if (o < open.size() && out[open[o]].x == r.x && out[open[o]].w == r.w &&
+                out[open[o]].label == r.label) {
+                out[open[o]].h += r.h;
+                remap[i]  = open[o++];
+                merged[i] = 1;
+            }
+        }
+        for (std::size_t i = 0; i < band.rects.size(); ++i) {
+            if (merged[i]) continue;
+            remap[i] = out.size();
+            out.push_back(band.rects[i]);
+        }
+
+        open.clear();
+        for (std::size_t i : band.open) open.push_back(remap[i]);
+    }
+}
+
+void Transpose(std::span<const std::uint32_t> in, std::uint32_t width, std::uint32_t height,
+               std::vector<std::uint32_t>& out)
+{
+    constexpr std::uint32_t kBlock = 64;
+    out.resize(in.size());
+    core::ParallelFor(0, (height + kBlock - 1) / kBlock, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t by = lo; by < hi; ++by) {
+            const std::uint32_t y0 = static_cast<std::uint32_t>(by) * kBlock;
+            const std::uint32_t y1 = std::min(height, y0 + kBlock);
+            for (std::uint32_t x0 = 0; x0 < width; x0 += kBlock) {
+                const std::uint32_t x1 = std::min(width, x0 + kBlock);
+                for (std::uint32_t y = y0; y < y1; ++y)
+                    for (std::uint32_t x = x0; x < x1; ++x)
+                        out[static_cast<std::size_t>(x) * height + y] = in[static_cast<std::size_t>(y) * width + x];
+            }
+        }
+    });
+}
+
+// Label the pixels of one band into `dst` (band.height rows of band.width).
+void LabelBand(const ImageView& band, ColorLabeler& labeler, std::uint32_t* dst)
+{
+    for (std::uint32_t y = 0; y < band.height; ++y, dst += band.width) {
+        const std::uint8_t* src = band.data + static_cast<std::size_t>(y) * band.stride;
+        for (std::uint32_t x = 0; x < band.width; ++x, src += 4) {
+            if (src[3] == 0) continue;
+            dst[x] = labeler.Label(Pixel(src[0], src[1], src[2], src[3]));
+        }
+    }
+}
+
+} // namespace
+
+void DecomposeRects(std::span<const std::uint32_t> labels,
+                    std::uint32_t width, std::uint32_t height,
+                    RectMergeMode mode,
+                    std::vector<LabeledRect>& out)
+{
+    out.clear();
+    if (width == 0 || height == 0 || labels.size() != static_cast<std::size_t>(width) * height) return;
+
+    DecomposeRows(labels, width, height, out);
+    if (mode == RectMergeMode::Rows) return;
+
+    std::vector<LabeledRect> byColumns;
+    {
+        std::vector<std::uint32_t> transposed;
+        Transpose(labels, width, height, transposed);
+        DecomposeRows(transposed, height, width, byColumns);
+    }
+    for (LabeledRect& r : byColumns) {
+        std::swap(r.x, r.y);
+        std::swap(r.w, r.h);
+    }
+
+    // Per label, keep the orientation with fewer rectangles.
+    std::uint32_t labelCount = 0;
+    for (const LabeledRect& r : out) labelCount = std::max(labelCount, r.label + 1);
+    std::vector<std::int64_t> balance(labelCount, 0);   // rows − columns
+    for (const LabeledRect& r : out)       ++balance[r.label];
+    for (const LabeledRect& r : byColumns) --balance[r.label];
+
+    std::erase_if(out, [&](const LabeledRect& r) { return balance[r.label] > 0; });
+    for (const LabeledRect& r : byColumns)
+        if (balance[r.label] > 0) out.push_back(r);
+}
+
+// ============================================================
+// Colour labels
+// ============================================================
+
+std::uint32_t ColorLabeler::Label(const Pixel& color)
+{
+    const std::uint32_t key = static_cast<std::uint32_t>(color.r) << 24 | static_cast<std::uint32_t>(color.g) << 16 |
+                              static_cast<std::uint32_t>(color.b) << 8  | static_cast<std::uint32_t>(color.a);
+    if (key == lastKey_ && lastLabel_ != kNoLabel) return lastLabel_;
+
+    const auto [it, inserted] = index_.try_emplace(key, static_cast<std::uint32_t>(colors_.size()));
+    if (inserted) colors_.push_back(color);
+    lastKey_   = key;
+    lastLabel_ = it->second;
+    return lastLabel_;
+}
+
+void LabelColors(const ImageView& view, std::vector<std::uint32_t>& labels, std::vector<Pixel>& colors)
+{
+    labels.assign(static_cast<std::size_t>(view.width) * view.height, kNoLabel);
+    colors.clear();
+    if (!view.valid() || view.channels != 4) return;
+
+    RowBands bands(view);
+    LabelColors(bands, labels, colors);
+}
+
+void LabelColors(RowBands& bands, std::vector<std::uint32_t>& labels, std::vector<Pixel>& colors)
+{
+    labels.assign(static_cast<std::size_t>(bands.Width()) * bands.Height(), kNoLabel);
+    colors.clear();
+
+    ColorLabeler  labeler;
+    ImageView     band;
+    std::uint32_t top = 0;
+    while (bands.Next(band, top)) {
+        LabelBand(band, labeler, labels.data() + static_cast<std::size_t>(top) * band.width);
+    }
+    colors = labeler.Colors();
+}
+
+// ============================================================
+// Streaming decomposition
+// ============================================================
+
+void DecomposeRects(RowBands& bands, RectMergeMode mode,
+                    std::vector<Pixel>& colors, std::vector<LabeledRect>& out)
+{
+    out.clear();
+    colors.clear();
+    if (!bands.Valid()) return;
+
+    if (mode != RectMergeMode::Rows) {
+        std::vector<std::uint32_t> labels;
+        LabelColors(bands, labels, colors);
+        if (!bands.Cancelled()) DecomposeRects(labels, bands.Width(), bands.Height(), mode, out);
+        return;
+    }
+
+    // One band of labels at a time; rects left open at the bottom of a
+    // band carry on into the next.  Creation order matches DecomposeRows.
+    ColorLabeler               labeler;
+    Band                       stack;
+    std::vector<std::uint32_t> labels;
+    ImageView                  band;
+    std::uint32_t              top = 0;
+    while (bands.Next(band, top)) {
+        labels.assign(static_cast<std::size_t>(band.width) * band.height, kNoLabel);
+        LabelBand(band, labeler, labels.data());
+        StackRows(labels, band.width, top, top + band.height, stack);
+    }
+    colors = labeler.Colors();
+    out    = std::move(stack.rects);
+}
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::exporter {
+
+class RowBands;
+
+// ---------------------------------------------------------------------------
+// Rectangle decomposition
+//
+// Splits a label grid (one small integer per pixel or cell) into
+// axis-aligned rectangles of a single label, shared by the SVG and mesh
+// exporters.
+//
+//   Rows        — every row is cut into runs of one label and runs with the
+//                 same extent on consecutive rows are stacked.  One linear
+//                 pass, each label read once; row bands run in parallel and
+//                 are stitched at the seams.
+//   NearMinimal — additionally decomposes by columns and keeps, per label,
+//                 whichever orientation produced fewer rectangles.  About
+//                 twice the work; much better on vertical detail.  Needs
+//                 the full label plane plus a transposed copy (8 bytes per
+//                 cell), so it is opt-in; Rows is the default everywhere.
+//
+// Labels must be dense (0 .. colours-1, as produced by ColorLabeler);
+// kNoLabel marks cells that produce no rectangle.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::uint32_t kNoLabel = 0xFFFFFFFFu;
+
+enum class RectMergeMode {
+    Rows,
+    NearMinimal,
+};
+
+struct LabeledRect {
+    std::uint32_t x = 0, y = 0, w = 0, h = 0;
+    std::uint32_t label = kNoLabel;
+};
+
+void DecomposeRects(std::span<const std::uint32_t> labels,
+                    std::uint32_t width, std::uint32_t height,
+                    RectMergeMode mode,
+                    std::vector<LabeledRect>& out);
+
+// ---------------------------------------------------------------------------
+// ColorLabeler — assigns dense labels to colours in order of first use.
+// ---------------------------------------------------------------------------
+
+class ColorLabeler {
+public:
+    [[nodiscard]] std::uint32_t Label(const Pixel& color);
+
+    [[nodiscard]] const std::vector<Pixel>& Colors() const noexcept { return colors_; }
+
+private:
+    std::unordered_map<std::uint32_t, std::uint32_t> index_;
+    std::vector<Pixel>                               colors_;
+    std::uint32_t                                    lastKey_   = 0;
+    std::uint32_t                                    lastLabel_ = kNoLabel;
+};
+
+// Label every pixel of an RGBA view by colour; fully transparent pixels get
+// kNoLabel.  colors[label] is the colour of each label.
+void LabelColors(const ImageView& view,
+                 std::vector<std::uint32_t>& labels,
+                 std::vector<Pixel>& colors);
+
+// Same, reading the image band by band.  The label grid is still one full
+// plane (the column pass of NearMinimal needs whole columns).  Check
+// bands.Cancelled() afterwards: a cancelled read leaves it unfinished.
+void LabelColors(RowBands& bands,
+                 std::vector<std::uint32_t>& labels,
+                 std::vector<Pixel>& colors);
+
+// LabelColors and DecomposeRects in one pass over the bands.  Rows mode
+// holds the labels of one band at a time; NearMinimal needs whole columns
+// and labels the full plane.  Check bands.Cancelled() afterwards.
+void DecomposeRects(RowBands& bands, RectMergeMode mode,
+                    std::vector<Pixel>& colors,
+                    std::vector<LabeledRect>& out);
+
+} // namespace pelpaint::exporter
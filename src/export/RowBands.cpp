@@ -0,0 +1,77 @@
+#include "RowBands.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace pelpaint::exporter {
+
+    RowBands::RowBands(const core::ImageSurface& surface, ExportProgress* progress)
+        : surface_(&surface)
+        , width_(surface.Width())
+        , height_(surface.Height())
+        , progress_(progress)
+    {
+    }
+
+    RowBands::RowBands(const pelpaint::ImageView& view, ExportProgress* progress)
+        : view_(view)
+        , progress_(progress)
+    {
+        if (view.valid() && view.channels == 4) {
+            width_  = view.width;
+            height_ = view.height;
+        }
+    }
+
+    bool RowBands::Next(pelpaint::ImageView& band, std::uint32_t& top)
+    {
+        const std::uint32_t bandCount = (height_ + kBandRows - 1) / kBandRows;
+        if (next_ >= bandCount || Cancelled()) return false;
+
+        top = next_ * kBandRows;
+        const std::uint32_t rows = std::min(kBandRows, height_ - top);
+
+        if (surface_) {
+            AssembleBand(next_);
+            band.data   = reinterpret_cast<const std::uint8_t*>(buffer_.data());
+            band.stride = width_ * 4;
+        } else {
+            band.data   = view_.data + static_cast<std::size_t>(top) * view_.stride;
+            band.stride = view_.stride;
+        }
+        band.width    = width_;
+        band.height   = rows;
+        band.channels = 4;
+
+        ++next_;
+        if (progress_) {
+            const float done = static_cast<float>(next_) / static_cast<float>(bandCount);
+            progress_->Report(progressFrom_ + (progressTo_ - progressFrom_) * done);
+        }
+        return true;
+    }
+
+    // Copy tile row ty into buffer_, one tile-width slice per row.
+    void RowBands::AssembleBand(std::uint32_t ty)
+    {
+        const std::uint32_t rows = surface_->TileHeight(ty);
+        buffer_.resize(static_cast<std::size_t>(width_) * kBandRows);
+
+        for (std::uint32_t tx = 0; tx < surface_->TilesX(); ++tx) {
+            const std::uint32_t x0 = tx * kBandRows;
+            const std::uint32_t tw = surface_->TileWidth(tx);
+            const auto          tile = surface_->TilePixels(tx, ty);
+
+            for (std::uint32_t ly = 0; ly < rows; ++ly) {
+                core::PixelRGBA8* dst = buffer_.data() + static_cast<std::size_t>(ly) * width_ + x0;
+                if (tile.empty()) {
+                    std::fill_n(dst, tw, core::PixelRGBA8{0, 0, 0, 0});
+                } else {
+                    std::memcpy(dst, tile.data() + core::ImageSurface::LocalIndex(0, ly),
+                                tw * sizeof(core::PixelRGBA8));
+                }
+            }
+        }
+    }
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ExportJob.hpp"
+#include "../core/ImageSurface.hpp"
+#include "../core/Types.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// RowBands
+//
+// Feeds an image to streaming encoders as bands of whole rows, top to
+// bottom, so no exporter needs the image as one contiguous buffer.
+//
+//   • From an ImageSurface, each band is one row of tiles (TileSize rows).
+//     It is assembled into a reusable buffer when asked for.  An export
+//     holds one band at a time, never a flattened copy.  Unallocated tiles
+//     read as transparent.
+//   • From a flat ImageView, bands are views into it (no copy).
+//
+// With an ExportProgress attached, every band read reports progress across
+// the range set by SetProgressRange().  Next() stops early once the export
+// is cancelled.
+// ---------------------------------------------------------------------------
+
+class RowBands {
+public:
+    static constexpr std::uint32_t kBandRows = core::ImageSurface::TileSize;
+
+    explicit RowBands(const core::ImageSurface& surface, ExportProgress* progress = nullptr);
+    explicit RowBands(const pelpaint::ImageView& view, ExportProgress* progress = nullptr);
+
+    [[nodiscard]] std::uint32_t Width()  const noexcept { return width_;  }
+    [[nodiscard]] std::uint32_t Height() const noexcept { return height_; }
+    [[nodiscard]] bool          Valid()  const noexcept { return width_ > 0 && height_ > 0; }
+
+    // Next band: `band` views its rows (4 channels) until the next call and
+    // `top` is the image row of its first line.  False after the last band
+    // or once the export has been cancelled.
+    bool Next(pelpaint::ImageView& band, std::uint32_t& top);
+
+    // Start again from the first band (for encoders that read twice).
+    void Rewind() noexcept { next_ = 0; }
+
+    // Share of the progress bar that one pass over the bands spans.
+    void SetProgressRange(float from, float to) noexcept { progressFrom_ = from; progressTo_ = to; }
+    [[nodiscard]] float ProgressFrom() const noexcept { return progressFrom_; }
+    [[nodiscard]] float ProgressTo()   const noexcept { return progressTo_; }
+
+    [[nodiscard]] bool Cancelled() const noexcept { return progress_ && progress_->Cancelled(); }
+
+private:
+    void AssembleBand(std::uint32_t ty);
+
+    const core::ImageSurface* surface_ = nullptr;
+    pelpaint::ImageView       view_;
+    std::uint32_t             width_  = 0;
+    std::uint32_t             height_ = 0;
+    std::uint32_t             next_   = 0;   // index of the next band
+
+    std::vector<core::PixelRGBA8> buffer_;   // surface mode: the current band
+
+    ExportProgress* progress_     = nullptr;
+    float           progressFrom_ = 0.0f;
+    float           progressTo_   = 1.0f;
+};
+
+} // namespace pelpaint::exporter
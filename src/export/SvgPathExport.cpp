@@ -0,0 +1,156 @@
+#include "SvgPathExport.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <vector>
+
+#include "BufferedWriter.hpp"
+#include "RectDecomposition.hpp"
+#include "RowBands.hpp"
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::exporter {
+
+namespace {
+
+// Colours are formatted in batches so at most this many path strings are
+// held in memory at once.
+constexpr std::size_t kColorBatch = 64;
+
+void AppendInt(std::string& out, std::int64_t value)
+{
+    std::array<char, 24> buf;
+    const auto result = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    out.append(buf.data(), result.ptr);
+}
+
+// d attribute: first subpath absolute, then each one relative to the start
+// of the previous (where "z" leaves the current point).
+void RectsToPath(std::span<const LabeledRect> rects, std::string& out)
+{
+    out.clear();
+    out.reserve(rects.size() * 16);
+
+    std::int64_t px = 0, py = 0;
+    bool first = true;
+    for (const LabeledRect& r : rects) {
+        out += first ? 'M' : 'm';
+        AppendInt(out, first ? r.x : static_cast<std::int64_t>(r.x) - px);
+        out += ' ';
+        AppendInt(out, first ? r.y : static_cast<std::int64_t>(r.y) - py);
+        out += 'h';
+        AppendInt(out, r.w);
+        out += 'v';
+        AppendInt(out, r.h);
+        out += "h-";
+        AppendInt(out, r.w);
+        out += 'z';
+        px = r.x;
+        py = r.y;
+        first = false;
+    }
+}
+
+void WriteHex(BufferedWriter& out, const Pixel& c)
+{
+    static constexpr char kDigits[] = "0123456789abcdef";
+    const char hex[7] = { '#', kDigits[c.r >> 4], kDigits[c.r & 15], kDigits[c.g >> 4],
+                               kDigits[c.g & 15], kDigits[c.b >> 4], kDigits[c.b & 15] };
+    out.Write(std::string_view(hex, 7));
+}
+
+void WriteClassName(BufferedWriter& out, const Pixel& c, std::size_t planeIndex,
+                    std::span<const Pixel> palette)
+{
+    const auto it = std::find(palette.begin(), palette.end(), c);
+    if (it != palette.end()) out.Write('p').Int(it - palette.begin());
+    else                     out.Write('c').Int(planeIndex);
+}
+
+} // namespace
+
+bool SaveToSVGPaths(const std::string& filename, const ImageView& view, const SvgPathOptions& options)
+{
+    if (!view.valid() || view.channels != 4) return false;
+
+    RowBands bands(view);
+    return SaveToSVGPaths(filename, bands, options);
+}
+
+bool SaveToSVGPaths(const std::string& filename, RowBands& bands, const SvgPathOptions& options)
+{
+    if (!bands.Valid()) return false;
+    const std::uint32_t width  = bands.Width();
+    const std::uint32_t height = bands.Height();
+
+    BufferedWriter out(filename);
+    if (!out.Ok()) return false;
+
+    // Rectangles grouped by colour (counting sort keeps each colour's rects
+    // in row order); first[c] .. first[c + 1] is colour c.
+    std::vector<Pixel>       colors;
+    std::vector<LabeledRect> rects;
+    DecomposeRects(bands, options.merge, colors, rects);
+    if (bands.Cancelled()) return false;
+
+    std::vector<std::size_t> first(colors.size() + 1, 0);
+    for (const LabeledRect& r : rects) ++first[r.label + 1];
+    for (std::size_t c = 0; c < colors.size(); ++c) first[c + 1] += first[c];
+    std::vector<LabeledRect> grouped(rects.size());
+    {
+        std::vector<std::size_t> cursor(first.begin(), first.end() - 1);
+        for (const LabeledRect& r : rects) grouped[cursor[r.label]++] = r;
+    }
+    rects = {};
+
+    out.Write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+              "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 ");
+    out.Int(width).Write(' ').Int(height).Write("\" shape-rendering=\"crispEdges\">\n");
+
+    if (options.useClasses && !colors.empty()) {
+        out.Write("<style>\n");
+        for (std::size_t i = 0; i < colors.size(); ++i) {
+            const Pixel& c = colors[i];
+            out.Write('.');
+            WriteClassName(out, c, i, options.palette);
+            out.Write("{fill:");
+            WriteHex(out, c);
+            if (c.a < 255) out.Write(";fill-opacity:").Fixed(c.a / 255.0, 3);
+            out.Write("}\n");
+        }
+        out.Write("</style>\n");
+    }
+
+    std::vector<std::string> paths(std::min(kColorBatch, colors.size()));
+    for (std::size_t b0 = 0; b0 < colors.size(); b0 += kColorBatch) {
+        const std::size_t b1 = std::min(b0 + kColorBatch, colors.size());
+
+        core::ParallelFor(b0, b1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i)
+                RectsToPath(std::span(grouped).subspan(first[i], first[i + 1] - first[i]), paths[i - b0]);
+        });
+
+        for (std::size_t i = b0; i < b1; ++i) {
+            const Pixel& c = colors[i];
+            out.Write("<path ");
+            if (options.useClasses) {
+                out.Write("class=\"");
+                WriteClassName(out, c, i, options.palette);
+                out.Write('"');
+            } else {
+                out.Write("fill=\"");
+                WriteHex(out, c);
+                out.Write('"');
+                if (c.a < 255) out.Write(" fill-opacity=\"").Fixed(c.a / 255.0, 3).Write('"');
+            }
+            out.Write(" d=\"").Write(paths[i - b0]).Write("\"/>\n");
+        }
+    }
+
+    out.Write("</svg>\n");
+    return out.Finish();
+}
+
+} // namespace pelpaint::exporter
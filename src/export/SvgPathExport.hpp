@@ -0,0 +1,39 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include "RectDecomposition.hpp"
+#include "../core/Types.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Colour-grouped SVG
+//
+// Every colour becomes ONE <path> whose d attribute lists that colour's
+// merged rectangles (RectDecomposition) as relative subpaths
+// ("m dx dy h w v h h -w z"), so the fill is written once per colour instead
+// of once per rectangle.  Paths are formatted in parallel per colour and
+// written in order of first appearance.
+//
+// useClasses — fills go into a <style> block and paths reference a class.
+//              Colours found in `palette` are named p<index>, so files
+//              exported against the same palette share class names;
+//              anything else is c<n>.
+// ---------------------------------------------------------------------------
+
+struct SvgPathOptions {
+    RectMergeMode          merge      = RectMergeMode::Rows;
+    bool                   useClasses = false;
+    std::span<const Pixel> palette;
+};
+
+bool SaveToSVGPaths(const std::string& filename, const ImageView& view,
+                    const SvgPathOptions& options = {});
+
+// Same, reading the image band by band (RowBands.hpp).
+bool SaveToSVGPaths(const std::string& filename, RowBands& bands,
+                    const SvgPathOptions& options = {});
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "BufferedWriter.hpp"
+#include "../core/Types.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// SvgWriter
+//
+// Emits the SVG markup the image exporters need on top of a BufferedWriter.
+// Coordinates are integers (pixel grid); the only fractional values are the
+// fill opacity (3 decimals) and the vector-style overlap (2 decimals).
+// ---------------------------------------------------------------------------
+
+class SvgWriter {
+public:
+    explicit SvgWriter(const std::string& filename) : out_(filename) {}
+
+    [[nodiscard]] bool Ok() const noexcept { return out_.Ok(); }
+
+    void Begin(std::uint32_t width, std::uint32_t height, bool crispEdges) {
+        out_.Write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 ");
+        out_.Int(width).Write(' ').Int(height).Write('"');
+        if (crispEdges) out_.Write(" shape-rendering=\"crispEdges\"");
+        out_.Write(">\n");
+    }
+
+    // <rect> covering [x, x+w) × [y, y+h) in `color`.
+    void Rect(std::uint32_t x, std::uint32_t y, std::uint32_t w, std::uint32_t h, const Pixel& color) {
+        out_.Write("<rect x=\"").Int(x).Write("\" y=\"").Int(y)
+            .Write("\" width=\"").Int(w).Write("\" height=\"").Int(h).Write('"');
+        Fill(color);
+        out_.Write("/>\n");
+    }
+
+    // Rounded <rect> grown by `overlap` so neighbours leave no hairline seams.
+    void RoundedRect(std::uint32_t x, std::uint32_t y, std::uint32_t w, std::uint32_t h,
+                     double overlap, const Pixel& color) {
+        out_.Write("<rect x=\"").Int(x).Write("\" y=\"").Int(y)
+            .Write("\" width=\"").Fixed(w + overlap, 2).Write("\" height=\"").Fixed(h + overlap, 2)
+            .Write("\" rx=\"0.4\" ry=\"0.4\"");
+        Fill(color);
+        out_.Write("/>\n");
+    }
+
+    // Writes the closing tag and flushes.  Returns true when the whole file
+    // was written.
+    bool End() {
+        out_.Write("</svg>\n");
+        return out_.Finish();
+    }
+
+private:
+    void Fill(const Pixel& color) {
+        out_.Write(" fill=\"rgb(").Int(color.r).Write(',').Int(color.g).Write(',').Int(color.b).Write(")\"");
+        if (color.a < 255) out_.Write(" fill-opacity=\"").Fixed(color.a / 255.0, 3).Write('"');
+    }
+
+    BufferedWriter out_;
+};
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,125 @@
+#include "TgaWriter.hpp"
+#include "BufferedWriter.hpp"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PELPAINT_TGA_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PELPAINT_TGA_NEON 1
+#endif
+
+namespace pelpaint::exporter {
+
+    constexpr std::uint32_t kTgaMaxPacket = 128;
+
+    void SwizzleRGBAtoBGRA(const std::uint8_t* src, std::uint8_t* dst, std::size_t count) noexcept
+    {
+        std::size_t i = 0;
+#if defined(PELPAINT_TGA_SSE2)
+        // Per 32-bit pixel: keep G and A, swap R and B.
+        const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+        const __m128i low  = _mm_set1_epi32(0x000000FF);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i p  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            const __m128i r  = _mm_slli_epi32(_mm_and_si128(p, low), 16);
+            const __m128i b  = _mm_and_si128(_mm_srli_epi32(p, 16), low);
+            const __m128i ga = _mm_and_si128(p, keep);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_or_si128(ga, r), b));
+        }
+#elif defined(PELPAINT_TGA_NEON)
+        for (; i + 16 <= count; i += 16) {
+            uint8x16x4_t p = vld4q_u8(src + i * 4);
+            const uint8x16_t r = p.val[0];
+            p.val[0] = p.val[2];
+            p.val[2] = r;
+            vst4q_u8(dst + i * 4, p);
+        }
+#endif
+        for (; i < count; ++i) {
+            const std::uint8_t r = src[i * 4 + 0];
+            dst[i * 4 + 0] = src[i * 4 + 2];
+            dst[i * 4 + 1] = src[i * 4 + 1];
+            dst[i * 4 + 2] = r;
+            dst[i * 4 + 3] = src[i * 4 + 3];
+        }
+    }
+
+    // RLE-encode one BGRA row, appending packets to `out`.
+    static void EncodeRow(const std::uint8_t* bgra, std::uint32_t width, std::vector<std::uint8_t>& out)
+    {
+        const auto pixel = [bgra](std::uint32_t x) {
+            std::uint32_t v;
+            std::memcpy(&v, bgra + static_cast<std::size_t>(x) * 4, 4);
+            return v;
+        };
+
+        std::uint32_t x = 0;
+        while (x < width) {
+            std::uint32_t run = 1;
+            while (x + run < width && run < kTgaMaxPacket && pixel(x + run) == pixel(x)) ++run;
+
+            if (run >= 2) {
+                out.push_back(static_cast<std::uint8_t>(0x80 | (run - 1)));
+                out.insert(out.end(), bgra + static_cast<std::size_t>(x) * 4, bgra + static_cast<std::size_t>(x) * 4 + 4);
+                x += run;
+                continue;
+            }
+
+            // Raw packet up to the start of the next run.
+            std::uint32_t end = x + 1;
+            while (end < width && end - x < kTgaMaxPacket &&
+                   !(end + 1 < width && pixel(end) == pixel(end + 1))) ++end;
+            out.push_back(static_cast<std::uint8_t>(end - x - 1));
+            out.insert(out.end(), bgra + static_cast<std::size_t>(x) * 4, bgra + static_cast<std::size_t>(end) * 4);
+            x = end;
+        }
+    }
+
+    bool WriteTga(const std::string& filename, RowBands& bands, const TgaOptions& options)
+    {
+        if (!bands.Valid() || bands.Width() > 0xFFFF || bands.Height() > 0xFFFF) return false;
+
+        BufferedWriter out(filename);
+        if (!out.Ok()) return false;
+
+        std::uint8_t header[18] = {};
+        header[2] = options.rle ? 10 : 2;                 // (RLE) true-colour
+        PutLittleEndian(header + 12, static_cast<std::uint16_t>(bands.Width()));
+        PutLittleEndian(header + 14, static_cast<std::uint16_t>(bands.Height()));
+        header[16] = 32;                                  // bits per pixel
+        header[17] = 0x28;                                // top-left origin, 8 alpha bits
+        out.WriteBytes(header, sizeof(header));
+
+        const std::size_t rowBytes = static_cast<std::size_t>(bands.Width()) * 4;
+        std::vector<std::uint8_t> swizzled(rowBytes * RowBands::kBandRows);
+        std::vector<std::uint8_t> packed;
+        if (options.rle) packed.reserve(swizzled.size() + swizzled.size() / (kTgaMaxPacket * 4) + RowBands::kBandRows);
+
+        pelpaint::ImageView band;
+        std::uint32_t       top = 0;
+        while (out.Ok() && bands.Next(band, top)) {
+            for (std::uint32_t y = 0; y < band.height; ++y) {
+                SwizzleRGBAtoBGRA(band.data + static_cast<std::size_t>(y) * band.stride,
+                                  swizzled.data() + y * rowBytes, band.width);
+            }
+
+            if (!options.rle) {
+                out.WriteBytes(swizzled.data(), rowBytes * band.height);
+                continue;
+            }
+            packed.clear();
+            for (std::uint32_t y = 0; y < band.height; ++y) {
+                EncodeRow(swizzled.data() + y * rowBytes, band.width, packed);
+            }
+            out.WriteBytes(packed.data(), packed.size());
+        }
+
+        const bool complete = !bands.Cancelled();
+        return out.Finish() && complete;
+    }
+
+} // namespace pelpaint::exporter
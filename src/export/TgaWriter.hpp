@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "RowBands.hpp"
+
+namespace pelpaint::exporter {
+
+// ---------------------------------------------------------------------------
+// Streaming TGA
+//
+// 32-bit BGRA with a top-left origin.  Each band is swizzled from RGBA
+// (SSE2 / NEON, scalar elsewhere) into one reusable buffer and handed to
+// BufferedWriter in a single write.  Every write is checked, and a failed
+// or cancelled export returns false.
+//
+// rle — image type 10.  Packets never cross a row, as the format
+//       recommends.  Runs of two or more equal pixels become run packets
+//       and everything else becomes raw packets.  Flat-colour pixel art
+//       typically shrinks by an order of magnitude.  Off: type 2,
+//       uncompressed.
+// ---------------------------------------------------------------------------
+
+struct TgaOptions {
+    bool rle = true;
+};
+
+bool WriteTga(const std::string& filename, RowBands& bands, const TgaOptions& options = {});
+
+// Reorder `count` RGBA pixels to BGRA (src and dst may be the same).
+void SwizzleRGBAtoBGRA(const std::uint8_t* src, std::uint8_t* dst, std::size_t count) noexcept;
+
+} // namespace pelpaint::exporter
@@ -0,0 +1,120 @@
+#include "BlockStats.hpp"
+
+#include <algorithm>
+
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::tools {
+
+// ============================================================
+// SummedAreaTable
+// ============================================================
+
+void SummedAreaTable::Build(std::span<const Pixel> pixels, int width, int height)
+{
+    if (width <= 0 || height <= 0 ||
+        pixels.size() < static_cast<std::size_t>(width) * static_cast<std::size_t>(height)) {
+        Clear();
+        return;
+    }
+
+    width_  = width;
+    height_ = height;
+    table_.assign(static_cast<std::size_t>(width + 1) * static_cast<std::size_t>(height + 1),
+                  Sum4{});
+
+    // Pass 1: horizontal prefix sums, one independent row per iteration.
+    core::ParallelFor(0, static_cast<std::size_t>(height),
+        [&](std::size_t y0, std::size_t y1) {
+            for (std::size_t y = y0; y < y1; ++y) {
+                const Pixel* src = pixels.data() + y * static_cast<std::size_t>(width_);
+                Sum4*        row = table_.data() + Index(0, static_cast<int>(y) + 1);
+                Sum4 acc{};
+                for (int x = 0; x < width_; ++x) {
+                    acc.r += src[x].r;
+                    acc.g += src[x].g;
+                    acc.b += src[x].b;
+                    acc.a += src[x].a;
+                    row[x + 1] = acc;
+                }
+            }
+        }, 16);
+
+    // Pass 2: vertical accumulation over column bands.  Each band walks the
+    // rows top to bottom; bands are wide enough to stay cache friendly.
+    core::ParallelFor(1, static_cast<std::size_t>(width_) + 1,
+        [&](std::size_t x0, std::size_t x1) {
+            for (int y = 2; y <= height_; ++y) {
+                const Sum4* above = table_.data() + Index(0, y - 1);
+                Sum4*       row   = table_.data() + Index(0, y);
+                for (std::size_t x = x0; x < x1; ++x) {
+                    row[x].r += above[x].r;
+                    row[x].g += above[x].g;
+                    row[x].b += above[x].b;
+                    row[x].a += above[x].a;
+                }
+            }
+        }, 64);
+}
+
+void SummedAreaTable::Clear() noexcept
+{
+    table_.clear();
+    width_  = 0;
+    height_ = 0;
+}
+
+Pixel SummedAreaTable::Mean(int x0, int y0, int x1, int y1) const noexcept
+{
+    x0 = std::clamp(x0, 0, width_);
+    x1 = std::clamp(x1, 0, width_);
+    y0 = std::clamp(y0, 0, height_);
+    y1 = std::clamp(y1, 0, height_);
+    if (x1 <= x0 || y1 <= y0) return Pixel{0, 0, 0, 0};
+
+    const Sum4& d = table_[Index(x1, y1)];
+    const Sum4& c = table_[Index(x0, y1)];
+    const Sum4& b = table_[Index(x1, y0)];
+    const Sum4& a = table_[Index(x0, y0)];
+
+    const std::uint32_t count =
+        static_cast<std::uint32_t>(x1 - x0) * static_cast<std::uint32_t>(y1 - y0);
+
+    return Pixel(
+        static_cast<std::uint8_t>((d.r - c.r - b.r + a.r) / count),
+        static_cast<std::uint8_t>((d.g - c.g - b.g + a.g) / count),
+        static_cast<std::uint8_t>((d.b - c.b - b.b + a.b) / count),
+        static_cast<std::uint8_t>((d.a - c.a - b.a + a.a) / count));
+}
+
+// ============================================================
+// Block means
+// ============================================================
+
+void ComputeBlockMeans(const SummedAreaTable& sat, int blockSize, BlockGrid& outGrid)
+{
+    outGrid.blockSize = std::max(1, blockSize);
+    outGrid.blocksX   = 0;
+    outGrid.blocksY   = 0;
+    outGrid.means.clear();
+    if (sat.Empty()) return;
+
+    const int bs = outGrid.blockSize;
+    outGrid.blocksX = (sat.Width()  + bs - 1) / bs;
+    outGrid.blocksY = (sat.Height() + bs - 1) / bs;
+    outGrid.means.resize(static_cast<std::size_t>(outGrid.blocksX) * outGrid.blocksY);
+
+    core::ParallelFor(0, static_cast<std::size_t>(outGrid.blocksY),
+        [&](std::size_t by0, std::size_t by1) {
+            for (std::size_t by = by0; by < by1; ++by) {
+                const int y0 = static_cast<int>(by) * bs;
+                for (int bx = 0; bx < outGrid.blocksX; ++bx) {
+                    const int x0 = bx * bs;
+                    outGrid.At(bx, static_cast<int>(by)) =
+                        sat.Mean(x0, y0, x0 + bs, y0 + bs);
+                }
+            }
+        }, 4);
+}
+
+} // namespace pelpaint::tools
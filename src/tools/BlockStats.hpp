@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// SummedAreaTable
+//
+// Per-channel integral image over an RGBA layer buffer.  Once built, the sum
+// (and therefore the mean colour) of any axis-aligned rectangle is four table
+// reads — O(1) regardless of rectangle size.
+//
+// Sums are stored as uint32 and allowed to wrap: rectangle sums are computed
+// with modular arithmetic, which is exact as long as the rectangle itself
+// holds fewer than 2^24 pixels (255 * 2^24 < 2^32).  That keeps the table at
+// 16 bytes per pixel instead of 32.
+//
+// Build() runs in two parallel passes (row prefixes, then column bands).
+// ---------------------------------------------------------------------------
+
+class SummedAreaTable {
+public:
+    SummedAreaTable() = default;
+
+    void Build(std::span<const Pixel> pixels, int width, int height);
+    void Clear() noexcept;
+
+    [[nodiscard]] int  Width()  const noexcept { return width_;  }
+    [[nodiscard]] int  Height() const noexcept { return height_; }
+    [[nodiscard]] bool Empty()  const noexcept { return table_.empty(); }
+
+    // Mean colour over [x0, x1) × [y0, y1), clamped to the table bounds.
+    // Truncating integer division — identical to summing the pixels by hand.
+    // Returns a transparent pixel for an empty rectangle.
+    [[nodiscard]] Pixel Mean(int x0, int y0, int x1, int y1) const noexcept;
+
+private:
+    struct Sum4 {
+        std::uint32_t r = 0;
+        std::uint32_t g = 0;
+        std::uint32_t b = 0;
+        std::uint32_t a = 0;
+    };
+
+    [[nodiscard]] std::size_t Index(int x, int y) const noexcept {
+        return static_cast<std::size_t>(y) * static_cast<std::size_t>(width_ + 1)
+             + static_cast<std::size_t>(x);
+    }
+
+    std::vector<Sum4> table_;   // (width+1) × (height+1); row 0 / column 0 are zero
+    int               width_  = 0;
+    int               height_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// BlockGrid — mean colour of every blockSize × blockSize cell of a layer.
+// Edge blocks are clipped to the layer bounds (their mean covers only the
+// pixels that exist).
+// ---------------------------------------------------------------------------
+
+struct BlockGrid {
+    int                blockSize = 1;
+    int                blocksX   = 0;
+    int                blocksY   = 0;
+    std::vector<Pixel> means;    // blocksX * blocksY, row-major
+
+    [[nodiscard]] const Pixel& At(int bx, int by) const noexcept {
+        return means[static_cast<std::size_t>(by) * blocksX + bx];
+    }
+    [[nodiscard]] Pixel& At(int bx, int by) noexcept {
+        return means[static_cast<std::size_t>(by) * blocksX + bx];
+    }
+};
+
+// Fill outGrid from an already-built table; block rows run in parallel.
+// Cheap enough to call on every block-size slider change.
+void ComputeBlockMeans(const SummedAreaTable& sat, int blockSize, BlockGrid& outGrid);
+
+} // namespace pelpaint::tools
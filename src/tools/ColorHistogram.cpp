@@ -0,0 +1,336 @@
+#include "ColorHistogram.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "../core/ImageSurface.hpp"
+#include "../core/Parallel.hpp"
+#include "../core/TileSource.hpp"
+
+namespace pelpaint::tools {
+
+namespace {
+
+[[nodiscard]] std::size_t SlotFor(std::uint32_t key, std::size_t mask) noexcept
+{
+    return static_cast<std::size_t>((key * 2654435761u) ^ (key >> 16)) & mask;
+}
+
+} // namespace
+
+// ============================================================
+// ColorHistogram
+// ============================================================
+
+void ColorHistogram::Clear()
+{
+    slots_.clear();
+    used_ = 0;
+    live_ = 0;
+    top_.clear();
+    outside_  = TopEntry{};
+    topStale_ = true;
+}
+
+void ColorHistogram::Rehash(std::size_t capacity)
+{
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(capacity, Slot{});
+    used_ = 0;
+
+    const std::size_t mask = capacity - 1;
+    for (const Slot& s : old) {
+        if (!s.used || s.count == 0) continue;   // drop zero-count slots
+        std::size_t i = SlotFor(s.key, mask);
+        while (slots_[i].used) i = (i + 1) & mask;
+        slots_[i] = s;
+        ++used_;
+    }
+}
+
+void ColorHistogram::Adjust(std::uint32_t key, int delta)
+{
+    // Keep load ≤ 0.75 so probe runs stay short.
+    if ((used_ + 1) * 4 > slots_.size() * 3) {
+        std::size_t capacity = std::max<std::size_t>(64, slots_.size());
+        while ((live_ + 1) * 2 > capacity) capacity *= 2;   // aim for ≤ 0.5 after rehash
+        Rehash(capacity);
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t       i    = SlotFor(key, mask);
+    while (slots_[i].used && slots_[i].key != key) i = (i + 1) & mask;
+
+    Slot& s = slots_[i];
+    if (!s.used) {
+        if (delta <= 0) return;   // removing a colour that was never counted
+        s.used = true;
+        s.key  = key;
+        ++used_;
+    }
+
+    const std::uint32_t before = s.count;
+    if (delta < 0) s.count -= std::min<std::uint32_t>(s.count, static_cast<std::uint32_t>(-delta));
+    else           s.count += static_cast<std::uint32_t>(delta);
+
+    if (before == 0 && s.count > 0) ++live_;
+    if (before > 0 && s.count == 0) --live_;
+
+    if (!topStale_ && s.count != before) UpdateTop(s);
+}
+
+ColorHistogram::Slot* ColorHistogram::Find(std::uint32_t key) noexcept
+{
+    if (slots_.empty()) return nullptr;
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = SlotFor(key, mask); slots_[i].used; i = (i + 1) & mask)
+        if (slots_[i].key == key) return &slots_[i];
+    return nullptr;
+}
+
+void ColorHistogram::AddPixels(std::span<const Pixel> pixels)
+{
+    topStale_ = true;   // one rescan beats following every new colour
+
+    // Runs of one colour are common in pixel art — count them in one probe.
+    std::size_t i = 0;
+    while (i < pixels.size()) {
+        std::size_t j = i + 1;
+        while (j < pixels.size() && pixels[j] == pixels[i]) ++j;
+        Adjust(Pack(pixels[i]), static_cast<int>(j - i));
+        i = j;
+    }
+}
+
+void ColorHistogram::TopN(std::size_t n, std::vector<Pixel>& out)
+{
+    out.clear();
+    if (n * 2 > topTracked_) {
+        topTracked_ = n * 2;
+        topStale_   = true;
+    }
+    if (!TopCurrent(n)) RescanTop();
+
+    const std::size_t k = std::min(n, top_.size());
+    out.reserve(k);
+    for (std::size_t i = 0; i < k; ++i) out.push_back(Unpack(top_[i].key));
+}
+
+void ColorHistogram::Entries(std::vector<std::pair<Pixel, std::uint32_t>>& out) const
+{
+    out.clear();
+    out.reserve(live_);
+    for (const Slot& s : slots_)
+        if (s.used && s.count > 0) out.emplace_back(Unpack(s.key), s.count);
+}
+
+// ============================================================
+// Top k
+// ============================================================
+
+void ColorHistogram::UpdateTop(Slot& slot)
+{
+    const TopEntry entry{ slot.key, slot.count };
+
+    if (slot.top) {
+        auto it = std::find_if(top_.begin(), top_.end(),
+                               [&](const TopEntry& e) { return e.key == slot.key; });
+        if (slot.count == 0) {
+            top_.erase(it);
+            slot.top = false;
+            return;
+        }
+        *it = entry;
+        while (it != top_.begin() && Higher(*it, *(it - 1))) { std::iter_swap(it, it - 1); --it; }
+        while (it + 1 != top_.end() && Higher(*(it + 1), *it)) { std::iter_swap(it, it + 1); ++it; }
+        return;
+    }
+
+    if (slot.count == 0) return;   // the bound still holds after a drop
+    if (top_.size() < topTracked_) {
+        top_.insert(std::upper_bound(top_.begin(), top_.end(), entry, Higher), entry);
+        slot.top = true;
+        return;
+    }
+    if (topTracked_ == 0 || !Higher(entry, top_.back())) {
+        if (Higher(entry, outside_)) outside_ = entry;
+        return;
+    }
+
+    if (Slot* evicted = Find(top_.back().key)) evicted->top = false;
+    if (Higher(top_.back(), outside_)) outside_ = top_.back();
+    top_.pop_back();
+    top_.insert(std::upper_bound(top_.begin(), top_.end(), entry, Higher), entry);
+    slot.top = true;
+}
+
+void ColorHistogram::RescanTop()
+{
+    std::vector<const Slot*> live;
+    live.reserve(live_);
+    for (Slot& s : slots_) {
+        s.top = false;
+        if (s.used && s.count > 0) live.push_back(&s);
+    }
+
+    // Sort one past the tracked entries: the first colour left out is the
+    // bound for everything outside.
+    const auto higher = [](const Slot* a, const Slot* b) {
+        return Higher({ a->key, a->count }, { b->key, b->count });
+    };
+    const std::size_t sorted = std::min(topTracked_ + 1, live.size());
+    std::partial_sort(live.begin(), live.begin() + static_cast<std::ptrdiff_t>(sorted), live.end(), higher);
+
+    const std::size_t tracked = std::min(topTracked_, live.size());
+    top_.clear();
+    for (std::size_t i = 0; i < tracked; ++i) {
+        top_.push_back({ live[i]->key, live[i]->count });
+        slots_[static_cast<std::size_t>(live[i] - slots_.data())].top = true;
+    }
+    outside_  = live.size() > tracked ? TopEntry{ live[tracked]->key, live[tracked]->count } : TopEntry{};
+    topStale_ = false;
+}
+
+bool ColorHistogram::TopCurrent(std::size_t n) const noexcept
+{
+    if (topStale_) return false;
+    const std::size_t m = std::min(n, top_.size());
+    if (m < n && outside_.count > 0) return false;   // some colour may be missing
+    return m == 0 || outside_.count == 0 || Higher(top_[m - 1], outside_);
+}
+
+// ============================================================
+// LayerHistogram
+// ============================================================
+
+void LayerHistogram::Reset()
+{
+    histogram_.Clear();
+    shadow_.clear();
+    counted_.reset();
+    valid_ = false;
+}
+
+void LayerHistogram::Rebuild(const Layer& layer, int width, int height)
+{
+    histogram_.Clear();
+    histogram_.AddPixels(layer.pixelData);
+    shadow_ = layer.pixelData;
+    counted_.reset();
+    width_  = width;
+    height_ = height;
+    valid_  = true;
+}
+
+void LayerHistogram::RebuildFromSource(const Layer& layer, int width, int height)
+{
+    histogram_.Clear();
+    const core::TileSource& source = *layer.source;
+    constexpr std::uint32_t T = core::ImageSurface::TileSize;
+    std::vector<Pixel> tile(static_cast<std::size_t>(T) * T);
+    for (std::uint32_t y = 0; y < source.Height(); y += T) {
+        for (std::uint32_t x = 0; x < source.Width(); x += T) {
+            const std::size_t count = static_cast<std::size_t>(std::min(T, source.Width() - x))
+                                    * std::min(T, source.Height() - y);
+            source.DecodeTile(layer.sourceLayer, x / T, y / T, tile);
+            histogram_.AddPixels(std::span<const Pixel>(tile.data(), count));
+        }
+    }
+    shadow_.clear();
+    counted_ = layer.source;
+    width_   = width;
+    height_  = height;
+    valid_   = true;
+}
+
+bool LayerHistogram::Sync(const Canvas& canvas)
+{
+    // A layer still pending in its project file is counted once it has
+    // been decoded; asking for it here would decode it on the UI thread.
+    // An imported image is already in memory and is counted in place.
+    if (canvas.ActiveLayerPending()) {
+        const Layer& pending = canvas.Layers()[static_cast<std::size_t>(canvas.ActiveLayerIndex())];
+        if (!pending.source->InMemory()) return false;
+        if (valid_ && counted_ == pending.source && layerIndex_ == canvas.ActiveLayerIndex()) return false;
+        layerIndex_ = canvas.ActiveLayerIndex();
+        layerZ_     = pending.zIndex;
+        revision_   = canvas.Revision();
+        RebuildFromSource(pending, canvas.Width(), canvas.Height());
+        return true;
+    }
+
+    const Layer* layer = canvas.ActiveLayer();
+    if (!layer) return false;
+
+    const int  width  = canvas.Width();
+    const int  height = canvas.Height();
+    const bool sameLayer = valid_
+                        && layerIndex_ == canvas.ActiveLayerIndex()
+                        && layerZ_     == layer->zIndex
+                        && width_      == width
+                        && height_     == height
+                        && shadow_.size() == layer->pixelData.size();
+
+    if (!sameLayer) {
+        layerIndex_ = canvas.ActiveLayerIndex();
+        layerZ_     = layer->zIndex;
+        revision_   = canvas.Revision();
+        Rebuild(*layer, width, height);
+        return true;
+    }
+
+    if (canvas.Revision() == revision_) return false;
+
+    canvas.CollectTilesChangedSince(revision_, changedTiles_);
+    revision_ = canvas.Revision();
+    if (changedTiles_.empty()) return false;
+
+    constexpr std::uint32_t T = core::ImageSurface::TileSize;
+    const auto tileRect = [&](std::pair<std::uint32_t, std::uint32_t> t) {
+        const int x0 = static_cast<int>(t.first  * T);
+        const int y0 = static_cast<int>(t.second * T);
+        return std::array<int, 4>{ x0, y0, std::min(x0 + static_cast<int>(T), width),
+                                           std::min(y0 + static_cast<int>(T), height) };
+    };
+
+    // Pass 1 (parallel): which of the flagged tiles really differ from the
+    // shadow?  A whole-canvas invalidation flags every tile, but usually
+    // only a few changed.
+    tileDiffers_.assign(changedTiles_.size(), 0);
+    core::ParallelFor(0, changedTiles_.size(), [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            const auto [x0, y0, x1, y1] = tileRect(changedTiles_[i]);
+            for (int y = y0; y < y1; ++y) {
+                const std::size_t row = static_cast<std::size_t>(y) * width + x0;
+                if (std::memcmp(layer->pixelData.data() + row, shadow_.data() + row,
+                                static_cast<std::size_t>(x1 - x0) * sizeof(Pixel)) != 0) {
+                    tileDiffers_[i] = 1;
+                    break;
+                }
+            }
+        }
+    }, 16);
+
+    // Pass 2 (serial): move counts from old to new colours and refresh the shadow.
+    bool changed = false;
+    for (std::size_t i = 0; i < changedTiles_.size(); ++i) {
+        if (!tileDiffers_[i]) continue;
+        const auto [x0, y0, x1, y1] = tileRect(changedTiles_[i]);
+        for (int y = y0; y < y1; ++y) {
+            const std::size_t row = static_cast<std::size_t>(y) * width;
+            for (int x = x0; x < x1; ++x) {
+                const Pixel& now = layer->pixelData[row + x];
+                Pixel&       was = shadow_[row + x];
+                if (now == was) continue;
+                histogram_.Remove(was);
+                histogram_.Add(now);
+                was     = now;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+} // namespace pelpaint::tools
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../core/Canvas.hpp"
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// ColorHistogram
+//
+// Colour → pixel count, stored in a flat open-addressing table (linear
+// probing, power-of-two capacity).  Counts may drop to zero; such slots are
+// skipped by queries and reclaimed on the next rehash.
+//
+// The most frequent colours (twice the largest n TopN() was asked for) are
+// kept in a sorted array as counts change, with a flag in their slots, and
+// a bound on everything else.  A count change outside them costs a compare
+// with the last entry.  The table is only rescanned when the n-th entry no
+// longer outranks the bound, which the spare entries make rare, or after a
+// bulk AddPixels().
+// ---------------------------------------------------------------------------
+
+class ColorHistogram {
+public:
+    void Clear();
+
+    void Add   (const Pixel& color) { Adjust(Pack(color), +1); }
+    void Remove(const Pixel& color) { Adjust(Pack(color), -1); }
+    void AddPixels(std::span<const Pixel> pixels);
+
+    [[nodiscard]] std::size_t DistinctColors() const noexcept { return live_; }
+
+    // Up to n most frequent colours, highest count first (ties: lower
+    // packed RGBA first).  O(n) while the tracked colours cover the top n;
+    // a rescan (O(distinct colours)) otherwise.
+    void TopN(std::size_t n, std::vector<Pixel>& out);
+
+    // Every colour with a non-zero count, with its count.
+    void Entries(std::vector<std::pair<Pixel, std::uint32_t>>& out) const;
+
+private:
+    struct Slot {
+        std::uint32_t key   = 0;
+        std::uint32_t count = 0;
+        bool          used  = false;
+        bool          top   = false;   // in top_
+    };
+
+    struct TopEntry {
+        std::uint32_t key   = 0;
+        std::uint32_t count = 0;
+    };
+
+    // Ranking order of TopN().
+    [[nodiscard]] static bool Higher(const TopEntry& a, const TopEntry& b) noexcept {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    }
+
+    [[nodiscard]] static std::uint32_t Pack(const Pixel& c) noexcept {
+        return (static_cast<std::uint32_t>(c.r) << 24) | (static_cast<std::uint32_t>(c.g) << 16) |
+               (static_cast<std::uint32_t>(c.b) << 8)  |  static_cast<std::uint32_t>(c.a);
+    }
+    [[nodiscard]] static Pixel Unpack(std::uint32_t key) noexcept {
+        return Pixel(static_cast<std::uint8_t>(key >> 24), static_cast<std::uint8_t>(key >> 16),
+                     static_cast<std::uint8_t>(key >> 8),  static_cast<std::uint8_t>(key));
+    }
+
+    void Adjust(std::uint32_t key, int delta);
+    void Rehash(std::size_t capacity);
+    [[nodiscard]] Slot* Find(std::uint32_t key) noexcept;
+
+    // Follow one count change in top_.
+    void UpdateTop(Slot& slot);
+    void RescanTop();
+    [[nodiscard]] bool TopCurrent(std::size_t n) const noexcept;
+
+    std::vector<Slot> slots_;
+    std::size_t       used_ = 0;   // occupied slots, including zero counts
+    std::size_t       live_ = 0;   // slots with count > 0
+
+    // Up to topTracked_ colours, best first.  Unless topStale_, no colour
+    // outside top_ outranks outside_ (count 0: there is none).
+    std::vector<TopEntry> top_;
+    std::size_t           topTracked_ = 0;
+    TopEntry              outside_;
+    bool                  topStale_   = true;
+};
+
+// ---------------------------------------------------------------------------
+// LayerHistogram
+//
+// Keeps a ColorHistogram in step with the canvas' active pixel layer.
+// Sync() asks the Canvas which tiles changed since the last call and diffs
+// only those against a shadow copy of the layer, so an idle frame costs a
+// revision compare and a brush stroke costs a few 64×64 tiles.  Selecting a
+// different layer (or resizing) triggers one full rebuild.  A layer pending
+// on an in-memory source (an imported image) is counted from its tiles, with
+// no shadow, and rebuilt from its pixels once it has been materialized.
+// ---------------------------------------------------------------------------
+
+class LayerHistogram {
+public:
+    // Returns true when the histogram changed.
+    bool Sync(const Canvas& canvas);
+
+    void Reset();
+
+    [[nodiscard]] const ColorHistogram& Histogram() const noexcept { return histogram_; }
+
+    // See ColorHistogram::TopN.
+    void TopN(std::size_t n, std::vector<Pixel>& out) { histogram_.TopN(n, out); }
+
+private:
+    void Rebuild(const Layer& layer, int width, int height);
+    void RebuildFromSource(const Layer& layer, int width, int height);
+
+    ColorHistogram     histogram_;
+    std::vector<Pixel> shadow_;               // layer pixels as last counted
+    std::shared_ptr<const core::TileSource> counted_;   // pending layer counted from its source
+    int                layerIndex_ = -1;
+    int                layerZ_     = 0;
+    int                width_      = 0;
+    int                height_     = 0;
+    std::uint64_t      revision_   = 0;
+    bool               valid_      = false;
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> changedTiles_;
+    std::vector<std::uint8_t>                            tileDiffers_;
+};
+
+} // namespace pelpaint::tools
@@ -0,0 +1,141 @@
+#include "ColorMatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace pelpaint::tools {
+
+namespace {
+
+constexpr int kCubeSize = 33;   // grid points per axis (32 cells)
+
+[[nodiscard]] float SrgbToLinear(float c) noexcept
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+[[nodiscard]] OklabColor LinearToOklab(float r, float g, float b) noexcept
+{
+    const float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    const float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    const float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+    return { 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+             1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+             0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s };
+}
+
+[[nodiscard]] const std::array<float, 256>& LinearTable()
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; ++i) t[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+        return t;
+    }();
+    return table;
+}
+
+[[nodiscard]] const std::vector<OklabColor>& Cube()
+{
+    static const std::vector<OklabColor> cube = [] {
+        std::vector<OklabColor> c(static_cast<std::size_t>(kCubeSize) * kCubeSize * kCubeSize);
+        std::array<float, kCubeSize> axis{};
+        for (int i = 0; i < kCubeSize; ++i)
+            axis[i] = SrgbToLinear(static_cast<float>(i) / static_cast<float>(kCubeSize - 1));
+        std::size_t n = 0;
+        for (int r = 0; r < kCubeSize; ++r)
+            for (int g = 0; g < kCubeSize; ++g)
+                for (int b = 0; b < kCubeSize; ++b)
+                    c[n++] = LinearToOklab(axis[r], axis[g], axis[b]);
+        return c;
+    }();
+    return cube;
+}
+
+} // namespace
+
+// ============================================================
+// Conversion
+// ============================================================
+
+OklabColor ToOklab(const Pixel& color) noexcept
+{
+    const auto& linear = LinearTable();
+    return LinearToOklab(linear[color.r], linear[color.g], linear[color.b]);
+}
+
+OklabColor ToOklabFast(const Pixel& color) noexcept
+{
+    if ((color.r | color.g | color.b) < 16) return ToOklab(color);
+
+    const auto& cube = Cube();
+
+    constexpr float kScale = static_cast<float>(kCubeSize - 1) / 255.0f;
+    const auto cell = [](std::uint8_t v, int& index, float& t) {
+        const float f = static_cast<float>(v) * kScale;
+        index = std::min(static_cast<int>(f), kCubeSize - 2);
+        t     = f - static_cast<float>(index);
+    };
+    int   ir, ig, ib;
+    float tr, tg, tb;
+    cell(color.r, ir, tr);
+    cell(color.g, ig, tg);
+    cell(color.b, ib, tb);
+
+    const auto at = [&](int dr, int dg, int db) -> const OklabColor& {
+        return cube[(static_cast<std::size_t>(ir + dr) * kCubeSize + (ig + dg)) * kCubeSize + (ib + db)];
+    };
+    const auto lerp = [](const OklabColor& p, const OklabColor& q, float t) {
+        return OklabColor{ p.L + (q.L - p.L) * t, p.a + (q.a - p.a) * t, p.b + (q.b - p.b) * t };
+    };
+
+    const OklabColor c00 = lerp(at(0, 0, 0), at(0, 0, 1), tb);
+    const OklabColor c01 = lerp(at(0, 1, 0), at(0, 1, 1), tb);
+    const OklabColor c10 = lerp(at(1, 0, 0), at(1, 0, 1), tb);
+    const OklabColor c11 = lerp(at(1, 1, 0), at(1, 1, 1), tb);
+    return lerp(lerp(c00, c01, tg), lerp(c10, c11, tg), tr);
+}
+
+// ============================================================
+// PaletteMatcher
+// ============================================================
+
+PaletteMatcher::PaletteMatcher(std::span<const Pixel> palette, ColorMatchMode mode)
+    : palette_(palette)
+    , mode_(mode)
+{
+    if (mode_ != ColorMatchMode::Oklab) return;
+
+    lab_.reserve(palette_.size());
+    for (const Pixel& p : palette_) {
+        const OklabColor lab = ToOklab(p);
+        lab_.push_back({ lab.L, lab.a, lab.b, static_cast<float>(p.a) / 255.0f });
+    }
+}
+
+Pixel PaletteMatcher::NearestOklab(const Pixel& color) const noexcept
+{
+    if (lab_.empty()) return color;
+
+    const OklabColor c     = ToOklabFast(color);
+    const float      alpha = static_cast<float>(color.a) / 255.0f;
+
+    std::size_t nearest = 0;
+    float       minDist = std::numeric_limits<float>::max();
+    for (std::size_t i = 0; i < lab_.size(); ++i) {
+        const auto& e  = lab_[i];
+        const float dL = c.L - e[0];
+        const float da = c.a - e[1];
+        const float db = c.b - e[2];
+        const float dA = alpha - e[3];
+        const float d  = dL * dL + da * da + db * db + dA * dA;
+        if (d < minDist) {
+            minDist = d;
+            nearest = i;
+        }
+    }
+    return palette_[nearest];
+}
+
+} // namespace pelpaint::tools
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "Filters.hpp"
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// OKLab conversion
+//
+// ToOklab is exact: sRGB → linear through a 256-entry table, then the OKLab
+// LMS matrix, cube root and output matrix.
+//
+// ToOklabFast trilinearly interpolates a 33³ cube of exact samples taken on
+// the sRGB grid (built once, shared).  Near black the cube root is too steep
+// to interpolate, so colours with every channel below 16 take the exact
+// path.  Worst-case error is about 0.008 ΔE_ok — under a just-noticeable
+// difference — and the pixel loop has no pow/cbrt calls.
+// ---------------------------------------------------------------------------
+
+struct OklabColor {
+    float L = 0.0f;
+    float a = 0.0f;
+    float b = 0.0f;
+};
+
+[[nodiscard]] OklabColor ToOklab(const Pixel& color) noexcept;
+[[nodiscard]] OklabColor ToOklabFast(const Pixel& color) noexcept;
+
+// ---------------------------------------------------------------------------
+// PaletteMatcher
+//
+// Nearest-palette-entry lookup under a ColorMatchMode.  Rgb forwards to
+// FindNearestColor unchanged.  Oklab converts the palette once at
+// construction and each query once through ToOklabFast; alpha is compared
+// on the same 0..1 scale as L.
+//
+// The palette is NOT copied — it must outlive the matcher.
+// ---------------------------------------------------------------------------
+
+class PaletteMatcher {
+public:
+    PaletteMatcher(std::span<const Pixel> palette, ColorMatchMode mode);
+
+    [[nodiscard]] Pixel Nearest(const Pixel& color) const noexcept {
+        return mode_ == ColorMatchMode::Rgb ? FindNearestColor(color, palette_)
+                                            : NearestOklab(color);
+    }
+
+    [[nodiscard]] std::span<const Pixel> Palette() const noexcept { return palette_; }
+    [[nodiscard]] ColorMatchMode         Mode()    const noexcept { return mode_; }
+
+private:
+    [[nodiscard]] Pixel NearestOklab(const Pixel& color) const noexcept;
+
+    std::span<const Pixel>            palette_;
+    ColorMatchMode                    mode_;
+    std::vector<std::array<float, 4>> lab_;    // L, a, b, alpha/255 per entry
+};
+
+} // namespace pelpaint::tools
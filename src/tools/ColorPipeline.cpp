@@ -0,0 +1,301 @@
+#include "ColorPipeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "ColorMatch.hpp"
+#include "../core/Parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PELPAINT_PIPELINE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define PELPAINT_PIPELINE_NEON 1
+#endif
+
+namespace pelpaint::tools {
+
+static_assert(sizeof(Pixel) == 4, "the SIMD paths treat a pixel as 4 packed bytes");
+
+namespace {
+
+// Pixels per inner chunk: every stage runs over one chunk before the next
+// is touched, so the chunk stays in L1 and the buffer is streamed once.
+constexpr std::size_t kChunk = 1024;
+
+[[nodiscard]] bool Cancelled(const std::atomic<bool>* cancel) noexcept
+{
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::uint8_t ClampByte(float v) noexcept
+{
+    return static_cast<std::uint8_t>(std::clamp(std::lround(v), 0L, 255L));
+}
+
+// Direct-mapped cache of nearest-palette results, one per band.
+class PaletteCache {
+public:
+    PaletteCache() { keys_.fill(kEmpty); }
+
+    [[nodiscard]] Pixel Lookup(const Pixel& color, const PaletteMatcher& matcher) noexcept
+    {
+        const std::uint32_t key = static_cast<std::uint32_t>(color.r)
+                                | static_cast<std::uint32_t>(color.g) << 8
+                                | static_cast<std::uint32_t>(color.b) << 16
+                                | static_cast<std::uint32_t>(color.a) << 24;
+        const std::size_t slot = (key * 2654435761u) >> (32 - kBits);
+        if (keys_[slot] != key) {
+            keys_[slot]   = key;
+            values_[slot] = matcher.Nearest(color);
+        }
+        return values_[slot];
+    }
+
+private:
+    static constexpr int           kBits  = 10;
+    static constexpr std::uint64_t kEmpty = std::numeric_limits<std::uint64_t>::max();
+
+    std::array<std::uint64_t, std::size_t{1} << kBits> keys_;
+    std::array<Pixel,         std::size_t{1} << kBits> values_;
+};
+
+// r, g and b through `rgb`, a through `alpha`.  NEON looks up 16 pixels
+// per step in four 64-byte tables; SSE2 has no byte shuffle to index a
+// table with, so x86 stays scalar.
+void ApplyLut(Pixel* pixels, std::size_t n, const std::array<std::uint8_t, 256>& rgb,
+              const std::array<std::uint8_t, 256>& alpha) noexcept
+{
+    std::size_t i = 0;
+#if defined(PELPAINT_PIPELINE_NEON)
+    const auto load = [](const std::array<std::uint8_t, 256>& lut, uint8x16x4_t (&table)[4]) {
+        for (int t = 0; t < 4; ++t)
+            for (int k = 0; k < 4; ++k) table[t].val[k] = vld1q_u8(lut.data() + t * 64 + k * 16);
+    };
+    const auto lookup = [](const uint8x16x4_t (&table)[4], uint8x16_t index) {
+        // Indices past a table's 64 entries leave the lane as it is.
+        const uint8x16_t k64 = vdupq_n_u8(64);
+        uint8x16_t out = vqtbl4q_u8(table[0], index);
+        index = vsubq_u8(index, k64);
+        out   = vqtbx4q_u8(out, table[1], index);
+        index = vsubq_u8(index, k64);
+        out   = vqtbx4q_u8(out, table[2], index);
+        index = vsubq_u8(index, k64);
+        return vqtbx4q_u8(out, table[3], index);
+    };
+    uint8x16x4_t rgbTable[4], alphaTable[4];
+    load(rgb, rgbTable);
+    load(alpha, alphaTable);
+
+    std::uint8_t* bytes = reinterpret_cast<std::uint8_t*>(pixels);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x4_t p = vld4q_u8(bytes + i * 4);
+        p.val[0] = lookup(rgbTable, p.val[0]);
+        p.val[1] = lookup(rgbTable, p.val[1]);
+        p.val[2] = lookup(rgbTable, p.val[2]);
+        p.val[3] = lookup(alphaTable, p.val[3]);
+        vst4q_u8(bytes + i * 4, p);
+    }
+#endif
+    for (; i < n; ++i) {
+        Pixel& p = pixels[i];
+        p.r = rgb[p.r];
+        p.g = rgb[p.g];
+        p.b = rgb[p.b];
+        p.a = alpha[p.a];
+    }
+}
+
+// Rec.601 luma in 16-bit fixed point (weights sum to 65536), rounded, into
+// r, g and b.  SSE2 4 pixels per step, NEON 8; both give the scalar bytes.
+void ApplyGrayscale(Pixel* pixels, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+#if defined(PELPAINT_PIPELINE_SSE2)
+    // madd takes signed 16-bit weights, and 38470 is not one: g sits in
+    // place of a as well, with half the weight in each slot.
+    const __m128i weights   = _mm_setr_epi16(19595, 19235, 7471, 19235, 19595, 19235, 7471, 19235);
+    const __m128i half      = _mm_set1_epi32(32768);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i zero      = _mm_setzero_si128();
+    const auto sums = [&](__m128i words) {
+        // Per pixel: [19595 r + 19235 g, 7471 b + 19235 g], added into the low lane.
+        words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, _MM_SHUFFLE(1, 2, 1, 0)), _MM_SHUFFLE(1, 2, 1, 0));
+        const __m128i pairs = _mm_madd_epi16(words, weights);
+        return _mm_shuffle_epi32(_mm_add_epi32(pairs, _mm_srli_epi64(pairs, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+    };
+    for (; i + 4 <= n; i += 4) {
+        const __m128i p    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+        const __m128i luma = _mm_unpacklo_epi64(sums(_mm_unpacklo_epi8(p, zero)), sums(_mm_unpackhi_epi8(p, zero)));
+        const __m128i gray = _mm_srli_epi32(_mm_add_epi32(luma, half), 16);
+        const __m128i rgb  = _mm_or_si128(_mm_or_si128(gray, _mm_slli_epi32(gray, 8)), _mm_slli_epi32(gray, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_or_si128(_mm_and_si128(p, alphaMask), rgb));
+    }
+#elif defined(PELPAINT_PIPELINE_NEON)
+    const auto luma = [](uint16x4_t r, uint16x4_t g, uint16x4_t b) {
+        return vrshrn_n_u32(vmlal_n_u16(vmlal_n_u16(vmull_n_u16(r, 19595), g, 38470), b, 7471), 16);
+    };
+    std::uint8_t* bytes = reinterpret_cast<std::uint8_t*>(pixels);
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x4_t p = vld4_u8(bytes + i * 4);
+        const uint16x8_t r = vmovl_u8(p.val[0]), g = vmovl_u8(p.val[1]), b = vmovl_u8(p.val[2]);
+        const uint8x8_t  gray = vmovn_u16(vcombine_u16(
+            luma(vget_low_u16(r),  vget_low_u16(g),  vget_low_u16(b)),
+            luma(vget_high_u16(r), vget_high_u16(g), vget_high_u16(b))));
+        p.val[0] = p.val[1] = p.val[2] = gray;
+        vst4_u8(bytes + i * 4, p);
+    }
+#endif
+    for (; i < n; ++i) {
+        Pixel& p = pixels[i];
+        const std::uint32_t gray = (19595u * p.r + 38470u * p.g + 7471u * p.b + 32768u) >> 16;
+        p.r = p.g = p.b = static_cast<std::uint8_t>(gray);
+    }
+}
+
+} // namespace
+
+// ============================================================
+// Building
+// ============================================================
+
+ColorPipeline::Stage& ColorPipeline::LutStage()
+{
+    if (stages_.empty() || stages_.back().kind != StageKind::Lut) {
+        Stage stage;
+        stage.kind = StageKind::Lut;
+        for (int i = 0; i < 256; ++i) {
+            stage.rgb[i]   = static_cast<std::uint8_t>(i);
+            stage.alpha[i] = static_cast<std::uint8_t>(i);
+        }
+        stages_.push_back(std::move(stage));
+    }
+    return stages_.back();
+}
+
+ColorPipeline& ColorPipeline::Levels(int inBlack, int inWhite, float gamma,
+                                     int outBlack, int outWhite)
+{
+    inBlack  = std::clamp(inBlack,  0, 254);
+    inWhite  = std::clamp(inWhite,  inBlack + 1, 255);
+    outBlack = std::clamp(outBlack, 0, 255);
+    outWhite = std::clamp(outWhite, 0, 255);
+    const float invGamma = 1.0f / std::max(gamma, 0.01f);
+
+    Lut curve{};
+    for (int v = 0; v < 256; ++v) {
+        const float t = std::clamp(static_cast<float>(v - inBlack) /
+                                   static_cast<float>(inWhite - inBlack), 0.0f, 1.0f);
+        curve[v] = ClampByte(static_cast<float>(outBlack) +
+                             static_cast<float>(outWhite - outBlack) * std::pow(t, invGamma));
+    }
+
+    Stage& stage = LutStage();
+    for (auto& v : stage.rgb) v = curve[v];
+    return *this;
+}
+
+ColorPipeline& ColorPipeline::Grayscale()
+{
+    Stage stage;
+    stage.kind = StageKind::Grayscale;
+    stages_.push_back(std::move(stage));
+    return *this;
+}
+
+ColorPipeline& ColorPipeline::Posterize(int levels)
+{
+    levels = std::clamp(levels, 2, 256);
+    const float step = 255.0f / static_cast<float>(levels - 1);
+
+    Stage& stage = LutStage();
+    for (auto& v : stage.rgb) v = ClampByte(std::round(static_cast<float>(v) / step) * step);
+    return *this;
+}
+
+ColorPipeline& ColorPipeline::PaletteMap(std::span<const Pixel> palette, ColorMatchMode match)
+{
+    if (palette.empty()) return *this;
+
+    Stage stage;
+    stage.kind = StageKind::Palette;
+    stage.palette.assign(palette.begin(), palette.end());
+    stage.match = match;
+    stages_.push_back(std::move(stage));
+    return *this;
+}
+
+ColorPipeline& ColorPipeline::AlphaThreshold(int threshold)
+{
+    Stage& stage = LutStage();
+    for (auto& a : stage.alpha) a = (a >= threshold) ? 255 : 0;
+    return *this;
+}
+
+ColorPipeline& ColorPipeline::Opacity(float opacity)
+{
+    opacity = std::clamp(opacity, 0.0f, 1.0f);
+
+    Stage& stage = LutStage();
+    for (auto& a : stage.alpha) a = ClampByte(static_cast<float>(a) * opacity);
+    return *this;
+}
+
+// ============================================================
+// Execution
+// ============================================================
+
+void ColorPipeline::Apply(std::span<Pixel> pixels, const std::atomic<bool>* cancel) const
+{
+    if (stages_.empty() || pixels.empty()) return;
+
+    // One matcher per palette stage, shared read-only by every band (the
+    // OKLab palette conversion happens once here, not per band).
+    std::vector<std::unique_ptr<PaletteMatcher>> matchers;
+    bool hasPalette = false;
+    for (const Stage& s : stages_) {
+        matchers.push_back(s.kind == StageKind::Palette
+                           ? std::make_unique<PaletteMatcher>(s.palette, s.match) : nullptr);
+        hasPalette = hasPalette || s.kind == StageKind::Palette;
+    }
+
+    core::ParallelFor(0, pixels.size(), [&](std::size_t lo, std::size_t hi) {
+        // Each palette stage gets its own cache, private to this band.
+        std::vector<std::unique_ptr<PaletteCache>> caches;
+        if (hasPalette) {
+            for (const Stage& s : stages_)
+                caches.push_back(s.kind == StageKind::Palette ? std::make_unique<PaletteCache>() : nullptr);
+        }
+
+        for (std::size_t c0 = lo; c0 < hi; c0 += kChunk) {
+            if (Cancelled(cancel)) return;
+            Pixel* const      chunk = pixels.data() + c0;
+            const std::size_t n     = std::min(kChunk, hi - c0);
+
+            for (std::size_t si = 0; si < stages_.size(); ++si) {
+                const Stage& stage = stages_[si];
+                switch (stage.kind) {
+                    case StageKind::Lut:
+                        ApplyLut(chunk, n, stage.rgb, stage.alpha);
+                        break;
+
+                    case StageKind::Grayscale:
+                        ApplyGrayscale(chunk, n);
+                        break;
+
+                    case StageKind::Palette: {
+                        PaletteCache& cache = *caches[si];
+                        for (std::size_t i = 0; i < n; ++i)
+                            chunk[i] = cache.Lookup(chunk[i], *matchers[si]);
+                        break;
+                    }
+                }
+            }
+        }
+    }, 1u << 14);
+}
+
+} // namespace pelpaint::tools
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// ColorPipeline
+//
+// Composes per-pixel colour operations and executes them in ONE pass over
+// the buffer, split into bands across worker threads.
+//   • Levels, posterize, opacity and alpha threshold fold into per-channel
+//     256-entry lookup tables at build time — any run of them costs one
+//     table lookup per channel, no floating point in the pixel loop.
+//     The lookups run 16 pixels at a time on NEON; x86 has no byte
+//     shuffle in SSE2 and looks up one channel at a time.
+//   • Grayscale is a fixed-point Rec.601 luma mix (rounded), SSE2 or NEON.
+//   • Palette mapping keeps a small per-band cache of recent colours, so
+//     pixel art with few distinct colours rarely reaches the palette search.
+//   • Stages run in the order they were added.
+//
+//   tools::ColorPipeline()
+//       .Levels(16, 240)
+//       .Grayscale()
+//       .Posterize(4)
+//       .Apply(layer.pixelData);
+// ---------------------------------------------------------------------------
+
+class ColorPipeline {
+public:
+    // Remap [inBlack, inWhite] to [outBlack, outWhite] on RGB with a gamma
+    // curve (gamma > 1 brightens midtones).
+    ColorPipeline& Levels(int inBlack, int inWhite, float gamma = 1.0f,
+                          int outBlack = 0, int outWhite = 255);
+
+    ColorPipeline& Grayscale();
+
+    // Quantise each RGB channel to `levels` evenly spaced values (2..256).
+    ColorPipeline& Posterize(int levels);
+
+    // Snap to the nearest palette entry under the given metric (see
+    // PaletteMatcher).  The palette is copied.  An empty palette adds no stage.
+    ColorPipeline& PaletteMap(std::span<const Pixel> palette,
+                              ColorMatchMode match = ColorMatchMode::Rgb);
+
+    // Alpha below threshold becomes 0, everything else 255.
+    ColorPipeline& AlphaThreshold(int threshold);
+
+    // Scale alpha by opacity (0..1).
+    ColorPipeline& Opacity(float opacity);
+
+    [[nodiscard]] bool        Empty()      const noexcept { return stages_.empty(); }
+    [[nodiscard]] std::size_t StageCount() const noexcept { return stages_.size(); }
+
+    // Run every stage over pixels in place.  cancel is polled between bands.
+    void Apply(std::span<Pixel> pixels, const std::atomic<bool>* cancel = nullptr) const;
+
+private:
+    using Lut = std::array<std::uint8_t, 256>;
+
+    enum class StageKind { Lut, Grayscale, Palette };
+
+    struct Stage {
+        StageKind          kind = StageKind::Lut;
+        Lut                rgb{};      // Lut: applied to r, g and b
+        Lut                alpha{};    // Lut: applied to a
+        std::vector<Pixel> palette;    // Palette
+        ColorMatchMode     match = ColorMatchMode::Rgb;
+    };
+
+    // The trailing Lut stage, appended (identity) if the last stage is not one.
+    Stage& LutStage();
+
+    std::vector<Stage> stages_;
+};
+
+} // namespace pelpaint::tools
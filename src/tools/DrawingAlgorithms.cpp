@@ -28,7 +28,7 @@ void BlendPixel(Pixel& dst, const Pixel& src) noexcept
 // ============================================================
 // Internal: write one pixel directly into the layer span.
 // Performs bounds check, selection check, then BlendPixel.
-// Marks the canvas dirty so the per-frame composite fires.
+// Marks the pixel's composite tile dirty so the per-frame composite fires.
 // ============================================================
 
 static void WritePixel(DrawCtx& ctx,
@@ -42,7 +42,7 @@ static void WritePixel(DrawCtx& ctx,
     const std::size_t idx = static_cast<std::size_t>(
         ctx.canvas.PixelIndex(x, y));
     BlendPixel(span[idx], color);
-    ctx.canvas.SetDirty();
+    ctx.canvas.MarkDirty(x, y);
 }
 
 // ============================================================
@@ -184,7 +184,7 @@ void FloodFill(DrawCtx& ctx,
             cur.b != targetColor.b || cur.a != targetColor.a) continue;
 
         BlendPixel(span[idx], fillColor);
-        ctx.canvas.SetDirty();
+        ctx.canvas.MarkDirty(cx, cy);
 
         // Enqueue 4-connected neighbours.
         constexpr int nx[4] = { 1, -1,  0,  0 };
@@ -239,7 +239,7 @@ void FloodFillThreshold(DrawCtx& ctx,
         const std::size_t idx = static_cast<std::size_t>(
             ctx.canvas.PixelIndex(cx, cy));
         BlendPixel(span[idx], fillColor);
-        ctx.canvas.SetDirty();
+        ctx.canvas.MarkDirty(cx, cy);
 
         constexpr int nx[4] = { 1, -1,  0,  0 };
         constexpr int ny[4] = { 0,  0,  1, -1 };
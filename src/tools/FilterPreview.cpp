@@ -0,0 +1,160 @@
+#include "FilterPreview.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::tools {
+
+// ============================================================
+// Proxy construction
+// ============================================================
+
+void BuildPreviewProxy(std::span<const Pixel> src, int width, int height,
+                       int regionX, int regionY, int regionW, int regionH,
+                       int maxW, int maxH, PreviewImage& out)
+{
+    out.pixels.clear();
+    out.width   = 0;
+    out.height  = 0;
+    out.sourceX = 0;
+    out.sourceY = 0;
+    out.sourceW = 0;
+    out.sourceH = 0;
+
+    if (width <= 0 || height <= 0 || maxW <= 0 || maxH <= 0) return;
+    if (src.size() < static_cast<std::size_t>(width) * height) return;
+
+    const int x0 = std::clamp(regionX, 0, width);
+    const int y0 = std::clamp(regionY, 0, height);
+    const int rw = std::clamp(regionX + regionW, 0, width)  - x0;
+    const int rh = std::clamp(regionY + regionH, 0, height) - y0;
+    if (rw <= 0 || rh <= 0) return;
+
+    const float scale = std::min({ 1.0f,
+                                   static_cast<float>(maxW) / static_cast<float>(rw),
+                                   static_cast<float>(maxH) / static_cast<float>(rh) });
+
+    out.width   = std::max(1, static_cast<int>(static_cast<float>(rw) * scale));
+    out.height  = std::max(1, static_cast<int>(static_cast<float>(rh) * scale));
+    out.sourceX = x0;
+    out.sourceY = y0;
+    out.sourceW = rw;
+    out.sourceH = rh;
+    out.pixels.resize(static_cast<std::size_t>(out.width) * out.height);
+
+    // Precompute source columns once; rows are looked up per output row.
+    std::vector<int> srcX(static_cast<std::size_t>(out.width));
+    for (int x = 0; x < out.width; ++x) {
+        srcX[x] = x0 + std::min(rw - 1,
+                                static_cast<int>((static_cast<std::int64_t>(x) * rw) / out.width));
+    }
+
+    core::ParallelFor(0, static_cast<std::size_t>(out.height), [&](std::size_t py0, std::size_t py1) {
+        for (std::size_t y = py0; y < py1; ++y) {
+            const int sy = y0 + std::min(rh - 1,
+                                         static_cast<int>((static_cast<std::int64_t>(y) * rh) / out.height));
+            const Pixel* srcRow = src.data() + static_cast<std::size_t>(sy) * width;
+            Pixel*       dstRow = out.pixels.data() + y * static_cast<std::size_t>(out.width);
+            for (int x = 0; x < out.width; ++x) dstRow[x] = srcRow[srcX[x]];
+        }
+    }, 32);
+}
+
+// ============================================================
+// FilterPreviewWorker
+// ============================================================
+
+FilterPreviewWorker::~FilterPreviewWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        pending_.reset();
+        cancel_.store(true);
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::uint64_t FilterPreviewWorker::Submit(PreviewImage proxy, FilterFn fn)
+{
+    if (!EnsureThread()) {
+        proxy.serial = ++nextSerial_;
+        if (fn && proxy.valid()) fn(proxy.pixels, proxy.width, proxy.height, nullptr);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_ = std::move(proxy);
+        return nextSerial_;
+    }
+
+    std::uint64_t serial = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        serial       = ++nextSerial_;
+        proxy.serial = serial;
+        pending_     = Job{ std::move(proxy), std::move(fn) };
+        cancel_.store(true);    // abort whatever is running now
+    }
+    cv_.notify_one();
+    return serial;
+}
+
+void FilterPreviewWorker::Cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.reset();
+    ready_.reset();
+    cancel_.store(true);
+}
+
+bool FilterPreviewWorker::TakeResult(PreviewImage& out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready_) return false;
+    out = std::move(*ready_);
+    ready_.reset();
+    return true;
+}
+
+bool FilterPreviewWorker::EnsureThread()
+{
+    if constexpr (!core::ThreadsAvailable) return false;
+    if (thread_.joinable()) return true;
+    try {
+        thread_ = std::thread([this] { Run(); });
+    } catch (const std::system_error&) {
+        return false;   // Submit() filters inline
+    }
+    return true;
+}
+
+void FilterPreviewWorker::Run()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return quit_ || pending_.has_value(); });
+            if (quit_) return;
+            job = std::move(*pending_);
+            pending_.reset();
+            cancel_.store(false);
+            busy_.store(true, std::memory_order_relaxed);
+        }
+
+        if (job.fn && job.image.valid()) {
+            job.fn(job.image.pixels, job.image.width, job.image.height, &cancel_);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_.store(false, std::memory_order_relaxed);
+        // A newer Submit() or Cancel() arrived while we were working —
+        // the result is stale, drop it.
+        if (!cancel_.load() && !pending_) {
+            ready_ = std::move(job.image);
+        }
+    }
+}
+
+} // namespace pelpaint::tools
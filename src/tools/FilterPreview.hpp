@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// PreviewImage — a small RGBA buffer (downsampled proxy of part of a layer,
+// or the filtered result of one).  serial identifies the Submit() it came
+// from; source* is the part of the layer it covers, in layer pixels.
+// ---------------------------------------------------------------------------
+
+struct PreviewImage {
+    std::vector<Pixel> pixels;
+    int                width   = 0;
+    int                height  = 0;
+    std::uint64_t      serial  = 0;
+    int                sourceX = 0;
+    int                sourceY = 0;
+    int                sourceW = 0;
+    int                sourceH = 0;
+
+    [[nodiscard]] bool valid() const noexcept {
+        return width > 0 && height > 0 &&
+               pixels.size() == static_cast<std::size_t>(width) * height;
+    }
+};
+
+// Nearest-neighbour downsample of the regionW × regionH part at (regionX,
+// regionY) of a width × height layer into at most maxW × maxH pixels,
+// preserving aspect ratio.  Never upsamples.  The region is clipped to the
+// layer.  Reads only proxy-sized samples, so it is cheap on the UI thread.
+void BuildPreviewProxy(std::span<const Pixel> src, int width, int height,
+                       int regionX, int regionY, int regionW, int regionH,
+                       int maxW, int maxH, PreviewImage& out);
+
+// ---------------------------------------------------------------------------
+// FilterPreviewWorker
+//
+// Runs one filter at a time on a background thread.
+//   • Submit() replaces any queued job and cancels the running one — the
+//     latest slider value always wins, stale work is abandoned mid-pass.
+//   • TakeResult() is non-blocking; call it once per frame and upload the
+//     returned image as the overlay texture.
+//   • Builds without thread support, or where the worker thread cannot be
+//     started, run the job synchronously in Submit().
+//
+// The filter callback receives the proxy buffer and a cancel flag to poll
+// (see tools/Filters.hpp — every kernel accepts it directly).
+// ---------------------------------------------------------------------------
+
+class FilterPreviewWorker {
+public:
+    using FilterFn = std::function<void(std::span<Pixel> pixels,
+                                        int width, int height,
+                                        const std::atomic<bool>* cancel)>;
+
+    FilterPreviewWorker() = default;
+    ~FilterPreviewWorker();
+
+    FilterPreviewWorker(const FilterPreviewWorker&)            = delete;
+    FilterPreviewWorker& operator=(const FilterPreviewWorker&) = delete;
+
+    // Queue proxy for processing by fn; returns the serial assigned to it.
+    std::uint64_t Submit(PreviewImage proxy, FilterFn fn);
+
+    // Drop the queued job, abort the running one and discard any result
+    // that has not been taken yet.
+    void Cancel();
+
+    // Move the newest finished result into out.  Returns false if nothing
+    // new has completed since the last call.
+    [[nodiscard]] bool TakeResult(PreviewImage& out);
+
+    [[nodiscard]] bool Busy() const noexcept { return busy_.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        PreviewImage image;
+        FilterFn     fn;
+    };
+
+    // Start the worker on first use; false when there is no thread to run on.
+    bool EnsureThread();
+    void Run();
+
+    std::thread                 thread_;
+    std::mutex                  mutex_;
+    std::condition_variable     cv_;
+    std::optional<Job>          pending_;
+    std::optional<PreviewImage> ready_;
+    std::atomic<bool>           cancel_{ false };
+    std::atomic<bool>           busy_{ false };
+    bool                        quit_       = false;
+    std::uint64_t               nextSerial_ = 0;
+};
+
+} // namespace pelpaint::tools
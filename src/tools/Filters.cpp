@@ -0,0 +1,386 @@
+#include "Filters.hpp"
+
+#include <algorithm>
+
+#include "BlockStats.hpp"
+#include "ColorMatch.hpp"
+#include "ColorPipeline.hpp"
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::tools {
+
+namespace {
+
+[[nodiscard]] bool Cancelled(const std::atomic<bool>* cancel) noexcept
+{
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+// Spread an error term to every neighbour inside a (2*spreadX+1) ×
+// (2*spreadY+1) window, scaled by divisor / totalWeight.
+void DiffuseError(std::span<Pixel> pixels, int width, int height,
+                  int x, int y, int errorR, int errorG, int errorB,
+                  int spreadX, int spreadY, int divisor, int totalWeight) noexcept
+{
+    for (int dy = -spreadY; dy <= spreadY; ++dy) {
+        for (int dx = -spreadX; dx <= spreadX; ++dx) {
+            if (dx == 0 && dy == 0) continue; // Skip the current pixel
+
+            const int nx = x + dx;
+            const int ny = y + dy;
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+
+            Pixel& neighbor = pixels[static_cast<std::size_t>(ny) * width + nx];
+            // Apply clamped error diffusion to avoid overflow/underflow
+            neighbor.r = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.r) + (errorR * divisor) / totalWeight, 0, 255));
+            neighbor.g = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.g) + (errorG * divisor) / totalWeight, 0, 255));
+            neighbor.b = static_cast<uint8_t>(std::clamp(static_cast<int>(neighbor.b) + (errorB * divisor) / totalWeight, 0, 255));
+        }
+    }
+}
+
+void DiffuseKernel(std::span<Pixel> pixels, int width, int height,
+                   const PaletteMatcher& matcher,
+                   int spread, int divisor, int totalWeight,
+                   const std::atomic<bool>* cancel) noexcept
+{
+    for (int y = 0; y < height; ++y) {
+        if (Cancelled(cancel)) return;
+        for (int x = 0; x < width; ++x) {
+            Pixel& currentPixel = pixels[static_cast<std::size_t>(y) * width + x];
+            const Pixel closestColor = matcher.Nearest(currentPixel);
+
+            const int errorR = currentPixel.r - closestColor.r;
+            const int errorG = currentPixel.g - closestColor.g;
+            const int errorB = currentPixel.b - closestColor.b;
+
+            currentPixel = closestColor;
+
+            DiffuseError(pixels, width, height, x, y, errorR, errorG, errorB,
+                         spread, spread, divisor, totalWeight);
+        }
+    }
+}
+
+} // namespace
+
+// ============================================================
+// Palette lookup
+// ============================================================
+
+Pixel FindNearestColor(const Pixel& color, std::span<const Pixel> palette) noexcept
+{
+    if (palette.empty()) return color;
+
+    // Squared distance orders identically to ColorDistance (no sqrt needed).
+    auto dist2 = [&color](const Pixel& p) noexcept {
+        const int dr = static_cast<int>(color.r) - static_cast<int>(p.r);
+        const int dg = static_cast<int>(color.g) - static_cast<int>(p.g);
+        const int db = static_cast<int>(color.b) - static_cast<int>(p.b);
+        const int da = static_cast<int>(color.a) - static_cast<int>(p.a);
+        return dr * dr + dg * dg + db * db + da * da;
+    };
+
+    std::size_t nearest = 0;
+    int         minDist = dist2(palette[0]);
+    for (std::size_t i = 1; i < palette.size(); ++i) {
+        const int d = dist2(palette[i]);
+        if (d < minDist) {
+            minDist = d;
+            nearest = i;
+        }
+    }
+    return palette[nearest];
+}
+
+// ============================================================
+// Point filters — single-stage ColorPipeline runs
+// ============================================================
+
+void ConvertToGrayscale(std::span<Pixel> pixels, const std::atomic<bool>* cancel)
+{
+    ColorPipeline().Grayscale().Apply(pixels, cancel);
+}
+
+void ApplyPalette(std::span<Pixel> pixels, std::span<const Pixel> palette,
+                  ColorMatchMode match, const std::atomic<bool>* cancel)
+{
+    ColorPipeline().PaletteMap(palette, match).Apply(pixels, cancel);
+}
+
+// ============================================================
+// Error diffusion (inherently serial — row order matters)
+// ============================================================
+
+void ApplyFloydSteinbergDithering(std::span<Pixel> pixels, int width, int height,
+                                  std::span<const Pixel> palette,
+                                  bool preserveAlpha,
+                                  ColorMatchMode match,
+                                  const std::atomic<bool>* cancel)
+{
+    const PaletteMatcher matcher(palette, match);
+    auto at = [&](int x, int y) -> Pixel& {
+        return pixels[static_cast<std::size_t>(y) * width + x];
+    };
+    auto spread = [](Pixel& n, int eR, int eG, int eB, int w) {
+        n.r = static_cast<uint8_t>(std::clamp(static_cast<int>(n.r) + eR * w / 16, 0, 255));
+        n.g = static_cast<uint8_t>(std::clamp(static_cast<int>(n.g) + eG * w / 16, 0, 255));
+        n.b = static_cast<uint8_t>(std::clamp(static_cast<int>(n.b) + eB * w / 16, 0, 255));
+    };
+
+    for (int y = 0; y < height; ++y) {
+        if (Cancelled(cancel)) return;
+        for (int x = 0; x < width; ++x) {
+            const Pixel oldPixel = at(x, y);
+            Pixel newPixel = matcher.Nearest(oldPixel);
+
+            if (preserveAlpha) {
+                newPixel.a = oldPixel.a;
+            }
+
+            at(x, y) = newPixel;
+
+            const int errorR = static_cast<int>(oldPixel.r) - static_cast<int>(newPixel.r);
+            const int errorG = static_cast<int>(oldPixel.g) - static_cast<int>(newPixel.g);
+            const int errorB = static_cast<int>(oldPixel.b) - static_cast<int>(newPixel.b);
+
+            if (x + 1 < width) spread(at(x + 1, y), errorR, errorG, errorB, 7);
+
+            if (y + 1 < height) {
+                if (x - 1 >= 0) spread(at(x - 1, y + 1), errorR, errorG, errorB, 3);
+                spread(at(x, y + 1), errorR, errorG, errorB, 5);
+                if (x + 1 < width) spread(at(x + 1, y + 1), errorR, errorG, errorB, 1);
+            }
+        }
+    }
+}
+
+void ApplyAtkinsonDithering(std::span<Pixel> pixels, int width, int height,
+                            std::span<const Pixel> palette,
+                            ColorMatchMode match,
+                            const std::atomic<bool>* cancel)
+{
+    DiffuseKernel(pixels, width, height, PaletteMatcher(palette, match), 1, 1, 8, cancel);   // Atkinson pattern
+}
+
+void ApplyStuckiDithering(std::span<Pixel> pixels, int width, int height,
+                          std::span<const Pixel> palette,
+                          ColorMatchMode match,
+                          const std::atomic<bool>* cancel)
+{
+    DiffuseKernel(pixels, width, height, PaletteMatcher(palette, match), 2, 2, 42, cancel);  // Stucki pattern
+}
+
+// ============================================================
+// Ordered dithering (per-pixel independent → parallel rows)
+// ============================================================
+
+void ApplyOrderedDithering(std::span<Pixel> pixels, int width, int height,
+                           std::span<const Pixel> palette,
+                           bool preserveAlpha,
+                           ColorMatchMode match,
+                           const std::atomic<bool>* cancel)
+{
+    const PaletteMatcher matcher(palette, match);
+    constexpr int ditherPatternSize = 4;
+    constexpr int ditherPattern[4][4] = {
+        {0, 8, 2, 10},
+        {12, 4, 14, 6},
+        {3, 11, 1, 9},
+        {15, 7, 13, 5}
+    };
+
+    core::ParallelFor(0, static_cast<std::size_t>(height), [&](std::size_t y0, std::size_t y1) {
+        for (std::size_t y = y0; y < y1; ++y) {
+            if (Cancelled(cancel)) return;
+            Pixel* row = pixels.data() + y * static_cast<std::size_t>(width);
+            for (int x = 0; x < width; ++x) {
+                const Pixel pixel = row[x];
+                const int ditherValue = ditherPattern[y % ditherPatternSize][x % ditherPatternSize];
+
+                Pixel ditheredPixel;
+                ditheredPixel.r = static_cast<uint8_t>(std::clamp(static_cast<int>(pixel.r) + ditherValue - 8, 0, 255));
+                ditheredPixel.g = static_cast<uint8_t>(std::clamp(static_cast<int>(pixel.g) + ditherValue - 8, 0, 255));
+                ditheredPixel.b = static_cast<uint8_t>(std::clamp(static_cast<int>(pixel.b) + ditherValue - 8, 0, 255));
+                ditheredPixel.a = pixel.a;
+
+                Pixel quantized = matcher.Nearest(ditheredPixel);
+                if (preserveAlpha) {
+                    quantized.a = pixel.a;
+                }
+                row[x] = quantized;
+            }
+        }
+    }, 8);
+}
+
+// ============================================================
+// Block filters
+// ============================================================
+
+void ApplyPixelify(std::span<Pixel> pixels, int width, int height,
+                   int blockSize,
+                   std::span<const Pixel> palette,
+                   ColorMatchMode match,
+                   const std::atomic<bool>* cancel)
+{
+    if (blockSize < 1 || width <= 0 || height <= 0) return;
+
+    BlockGrid blocks;
+    {
+        SummedAreaTable sat;
+        sat.Build(pixels, width, height);
+        if (Cancelled(cancel)) return;
+        ComputeBlockMeans(sat, blockSize, blocks);
+    }   // table released before the write pass
+
+    const PaletteMatcher matcher(palette, match);
+
+    core::ParallelFor(0, static_cast<std::size_t>(blocks.blocksY),
+        [&](std::size_t by0, std::size_t by1) {
+            for (std::size_t by = by0; by < by1; ++by) {
+                if (Cancelled(cancel)) return;
+                const int blockY = static_cast<int>(by) * blockSize;
+                const int maxY   = std::min(blockY + blockSize, height);
+
+                for (int bx = 0; bx < blocks.blocksX; ++bx) {
+                    // Averaged, optionally palette-quantised block colour
+                    const Pixel averageColor =
+                        matcher.Nearest(blocks.At(bx, static_cast<int>(by)));
+
+                    const int blockX = bx * blockSize;
+                    const int maxX   = std::min(blockX + blockSize, width);
+                    for (int y = blockY; y < maxY; ++y) {
+                        Pixel* row = pixels.data() + static_cast<std::size_t>(y) * width;
+                        std::fill(row + blockX, row + maxX, averageColor);
+                    }
+                }
+            }
+        }, 2);
+}
+
+void ApplyShapeRedraw(std::span<Pixel> pixels, int width, int height,
+                      const ShapeRedrawParams& params,
+                      const std::atomic<bool>* cancel)
+{
+    if (width <= 0 || height <= 0) return;
+
+    const int blockSize = std::max(1, params.blockSize);
+    const int padding   = std::max(0, params.padding);
+
+    BlockGrid blocks;
+    {
+        SummedAreaTable sat;
+        sat.Build(pixels, width, height);
+        if (Cancelled(cancel)) return;
+        ComputeBlockMeans(sat, blockSize, blocks);
+    }
+
+    const PaletteMatcher matcher(params.palette, params.match);
+
+    core::ParallelFor(0, static_cast<std::size_t>(blocks.blocksY),
+        [&](std::size_t by0, std::size_t by1) {
+            for (std::size_t by = by0; by < by1; ++by) {
+                if (Cancelled(cancel)) return;
+                const int blockY = static_cast<int>(by) * blockSize;
+                const int maxY   = std::min(blockY + blockSize, height);
+
+                // Clear this block row to the background colour.
+                std::fill(pixels.begin() + static_cast<std::ptrdiff_t>(blockY) * width,
+                          pixels.begin() + static_cast<std::ptrdiff_t>(maxY)   * width,
+                          params.bgColor);
+
+                for (int bx = 0; bx < blocks.blocksX; ++bx) {
+                    const int blockX = bx * blockSize;
+                    const int maxX   = std::min(blockX + blockSize, width);
+
+                    const Pixel avgColor =
+                        matcher.Nearest(blocks.At(bx, static_cast<int>(by)));
+
+                    // Inner drawable area: block minus padding on all sides
+                    const int innerX0 = blockX + padding;
+                    const int innerY0 = blockY + padding;
+                    const int innerX1 = maxX  - padding;
+                    const int innerY1 = maxY  - padding;
+                    if (innerX1 <= innerX0 || innerY1 <= innerY0) continue;
+
+                    const int innerW = innerX1 - innerX0;
+                    const int innerH = innerY1 - innerY0;
+                    const int cx = innerX0 + innerW / 2;
+                    const int cy = innerY0 + innerH / 2;
+                    const int radius = std::min(innerW, innerH) / 2;
+
+                    auto plot = [&](int px, int py) {
+                        if (px >= blockX && px < maxX && py >= blockY && py < maxY)
+                            pixels[static_cast<std::size_t>(py) * width + px] = avgColor;
+                    };
+
+                    switch (params.mode) {
+                        case ShapeRedrawFilterMode::Square: {
+                            for (int y = innerY0; y < innerY1; ++y) {
+                                Pixel* row = pixels.data() + static_cast<std::size_t>(y) * width;
+                                std::fill(row + innerX0, row + innerX1, avgColor);
+                            }
+                            break;
+                        }
+                        case ShapeRedrawFilterMode::Dot: {
+                            for (int dy = -radius; dy <= radius; ++dy) {
+                                for (int dx = -radius; dx <= radius; ++dx) {
+                                    if (dx * dx + dy * dy <= radius * radius)
+                                        plot(cx + dx, cy + dy);
+                                }
+                            }
+                            break;
+                        }
+                        case ShapeRedrawFilterMode::Custom: {
+                            // Stamp the 8x8 custom map, scaled to fit innerW x innerH
+                            const int pw = std::max(1, innerW / 8);
+                            const int ph = std::max(1, innerH / 8);
+                            for (int row = 0; row < 8; ++row) {
+                                for (int col = 0; col < 8; ++col) {
+                                    if (!params.customMap[row * 8 + col]) continue;
+                                    const int px = innerX0 + (col * innerW) / 8;
+                                    const int py = innerY0 + (row * innerH) / 8;
+                                    for (int oy = 0; oy < ph; ++oy)
+                                        for (int ox = 0; ox < pw; ++ox)
+                                            plot(px + ox, py + oy);
+                                }
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+        }, 2);
+}
+
+// ============================================================
+// Adjustment layers
+// ============================================================
+
+void ApplyAdjustment(const Adjustment& adjustment,
+                     std::span<Pixel> pixels, int width, int height,
+                     const std::atomic<bool>* cancel)
+{
+    switch (adjustment.type) {
+        case AdjustmentType::Grayscale:
+            ConvertToGrayscale(pixels, cancel);
+            break;
+        case AdjustmentType::PaletteMap:
+            ApplyPalette(pixels, adjustment.palette, adjustment.match, cancel);
+            break;
+        case AdjustmentType::OrderedDither:
+            if (adjustment.palette.empty()) break;
+            ApplyOrderedDithering(pixels, width, height, adjustment.palette,
+                                  adjustment.preserveAlpha, adjustment.match, cancel);
+            break;
+        case AdjustmentType::Pixelify:
+            ApplyPixelify(pixels, width, height, adjustment.blockSize,
+                          adjustment.palette, adjustment.match, cancel);
+            break;
+        case AdjustmentType::None:
+            break;
+    }
+}
+
+} // namespace pelpaint::tools
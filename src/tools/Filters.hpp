@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// Filter kernels
+//
+// Buffer-level implementations of the Filter-tab effects.  They operate on a
+// plain row-major RGBA span (width * height entries) so the same code runs on
+// a full-resolution layer (PixelPaintView::Apply*) and on a downsampled
+// preview proxy (FilterPreview).  No undo, no dirty flags, no ImGui.
+//
+// cancel — optional; polled between rows.  When it reads true the kernel
+//          returns early and leaves the buffer partially processed (callers
+//          discard the result).
+// palette — an empty span means "no quantisation" where that is optional.
+// match   — palette distance metric (ColorMatchMode, core/Types.hpp).  Rgb
+//           is the default; Oklab is perceptual at a small extra cost.
+// ---------------------------------------------------------------------------
+
+// Nearest palette entry by RGBA Euclidean distance (same metric as
+// ColorDistance).  Returns color unchanged for an empty palette.
+[[nodiscard]] Pixel FindNearestColor(const Pixel& color,
+                                     std::span<const Pixel> palette) noexcept;
+
+void ConvertToGrayscale(std::span<Pixel> pixels,
+                        const std::atomic<bool>* cancel = nullptr);
+
+void ApplyPalette(std::span<Pixel> pixels,
+                  std::span<const Pixel> palette,
+                  ColorMatchMode match = ColorMatchMode::Rgb,
+                  const std::atomic<bool>* cancel = nullptr);
+
+void ApplyFloydSteinbergDithering(std::span<Pixel> pixels, int width, int height,
+                                  std::span<const Pixel> palette,
+                                  bool preserveAlpha,
+                                  ColorMatchMode match = ColorMatchMode::Rgb,
+                                  const std::atomic<bool>* cancel = nullptr);
+
+void ApplyAtkinsonDithering(std::span<Pixel> pixels, int width, int height,
+                            std::span<const Pixel> palette,
+                            ColorMatchMode match = ColorMatchMode::Rgb,
+                            const std::atomic<bool>* cancel = nullptr);
+
+void ApplyStuckiDithering(std::span<Pixel> pixels, int width, int height,
+                          std::span<const Pixel> palette,
+                          ColorMatchMode match = ColorMatchMode::Rgb,
+                          const std::atomic<bool>* cancel = nullptr);
+
+void ApplyOrderedDithering(std::span<Pixel> pixels, int width, int height,
+                           std::span<const Pixel> palette,
+                           bool preserveAlpha,
+                           ColorMatchMode match = ColorMatchMode::Rgb,
+                           const std::atomic<bool>* cancel = nullptr);
+
+// Block-average pixelation (summed-area table, block rows in parallel,
+// written in place).  palette may be empty.
+void ApplyPixelify(std::span<Pixel> pixels, int width, int height,
+                   int blockSize,
+                   std::span<const Pixel> palette,
+                   ColorMatchMode match = ColorMatchMode::Rgb,
+                   const std::atomic<bool>* cancel = nullptr);
+
+struct ShapeRedrawParams {
+    ShapeRedrawFilterMode   mode      = ShapeRedrawFilterMode::Square;
+    Pixel                   bgColor   = Pixel(0, 0, 0, 255);
+    int                     blockSize = 8;
+    int                     padding   = 1;
+    std::span<const Pixel>  palette;            // empty → no quantisation
+    ColorMatchMode          match     = ColorMatchMode::Rgb;
+    std::array<bool, 64>    customMap = {};     // 8×8 stamp for Custom mode
+};
+
+// Per-block shape stamp (square / dot / custom 8×8) on a background fill.
+// Stamps are clipped to their own block.
+void ApplyShapeRedraw(std::span<Pixel> pixels, int width, int height,
+                      const ShapeRedrawParams& params,
+                      const std::atomic<bool>* cancel = nullptr);
+
+// Evaluate one adjustment-layer operation in place (Adjustment, core/Types.hpp).
+// The ordered-dither phase and the pixelify block grid start at the buffer
+// origin, so callers evaluating per tile must pass tile-aligned buffers.
+void ApplyAdjustment(const Adjustment& adjustment,
+                     std::span<Pixel> pixels, int width, int height,
+                     const std::atomic<bool>* cancel = nullptr);
+
+} // namespace pelpaint::tools
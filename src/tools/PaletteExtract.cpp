@@ -0,0 +1,381 @@
+#include "PaletteExtract.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <tuple>
+
+#include "../core/Parallel.hpp"
+
+namespace pelpaint::tools {
+
+namespace {
+
+constexpr int kBinBits = 5;
+constexpr int kBins    = 1 << (3 * kBinBits);
+
+// A histogram bin reduced to its mean colour and pixel count.
+struct Point {
+    float r = 0, g = 0, b = 0;
+    float weight = 0;
+};
+
+[[nodiscard]] float Channel(const Point& p, int axis) noexcept
+{
+    return axis == 0 ? p.r : axis == 1 ? p.g : p.b;
+}
+
+[[nodiscard]] float DistanceSq(const Point& a, const Point& b) noexcept
+{
+    const float dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+    return dr * dr + dg * dg + db * db;
+}
+
+// Stride-sample opaque pixels into 5:5:5 bins and return one weighted point
+// per occupied bin, located at the mean of the colours that fell into it.
+[[nodiscard]] std::vector<Point> SampleHistogram(std::span<const Pixel> pixels, std::size_t maxSamples)
+{
+    struct Bin {
+        std::uint32_t count = 0;
+        std::uint64_t r = 0, g = 0, b = 0;
+    };
+    std::vector<Bin> bins(kBins);
+
+    const std::size_t stride = std::max<std::size_t>(1, pixels.size() / std::max<std::size_t>(1, maxSamples));
+    for (std::size_t i = 0; i < pixels.size(); i += stride) {
+        const Pixel& p = pixels[i];
+        if (p.a < 128) continue;
+        const std::size_t index = (static_cast<std::size_t>(p.r >> (8 - kBinBits)) << (2 * kBinBits))
+                                | (static_cast<std::size_t>(p.g >> (8 - kBinBits)) << kBinBits)
+                                |  static_cast<std::size_t>(p.b >> (8 - kBinBits));
+        Bin& bin = bins[index];
+        ++bin.count;
+        bin.r += p.r;
+        bin.g += p.g;
+        bin.b += p.b;
+    }
+
+    std::vector<Point> points;
+    for (const Bin& bin : bins) {
+        if (bin.count == 0) continue;
+        const float n = static_cast<float>(bin.count);
+        points.push_back({ static_cast<float>(bin.r) / n, static_cast<float>(bin.g) / n,
+                           static_cast<float>(bin.b) / n, n });
+    }
+    return points;
+}
+
+[[nodiscard]] Point WeightedMean(std::span<const Point> points)
+{
+    double r = 0, g = 0, b = 0, w = 0;
+    for (const Point& p : points) {
+        r += p.r * p.weight;
+        g += p.g * p.weight;
+        b += p.b * p.weight;
+        w += p.weight;
+    }
+    if (w <= 0) return {};
+    return { static_cast<float>(r / w), static_cast<float>(g / w), static_cast<float>(b / w),
+             static_cast<float>(w) };
+}
+
+// ============================================================
+// Median cut
+// ============================================================
+
+[[nodiscard]] std::vector<Point> MedianCut(std::vector<Point> points, std::size_t k)
+{
+    struct Box {
+        std::size_t begin = 0, end = 0;
+        int         axis  = 0;
+        float       range = 0;
+    };
+
+    const auto measure = [&](Box& box) {
+        std::array<float, 3> lo{ 255, 255, 255 }, hi{ 0, 0, 0 };
+        for (std::size_t i = box.begin; i < box.end; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = std::min(lo[a], Channel(points[i], a));
+                hi[a] = std::max(hi[a], Channel(points[i], a));
+            }
+        }
+        box.axis  = 0;
+        box.range = hi[0] - lo[0];
+        for (int a = 1; a < 3; ++a) {
+            if (hi[a] - lo[a] > box.range) {
+                box.axis  = a;
+                box.range = hi[a] - lo[a];
+            }
+        }
+    };
+
+    std::vector<Box> boxes{ Box{ 0, points.size() } };
+    measure(boxes.front());
+
+    while (boxes.size() < k) {
+        // Split the widest box that still holds more than one colour.
+        Box* widest = nullptr;
+        for (Box& box : boxes)
+            if (box.end - box.begin > 1 && (!widest || box.range > widest->range)) widest = &box;
+        if (!widest || widest->range <= 0) break;
+
+        const auto first = points.begin() + static_cast<std::ptrdiff_t>(widest->begin);
+        const auto last  = points.begin() + static_cast<std::ptrdiff_t>(widest->end);
+        const int  axis  = widest->axis;
+        std::sort(first, last, [axis](const Point& a, const Point& b) { return Channel(a, axis) < Channel(b, axis); });
+
+        // Weighted median, kept strictly inside the box so both halves are non-empty.
+        float total = 0;
+        for (auto it = first; it != last; ++it) total += it->weight;
+        float       running = 0;
+        std::size_t split   = widest->begin + 1;
+        for (std::size_t i = widest->begin; i < widest->end - 1; ++i) {
+            running += points[i].weight;
+            split = i + 1;
+            if (running >= total * 0.5f) break;
+        }
+
+        Box upper{ split, widest->end };
+        widest->end = split;
+        measure(*widest);
+        measure(upper);
+        boxes.push_back(upper);
+    }
+
+    std::vector<Point> centres;
+    centres.reserve(boxes.size());
+    for (const Box& box : boxes)
+        centres.push_back(WeightedMean(std::span(points).subspan(box.begin, box.end - box.begin)));
+    return centres;
+}
+
+// ============================================================
+// Octree
+// ============================================================
+
+[[nodiscard]] std::vector<Point> Octree(std::span<const Point> points, std::size_t k)
+{
+    constexpr int kDepth = 6;
+
+    struct Node {
+        std::array<std::int32_t, 8> children;
+        double r = 0, g = 0, b = 0, weight = 0;
+        bool   leaf = false;
+        Node() { children.fill(-1); }
+    };
+
+    std::vector<Node>                             nodes(1);
+    std::array<std::vector<std::int32_t>, kDepth> levels;   // interior nodes per level
+    std::size_t                                   leaves = 0;
+    levels[0].push_back(0);
+
+    for (const Point& p : points) {
+        const int r = static_cast<int>(p.r + 0.5f), g = static_cast<int>(p.g + 0.5f), b = static_cast<int>(p.b + 0.5f);
+        std::int32_t node = 0;
+        for (int level = 0; level < kDepth && !nodes[node].leaf; ++level) {
+            const int shift = 7 - level;
+            const int child = ((r >> shift) & 1) << 2 | ((g >> shift) & 1) << 1 | ((b >> shift) & 1);
+            std::int32_t next = nodes[node].children[child];
+            if (next < 0) {
+                next = static_cast<std::int32_t>(nodes.size());
+                nodes.emplace_back();
+                if (level + 1 == kDepth) {
+                    nodes.back().leaf = true;
+                    ++leaves;
+                } else {
+                    levels[level + 1].push_back(next);
+                }
+                nodes[node].children[child] = next;
+            }
+            node = next;
+        }
+        Node& n = nodes[node];
+        n.r      += static_cast<double>(p.r) * p.weight;
+        n.g      += static_cast<double>(p.g) * p.weight;
+        n.b      += static_cast<double>(p.b) * p.weight;
+        n.weight += p.weight;
+    }
+
+    // Subtree weight of every node, children before parents (nodes are
+    // always appended after their parent).
+    std::vector<double> subtree(nodes.size());
+    for (std::size_t i = nodes.size(); i-- > 0;) {
+        subtree[i] = nodes[i].weight;
+        for (std::int32_t c : nodes[i].children)
+            if (c >= 0) subtree[i] += subtree[c];
+    }
+
+    // Fold the lightest interior node of the deepest level into a leaf until
+    // at most k leaves remain.
+    for (int level = kDepth - 1; level >= 0 && leaves > k; --level) {
+        std::vector<std::int32_t>& candidates = levels[level];
+        std::sort(candidates.begin(), candidates.end(),
+                  [&](std::int32_t a, std::int32_t b) { return subtree[a] < subtree[b]; });
+        for (std::int32_t index : candidates) {
+            if (leaves <= k) break;
+            Node& n = nodes[index];
+            std::size_t merged = 0;
+            for (std::int32_t& c : n.children) {
+                if (c < 0) continue;
+                n.r      += nodes[c].r;
+                n.g      += nodes[c].g;
+                n.b      += nodes[c].b;
+                n.weight += nodes[c].weight;
+                c = -1;
+                ++merged;
+            }
+            n.leaf = true;
+            leaves = leaves - merged + 1;
+        }
+    }
+
+    std::vector<Point> centres;
+    std::vector<std::int32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const Node& n = nodes[stack.back()];
+        stack.pop_back();
+        if (n.leaf) {
+            if (n.weight > 0)
+                centres.push_back({ static_cast<float>(n.r / n.weight), static_cast<float>(n.g / n.weight),
+                                    static_cast<float>(n.b / n.weight), static_cast<float>(n.weight) });
+            continue;
+        }
+        for (std::int32_t c : n.children)
+            if (c >= 0) stack.push_back(c);
+    }
+    return centres;
+}
+
+// ============================================================
+// k-means
+// ============================================================
+
+// k-means++: each further seed is drawn with probability ∝ weight·D².
+// Seeded deterministically so the same image gives the same palette.
+[[nodiscard]] std::vector<Point> KMeansSeeds(std::span<const Point> points, std::size_t k)
+{
+    std::mt19937 rng(0x9e3779b9u);
+
+    std::vector<Point> seeds;
+    std::vector<float> nearest(points.size(), std::numeric_limits<float>::max());
+
+    std::vector<double> score(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) score[i] = points[i].weight;
+    seeds.push_back(points[std::discrete_distribution<std::size_t>(score.begin(), score.end())(rng)]);
+
+    while (seeds.size() < k) {
+        double total = 0;
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            nearest[i] = std::min(nearest[i], DistanceSq(points[i], seeds.back()));
+            score[i]   = static_cast<double>(nearest[i]) * points[i].weight;
+            total     += score[i];
+        }
+        if (total <= 0) break;   // every point already coincides with a seed
+
+        double pick = std::uniform_real_distribution<double>(0.0, total)(rng);
+        std::size_t chosen = points.size() - 1;
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            pick -= score[i];
+            if (pick < 0 && score[i] > 0) {
+                chosen = i;
+                break;
+            }
+        }
+        seeds.push_back(points[chosen]);
+    }
+    return seeds;
+}
+
+// Lloyd iterations.  Assignment is the O(points × k) part and runs in
+// parallel; the centroid update is a cheap serial pass.
+void Lloyd(std::span<const Point> points, std::vector<Point>& centres, int iterations)
+{
+    if (centres.empty()) return;
+
+    std::vector<std::uint16_t> assignment(points.size(), std::numeric_limits<std::uint16_t>::max());
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        std::atomic<bool> moved{ false };
+        core::ParallelFor(0, points.size(), [&](std::size_t lo, std::size_t hi) {
+            bool localMoved = false;
+            for (std::size_t i = lo; i < hi; ++i) {
+                std::uint16_t best     = 0;
+                float         bestDist = std::numeric_limits<float>::max();
+                for (std::size_t c = 0; c < centres.size(); ++c) {
+                    const float d = DistanceSq(points[i], centres[c]);
+                    if (d < bestDist) {
+                        bestDist = d;
+                        best     = static_cast<std::uint16_t>(c);
+                    }
+                }
+                if (assignment[i] != best) {
+                    assignment[i] = best;
+                    localMoved    = true;
+                }
+            }
+            if (localMoved) moved.store(true, std::memory_order_relaxed);
+        }, 1024);
+        if (!moved.load()) break;
+
+        std::vector<std::array<double, 4>> sums(centres.size(), { 0, 0, 0, 0 });
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            auto& s = sums[assignment[i]];
+            s[0] += points[i].r * points[i].weight;
+            s[1] += points[i].g * points[i].weight;
+            s[2] += points[i].b * points[i].weight;
+            s[3] += points[i].weight;
+        }
+        for (std::size_t c = 0; c < centres.size(); ++c) {
+            if (sums[c][3] <= 0) continue;   // empty cluster keeps its position
+            centres[c] = { static_cast<float>(sums[c][0] / sums[c][3]), static_cast<float>(sums[c][1] / sums[c][3]),
+                           static_cast<float>(sums[c][2] / sums[c][3]), static_cast<float>(sums[c][3]) };
+        }
+    }
+}
+
+} // namespace
+
+std::vector<Pixel> ExtractPalette(std::span<const Pixel> pixels, const PaletteExtractOptions& options)
+{
+    const std::size_t k = static_cast<std::size_t>(std::clamp(options.colors, 1, 256));
+
+    const std::vector<Point> points = SampleHistogram(pixels, options.maxSamples);
+    if (points.empty()) return {};
+
+    std::vector<Point> centres;
+    int                iterations = std::max(options.refineIterations, 0);
+    if (points.size() <= k) {
+        centres    = points;   // fewer distinct colours than requested
+        iterations = 0;
+    } else {
+        switch (options.method) {
+            case PaletteExtractMethod::MedianCut: centres = MedianCut(points, k); break;
+            case PaletteExtractMethod::Octree:    centres = Octree(points, k);    break;
+            case PaletteExtractMethod::KMeans:
+                centres    = KMeansSeeds(points, k);
+                iterations = std::max(iterations, 8);
+                break;
+        }
+    }
+    Lloyd(points, centres, iterations);
+
+    std::vector<Pixel> palette;
+    palette.reserve(centres.size());
+    for (const Point& c : centres) {
+        const auto byte = [](float v) { return static_cast<std::uint8_t>(std::clamp(std::lround(v), 0L, 255L)); };
+        const Pixel p(byte(c.r), byte(c.g), byte(c.b), 255);
+        if (std::find(palette.begin(), palette.end(), p) == palette.end()) palette.push_back(p);
+    }
+
+    std::sort(palette.begin(), palette.end(), [](const Pixel& a, const Pixel& b) {
+        const int la = 299 * a.r + 587 * a.g + 114 * a.b;
+        const int lb = 299 * b.r + 587 * b.g + 114 * b.b;
+        return la != lb ? la < lb : std::tie(a.r, a.g, a.b) < std::tie(b.r, b.g, b.b);
+    });
+    return palette;
+}
+
+} // namespace pelpaint::tools
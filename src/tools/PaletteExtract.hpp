@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "../core/Types.hpp"
+
+namespace pelpaint::tools {
+
+// ---------------------------------------------------------------------------
+// Palette extraction
+//
+// Derives an N-colour palette from an image.  All methods work on a sampled,
+// 15-bit (5:5:5) colour histogram rather than on raw pixels, so cost depends
+// on maxSamples and the number of distinct colours — not on image size.
+//
+//   MedianCut — recursively split the colour box with the widest weighted
+//               range at its weighted median.
+//   Octree    — classic octree quantiser; least-populated branches are
+//               folded into their parent until N leaves remain.
+//   KMeans    — k-means++ seeding followed by Lloyd iterations.  The
+//               assignment step runs in parallel.
+//
+// refineIterations > 0 runs that many Lloyd iterations on the MedianCut /
+// Octree result as well.  Pixels with alpha < 128 are ignored.  Output
+// colours are opaque and sorted by luma; the result is suitable for
+// customPalette.
+// ---------------------------------------------------------------------------
+
+enum class PaletteExtractMethod {
+    MedianCut,
+    Octree,
+    KMeans,
+};
+
+struct PaletteExtractOptions {
+    PaletteExtractMethod method           = PaletteExtractMethod::MedianCut;
+    int                  colors           = 16;
+    std::size_t          maxSamples       = std::size_t{1} << 18;
+    int                  refineIterations = 0;   // KMeans always runs at least 8
+};
+
+[[nodiscard]] std::vector<Pixel> ExtractPalette(std::span<const Pixel> pixels,
+                                                const PaletteExtractOptions& options);
+
+} // namespace pelpaint::tools
@@ -235,7 +235,8 @@ inline bool LayerPanel(std::vector<pelpaint::Layer>& layers,
             std::string layerLabel =
                 (layer.visible ? "[V] " : "[ ] ") +
                 layer.name +
-                " (z:" + std::to_string(layer.zIndex) + ")";
+                " (z:" + std::to_string(layer.zIndex) + ")" +
+                (layer.damaged ? " [damaged]" : "");
 
             ImGui::PushID(i);
 